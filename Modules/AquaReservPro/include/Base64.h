@@ -10,6 +10,7 @@ class Base64 {
 public:
     static String encode(const byte* data, size_t size);
     static String decode(const String& data);
+    static size_t decode(const String& data, byte* out, size_t maxLen); // Données binaires
 };
 
 #endif
@@ -0,0 +1,47 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_partition.h>
+#include "config.h"
+#include "FuotaCodec.h"
+
+// États d'une session de mise à jour, tels que rapportés à la passerelle (FSTAT "st")
+enum FuotaState {
+    FUOTA_IDLE = -1,
+    FUOTA_RECEIVING = 0,
+    FUOTA_VERIFIED = 1,   // Image complète, empreinte vérifiée, partition de démarrage basculée
+    FUOTA_FAILED = 2
+};
+
+// Réception d'une image de firmware diffusée par la passerelle.
+// Les générations décodées sont écrites directement à leur place dans la partition OTA
+// inactive (effacée à l'ouverture de la session) : l'ordre d'arrivée est indifférent.
+// Utilisé uniquement par la tâche LoRa.
+class FuotaClient {
+public:
+    bool begin(uint8_t sessionId, uint32_t imageSize, const uint8_t* sha256);
+    void abort();
+    bool isActive() const { return state != FUOTA_IDLE; }
+    FuotaState getState() const { return state; }
+    uint8_t getSessionId() const { return sessionId; }
+    unsigned long getLastActivity() const { return lastActivity; }
+    void touch() { lastActivity = millis(); }
+    void onRow(uint32_t generation, uint16_t row, const uint8_t* data, size_t length);
+    uint8_t getMissing(uint32_t* generations, uint8_t* deficits, uint8_t maxEntries, uint32_t& remaining) const;
+
+private:
+    FuotaState state = FUOTA_IDLE;
+    uint8_t sessionId = 0;
+    uint32_t imageSize = 0;
+    uint32_t generationCount = 0;
+    uint32_t completedCount = 0;
+    uint8_t expectedHash[32];
+    unsigned long lastActivity = 0;
+    const esp_partition_t* partition = nullptr;
+    uint8_t doneMap[(FUOTA_MAX_IMAGE_SIZE / FUOTA_GENERATION_SIZE + 8) / 8];
+    GenerationDecoder decoders[FUOTA_OPEN_GENERATIONS];
+    unsigned long decoderUse[FUOTA_OPEN_GENERATIONS];
+
+    bool isDone(uint32_t generation) const { return doneMap[generation / 8] & (1 << (generation % 8)); }
+    GenerationDecoder* decoderFor(uint32_t generation);
+    void finalize();
+};
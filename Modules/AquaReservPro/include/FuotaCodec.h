@@ -0,0 +1,43 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Codage des images de firmware pour les mises à jour par LoRa (FUOTA).
+// L'image est découpée en blocs de FUOTA_BLOCK_SIZE octets, regroupés en générations de
+// FUOTA_GENERATION_BLOCKS blocs. Dans une génération de n blocs, la ligne r < n est le
+// bloc r lui-même ; une ligne r >= n est le XOR d'un sous-ensemble de blocs tiré de façon
+// reproductible à partir de (génération, r) : seul l'index de ligne circule sur l'air.
+// Un module reconstitue une génération dès qu'il possède n lignes indépendantes, quelles
+// qu'elles soient : une même ligne de réparation comble des pertes différentes chez
+// des modules différents, et une mise à jour de flotte coûte à peu près une seule copie.
+
+static_assert(FUOTA_GENERATION_BLOCKS <= 32, "Les coefficients d'une ligne tiennent sur 32 bits");
+
+#define FUOTA_GENERATION_SIZE (FUOTA_BLOCK_SIZE * FUOTA_GENERATION_BLOCKS)
+
+uint32_t fuotaGenerationCount(uint32_t imageSize);
+uint8_t fuotaBlocksInGeneration(uint32_t imageSize, uint32_t generation);
+uint32_t fuotaRowMask(uint32_t generation, uint16_t row, uint8_t blocks);
+
+// Élimination de Gauss incrémentale sur GF(2) pour une génération.
+// Chaque ligne conservée a pour pivot son bit de poids faible ; la résolution
+// finale (solve) remonte les pivots pour ne laisser que les blocs d'origine.
+class GenerationDecoder {
+public:
+    void reset(uint32_t generation, uint8_t blocks);
+    bool addRow(uint32_t mask, const uint8_t* data);   // true si la ligne augmente le rang
+    bool isComplete() const { return blocks > 0 && pivots == fullMask(); }
+    uint8_t getRank() const { return __builtin_popcount(pivots); }
+    uint8_t getBlocks() const { return blocks; }
+    uint32_t getGeneration() const { return generation; }
+    const uint8_t* solve();                             // Blocs contigus, dans l'ordre
+
+private:
+    uint32_t generation;
+    uint8_t blocks = 0;
+    uint32_t pivots;
+    uint32_t masks[FUOTA_GENERATION_BLOCKS];
+    uint8_t rows[FUOTA_GENERATION_BLOCKS][FUOTA_BLOCK_SIZE];
+
+    uint32_t fullMask() const { return blocks >= 32 ? 0xFFFFFFFFUL : ((1UL << blocks) - 1); }
+};
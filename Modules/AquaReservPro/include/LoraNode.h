@@ -1,21 +1,100 @@
 #pragma once
 #include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "Fragmentation.h"
+#include "FuotaClient.h"
+#include "MessageCounter.h"
+
+// Message montant en attente d'émission par la tâche LoRa
+struct OutboundMessage {
+    char data[128];             // Objet JSON "data" déjà sérialisé
+    bool confirmed;
+    uint32_t msgCtr;            // Attribué à la première émission, réutilisé pour les nouveaux essais
+    uint8_t attempts;
+    unsigned long lastAttemptAt;
+    uint32_t retryDelayMs;
+};
+
+// Réglages du rapport, assignés par set_config (tâche LoRa) et lus par la tâche des capteurs
+struct ReportConfig {
+    uint32_t intervalMs = TELEMETRY_INTERVAL_MS; // Assigné par la passerelle : plancher du heartbeat
+    uint32_t jitterMs = 0;
+    uint32_t heartbeatMs = REPORT_HEARTBEAT_MS;  // Silence maximal sans changement de niveau
+};
+
+// Commande reçue de la passerelle, hors set_config : retourne true si elle a été appliquée
+// (la passerelle reçoit alors un ACK). Appelée depuis la tâche LoRa.
+typedef bool (*CommandCallback)(const char* method, JsonObjectConst params);
 
 class LoraNode {
 public:
     void init();
     void run();
     bool isJoined();
-    void sendTelemetry(bool isFull);
+    void sendTelemetry(bool isFull, bool confirmed = false);
+    bool queueUplink(JsonObjectConst data, bool confirmed);
+    void onCommand(CommandCallback callback);
+    bool isReportDue();
+    uint32_t getHeartbeatInterval();
+    long getFirstTxAt() const { return firstTxAt; } // millis() de la première émission, -1 sans émission
+
+    // Mode basse consommation (LOW_POWER_MODE) : pas de tâche LoRa, le module dort entre deux réveils
+    uint32_t serviceNow();            // Émet ce qui est prêt ; délai jusqu'à la prochaine échéance
+    void sleep();                     // Avant le sommeil profond : session en mémoire RTC, radio en veille
 
 private:
     uint8_t nodeId = 0;
-    uint32_t msgCounter = 0; // Compteur de messages pour la sécurité
+    MessageCounter msgCounter;        // Compteur de messages pour la sécurité (anti-rejeu)
     unsigned long lastJoinAttempt = 0;
+    unsigned long lastTelemetryTime = 0;
+    ReportConfig reportConfig;        // Sauvegardé en NVS ; modifié sous reportConfigMux par la tâche LoRa seule
+    portMUX_TYPE reportConfigMux = portMUX_INITIALIZER_UNLOCKED;
+    uint32_t nextReportJitterMs = 0;  // Gigue tirée pour le prochain envoi
+    uint32_t jitterSeed = 0;          // Graine de la gigue, tirée au démarrage ; tâche des capteurs seule
+    CommandCallback commandCallback = nullptr;
+    unsigned long nextJoinDelay = 0;  // Délai avant la prochaine tentative d'adhésion
+    uint8_t joinAttempts = 0;         // Tentatives échouées depuis le démarrage
+    uint32_t joinNonce = 0;           // Nonce du dernier JOIN_REQUEST, en NVS
+    uint32_t backoffSeed = 0;         // Graine du backoff, dérivée de l'adresse MAC ; tâche LoRa seule
+    QueueHandle_t confirmedQueue = NULL;
+    QueueHandle_t unconfirmedQueue = NULL;
+    OutboundMessage inFlight;         // Message confirmé en cours (attente d'ACK ou de nouvel essai)
+    bool hasInFlight = false;
+    uint32_t lastAckedCtr = 0;        // Compteur acquitté par le dernier ACK reçu
+    FragmentSender fragmentSender;    // Message montant trop long pour une trame
+    FragmentReassembler reassembler;  // Message descendant fragmenté en cours de réception
+    uint16_t nextTransferId = 0;      // Tiré au démarrage : un redémarrage ne réutilise pas l'identifiant précédent
+    bool fragmentProgress = false;    // Le dernier FACK reçu a acquitté de nouveaux fragments
+    FuotaClient fuota;                // Session de mise à jour du firmware en cours
+    long firstTxAt = -1;              // Jalon du démarrage : temps jusqu'au premier message
 
     void loadConfig();
     void saveConfig();
-    void performJoinRequest();
+    void restoreSession();
+    void attachRadioTask();
+    void attemptJoin();
+    bool performJoinRequest();
+    bool receiveWithTimeout(String& response, unsigned long timeoutMs);
+    void listenForDownlinks(unsigned long windowMs);
+    void handleDownlink(const String& frame);
+    void handleMessage(JsonObjectConst msg);
+    void handleFragment(JsonObjectConst frag);
+    void sendFragmentAck(uint16_t transferId, uint32_t receivedMask);
+    void serviceFuota();
+    void handleFuotaSetup(JsonObjectConst setup);
+    void sendFuotaStatus();
+    bool sendFragmented(const String& plaintext);
+    bool sendFragmentRound();
+    bool transmitPlaintext(const String& plaintext);
+    void handleCommand(JsonObjectConst cmd);
+    void serviceUplinks();
+    bool isUplinkReady();
+    TickType_t nextUplinkWait();
+    bool transmitUplink(OutboundMessage& msg);
+    void applyReportConfig(JsonObjectConst params);
+    ReportConfig readReportConfig();
+    void sendAck(uint16_t msgId);
     String encryptPayload(const String& plaintext);
     String decryptPayload(const String& b64_ciphertext);
 };
@@ -10,12 +10,98 @@
 #define LORA_BUSY 13
 #define LORA_FREQ 868.0f
 
-#define WATER_LEVEL_PIN 25 // Pin pour le capteur de contact (flotteur)
+#define WATER_LEVEL_PIN 7 // Pin pour le capteur de contact (flotteur) ; broche RTC, voir LOW_POWER_MODE
+
+// -- WiFi et interface web --
+// Démarrés en arrière-plan, après la liaison LoRa qui n'en dépend jamais. Avec WIFI_ON_DEMAND,
+// ils ne démarrent qu'à l'appui sur le bouton PRG de la carte.
+#define WIFI_ON_DEMAND 0
+#define WIFI_BUTTON_PIN 0               // Bouton PRG de la Heltec V3
 
 // -- Configuration Système --
 #define LORA_SECRET_KEY "HydrauParkSecretKey2025"
 #define TELEMETRY_INTERVAL_MS 60000 // Envoi de la télémétrie toutes les minutes
 #define LEVEL_CONFIRMATION_MS 2000 // Le contact doit être stable pendant 2s pour être confirmé
 
+// -- Mode basse consommation (env:lowpower) --
+// Sans WiFi ni interface web : le module dort en sommeil profond et se réveille sur changement
+// du contact (ext0, WATER_LEVEL_PIN doit alors être une broche RTC : GPIO 0 à 21 sur l'ESP32-S3
+// de la Heltec V3), sur la fin de la confirmation, le heartbeat ou une échéance LoRa.
+#ifndef LOW_POWER_MODE
+#define LOW_POWER_MODE 0
+#endif
+#if LOW_POWER_MODE && (WATER_LEVEL_PIN < 0 || WATER_LEVEL_PIN > 21)
+#error "LOW_POWER_MODE : WATER_LEVEL_PIN doit être une broche RTC (GPIO 0 à 21 sur l'ESP32-S3) pour le réveil ext0"
+#endif
+
+// -- Adhésion au réseau (JOIN) --
+// Backoff exponentiel avec gigue, dont la graine est dérivée de l'adresse MAC :
+// après une coupure de courant, les modules ne retentent pas tous au même instant.
+// L'étalement initial ne s'applique qu'après une mise sous tension ou une chute de tension, seules
+// à redémarrer toute une flotte d'un coup ; après un redémarrage logiciel, l'adhésion part aussitôt.
+#define JOIN_INITIAL_SPREAD_MS 10000  // Première tentative tirée dans [0, 10s] après le démarrage
+#define JOIN_BACKOFF_BASE_MS 8000     // Plafond de la première nouvelle tentative
+#define JOIN_BACKOFF_MAX_MS 300000    // Plafond maximal entre deux tentatives (5 minutes)
+#define JOIN_RX_TIMEOUT_MS 5000       // Fenêtre d'écoute du JOIN_ACCEPT
+// Nonce d'adhésion : croissant, sauvegardé avant chaque JOIN_REQUEST. La passerelle refuse un nonce
+// déjà vu (JOIN_REQUEST rejoué) et ne recale son anti-rejeu que sur un message portant le nonce de la
+// dernière adhésion, joint aux JOIN_NONCE_FRAMES premiers messages qui la suivent
+#define JOIN_NONCE_FRAMES 8
+
+// -- Intervalle de télémétrie piloté par la passerelle --
+// TELEMETRY_INTERVAL_MS n'est que la valeur par défaut : la passerelle assigne l'intervalle
+// et la gigue via la commande "set_config", appliquée immédiatement et sauvegardée en NVS.
+#define REPORT_INTERVAL_MIN_MS 10000   // Bornes de sécurité appliquées à la configuration reçue
+#define REPORT_INTERVAL_MAX_MS 3600000
+
+// -- Rapport par exception --
+// Un changement de niveau part immédiatement, seul, en message confirmé. Sans changement, l'état
+// complet n'est renvoyé qu'après REPORT_HEARTBEAT_MS de silence (jamais moins que l'intervalle
+// assigné), à garder sous le délai au-delà duquel la passerelle déclare le module hors ligne
+// (5 minutes). Réglable par set_config ({"heartbeat": ms}).
+#define REPORT_HEARTBEAT_MS 240000       // Silence maximal (4 minutes)
+
+// -- Messages montants confirmés --
+// Les événements critiques sont acquittés par la passerelle et réémis avec backoff
+// tant que l'ACK n'est pas reçu. La télémétrie périodique reste non confirmée.
+#define CONFIRMED_QUEUE_SIZE 4          // Événements confirmés en attente
+#define UNCONFIRMED_QUEUE_SIZE 2        // Télémétries périodiques en attente
+#define CONFIRMED_MAX_ATTEMPTS 6        // Émissions avant abandon (premier essai compris)
+#define CONFIRMED_BACKOFF_BASE_MS 3000
+#define CONFIRMED_BACKOFF_MAX_MS 60000
+#define NODE_RX_WINDOW_MS 1500        // Écoute après chaque émission (ACK et commandes de la passerelle)
+
+// -- Fragmentation des messages longs --
+// Au-delà de LORA_MAX_PLAINTEXT_LEN octets en clair, un message ne tient plus dans une trame
+// de 255 octets : il est découpé en fragments, et seuls ceux que la passerelle n'a pas
+// reçus (masque renvoyé dans un FACK) sont réémis.
+#define LORA_MAX_PLAINTEXT_LEN 159
+#define FRAG_CHUNK_SIZE 64               // Octets utiles par fragment
+#define FRAG_MAX_FRAGMENTS 32            // Soit 2048 octets au plus par transfert
+#define FRAG_REASSEMBLY_SLOTS 1          // Un seul transfert descendant à la fois
+#define FRAG_REASSEMBLY_TIMEOUT_MS 30000
+#define FRAG_TX_SPACING_MS 50            // Temps laissé à la passerelle entre deux fragments
+#define FRAG_RX_GAP_MS 1000              // Écoute prolongée tant que des fragments arrivent
+#define FRAG_MAX_ROUNDS 4                // Tours de réémission sans progrès avant abandon
+
+// -- Mises à jour du firmware par LoRa (FUOTA) --
+// La passerelle diffuse l'image par générations de FUOTA_GENERATION_BLOCKS blocs, complétées
+// de lignes de redondance (XOR de blocs). Pendant la session, le module écoute en continu.
+#define FUOTA_BLOCK_SIZE 64              // Doit être identique sur la passerelle
+#define FUOTA_GENERATION_BLOCKS 32       // Doit être identique sur la passerelle
+#define FUOTA_MAX_IMAGE_SIZE 0x180000    // 1,5 Mo, borné en pratique par la partition OTA
+#define FUOTA_OPEN_GENERATIONS 4         // Générations en cours de décodage simultanément (~2,2 Ko chacune)
+#define FUOTA_STATUS_MAX_ENTRIES 16      // Générations incomplètes détaillées par rapport
+#define FUOTA_RX_POLL_MS 500
+#define FUOTA_SESSION_TIMEOUT_MS 600000  // Session abandonnée après 10 minutes sans trame
+#define FUOTA_REBOOT_DELAY_MS 30000      // Image vérifiée : redémarrage une fois la passerelle informée
+
 // Namespace NVS
 #define NVS_NAMESPACE "node_config"
+
+// -- Persistance du compteur de messages (MessageCounter) --
+// La NVS n'est écrite qu'une fois tous les MSG_COUNTER_COMMIT_INTERVAL messages ; après une coupure
+// de courant, le compteur saute d'au plus autant de valeurs, que la passerelle ne compte pas comme perdues.
+#define MSG_COUNTER_COMMIT_INTERVAL 16
+#define MSG_COUNTER_SLOTS 4              // Clés NVS écrites à tour de rôle
+#define MSG_COUNTER_RESTART_FRAMES 4     // Messages portant le point de reprise ("rst") après une coupure
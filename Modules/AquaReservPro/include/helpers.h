@@ -2,3 +2,24 @@
 #include <Arduino.h>
 
 uint32_t calculateCRC32(const uint8_t *data, size_t length);
+
+/**
+ * @brief Générateur pseudo-aléatoire xorshift32, déterministe pour une graine donnée.
+ *        La graine est mise à jour à chaque appel (elle ne doit jamais valoir 0).
+ */
+uint32_t nextRandom(uint32_t &seed);
+
+/**
+ * @brief Délai de backoff exponentiel avec gigue ("equal jitter").
+ *
+ * Le plafond vaut min(maxMs, baseMs * 2^attempt) ; le délai retourné est tiré
+ * uniformément dans [plafond/2, plafond], ce qui désynchronise les modules tout
+ * en garantissant un espacement minimal entre deux tentatives.
+ */
+uint32_t computeBackoffDelay(uint8_t attempt, uint32_t baseMs, uint32_t maxMs, uint32_t &seed);
+
+/**
+ * @brief Horloge en millisecondes qui, contrairement à millis(), continue de tourner pendant
+ *        le sommeil profond (temps système entretenu par le timer RTC).
+ */
+uint64_t rtcMillis();
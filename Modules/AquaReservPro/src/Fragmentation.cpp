@@ -0,0 +1,133 @@
+#include "Fragmentation.h"
+
+FragmentSender::FragmentSender() {
+    active = false;
+    peerId = 0;
+    transferId = 0;
+    count = 0;
+    length = 0;
+    ackedMask = 0;
+}
+
+bool FragmentSender::begin(uint8_t peer, uint16_t id, const uint8_t* data, size_t len) {
+    if (len == 0 || len > FRAG_MAX_PAYLOAD_LEN) return false;
+    memcpy(buffer, data, len);
+    length = len;
+    count = (len + FRAG_CHUNK_SIZE - 1) / FRAG_CHUNK_SIZE;
+    peerId = peer;
+    transferId = id;
+    ackedMask = 0;
+    active = true;
+    return true;
+}
+
+size_t FragmentSender::getFragment(uint8_t index, const uint8_t*& chunk) const {
+    if (!active || index >= count) return 0;
+    size_t offset = (size_t)index * FRAG_CHUNK_SIZE;
+    chunk = buffer + offset;
+    return (length - offset < FRAG_CHUNK_SIZE) ? length - offset : FRAG_CHUNK_SIZE;
+}
+
+bool FragmentSender::onStatus(uint32_t receivedMask) {
+    uint32_t previous = ackedMask;
+    ackedMask |= receivedMask & fullMask();
+    return ackedMask != previous;
+}
+
+FragmentReassembler::FragmentReassembler() {
+    for (int i = 0; i < FRAG_REASSEMBLY_SLOTS; i++) {
+        slots[i].used = false;
+    }
+}
+
+FragmentReassembler::Slot* FragmentReassembler::findSlot(uint8_t peerId, uint16_t transferId) {
+    for (int i = 0; i < FRAG_REASSEMBLY_SLOTS; i++) {
+        if (slots[i].used && slots[i].peerId == peerId && slots[i].transferId == transferId) {
+            return &slots[i];
+        }
+    }
+    return nullptr;
+}
+
+const FragmentReassembler::Slot* FragmentReassembler::findSlot(uint8_t peerId, uint16_t transferId) const {
+    return const_cast<FragmentReassembler*>(this)->findSlot(peerId, transferId);
+}
+
+FragmentReassembler::Slot* FragmentReassembler::allocateSlot(uint8_t peerId) {
+    Slot* freeSlot = nullptr;
+    Slot* oldestComplete = nullptr;
+    for (int i = 0; i < FRAG_REASSEMBLY_SLOTS; i++) {
+        Slot& slot = slots[i];
+        // Un nouveau transfert d'un pair remplace le précédent
+        if (slot.used && slot.peerId == peerId) return &slot;
+        if (!slot.used) {
+            if (!freeSlot) freeSlot = &slot;
+        } else if (slot.complete && (!oldestComplete || slot.lastActivity < oldestComplete->lastActivity)) {
+            oldestComplete = &slot;
+        }
+    }
+    // À défaut de tampon libre, un transfert déjà livré peut être écrasé
+    return freeSlot ? freeSlot : oldestComplete;
+}
+
+FragmentResult FragmentReassembler::add(uint8_t peerId, uint16_t transferId, uint8_t index, uint8_t count,
+                                        const uint8_t* chunk, size_t chunkLength) {
+    if (count == 0 || count > FRAG_MAX_FRAGMENTS || index >= count) return FRAG_REJECTED;
+    // Tous les fragments sauf le dernier sont pleins : la position se déduit de l'index
+    if (chunkLength == 0 || chunkLength > FRAG_CHUNK_SIZE || (index < count - 1 && chunkLength != FRAG_CHUNK_SIZE)) {
+        return FRAG_REJECTED;
+    }
+
+    Slot* slot = findSlot(peerId, transferId);
+    if (!slot) {
+        slot = allocateSlot(peerId);
+        if (!slot) return FRAG_REJECTED;
+        slot->used = true;
+        slot->complete = false;
+        slot->peerId = peerId;
+        slot->transferId = transferId;
+        slot->count = count;
+        slot->receivedMask = 0;
+        slot->length = 0;
+    } else if (slot->count != count) {
+        return FRAG_REJECTED;
+    }
+    slot->lastActivity = millis();
+
+    uint32_t bit = 1UL << index;
+    if (slot->complete || (slot->receivedMask & bit)) return FRAG_DUPLICATE;
+
+    memcpy(slot->data + (size_t)index * FRAG_CHUNK_SIZE, chunk, chunkLength);
+    slot->receivedMask |= bit;
+    if (index == count - 1) {
+        slot->length = (size_t)index * FRAG_CHUNK_SIZE + chunkLength;
+    }
+
+    uint32_t fullMask = count >= 32 ? 0xFFFFFFFFUL : ((1UL << count) - 1);
+    if (slot->receivedMask != fullMask) return FRAG_ACCEPTED;
+
+    slot->data[slot->length] = '\0';
+    slot->complete = true;
+    return FRAG_COMPLETE;
+}
+
+uint32_t FragmentReassembler::getReceivedMask(uint8_t peerId, uint16_t transferId) const {
+    const Slot* slot = findSlot(peerId, transferId);
+    return slot ? slot->receivedMask : 0;
+}
+
+const char* FragmentReassembler::getMessage(uint8_t peerId, uint16_t transferId, size_t& length) const {
+    const Slot* slot = findSlot(peerId, transferId);
+    if (!slot || !slot->complete) return nullptr;
+    length = slot->length;
+    return slot->data;
+}
+
+void FragmentReassembler::expire() {
+    unsigned long now = millis();
+    for (int i = 0; i < FRAG_REASSEMBLY_SLOTS; i++) {
+        if (slots[i].used && now - slots[i].lastActivity > FRAG_REASSEMBLY_TIMEOUT_MS) {
+            slots[i].used = false;
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#include "FuotaClient.h"
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+
+bool FuotaClient::begin(uint8_t id, uint32_t size, const uint8_t* sha256) {
+    partition = esp_ota_get_next_update_partition(NULL);
+    if (!partition || size == 0 || size > partition->size || size > FUOTA_MAX_IMAGE_SIZE) {
+        Serial.printf("[FUOTA] Image of %u bytes rejected\n", size);
+        state = FUOTA_FAILED;
+        sessionId = id;
+        return false;
+    }
+
+    // L'effacement prend quelques secondes : il est fait une fois pour toutes à l'ouverture
+    uint32_t eraseSize = (size + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+    if (esp_partition_erase_range(partition, 0, eraseSize) != ESP_OK) {
+        Serial.println(F("[FUOTA] Partition erase failed"));
+        state = FUOTA_FAILED;
+        sessionId = id;
+        return false;
+    }
+
+    sessionId = id;
+    imageSize = size;
+    generationCount = fuotaGenerationCount(size);
+    completedCount = 0;
+    memcpy(expectedHash, sha256, sizeof(expectedHash));
+    memset(doneMap, 0, sizeof(doneMap));
+    for (int i = 0; i < FUOTA_OPEN_GENERATIONS; i++) {
+        decoders[i].reset(0, 0);
+        decoderUse[i] = 0;
+    }
+    state = FUOTA_RECEIVING;
+    lastActivity = millis();
+    Serial.printf("[FUOTA] Session %u: %u bytes, %u generations -> %s\n", sessionId, imageSize, generationCount, partition->label);
+    return true;
+}
+
+void FuotaClient::abort() {
+    if (state != FUOTA_IDLE) {
+        Serial.printf("[FUOTA] Session %u closed\n", sessionId);
+    }
+    state = FUOTA_IDLE;
+}
+
+// Décodeur de la génération, ouvert au besoin ; à défaut de place, la génération
+// inachevée la moins récemment alimentée est abandonnée (elle sera redemandée en entier).
+GenerationDecoder* FuotaClient::decoderFor(uint32_t generation) {
+    int victim = 0;
+    for (int i = 0; i < FUOTA_OPEN_GENERATIONS; i++) {
+        if (decoders[i].getBlocks() > 0 && decoders[i].getGeneration() == generation) {
+            decoderUse[i] = millis();
+            return &decoders[i];
+        }
+        if (decoders[i].getBlocks() == 0) {
+            victim = i;
+        } else if (decoders[victim].getBlocks() > 0 && decoderUse[i] < decoderUse[victim]) {
+            victim = i;
+        }
+    }
+    decoders[victim].reset(generation, fuotaBlocksInGeneration(imageSize, generation));
+    decoderUse[victim] = millis();
+    return &decoders[victim];
+}
+
+void FuotaClient::onRow(uint32_t generation, uint16_t row, const uint8_t* data, size_t length) {
+    if (state != FUOTA_RECEIVING || generation >= generationCount || isDone(generation)) return;
+    lastActivity = millis();
+
+    uint8_t block[FUOTA_BLOCK_SIZE] = {0}; // Le dernier bloc de l'image est complété par des zéros
+    memcpy(block, data, length < FUOTA_BLOCK_SIZE ? length : FUOTA_BLOCK_SIZE);
+
+    GenerationDecoder* decoder = decoderFor(generation);
+    if (!decoder->addRow(fuotaRowMask(generation, row, decoder->getBlocks()), block) || !decoder->isComplete()) return;
+
+    const uint8_t* blocks = decoder->solve();
+    uint32_t offset = generation * FUOTA_GENERATION_SIZE;
+    uint32_t length32 = imageSize - offset < FUOTA_GENERATION_SIZE ? imageSize - offset : FUOTA_GENERATION_SIZE;
+    if (esp_partition_write(partition, offset, blocks, length32) != ESP_OK) {
+        Serial.printf("[FUOTA] Flash write failed at 0x%x\n", offset);
+        state = FUOTA_FAILED;
+        return;
+    }
+    doneMap[generation / 8] |= 1 << (generation % 8);
+    completedCount++;
+    decoder->reset(0, 0);
+
+    if (completedCount == generationCount) {
+        finalize();
+    }
+}
+
+// Vérifie l'empreinte SHA-256 de l'image écrite, puis bascule la partition de démarrage
+void FuotaClient::finalize() {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    uint8_t buffer[FUOTA_BLOCK_SIZE * 4];
+    for (uint32_t offset = 0; offset < imageSize; offset += sizeof(buffer)) {
+        uint32_t chunk = imageSize - offset < sizeof(buffer) ? imageSize - offset : sizeof(buffer);
+        esp_partition_read(partition, offset, buffer, chunk);
+        mbedtls_sha256_update(&ctx, buffer, chunk);
+    }
+    uint8_t hash[32];
+    mbedtls_sha256_finish(&ctx, hash);
+    mbedtls_sha256_free(&ctx);
+
+    if (memcmp(hash, expectedHash, sizeof(hash)) != 0) {
+        Serial.println(F("[FUOTA] SHA-256 mismatch, image rejected"));
+        state = FUOTA_FAILED;
+        return;
+    }
+    // esp_ota_set_boot_partition valide aussi l'en-tête de l'image
+    if (esp_ota_set_boot_partition(partition) != ESP_OK) {
+        Serial.println(F("[FUOTA] Image is not bootable"));
+        state = FUOTA_FAILED;
+        return;
+    }
+    state = FUOTA_VERIFIED;
+    Serial.printf("[FUOTA] Session %u: image verified, reboot pending\n", sessionId);
+}
+
+// Générations encore incomplètes et nombre de lignes qu'il leur manque, dans l'ordre
+uint8_t FuotaClient::getMissing(uint32_t* generations, uint8_t* deficits, uint8_t maxEntries, uint32_t& remaining) const {
+    uint8_t count = 0;
+    remaining = 0;
+    if (state != FUOTA_RECEIVING) return 0;
+    for (uint32_t g = 0; g < generationCount; g++) {
+        if (isDone(g)) continue;
+        remaining++;
+        if (count >= maxEntries) continue;
+        uint8_t deficit = fuotaBlocksInGeneration(imageSize, g);
+        for (int i = 0; i < FUOTA_OPEN_GENERATIONS; i++) {
+            if (decoders[i].getBlocks() > 0 && decoders[i].getGeneration() == g) {
+                deficit -= decoders[i].getRank();
+            }
+        }
+        generations[count] = g;
+        deficits[count] = deficit;
+        count++;
+    }
+    return count;
+}
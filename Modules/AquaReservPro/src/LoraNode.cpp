@@ -8,6 +8,7 @@
 #include <Preferences.h>
 #include <WiFi.h>
 #include <AESLib.h>
+#include <esp_system.h>
 
 extern SX1262 radio;
 Preferences preferences;
@@ -19,12 +20,61 @@ byte aes_iv[16];
 byte encrypted[256];
 byte decrypted[256];
 
+// Tâche LoRa, réveillée par DIO1 (fin d'émission ou de réception) et par queueUplink
+static TaskHandle_t radioTaskHandle = NULL;
+
+static void IRAM_ATTR radioInterrupt() {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(radioTaskHandle, &xHigherPriorityTaskWoken);
+    if (xHigherPriorityTaskWoken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+#define LORA_SESSION_RTC_MAGIC 0x53454E4CUL // "LNES"
+
+// Session conservée pendant le sommeil profond (LOW_POWER_MODE) : le réveil reprend l'adhésion,
+// la configuration et l'événement confirmé en cours sans relire la NVS. Les échéances y sont
+// en temps absolu (rtcMillis), millis() repartant de 0 à chaque réveil.
+struct LoraSessionRtc {
+    uint32_t magic;
+    uint8_t nodeId;
+    uint8_t joinAttempts;
+    uint16_t nextTransferId;
+    uint32_t backoffSeed;
+    uint32_t jitterSeed;
+    ReportConfig reportConfig;
+    uint64_t joinAt;
+    bool hasInFlight;
+    uint64_t retryAt;
+    OutboundMessage inFlight;
+};
+
+// Réinitialisée à chaque démarrage qui n'est pas un réveil de sommeil profond
+static RTC_DATA_ATTR LoraSessionRtc rtcSession;
 
 void LoraNode::init() {
     memcpy(aes_key, LORA_SECRET_KEY, 16);
     memcpy(aes_iv, LORA_AES_IV, 16);
 
-    loadConfig();
+    if (esp_reset_reason() == ESP_RST_DEEPSLEEP && rtcSession.magic == LORA_SESSION_RTC_MAGIC) {
+        restoreSession();
+    } else {
+        loadConfig();
+
+        String mac = WiFi.macAddress();
+        backoffSeed = calculateCRC32((const uint8_t*)mac.c_str(), mac.length());
+        esp_reset_reason_t reason = esp_reset_reason();
+        bool powerEvent = reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT;
+        nextJoinDelay = powerEvent ? nextRandom(backoffSeed) % (JOIN_INITIAL_SPREAD_MS + 1) : 0;
+        lastJoinAttempt = millis();
+        nextTransferId = nextRandom(backoffSeed);
+        jitterSeed = nextRandom(backoffSeed);
+    }
+
+    lastTelemetryTime = millis() - reportConfig.heartbeatMs; // Premier rapport dès le démarrage
+    confirmedQueue = xQueueCreate(CONFIRMED_QUEUE_SIZE, sizeof(OutboundMessage));
+    unconfirmedQueue = xQueueCreate(UNCONFIRMED_QUEUE_SIZE, sizeof(OutboundMessage));
 
     Serial.print(F("[LORA] Initializing... "));
     int state = radio.begin(LORA_FREQ);
@@ -35,42 +85,168 @@ void LoraNode::init() {
     Serial.println(F("success!"));
 }
 
+// Une itération de la tâche LoRa. Chaque branche bloque (émission, fenêtre d'écoute ou attente
+// d'une notification) : la tâche n'a pas de délai fixe entre deux itérations.
 void LoraNode::run() {
+    attachRadioTask();
+
+    if (nodeId == 0) {
+        unsigned long elapsed = millis() - lastJoinAttempt;
+        if (elapsed < nextJoinDelay) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(nextJoinDelay - elapsed));
+        } else {
+            attemptJoin();
+        }
+    } else if (fuota.isActive()) {
+        serviceFuota();
+    } else {
+        serviceUplinks();
+        if (!isUplinkReady()) {
+            // Classe A : le module n'écoute qu'après ses émissions, il dort jusqu'à la prochaine
+            ulTaskNotifyTake(pdTRUE, nextUplinkWait());
+        }
+    }
+}
+
+// Les notifications de DIO1 vont à la tâche qui utilise la radio
+void LoraNode::attachRadioTask() {
+    if (radioTaskHandle != xTaskGetCurrentTaskHandle()) {
+        radioTaskHandle = xTaskGetCurrentTaskHandle();
+        radio.setDio1Action(radioInterrupt);
+    }
+}
+
+void LoraNode::attemptJoin() {
+    if (performJoinRequest()) {
+        joinAttempts = 0;
+    } else {
+        nextJoinDelay = computeBackoffDelay(joinAttempts, JOIN_BACKOFF_BASE_MS, JOIN_BACKOFF_MAX_MS, backoffSeed);
+        if (joinAttempts < 255) joinAttempts++;
+        Serial.printf("[LORA] Join attempt %u failed, next in %lu ms\n", joinAttempts, nextJoinDelay);
+    }
+    lastJoinAttempt = millis();
+}
+
+// Mode basse consommation : tout ce qui peut partir part maintenant, dans la tâche appelante.
+// Retourne le délai avant la prochaine échéance (adhésion, nouvel essai), UINT32_MAX s'il n'y en a pas.
+uint32_t LoraNode::serviceNow() {
+    attachRadioTask();
     if (nodeId == 0) {
-        if (millis() - lastJoinAttempt > 10000) { // Tenter de joindre toutes les 10s
-            lastJoinAttempt = millis();
-            performJoinRequest();
+        if (millis() - lastJoinAttempt >= nextJoinDelay) attemptJoin();
+        if (nodeId == 0) {
+            unsigned long elapsed = millis() - lastJoinAttempt;
+            return elapsed >= nextJoinDelay ? 0 : nextJoinDelay - elapsed;
         }
     }
+    // Une session FUOTA ouverte pendant la fenêtre d'écoute garde le module éveillé jusqu'à sa fin
+    while (isUplinkReady() || fuota.isActive()) {
+        if (fuota.isActive()) {
+            serviceFuota();
+        } else {
+            serviceUplinks();
+        }
+    }
+    if (!hasInFlight) return UINT32_MAX;
+    unsigned long elapsed = millis() - inFlight.lastAttemptAt;
+    return elapsed >= inFlight.retryDelayMs ? 0 : inFlight.retryDelayMs - elapsed;
+}
+
+void LoraNode::sleep() {
+    uint64_t now = rtcMillis();
+    rtcSession.magic = LORA_SESSION_RTC_MAGIC;
+    rtcSession.nodeId = nodeId;
+    rtcSession.joinAttempts = joinAttempts;
+    rtcSession.nextTransferId = nextTransferId;
+    rtcSession.backoffSeed = backoffSeed;
+    rtcSession.jitterSeed = jitterSeed;
+    rtcSession.reportConfig = readReportConfig();
+    unsigned long joinElapsed = millis() - lastJoinAttempt;
+    rtcSession.joinAt = now + (joinElapsed >= nextJoinDelay ? 0 : nextJoinDelay - joinElapsed);
+    rtcSession.hasInFlight = hasInFlight;
+    if (hasInFlight) {
+        unsigned long retryElapsed = millis() - inFlight.lastAttemptAt;
+        rtcSession.retryAt = now + (retryElapsed >= inFlight.retryDelayMs ? 0 : inFlight.retryDelayMs - retryElapsed);
+        rtcSession.inFlight = inFlight;
+    }
+    radio.sleep();
+}
+
+void LoraNode::restoreSession() {
+    uint64_t now = rtcMillis();
+    nodeId = rtcSession.nodeId;
+    joinAttempts = rtcSession.joinAttempts;
+    nextTransferId = rtcSession.nextTransferId;
+    backoffSeed = rtcSession.backoffSeed;
+    jitterSeed = rtcSession.jitterSeed;
+    reportConfig = rtcSession.reportConfig;
+    lastJoinAttempt = millis();
+    nextJoinDelay = rtcSession.joinAt > now ? rtcSession.joinAt - now : 0;
+    hasInFlight = rtcSession.hasInFlight;
+    if (hasInFlight) {
+        inFlight = rtcSession.inFlight;
+        inFlight.lastAttemptAt = millis();
+        inFlight.retryDelayMs = rtcSession.retryAt > now ? rtcSession.retryAt - now : 0;
+    }
+    msgCounter.begin();
+    Serial.printf("[RTC] Session resumed. Node ID: %d, Msg Counter: %u\n", nodeId, msgCounter.get());
+}
+
+void LoraNode::onCommand(CommandCallback callback) {
+    commandCallback = callback;
 }
 
 bool LoraNode::isJoined() {
     return nodeId != 0;
 }
 
+bool LoraNode::isReportDue() {
+    const ReportConfig config = readReportConfig();
+    // Gigue réduite par set_config depuis le dernier tirage : tirée à nouveau, ici, dans la tâche des capteurs
+    if (nextReportJitterMs > config.jitterMs) {
+        nextReportJitterMs = config.jitterMs ? nextRandom(jitterSeed) % (config.jitterMs + 1) : 0;
+    }
+    // Heartbeat : l'état courant n'est renvoyé qu'après un silence de heartbeatMs
+    return isJoined() && (millis() - lastTelemetryTime >= config.heartbeatMs + nextReportJitterMs);
+}
+
+uint32_t LoraNode::getHeartbeatInterval() {
+    return readReportConfig().heartbeatMs + nextReportJitterMs;
+}
+
 void LoraNode::loadConfig() {
     preferences.begin(NVS_NAMESPACE, false);
     nodeId = preferences.getUChar("nodeId", 0);
-    msgCounter = preferences.getUInt("msgCtr", 0);
+    joinNonce = preferences.getUInt("joinN", 0);
+    reportConfig.intervalMs = preferences.getUInt("txInt", TELEMETRY_INTERVAL_MS);
+    reportConfig.jitterMs = preferences.getUInt("txJit", 0);
+    reportConfig.heartbeatMs = preferences.getUInt("txHb", REPORT_HEARTBEAT_MS);
     preferences.end();
-    Serial.printf("[NVS] Node ID: %d, Msg Counter: %u\n", nodeId, msgCounter);
+    msgCounter.begin();
+    Serial.printf("[NVS] Node ID: %d, Msg Counter: %u, Interval: %u ms\n", nodeId, msgCounter.get(), reportConfig.intervalMs);
 }
 
 void LoraNode::saveConfig() {
     preferences.begin(NVS_NAMESPACE, false);
     preferences.putUChar("nodeId", nodeId);
-    preferences.putUInt("msgCtr", msgCounter);
+    preferences.putUInt("txInt", reportConfig.intervalMs); // Tâche LoRa : seule à modifier reportConfig
+    preferences.putUInt("txJit", reportConfig.jitterMs);
+    preferences.putUInt("txHb", reportConfig.heartbeatMs);
     preferences.end();
-    Serial.printf("[NVS] Config saved. Node ID: %d, Msg Counter: %u\n", nodeId, msgCounter);
+    Serial.printf("[NVS] Config saved. Node ID: %d, Interval: %u ms\n", nodeId, reportConfig.intervalMs);
 }
 
-void LoraNode::performJoinRequest() {
+bool LoraNode::performJoinRequest() {
     Serial.println(F("[LORA] Sending JOIN_REQUEST..."));
 
     StaticJsonDocument<200> doc;
     doc["type"] = "JOIN_REQUEST";
     doc["mac"] = WiFi.macAddress();
     doc["devType"] = DEVICE_TYPE;
+    // Sauvegardé avant l'émission : après une coupure, le nonce émis n'est jamais réutilisé
+    preferences.begin(NVS_NAMESPACE, false);
+    preferences.putUInt("joinN", ++joinNonce);
+    preferences.end();
+    doc["jn"] = joinNonce;
     
     String payloadStr;
     serializeJson(doc, payloadStr);
@@ -84,16 +260,16 @@ void LoraNode::performJoinRequest() {
     String msg;
     serializeJson(finalDoc, msg);
 
+    if (firstTxAt < 0) firstTxAt = millis();
     int state = radio.transmit(msg);
     if (state != RADIOLIB_ERR_NONE) {
         Serial.printf("[LORA] Transmit failed, code %d\n", state);
-        return;
+        return false;
     }
 
-    // Écouter la réponse
+    // Écouter la réponse : la passerelle peut différer l'acceptation pour espacer les JOIN_ACCEPT
     String response;
-    state = radio.receive(response, 5000);
-    if (state == RADIOLIB_ERR_NONE && response.length() > 0) {
+    if (receiveWithTimeout(response, JOIN_RX_TIMEOUT_MS)) {
         StaticJsonDocument<256> rxDoc;
         if (deserializeJson(rxDoc, response) == DeserializationError::Ok && rxDoc.containsKey("p")) {
             String decrypted = decryptPayload(rxDoc["p"]);
@@ -104,9 +280,10 @@ void LoraNode::performJoinRequest() {
 
                     nodeId = joinAcceptDoc["nodeId"];
                     if (nodeId > 0) {
-                        msgCounter = 0; // Réinitialiser le compteur après un join réussi
+                        msgCounter.reset(); // Réinitialiser le compteur après un join réussi
                         saveConfig();
                         Serial.printf("[LORA] Join successful! Assigned Node ID: %d\n", nodeId);
+                        return true;
                     }
                 }
             }
@@ -114,41 +291,455 @@ void LoraNode::performJoinRequest() {
     } else {
         Serial.println(F("[LORA] No response to JOIN_REQUEST."));
     }
+    return false;
+}
+
+bool LoraNode::receiveWithTimeout(String& response, unsigned long timeoutMs) {
+    // radio.receive() n'attend qu'une centaine de symboles : on ouvre ici une vraie fenêtre temporisée,
+    // pendant laquelle la tâche dort jusqu'à l'interruption DIO1.
+    ulTaskNotifyTake(pdTRUE, 0); // Fin d'émission signalée sur DIO1 : ce n'est pas une réception
+    if (radio.startReceive() != RADIOLIB_ERR_NONE) return false;
+    unsigned long start = millis();
+    bool received = false;
+    for (;;) {
+        if (digitalRead(LORA_DIO1) == HIGH) {
+            int state = radio.readData(response);
+            received = state == RADIOLIB_ERR_NONE && response.length() > 0;
+            break;
+        }
+        unsigned long elapsed = millis() - start;
+        if (elapsed >= timeoutMs) break;
+        // Réveil anticipé possible (queueUplink) : la fenêtre reprend pour le temps restant
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs - elapsed));
+    }
+    radio.standby();
+    return received;
 }
 
-void LoraNode::sendTelemetry(bool isFull) {
+void LoraNode::sendTelemetry(bool isFull, bool confirmed) {
     if (!isJoined()) return;
+    lastTelemetryTime = millis();
+    uint32_t jitterMs = readReportConfig().jitterMs;
+    nextReportJitterMs = jitterMs ? nextRandom(jitterSeed) % (jitterMs + 1) : 0;
+
+    // Changement de niveau (confirmé) : le seul champ qui a changé. Heartbeat : état complet
+    StaticJsonDocument<64> data;
+    data["level_full"] = isFull;
+    if (!confirmed) {
+        data["voltage"] = 3.3; // Valeur statique pour l'exemple
+    }
+    queueUplink(data.as<JsonObjectConst>(), confirmed);
+}
+
+bool LoraNode::queueUplink(JsonObjectConst data, bool confirmed) {
+    if (!isJoined()) return false;
+
+    OutboundMessage msg = {};
+    msg.confirmed = confirmed;
+    if (serializeJson(data, msg.data, sizeof(msg.data)) >= sizeof(msg.data) - 1) {
+        Serial.println(F("[LORA] Uplink data too long, dropped"));
+        return false;
+    }
+
+    QueueHandle_t queue = confirmed ? confirmedQueue : unconfirmedQueue;
+    if (xQueueSend(queue, &msg, 0) != pdPASS) {
+        if (!confirmed) return false;
+        // File pleine : l'événement le plus ancien cède sa place au plus récent
+        OutboundMessage dropped;
+        xQueueReceive(queue, &dropped, 0);
+        Serial.printf("[LORA] Confirmed queue full, dropped %s\n", dropped.data);
+        xQueueSend(queue, &msg, 0);
+    }
+    // Réveille la tâche LoRa : le message part sans attendre la fin de son attente
+    if (radioTaskHandle) xTaskNotifyGive(radioTaskHandle);
+    return true;
+}
+
+// Un message montant peut partir sans attendre : télémétrie en file, événement confirmé
+// sans envoi en cours, ou nouvel essai arrivé à échéance
+bool LoraNode::isUplinkReady() {
+    if (uxQueueMessagesWaiting(unconfirmedQueue) > 0) return true;
+    if (hasInFlight) return millis() - inFlight.lastAttemptAt >= inFlight.retryDelayMs;
+    return uxQueueMessagesWaiting(confirmedQueue) > 0;
+}
+
+// Attente maximale de la tâche LoRa : jusqu'au prochain essai, sinon jusqu'à une notification
+TickType_t LoraNode::nextUplinkWait() {
+    if (!hasInFlight) return portMAX_DELAY;
+    unsigned long elapsed = millis() - inFlight.lastAttemptAt;
+    return elapsed >= inFlight.retryDelayMs ? 0 : pdMS_TO_TICKS(inFlight.retryDelayMs - elapsed);
+}
+
+// Appelé par la tâche LoRa : seule cette tâche émet sur la radio.
+void LoraNode::serviceUplinks() {
+    if (hasInFlight) {
+        if (millis() - inFlight.lastAttemptAt < inFlight.retryDelayMs) {
+            // En attente du prochain essai : la télémétrie périodique peut passer entre-temps
+            OutboundMessage msg;
+            if (xQueueReceive(unconfirmedQueue, &msg, 0) == pdPASS) {
+                transmitUplink(msg);
+            }
+            return;
+        }
+    } else {
+        OutboundMessage msg;
+        if (xQueueReceive(confirmedQueue, &inFlight, 0) == pdPASS) {
+            hasInFlight = true;
+        } else if (xQueueReceive(unconfirmedQueue, &msg, 0) == pdPASS) {
+            transmitUplink(msg);
+            return;
+        } else {
+            return;
+        }
+    }
+
+    bool acked = transmitUplink(inFlight);
+    inFlight.attempts++;
+    inFlight.lastAttemptAt = millis();
+    if (acked) {
+        Serial.printf("[LORA] Confirmed uplink %u delivered after %u attempt(s)\n", inFlight.msgCtr, inFlight.attempts);
+        hasInFlight = false;
+    } else if (inFlight.attempts >= CONFIRMED_MAX_ATTEMPTS) {
+        Serial.printf("[LORA] Confirmed uplink %u dropped after %u attempts\n", inFlight.msgCtr, inFlight.attempts);
+        hasInFlight = false;
+    } else {
+        inFlight.retryDelayMs = computeBackoffDelay(inFlight.attempts - 1, CONFIRMED_BACKOFF_BASE_MS, CONFIRMED_BACKOFF_MAX_MS, backoffSeed);
+        Serial.printf("[LORA] No ACK for %u, retry in %u ms\n", inFlight.msgCtr, inFlight.retryDelayMs);
+    }
+}
 
-    msgCounter++; // Incrémenter avant l'envoi
+// Émet le message puis écoute la réponse de la passerelle. Retourne true si un ACK correspondant a été reçu.
+bool LoraNode::transmitUplink(OutboundMessage& msg) {
+    if (msg.msgCtr == 0) {
+        msg.msgCtr = msgCounter.next(); // Incrémenter avant l'envoi
+    }
 
     StaticJsonDocument<256> doc;
     doc["type"] = "TELEMETRY";
     doc["nodeId"] = nodeId;
-    doc["msgCtr"] = msgCounter;
-
-    JsonObject data = doc.createNestedObject("data");
-    data["level_full"] = isFull;
-    data["voltage"] = 3.3; // Valeur statique pour l'exemple
+    doc["msgCtr"] = msg.msgCtr;
+    uint32_t restartedAt = msgCounter.restartMarker();
+    if (restartedAt) doc["rst"] = restartedAt; // Compteurs sautés par une coupure : pas des pertes
+    if (msg.msgCtr <= JOIN_NONCE_FRAMES) doc["jn"] = joinNonce; // Premiers messages de l'adhésion : la passerelle s'y recale
+    if (msg.confirmed) {
+        doc["conf"] = 1;
+    }
+    doc["data"] = serialized(msg.data);
 
     String payloadStr;
     serializeJson(doc, payloadStr);
-    
-    String encryptedPayload = encryptPayload(payloadStr);
-    
+
+    Serial.printf("[LORA] Sending TELEMETRY (msgCtr: %u%s)...\n", msg.msgCtr, msg.confirmed ? ", confirmed" : "");
+    bool sent = payloadStr.length() > LORA_MAX_PLAINTEXT_LEN ? sendFragmented(payloadStr) : transmitPlaintext(payloadStr);
+    if (!sent) {
+        if (msgCounter.release(msg.msgCtr)) { // Annuler l'incrémentation si rien n'est parti depuis
+            msg.msgCtr = 0;
+        }
+        return false;
+    }
+
+    // Le module n'écoute qu'après ses propres émissions : c'est là que la passerelle lui répond
+    lastAckedCtr = 0;
+    listenForDownlinks(NODE_RX_WINDOW_MS);
+    return msg.confirmed && lastAckedCtr == msg.msgCtr;
+}
+
+// Chiffre un message clair et l'émet dans une seule trame
+bool LoraNode::transmitPlaintext(const String& plaintext) {
+    String encryptedPayload = encryptPayload(plaintext);
+
     StaticJsonDocument<384> finalDoc;
     finalDoc["p"] = encryptedPayload;
-    finalDoc["c"] = calculateCRC32((const uint8_t*)payloadStr.c_str(), payloadStr.length());
+    finalDoc["c"] = calculateCRC32((const uint8_t*)plaintext.c_str(), plaintext.length());
 
-    String msg;
-    serializeJson(finalDoc, msg);
+    String frame;
+    serializeJson(finalDoc, frame);
 
-    Serial.printf("[LORA] Sending TELEMETRY (msgCtr: %u)...\n", msgCounter);
-    int state = radio.transmit(msg);
+    if (firstTxAt < 0) firstTxAt = millis();
+    int state = radio.transmit(frame);
     if (state != RADIOLIB_ERR_NONE) {
         Serial.printf("[LORA] Transmit failed, code %d\n", state);
-        msgCounter--; // Annuler l'incrémentation si l'envoi échoue
-    } else {
-        saveConfig(); // Sauvegarder le nouveau compteur après un envoi réussi
+        return false;
+    }
+    return true;
+}
+
+// Émet un message trop long pour une trame en fragments, puis ne réémet que ceux
+// que la passerelle signale manquants. Retourne true quand tous sont acquittés.
+bool LoraNode::sendFragmented(const String& plaintext) {
+    if (++nextTransferId == 0) nextTransferId = 1;
+    if (!fragmentSender.begin(0, nextTransferId, (const uint8_t*)plaintext.c_str(), plaintext.length())) {
+        Serial.printf("[LORA] Message too long (%u bytes), dropped\n", plaintext.length());
+        return false;
+    }
+
+    uint8_t rounds = 0;
+    while (rounds < FRAG_MAX_ROUNDS) {
+        if (!sendFragmentRound()) break;
+        fragmentProgress = false;
+        String response;
+        if (receiveWithTimeout(response, NODE_RX_WINDOW_MS)) {
+            handleDownlink(response);
+        }
+        if (fragmentSender.isDone()) {
+            fragmentSender.reset();
+            return true;
+        }
+        if (!fragmentProgress) rounds++;
+    }
+    Serial.printf("[LORA] Transfer %u abandoned\n", fragmentSender.getTransferId());
+    fragmentSender.reset();
+    return false;
+}
+
+// Émet les fragments non encore acquittés ; le dernier demande un FACK à la passerelle
+bool LoraNode::sendFragmentRound() {
+    uint32_t missing = fragmentSender.getMissingMask();
+    uint8_t last = 31 - __builtin_clz(missing);
+
+    for (uint8_t i = 0; i <= last; i++) {
+        if (!(missing & (1UL << i))) continue;
+        const uint8_t* chunk;
+        size_t chunkLength = fragmentSender.getFragment(i, chunk);
+
+        StaticJsonDocument<192> fragDoc;
+        fragDoc["type"] = "FRAG";
+        fragDoc["nodeId"] = nodeId;
+        fragDoc["x"] = fragmentSender.getTransferId();
+        fragDoc["i"] = i;
+        fragDoc["n"] = fragmentSender.getCount();
+        if (i == last) fragDoc["f"] = 1;
+        fragDoc["d"] = Base64::encode(chunk, chunkLength);
+
+        String payloadStr;
+        serializeJson(fragDoc, payloadStr);
+        if (!transmitPlaintext(payloadStr)) return false;
+        if (i != last) delay(FRAG_TX_SPACING_MS);
+    }
+    Serial.printf("[LORA] Transfer %u: %d fragment(s) sent\n", fragmentSender.getTransferId(), __builtin_popcount(missing));
+    return true;
+}
+
+// Fenêtre d'écoute après une émission, prolongée tant que la passerelle continue d'émettre
+// (fragments d'un message long à la suite d'un ACK, par exemple)
+void LoraNode::listenForDownlinks(unsigned long windowMs) {
+    String response;
+    while (receiveWithTimeout(response, windowMs)) {
+        handleDownlink(response);
+        windowMs = FRAG_RX_GAP_MS;
+    }
+}
+
+void LoraNode::handleDownlink(const String& frame) {
+    StaticJsonDocument<384> rxDoc;
+    if (deserializeJson(rxDoc, frame) != DeserializationError::Ok || !rxDoc.containsKey("p")) return;
+
+    String decrypted = decryptPayload(rxDoc["p"]);
+    if (decrypted.length() == 0) return;
+
+    StaticJsonDocument<384> msgDoc;
+    if (deserializeJson(msgDoc, decrypted) != DeserializationError::Ok) return;
+    handleMessage(msgDoc.as<JsonObjectConst>());
+}
+
+void LoraNode::handleMessage(JsonObjectConst msg) {
+    uint8_t target = msg["nodeId"];
+    // Les blocs de firmware sont diffusés à tout le groupe (nodeId 0)
+    if (target != nodeId && !(target == 0 && msg["type"] == "FUOTA")) return;
+
+    if (msg["type"] == "ACK") {
+        lastAckedCtr = msg["msgCtr"];
+        // La passerelle peut joindre une commande en attente à son ACK
+        if (msg.containsKey("cmd")) {
+            handleCommand(msg["cmd"]);
+        }
+    } else if (msg["type"] == "CMD") {
+        handleCommand(msg);
+    } else if (msg["type"] == "FRAG") {
+        handleFragment(msg);
+    } else if (msg["type"] == "FACK") {
+        if (fragmentSender.isActive() && msg["x"] == fragmentSender.getTransferId()) {
+            fragmentProgress = fragmentSender.onStatus(msg["m"]);
+        }
+    } else if (msg["type"] == "FSETUP") {
+        handleFuotaSetup(msg);
+    } else if (msg["type"] == "FUOTA") {
+        if (fuota.isActive() && msg["s"] == fuota.getSessionId()) {
+            uint8_t block[FUOTA_BLOCK_SIZE];
+            size_t length = Base64::decode(msg["d"].as<String>(), block, sizeof(block));
+            fuota.onRow(msg["g"], msg["r"], block, length);
+        }
+    } else if (msg["type"] == "FSREQ") {
+        if (fuota.isActive() && msg["s"] == fuota.getSessionId()) {
+            fuota.touch();
+            sendFuotaStatus();
+        }
+    }
+}
+
+// Pendant une session FUOTA, le module écoute en continu et suspend ses envois périodiques
+void LoraNode::serviceFuota() {
+    String response;
+    if (receiveWithTimeout(response, FUOTA_RX_POLL_MS)) {
+        handleDownlink(response);
+    }
+
+    unsigned long idle = millis() - fuota.getLastActivity();
+    if (fuota.getState() == FUOTA_VERIFIED && idle > FUOTA_REBOOT_DELAY_MS) {
+        Serial.println(F("[FUOTA] Rebooting into the new firmware"));
+        ESP.restart();
+    } else if (idle > FUOTA_SESSION_TIMEOUT_MS) {
+        fuota.abort();
+    }
+}
+
+void LoraNode::handleFuotaSetup(JsonObjectConst setup) {
+    uint8_t sessionId = setup["s"];
+    // Demande répétée (réponse perdue) : la session est déjà ouverte
+    if (!fuota.isActive() || fuota.getSessionId() != sessionId) {
+        uint8_t hash[32];
+        if (Base64::decode(setup["h"].as<String>(), hash, sizeof(hash)) != sizeof(hash)) return;
+        fuota.begin(sessionId, setup["size"], hash);
+    }
+    fuota.touch();
+    sendFuotaStatus();
+}
+
+// Rapport d'avancement : générations incomplètes et nombre de lignes manquantes pour chacune
+void LoraNode::sendFuotaStatus() {
+    uint32_t generations[FUOTA_STATUS_MAX_ENTRIES];
+    uint8_t deficits[FUOTA_STATUS_MAX_ENTRIES];
+    uint32_t remaining;
+    uint8_t count = fuota.getMissing(generations, deficits, FUOTA_STATUS_MAX_ENTRIES, remaining);
+
+    DynamicJsonDocument doc(256 + FUOTA_STATUS_MAX_ENTRIES * 32);
+    doc["type"] = "FSTAT";
+    doc["nodeId"] = nodeId;
+    uint32_t counter = msgCounter.next();
+    doc["msgCtr"] = counter;
+    uint32_t restartedAt = msgCounter.restartMarker();
+    if (restartedAt) doc["rst"] = restartedAt;
+    if (counter <= JOIN_NONCE_FRAMES) doc["jn"] = joinNonce;
+    doc["s"] = fuota.getSessionId();
+    doc["st"] = (int)fuota.getState();
+    doc["left"] = remaining;
+    JsonArray missing = doc.createNestedArray("miss");
+    for (uint8_t i = 0; i < count; i++) {
+        JsonArray entry = missing.createNestedArray();
+        entry.add(generations[i]);
+        entry.add(deficits[i]);
+    }
+
+    String payloadStr;
+    serializeJson(doc, payloadStr);
+    delay(FRAG_TX_SPACING_MS); // La passerelle se remet en écoute après sa requête
+    bool sent = payloadStr.length() > LORA_MAX_PLAINTEXT_LEN ? sendFragmented(payloadStr) : transmitPlaintext(payloadStr);
+    if (!sent) {
+        msgCounter.release(counter);
+    }
+}
+
+void LoraNode::handleFragment(JsonObjectConst frag) {
+    uint16_t transferId = frag["x"];
+    uint8_t index = frag["i"];
+    uint8_t count = frag["n"];
+    String chunk = Base64::decode(frag["d"].as<String>());
+
+    FragmentResult result = reassembler.add(0, transferId, index, count, (const uint8_t*)chunk.c_str(), chunk.length());
+    if (result == FRAG_REJECTED) return;
+    if ((frag["f"] | 0) != 0 || result == FRAG_COMPLETE) {
+        sendFragmentAck(transferId, reassembler.getReceivedMask(0, transferId));
+    }
+    if (result != FRAG_COMPLETE) return;
+
+    size_t length;
+    const char* message = reassembler.getMessage(0, transferId, length);
+    DynamicJsonDocument msgDoc(2 * FRAG_MAX_PAYLOAD_LEN);
+    if (deserializeJson(msgDoc, message, length) != DeserializationError::Ok) return;
+    if (msgDoc["type"] == "FRAG" || msgDoc["type"] == "FACK") return;
+    Serial.printf("[LORA] Transfer %u reassembled (%u bytes)\n", transferId, length);
+    delay(FRAG_TX_SPACING_MS); // La passerelle se remet en écoute après notre FACK
+    handleMessage(msgDoc.as<JsonObjectConst>());
+}
+
+void LoraNode::sendFragmentAck(uint16_t transferId, uint32_t receivedMask) {
+    StaticJsonDocument<128> doc;
+    doc["type"] = "FACK";
+    doc["nodeId"] = nodeId;
+    doc["x"] = transferId;
+    doc["m"] = receivedMask;
+
+    String payloadStr;
+    serializeJson(doc, payloadStr);
+    transmitPlaintext(payloadStr);
+}
+
+void LoraNode::handleCommand(JsonObjectConst cmd) {
+    Serial.println("[LORA] Received CMD");
+    bool handled = false;
+    if (cmd["method"] == "set_config") {
+        applyReportConfig(cmd["params"]);
+        handled = true;
+    } else if (commandCallback) {
+        // Commandes propres à l'application, traitées dans la tâche LoRa
+        handled = commandCallback(cmd["method"] | "", cmd["params"]);
+    }
+    if (handled && cmd.containsKey("msgId")) {
+        sendAck(cmd["msgId"]);
+    }
+}
+
+// Paramètres absents : inchangés. La passerelle n'envoie que l'intervalle et la gigue ; le
+// heartbeat vient d'une commande set_config de l'opérateur
+void LoraNode::applyReportConfig(JsonObjectConst params) {
+    // Valeurs calculées et bornées à part, puis publiées d'un bloc : la tâche des capteurs, sur
+    // l'autre cœur, ne voit jamais un réglage à moitié appliqué
+    ReportConfig config = readReportConfig();
+    if (params.containsKey("interval")) {
+        uint32_t interval = params["interval"];
+        uint32_t jitter = params["jitter"] | 0;
+        interval = constrain(interval, (uint32_t)REPORT_INTERVAL_MIN_MS, (uint32_t)REPORT_INTERVAL_MAX_MS);
+        if (jitter > interval / 2) jitter = interval / 2;
+
+        config.intervalMs = interval;
+        config.jitterMs = jitter;
+    }
+    uint32_t heartbeat = params["heartbeat"] | config.heartbeatMs;
+    config.heartbeatMs = constrain(heartbeat, config.intervalMs, (uint32_t)REPORT_INTERVAL_MAX_MS);
+
+    portENTER_CRITICAL(&reportConfigMux);
+    reportConfig = config;
+    portEXIT_CRITICAL(&reportConfigMux);
+
+    saveConfig();
+    Serial.printf("[LORA] Report interval set to %u ms (jitter %u ms, heartbeat %u ms)\n",
+                  config.intervalMs, config.jitterMs, config.heartbeatMs);
+}
+
+ReportConfig LoraNode::readReportConfig() {
+    portENTER_CRITICAL(&reportConfigMux);
+    ReportConfig config = reportConfig;
+    portEXIT_CRITICAL(&reportConfigMux);
+    return config;
+}
+
+void LoraNode::sendAck(uint16_t msgId) {
+    uint32_t counter = msgCounter.next();
+    StaticJsonDocument<128> doc;
+    doc["type"] = "ACK";
+    doc["nodeId"] = nodeId;
+    doc["msgId"] = msgId;
+    doc["msgCtr"] = counter;
+    uint32_t restartedAt = msgCounter.restartMarker();
+    if (restartedAt) doc["rst"] = restartedAt;
+    if (counter <= JOIN_NONCE_FRAMES) doc["jn"] = joinNonce;
+
+    String payloadStr;
+    serializeJson(doc, payloadStr);
+
+    Serial.printf("[LORA] Sending ACK for msgId %d\n", msgId);
+    if (!transmitPlaintext(payloadStr)) {
+        msgCounter.release(counter);
     }
 }
 
@@ -8,6 +8,10 @@
 #include "LoraNode.h"
 #include "helpers.h"
 #include "Base64.h"
+#if LOW_POWER_MODE
+#include <esp_sleep.h>
+#include <driver/rtc_io.h>
+#endif
 
 // ===================== OBJETS GLOBAUX =====================
 Module mod(LORA_CS, LORA_DIO1, LORA_RST, LORA_BUSY);
@@ -70,27 +74,35 @@ const char* HTML_CONTENT = R"rawliteral(
 // ===================== PROTOTYPES DES TÂCHES =====================
 void taskLoRa(void* params);
 void taskSensors(void* params);
-void connectWiFi();
+void taskWiFi(void* params);
+void bootPhase(const char* phase, unsigned long at = millis());
 void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
 void setupWebServer();
+#if LOW_POWER_MODE
+void lowPowerCycle();
+#endif
 
 
 void setup() {
     Serial.begin(115200);
     pinMode(WATER_LEVEL_PIN, INPUT_PULLUP);
 
-    stateMutex = xSemaphoreCreateMutex();
-
-    connectWiFi();
+#if LOW_POWER_MODE
+    lowPowerCycle(); // Ne retourne pas : chaque réveil repasse par setup()
+#endif
 
-    setupWebServer();
+    stateMutex = xSemaphoreCreateMutex();
 
+    // LoRa d'abord : le premier message part sans attendre le WiFi
     loraNode.init();
+    bootPhase("lora");
 
     BaseType_t taskSensorsStatus = xTaskCreatePinnedToCore(taskSensors, "Sensors", 2048, NULL, 1, NULL, 0);
     BaseType_t taskLoRaStatus = xTaskCreatePinnedToCore(taskLoRa, "LoRa", 4096, NULL, 1, NULL, 1);
+    BaseType_t taskWiFiStatus = xTaskCreatePinnedToCore(taskWiFi, "WiFi", 4096, NULL, 0, NULL, 0);
+    bootPhase("tasks");
 
-    if (taskSensorsStatus != pdPASS || taskLoRaStatus != pdPASS) {
+    if (taskSensorsStatus != pdPASS || taskLoRaStatus != pdPASS || taskWiFiStatus != pdPASS) {
         Serial.println("Erreur fatale: Impossible de créer les tâches FreeRTOS !");
         ESP.restart();
     }
@@ -98,16 +110,31 @@ void setup() {
 
 void loop() { vTaskDelete(NULL); }
 
-void connectWiFi() {
-    Serial.print("Connexion au WiFi...");
+// Jalon du démarrage, en ms depuis le lancement de l'application
+void bootPhase(const char* phase, unsigned long at) {
+    Serial.printf("[BOOT] %-8s %6lu ms\n", phase, at);
+}
+
+// WiFi et interface web, en arrière-plan : la liaison LoRa n'en dépend jamais
+void taskWiFi(void* params) {
+#if WIFI_ON_DEMAND
+    pinMode(WIFI_BUTTON_PIN, INPUT_PULLUP);
+    while (digitalRead(WIFI_BUTTON_PIN) != LOW) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+#endif
+    Serial.println("Connexion au WiFi...");
     WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
     while (WiFi.status() != WL_CONNECTED) {
-        delay(500);
-        Serial.print(".");
+        vTaskDelay(pdMS_TO_TICKS(250));
     }
-    Serial.println(" Connecté!");
+    bootPhase("wifi");
     Serial.print("IP Address: ");
     Serial.println(WiFi.localIP());
+
+    setupWebServer();
+    bootPhase("web");
+    vTaskDelete(NULL);
 }
 
 void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
@@ -134,8 +161,12 @@ void setupWebServer() {
 
 void taskSensors(void* params) {
     unsigned long lastChangeTime = 0;
-    bool lastStableState = false;
-    bool currentState = false;
+    // L'état lu au démarrage est retenu tel quel : le premier rapport part sans attendre la confirmation
+    bool currentState = (digitalRead(WATER_LEVEL_PIN) == LOW);
+    bool lastStableState = currentState;
+    xSemaphoreTake(stateMutex, portMAX_DELAY);
+    sharedState.isFull = lastStableState;
+    xSemaphoreGive(stateMutex);
 
     for(;;) {
         bool rawState = (digitalRead(WATER_LEVEL_PIN) == LOW);
@@ -145,6 +176,10 @@ void taskSensors(void* params) {
             lastChangeTime = millis();
         }
 
+        if (loraNode.isReportDue()) {
+            loraNode.sendTelemetry(lastStableState);
+        }
+
         if ((millis() - lastChangeTime > LEVEL_CONFIRMATION_MS) && (currentState != lastStableState)) {
             lastStableState = currentState;
             Serial.printf("Nouvel état de niveau confirmé : %s\n", lastStableState ? "PLEIN" : "VIDE");
@@ -160,7 +195,7 @@ void taskSensors(void* params) {
             ws.textAll(output);
 
             if(loraNode.isJoined()) {
-                loraNode.sendTelemetry(lastStableState);
+                loraNode.sendTelemetry(lastStableState, true); // Changement de niveau : envoi confirmé
             }
         }
         
@@ -169,8 +204,116 @@ void taskSensors(void* params) {
 }
 
 void taskLoRa(void* params) {
+    bool firstTxReported = false;
     for(;;) {
-        loraNode.run();
-        vTaskDelay(pdMS_TO_TICKS(10000));
+        loraNode.run(); // Bloque jusqu'à DIO1, une demande d'émission ou la prochaine échéance
+        if (!firstTxReported && loraNode.getFirstTxAt() >= 0) {
+            bootPhase("first_tx", loraNode.getFirstTxAt());
+            firstTxReported = true;
+        }
     }
 }
+
+#if LOW_POWER_MODE
+// ===================== MODE BASSE CONSOMMATION =====================
+
+#define LEVEL_RTC_MAGIC 0x4C56524CUL // "LRVL"
+
+// Anti-rebond et échéances, conservés d'un réveil à l'autre (horloge rtcMillis)
+struct LevelRtc {
+    uint32_t magic;
+    bool stableLevel;          // Dernier niveau confirmé
+    bool pending;              // Changement du contact en cours de confirmation
+    uint64_t changeAt;         // Début de ce changement
+    uint64_t reportAt;         // Prochain heartbeat (UINT64_MAX tant que le module n'a pas adhéré)
+    uint64_t loraAt;           // Prochaine échéance de LoraNode : adhésion ou nouvel essai
+};
+static RTC_DATA_ATTR LevelRtc rtcLevel;
+
+static const char* wakeCauseName(esp_sleep_wakeup_cause_t cause) {
+    switch (cause) {
+        case ESP_SLEEP_WAKEUP_EXT0: return "ext0";
+        case ESP_SLEEP_WAKEUP_TIMER: return "timer";
+        default: return "boot";
+    }
+}
+
+// Un réveil : lecture du contact, émission si nécessaire, puis sommeil profond jusqu'à la prochaine
+// échéance. La ligne "POWER" finale sert de journal de mesure (voir tools/power_report.py).
+void lowPowerCycle() {
+    esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
+    uint64_t wokeAt = rtcMillis();
+    gpio_num_t levelPin = (gpio_num_t)WATER_LEVEL_PIN;
+    rtc_gpio_deinit(levelPin); // Broche rendue au GPIO numérique après un réveil ext0
+    pinMode(WATER_LEVEL_PIN, INPUT_PULLUP);
+    bool rawState = (digitalRead(WATER_LEVEL_PIN) == LOW);
+
+    if (rtcLevel.magic != LEVEL_RTC_MAGIC) {
+        rtcLevel = {};
+        rtcLevel.magic = LEVEL_RTC_MAGIC;
+        rtcLevel.stableLevel = rawState;
+    }
+
+    // Même logique de confirmation que taskSensors, mais d'un réveil à l'autre
+    bool confirmed = false;
+    if (rawState == rtcLevel.stableLevel) {
+        rtcLevel.pending = false;
+    } else if (!rtcLevel.pending) {
+        rtcLevel.pending = true;
+        rtcLevel.changeAt = wokeAt;
+    } else if (wokeAt - rtcLevel.changeAt >= LEVEL_CONFIRMATION_MS) {
+        rtcLevel.stableLevel = rawState;
+        rtcLevel.pending = false;
+        confirmed = true;
+        Serial.printf("Nouvel état de niveau confirmé : %s\n", rawState ? "PLEIN" : "VIDE");
+    }
+
+    // La radio n'est démarrée que si quelque chose est à émettre
+    bool coldBoot = cause != ESP_SLEEP_WAKEUP_EXT0 && cause != ESP_SLEEP_WAKEUP_TIMER;
+    bool radioOn = coldBoot || confirmed || wokeAt >= rtcLevel.reportAt || wokeAt >= rtcLevel.loraAt;
+    if (radioOn) {
+        loraNode.init();
+        bool wasJoined = loraNode.isJoined();
+        bool report = wasJoined && (confirmed || wokeAt >= rtcLevel.reportAt);
+        if (report) {
+            loraNode.sendTelemetry(rtcLevel.stableLevel, confirmed); // Changement de niveau : envoi confirmé
+        }
+        uint32_t loraDelay = loraNode.serviceNow();
+        if (!wasJoined && loraNode.isJoined()) {
+            loraNode.sendTelemetry(rtcLevel.stableLevel, true); // État initial, dès l'adhésion
+            loraDelay = loraNode.serviceNow();
+            report = true;
+        }
+
+        uint64_t now = rtcMillis();
+        if (!loraNode.isJoined()) {
+            rtcLevel.reportAt = UINT64_MAX;
+        } else if (report) {
+            rtcLevel.reportAt = now + loraNode.getHeartbeatInterval();
+        }
+        rtcLevel.loraAt = loraDelay == UINT32_MAX ? UINT64_MAX : now + loraDelay;
+        loraNode.sleep();
+    }
+
+    uint64_t now = rtcMillis();
+    uint64_t wakeAt = min(rtcLevel.reportAt, rtcLevel.loraAt);
+    if (rtcLevel.pending) wakeAt = min(wakeAt, rtcLevel.changeAt + LEVEL_CONFIRMATION_MS);
+    uint64_t sleepMs = wakeAt > now ? wakeAt - now : 0;
+    if (sleepMs > REPORT_INTERVAL_MAX_MS) sleepMs = REPORT_INTERVAL_MAX_MS;
+
+    // Réveil dès que le contact quitte son état actuel (déclenchement sur niveau : un changement
+    // survenu depuis la lecture réveille aussitôt)
+    rtc_gpio_pullup_en(levelPin);
+    rtc_gpio_pulldown_dis(levelPin);
+    if (esp_sleep_enable_ext0_wakeup(levelPin, rawState ? 1 : 0) != ESP_OK) {
+        Serial.println("[POWER] ERREUR : réveil ext0 refusé, le contact ne sera relu qu'au prochain réveil");
+    }
+    esp_sleep_enable_timer_wakeup(sleepMs * 1000ULL);
+
+    Serial.printf("POWER wake=%s t=%llu awake_ms=%lu tx_ms=%ld sleep_ms=%llu level=%d radio=%d\n",
+                  wakeCauseName(cause), wokeAt, millis(), loraNode.getFirstTxAt(), sleepMs,
+                  rtcLevel.stableLevel, radioOn);
+    Serial.flush();
+    esp_deep_sleep_start();
+}
+#endif
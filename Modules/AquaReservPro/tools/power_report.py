@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+# Bilan du mode basse consommation (env:lowpower) à partir du port série du module.
+# Chaque réveil se termine par une ligne :
+#   POWER wake=ext0 t=123456 awake_ms=412 tx_ms=96 sleep_ms=60000 level=1 radio=1
+# t est l'horloge RTC au réveil : l'écart entre deux lignes donne la durée réelle du cycle, même
+# quand un changement du contact écourte le sommeil prévu. millis() ne compte qu'à partir du
+# lancement de l'application : --boot-ms ajoute le démarrage (ROM et bootloader) à chaque réveil.
+#   power_report.py moniteur.log --awake-ma 45 --sleep-ua 20 --battery-mah 2600
+import argparse
+import re
+import sys
+
+LINE = re.compile(r"POWER wake=(\w+) t=(\d+) awake_ms=(\d+) tx_ms=(-?\d+) sleep_ms=(\d+) level=(\d) radio=(\d)")
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def parse(path):
+    cycles = []
+    with open(path, "rb") as f:
+        for raw in f:
+            match = LINE.search(raw.decode("utf-8", "replace"))
+            if match:
+                wake, t, awake, tx, sleep, level, radio = match.groups()
+                cycles.append({"wake": wake, "t": int(t), "awake": int(awake), "tx": int(tx),
+                               "sleep": int(sleep), "level": int(level), "radio": int(radio)})
+    return cycles
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Bilan du mode basse consommation d'AquaReservPro")
+    parser.add_argument("log")
+    parser.add_argument("--boot-ms", type=float, default=60.0, help="démarrage avant setup(), par réveil")
+    parser.add_argument("--awake-ma", type=float, default=45.0, help="courant moyen éveillé, radio comprise")
+    parser.add_argument("--sleep-ua", type=float, default=20.0, help="courant en sommeil profond (carte entière)")
+    parser.add_argument("--battery-mah", type=float, default=0.0, help="capacité pour l'estimation d'autonomie")
+    args = parser.parse_args()
+
+    cycles = parse(args.log)
+    if not cycles:
+        sys.exit("%s : aucune ligne POWER" % args.log)
+
+    awake_ms = sleep_ms = 0.0
+    for i, cycle in enumerate(cycles):
+        awake = cycle["awake"] + args.boot_ms
+        if i + 1 < len(cycles) and cycles[i + 1]["t"] > cycle["t"]:
+            period = cycles[i + 1]["t"] - cycle["t"]
+            sleep = max(0.0, period - awake)
+        else:
+            sleep = cycle["sleep"]  # Dernier réveil, ou redémarrage entre deux lignes
+        awake_ms += awake
+        sleep_ms += sleep
+
+    causes = {}
+    for cycle in cycles:
+        causes[cycle["wake"]] = causes.get(cycle["wake"], 0) + 1
+    total_ms = awake_ms + sleep_ms
+    print("%d réveil(s) sur %.2f h : %s" % (len(cycles), total_ms / 3.6e6,
+                                           ", ".join("%s %d" % item for item in sorted(causes.items()))))
+    print("Radio démarrée : %d réveil(s)" % sum(cycle["radio"] for cycle in cycles))
+
+    latencies = [cycle["tx"] + args.boot_ms for cycle in cycles if cycle["tx"] >= 0]
+    if latencies:
+        print("Réveil -> émission : médiane %.0f ms, p95 %.0f ms, max %.0f ms (%d émission(s))"
+              % (percentile(latencies, 0.5), percentile(latencies, 0.95), max(latencies), len(latencies)))
+
+    charge_mas = awake_ms / 1000 * args.awake_ma + sleep_ms / 1000 * args.sleep_ua / 1000
+    average_ma = charge_mas / (total_ms / 1000) if total_ms else 0.0
+    print("Temps éveillé : %.3f %% ; courant moyen : %.3f mA" % (100 * awake_ms / total_ms if total_ms else 0, average_ma))
+    if args.battery_mah and average_ma:
+        print("Autonomie estimée : %.0f jours pour %.0f mAh" % (args.battery_mah / average_ma / 24, args.battery_mah))
+
+
+if __name__ == "__main__":
+    main()
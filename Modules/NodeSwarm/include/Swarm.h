@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "VirtualNode.h"
+
+static_assert(SWARM_NODE_COUNT > 0 && SWARM_NODE_COUNT <= SWARM_MAX_NODES, "SWARM_NODE_COUNT hors bornes");
+
+// Les modules virtuels partagent une seule radio, laissée en réception entre deux émissions.
+// Les trames descendantes sont aiguillées par nodeId ; le JOIN_ACCEPT ne porte pas l'adresse MAC
+// du demandeur, d'où une seule adhésion en cours à la fois.
+class Swarm {
+public:
+    void init();
+    void run();
+    uint8_t getJoinedCount() const;
+
+private:
+    VirtualNode nodes[SWARM_NODE_COUNT];
+    uint32_t savedCtr[SWARM_NODE_COUNT];  // Compteurs tels qu'écrits en NVS
+    SwarmStats stats;
+    uint8_t nextNode = 0;                 // Tourniquet : aucun module ne monopolise la radio
+    unsigned long lastTxAt = 0;
+    unsigned long lastSaveAt = 0;
+    unsigned long lastReportAt = 0;
+
+    void loadState();
+    void saveState(bool force);
+    void transmitNext(unsigned long now, bool joinAllowed);
+    bool transmit(const Uplink& up);
+    void receive();
+    void dispatch(JsonObjectConst msg, unsigned long now);
+    void printReport(unsigned long now);
+    String encryptPayload(const char* plaintext, size_t length);
+    String decryptPayload(const String& b64_ciphertext);
+};
@@ -0,0 +1,102 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+enum UplinkKind { UPLINK_JOIN, UPLINK_TELEMETRY, UPLINK_EVENT, UPLINK_ACK, UPLINK_KIND_COUNT };
+
+// Message en clair préparé par un module virtuel, chiffré et émis par l'essaim
+struct Uplink {
+    UplinkKind kind;
+    uint32_t msgCtr;
+    char plaintext[160];        // LORA_MAX_PLAINTEXT_LEN des modules : une seule trame
+};
+
+// Bilan cumulé de l'essaim, affiché par la ligne de synthèse
+struct SwarmStats {
+    uint32_t sent[UPLINK_KIND_COUNT];
+    uint32_t txFailed;
+    uint32_t joinAccepted;
+    uint32_t joinTimeouts;
+    uint32_t eventsAcked;
+    uint32_t eventRetries;
+    uint32_t eventsDropped;     // Abandonnés après CONFIRMED_MAX_ATTEMPTS, ou file pleine
+    uint32_t commands;
+    uint32_t downlinksMissed;   // Adressés à un module qui n'était pas en écoute
+    uint32_t airtimeMs;
+};
+
+// Un module simulé par l'essaim : même protocole et mêmes temporisations qu'un WellguardPro ou
+// un AquaReservPro, sans capteurs ni radio propre. Les appels viennent tous de la tâche LoRa.
+class VirtualNode {
+public:
+    void begin(uint8_t index, const char* mac, uint32_t seed, SwarmStats* stats);
+    void restore(uint8_t nodeId, uint32_t msgCtr, uint32_t joinNonce);
+    const char* getMac() const { return mac; }
+    uint8_t getNodeId() const { return nodeId; }
+    uint32_t getMsgCounter() const { return msgCounter; }
+    uint32_t getJoinNonce() const { return joinNonce; }
+    bool isJoined() const { return nodeId != 0; }
+    bool isJoinPending() const { return joinPending; }
+    bool isListening(unsigned long now) const;
+
+    bool nextUplink(unsigned long now, bool joinAllowed, Uplink& up);
+    void onTransmitted(const Uplink& up, bool ok, unsigned long now);
+    void onJoinAccept(uint8_t assignedId, unsigned long now);
+    void handleMessage(JsonObjectConst msg, unsigned long now);
+    void service(unsigned long now);
+
+private:
+    uint8_t index = 0;
+    char mac[18];
+    const char* devType = "";
+    uint32_t seed = 0;
+    SwarmStats* stats = nullptr;
+
+    uint8_t nodeId = 0;
+    uint32_t msgCounter = 0;
+    uint32_t reportIntervalMs = TELEMETRY_INTERVAL_MS;
+    uint32_t reportJitterMs = 0;
+
+    // Adhésion
+    bool joinPending = false;
+    uint8_t joinAttempts = 0;
+    uint32_t joinNonce = 0;           // Croissant d'un JOIN_REQUEST à l'autre : la passerelle refuse un nonce déjà vu
+    unsigned long joinAt = 0;
+    unsigned long bootAt = 0;
+
+    // Écoute après la dernière émission
+    unsigned long rxUntil = 0;
+
+    // Calendrier
+    unsigned long nextTelemetryAt = 0;
+    unsigned long nextEventAt = 0;
+
+    // Événement confirmé en cours et événements en attente derrière lui
+    bool eventActive = false;
+    bool awaitingAck = false;
+    uint32_t eventCtr = 0;
+    uint8_t eventAttempts = 0;
+    unsigned long eventRetryAt = 0;
+    uint8_t queuedEvents = 0;
+
+    // Acquittement d'une commande, émis après le délai de traitement
+    bool ackPending = false;
+    uint16_t ackMsgId = 0;
+    unsigned long ackDueAt = 0;
+
+    // État simulé du module
+    bool pumpOn = false;
+    bool levelFull = false;
+
+    bool isWellguard() const { return (index % 2) == 0; }
+    uint32_t uniform(uint32_t maxMs);
+    uint32_t exponential(uint32_t meanMs);
+    void scheduleTelemetry(unsigned long from);
+    void buildJoin(Uplink& up);
+    void buildTelemetry(Uplink& up, bool confirmed);
+    void buildAck(Uplink& up);
+    void handleCommand(JsonObjectConst cmd, unsigned long now);
+    void applyReportConfig(JsonObjectConst params);
+    void logOutcome(UplinkKind kind, uint32_t ctr, const char* format, ...) __attribute__((format(printf, 4, 5)));
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#define FIRMWARE_VERSION "1.0.0-NodeSwarm"
+
+// -- Configuration Matérielle --
+#define LORA_CS 8
+#define LORA_DIO1 14
+#define LORA_RST 12
+#define LORA_BUSY 13
+#define LORA_FREQ 868.0f
+
+// -- Essaim de modules virtuels --
+// Une seule carte joue le rôle de SWARM_NODE_COUNT modules : chacun a sa propre adresse MAC,
+// son identifiant, son compteur et son calendrier d'émission. Les modules virtuels alternent
+// entre WellguardPro (indices pairs) et AquaReservPro (indices impairs).
+#ifndef SWARM_NODE_COUNT
+#define SWARM_NODE_COUNT 16
+#endif
+#define SWARM_MAX_NODES 64             // Borne de SWARM_NODE_COUNT (le gateway en gère MAX_DEVICES)
+#define SWARM_BOOT_SPREAD_MS 60000     // Première adhésion de chaque module tirée dans [0, 60s]
+#define SWARM_TX_GUARD_MS 400          // Écoute minimale après une émission avant la suivante (réponse de la passerelle)
+#define SWARM_POLL_MS 20               // Période de la boucle radio en l'absence d'interruption
+#define SWARM_REPORT_INTERVAL_MS 60000 // Ligne de synthèse sur le port série
+
+// -- Distributions de temps --
+// Télémétrie périodique : intervalle assigné par la passerelle + gigue uniforme.
+// Événements (pompe, niveau) : processus de Poisson, émis en messages confirmés.
+// Acquittement des commandes : délai de traitement uniforme.
+#ifndef SWARM_EVENT_MEAN_INTERVAL_MS
+#define SWARM_EVENT_MEAN_INTERVAL_MS 600000 // Moyenne par module ; 0 : aucun événement
+#endif
+#define SWARM_ACK_DELAY_MIN_MS 20
+#define SWARM_ACK_DELAY_MAX_MS 300
+
+// -- Reprise après redémarrage --
+// Les compteurs ne sont sauvegardés que périodiquement (la NVS ne supporterait pas une écriture
+// par trame et par module) : au démarrage, ils sont avancés d'une marge supérieure au nombre de
+// messages qu'un module peut émettre entre deux sauvegardes, pour ne pas être pris pour un rejeu.
+#define SWARM_NVS_SAVE_INTERVAL_MS 60000
+#define SWARM_COUNTER_BOOT_MARGIN 64
+
+// -- Paramètres des modules réels (mêmes valeurs que WellguardPro et AquaReservPro) --
+#define TELEMETRY_INTERVAL_MS 30000
+#define REPORT_INTERVAL_MIN_MS 10000
+#define REPORT_INTERVAL_MAX_MS 3600000
+#define NODE_RX_WINDOW_MS 1500        // Un module n'entend la passerelle qu'après ses propres émissions
+#define JOIN_BACKOFF_BASE_MS 8000
+#define JOIN_BACKOFF_MAX_MS 300000
+#define JOIN_RX_TIMEOUT_MS 5000
+#define CONFIRMED_QUEUE_SIZE 4
+#define CONFIRMED_MAX_ATTEMPTS 6
+#define CONFIRMED_BACKOFF_BASE_MS 3000
+#define CONFIRMED_BACKOFF_MAX_MS 60000
+
+// Namespace pour la sauvegarde en mémoire non-volatile
+#define NVS_NAMESPACE "swarm"
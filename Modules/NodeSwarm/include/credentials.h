@@ -0,0 +1,8 @@
+#pragma once
+
+// -- Configuration LoRa --
+// Clé secrète partagée pour la communication LoRa (16 octets), identique à celle des modules
+#define LORA_SECRET_KEY "HydrauParkSecretKey2025"
+
+// Vecteur d'initialisation (IV) pour le chiffrement AES (16 octets)
+#define LORA_AES_IV "INITIALVECTORIV0"
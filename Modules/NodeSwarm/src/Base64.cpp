@@ -0,0 +1,81 @@
+#include <Arduino.h>
+#include "Base64.h"
+
+static const char b64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+String Base64::encode(const byte* data, size_t size) {
+    String out;
+    int i = 0, j = 0;
+    byte char_array_3[3], char_array_4[4];
+
+    while (size--) {
+        char_array_3[i++] = *(data++);
+        if (i == 3) {
+            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+            char_array_4[3] = char_array_3[2] & 0x3f;
+            for (i = 0; (i < 4); i++) out += b64_alphabet[char_array_4[i]];
+            i = 0;
+        }
+    }
+
+    if (i) {
+        for (j = i; j < 3; j++) char_array_3[j] = '\0';
+        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+        for (j = 0; (j < i + 1); j++) out += b64_alphabet[char_array_4[j]];
+        while ((i++ < 3)) out += '=';
+    }
+
+    return out;
+}
+
+String Base64::decode(const String& data) {
+    int in_len = data.length();
+    int i = 0, j = 0, in_ = 0;
+    byte char_array_4[4], char_array_3[3];
+    String ret;
+
+    while (in_len-- && (data[in_] != '=') && (isalnum(data[in_]) || data[in_] == '+' || data[in_] == '/')) {
+        char_array_4[i++] = data[in_]; in_++;
+        if (i == 4) {
+            for (i = 0; i < 4; i++) char_array_4[i] = strchr(b64_alphabet, char_array_4[i]) - b64_alphabet;
+            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+            for (i = 0; (i < 3); i++) ret += (char)char_array_3[i];
+            i = 0;
+        }
+    }
+
+    if (i) {
+        for (j = i; j < 4; j++) char_array_4[j] = 0;
+        for (j = 0; j < 4; j++) char_array_4[j] = strchr(b64_alphabet, char_array_4[j]) - b64_alphabet;
+        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+        char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+        for (j = 0; (j < i - 1); j++) ret += (char)char_array_3[j];
+    }
+
+    return ret;
+}
+
+size_t Base64::decode(const String& data, byte* out, size_t maxLen) {
+    size_t outLen = 0;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (unsigned int i = 0; i < data.length() && data[i] != '='; i++) {
+        const char* pos = strchr(b64_alphabet, data[i]);
+        if (!pos || data[i] == '\0') break;
+        acc = (acc << 6) | (pos - b64_alphabet);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (outLen >= maxLen) return outLen;
+            out[outLen++] = (acc >> bits) & 0xFF;
+        }
+    }
+    return outLen;
+}
@@ -0,0 +1,253 @@
+#include "Swarm.h"
+#include "config.h"
+#include "credentials.h"
+#include "helpers.h"
+#include "Base64.h"
+#include <RadioLib.h>
+#include <ArduinoJson.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <AESLib.h>
+
+extern SX1262 radio;
+Preferences preferences;
+AESLib aesLib;
+
+// Tampons pour le chiffrement/déchiffrement
+byte aes_key[16];
+byte aes_iv[16];
+byte encrypted[256];
+byte decrypted[256];
+
+static TaskHandle_t radioTaskHandle = NULL;
+
+static void IRAM_ATTR radioInterrupt() {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(radioTaskHandle, &xHigherPriorityTaskWoken);
+    if (xHigherPriorityTaskWoken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void Swarm::init() {
+    memcpy(aes_key, LORA_SECRET_KEY, 16);
+    memcpy(aes_iv, LORA_AES_IV, 16);
+    memset(&stats, 0, sizeof(stats));
+
+    // Adresses localement administrées (02:...) dérivées de celle de la carte : deux essaims
+    // sur la même passerelle ne se marchent pas dessus
+    uint8_t board[6] = {0};
+    sscanf(WiFi.macAddress().c_str(), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx",
+           &board[0], &board[1], &board[2], &board[3], &board[4], &board[5]);
+    for (uint8_t i = 0; i < SWARM_NODE_COUNT; i++) {
+        char mac[18];
+        snprintf(mac, sizeof(mac), "02:%02X:%02X:%02X:53:%02X", board[3], board[4], board[5], i);
+        nodes[i].begin(i, mac, calculateCRC32((const uint8_t*)mac, strlen(mac)), &stats);
+    }
+    loadState();
+
+    Serial.print(F("[LORA] Initializing... "));
+    int state = radio.begin(LORA_FREQ);
+    if (state != RADIOLIB_ERR_NONE) {
+        Serial.printf("failed, code %d\n", state);
+        ESP.restart();
+    }
+    Serial.println(F("success!"));
+    Serial.printf("[SWARM] %u virtual nodes, first MAC %s\n", SWARM_NODE_COUNT, nodes[0].getMac());
+}
+
+// Une itération de la tâche LoRa : réception sur interruption, puis au plus une émission
+void Swarm::run() {
+    if (radioTaskHandle != xTaskGetCurrentTaskHandle()) {
+        radioTaskHandle = xTaskGetCurrentTaskHandle();
+        radio.setDio1Action(radioInterrupt);
+        radio.startReceive();
+    }
+
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SWARM_POLL_MS))) {
+        receive();
+    }
+
+    unsigned long now = millis();
+    bool joinAllowed = true;
+    for (uint8_t i = 0; i < SWARM_NODE_COUNT; i++) {
+        nodes[i].service(now);
+        if (nodes[i].isJoinPending()) joinAllowed = false;
+    }
+
+    // Laisser à la passerelle le temps de répondre au module précédent
+    if (now - lastTxAt >= SWARM_TX_GUARD_MS) {
+        transmitNext(now, joinAllowed);
+    }
+    if (now - lastSaveAt >= SWARM_NVS_SAVE_INTERVAL_MS) {
+        saveState(false);
+        lastSaveAt = now;
+    }
+    if (now - lastReportAt >= SWARM_REPORT_INTERVAL_MS) {
+        printReport(now);
+        lastReportAt = now;
+    }
+}
+
+void Swarm::loadState() {
+    preferences.begin(NVS_NAMESPACE, false);
+    uint8_t restored = 0;
+    for (uint8_t i = 0; i < SWARM_NODE_COUNT; i++) {
+        char key[8];
+        snprintf(key, sizeof(key), "id%u", i);
+        uint8_t nodeId = preferences.getUChar(key, 0);
+        snprintf(key, sizeof(key), "ctr%u", i);
+        savedCtr[i] = preferences.getUInt(key, 0);
+        snprintf(key, sizeof(key), "jn%u", i);
+        nodes[i].restore(nodeId, savedCtr[i], preferences.getUInt(key, 0));
+        if (nodeId) restored++;
+    }
+    preferences.end();
+    Serial.printf("[NVS] %u virtual node(s) restored, counters advanced by %u\n", restored, SWARM_COUNTER_BOOT_MARGIN);
+}
+
+// N'écrit que les modules dont le compteur a changé depuis la dernière sauvegarde
+void Swarm::saveState(bool force) {
+    bool opened = false;
+    for (uint8_t i = 0; i < SWARM_NODE_COUNT; i++) {
+        if (!nodes[i].isJoined() || (!force && nodes[i].getMsgCounter() == savedCtr[i])) continue;
+        if (!opened) {
+            preferences.begin(NVS_NAMESPACE, false);
+            opened = true;
+        }
+        char key[8];
+        snprintf(key, sizeof(key), "id%u", i);
+        preferences.putUChar(key, nodes[i].getNodeId());
+        snprintf(key, sizeof(key), "ctr%u", i);
+        savedCtr[i] = nodes[i].getMsgCounter();
+        preferences.putUInt(key, savedCtr[i]);
+        snprintf(key, sizeof(key), "jn%u", i);
+        preferences.putUInt(key, nodes[i].getJoinNonce());
+    }
+    if (opened) preferences.end();
+}
+
+void Swarm::transmitNext(unsigned long now, bool joinAllowed) {
+    for (uint8_t k = 0; k < SWARM_NODE_COUNT; k++) {
+        uint8_t i = (nextNode + k) % SWARM_NODE_COUNT;
+        Uplink up;
+        if (!nodes[i].nextUplink(now, joinAllowed, up)) continue;
+
+        bool ok = transmit(up);
+        lastTxAt = millis();
+        nodes[i].onTransmitted(up, ok, lastTxAt);
+        nextNode = (i + 1) % SWARM_NODE_COUNT;
+        return;
+    }
+}
+
+// Chiffre et émet le message, puis remet la radio en réception
+bool Swarm::transmit(const Uplink& up) {
+    size_t length = strlen(up.plaintext);
+    StaticJsonDocument<384> finalDoc;
+    finalDoc["p"] = encryptPayload(up.plaintext, length);
+    finalDoc["c"] = calculateCRC32((const uint8_t*)up.plaintext, length);
+
+    String frame;
+    serializeJson(finalDoc, frame);
+
+    int state = radio.transmit(frame);
+    if (state == RADIOLIB_ERR_NONE) {
+        stats.airtimeMs += radio.getTimeOnAir(frame.length()) / 1000;
+    } else {
+        Serial.printf("[LORA] Transmit failed, code %d\n", state);
+    }
+    ulTaskNotifyTake(pdTRUE, 0); // Fin d'émission signalée sur DIO1 : ce n'est pas une réception
+    radio.startReceive();
+    return state == RADIOLIB_ERR_NONE;
+}
+
+void Swarm::receive() {
+    String frame;
+    int state = radio.readData(frame);
+    radio.startReceive();
+    if (state != RADIOLIB_ERR_NONE || frame.length() == 0) return;
+
+    StaticJsonDocument<384> rxDoc;
+    if (deserializeJson(rxDoc, frame) != DeserializationError::Ok || !rxDoc.containsKey("p")) return;
+
+    String plaintext = decryptPayload(rxDoc["p"]);
+    if (plaintext.length() == 0) return;
+
+    StaticJsonDocument<384> msgDoc;
+    if (deserializeJson(msgDoc, plaintext) != DeserializationError::Ok) return;
+    dispatch(msgDoc.as<JsonObjectConst>(), millis());
+}
+
+void Swarm::dispatch(JsonObjectConst msg, unsigned long now) {
+    uint8_t target = msg["nodeId"] | 0;
+
+    if (msg["type"] == "JOIN_ACCEPT") {
+        for (uint8_t i = 0; i < SWARM_NODE_COUNT; i++) {
+            if (nodes[i].isJoinPending()) {
+                nodes[i].onJoinAccept(target, now);
+                saveState(true);
+                return;
+            }
+        }
+        // Réponse à un module réel, ou arrivée après la fin de la fenêtre
+        return;
+    }
+
+    // Trames adressées aux modules réels ou diffusées à tous (FUOTA) : ignorées
+    if (target == 0) return;
+    for (uint8_t i = 0; i < SWARM_NODE_COUNT; i++) {
+        if (nodes[i].getNodeId() == target) {
+            nodes[i].handleMessage(msg, now);
+            return;
+        }
+    }
+}
+
+uint8_t Swarm::getJoinedCount() const {
+    uint8_t joined = 0;
+    for (uint8_t i = 0; i < SWARM_NODE_COUNT; i++) {
+        if (nodes[i].isJoined()) joined++;
+    }
+    return joined;
+}
+
+void Swarm::printReport(unsigned long now) {
+    Serial.printf("SWARM_STATS %lu joined=%u/%u join_tx=%u join_ok=%u join_timeout=%u telemetry=%u "
+                  "event_tx=%u event_acked=%u event_retry=%u event_dropped=%u ack_tx=%u commands=%u "
+                  "missed=%u tx_failed=%u duty=%.2f%%\n",
+                  now, getJoinedCount(), SWARM_NODE_COUNT, stats.sent[UPLINK_JOIN], stats.joinAccepted, stats.joinTimeouts,
+                  stats.sent[UPLINK_TELEMETRY], stats.sent[UPLINK_EVENT], stats.eventsAcked, stats.eventRetries,
+                  stats.eventsDropped, stats.sent[UPLINK_ACK], stats.commands, stats.downlinksMissed, stats.txFailed,
+                  now ? stats.airtimeMs * 100.0 / now : 0.0);
+}
+
+String Swarm::encryptPayload(const char* plaintext, size_t length) {
+    int paddedLen = (length / 16 + 1) * 16;
+    byte pad = paddedLen - length;
+
+    byte paddedPlaintext[paddedLen];
+    memcpy(paddedPlaintext, plaintext, length);
+    for (int i = length; i < paddedLen; i++) {
+        paddedPlaintext[i] = pad;
+    }
+
+    aesLib.encrypt(paddedPlaintext, paddedLen, encrypted, aes_key, sizeof(aes_key), aes_iv);
+
+    return Base64::encode(encrypted, paddedLen);
+}
+
+String Swarm::decryptPayload(const String& b64_ciphertext) {
+    String decoded_string = Base64::decode(b64_ciphertext);
+    if (decoded_string.length() == 0 || decoded_string.length() > sizeof(decrypted) - 1) return String();
+
+    aesLib.decrypt((byte*)decoded_string.c_str(), decoded_string.length(), decrypted, aes_key, sizeof(aes_key), aes_iv);
+    decrypted[decoded_string.length()] = '\0';
+
+    // Supprimer le padding PKCS7 (la passerelle complète avec des zéros : la chaîne s'arrête alors au premier)
+    int pad = decrypted[decoded_string.length() - 1];
+    if (pad > 0 && pad <= 16) {
+        return String((char*)decrypted).substring(0, decoded_string.length() - pad);
+    }
+    return String((char*)decrypted);
+}
@@ -0,0 +1,298 @@
+#include "VirtualNode.h"
+#include "helpers.h"
+
+static const char* const KIND_NAMES[UPLINK_KIND_COUNT] = { "JOIN", "TELEMETRY", "EVENT", "ACK" };
+
+// Comparaison tolérante au débordement de millis()
+static bool reached(unsigned long now, unsigned long at) {
+    return (long)(now - at) >= 0;
+}
+
+void VirtualNode::begin(uint8_t index, const char* mac, uint32_t seed, SwarmStats* stats) {
+    this->index = index;
+    strncpy(this->mac, mac, sizeof(this->mac));
+    this->mac[sizeof(this->mac) - 1] = '\0';
+    this->seed = seed ? seed : index + 1;
+    this->stats = stats;
+    devType = isWellguard() ? "WELL_PUMP_STATION" : "RESERVOIR_SENSOR";
+
+    // Démarrage simultané des modules (reprise secteur) : premières adhésions étalées
+    bootAt = millis();
+    joinAt = bootAt + uniform(SWARM_BOOT_SPREAD_MS);
+}
+
+void VirtualNode::restore(uint8_t savedId, uint32_t savedCtr, uint32_t savedNonce) {
+    // Les essais d'adhésion perdus avec une coupure sont rattrapés : un nonce refusé passe au suivant
+    joinNonce = savedNonce;
+    if (savedId == 0) return;
+    unsigned long now = millis();
+    nodeId = savedId;
+    msgCounter = savedCtr + SWARM_COUNTER_BOOT_MARGIN;
+    nextTelemetryAt = now + uniform(reportIntervalMs);
+    nextEventAt = now + exponential(SWARM_EVENT_MEAN_INTERVAL_MS);
+}
+
+bool VirtualNode::isListening(unsigned long now) const {
+    return (long)(rxUntil - now) > 0;
+}
+
+// Choisit le prochain message dû, dans l'ordre de priorité d'un module réel
+bool VirtualNode::nextUplink(unsigned long now, bool joinAllowed, Uplink& up) {
+    if (!isJoined()) {
+        if (joinPending || !joinAllowed || !reached(now, joinAt)) return false;
+        buildJoin(up);
+        return true;
+    }
+    // La commande a été reçue pendant la fenêtre d'écoute : l'ACK part même si elle est encore ouverte
+    if (ackPending && reached(now, ackDueAt)) {
+        buildAck(up);
+        return true;
+    }
+    if (isListening(now)) return false;
+
+    if (eventActive) {
+        if (!awaitingAck && reached(now, eventRetryAt)) {
+            buildTelemetry(up, true);
+            return true;
+        }
+    } else if (queuedEvents > 0) {
+        queuedEvents--;
+        eventActive = true;
+        eventAttempts = 0;
+        eventCtr = 0;
+        if (isWellguard()) pumpOn = !pumpOn;
+        else levelFull = !levelFull;
+        buildTelemetry(up, true);
+        return true;
+    }
+
+    if (reached(now, nextTelemetryAt)) {
+        buildTelemetry(up, false);
+        scheduleTelemetry(now);
+        return true;
+    }
+    return false;
+}
+
+void VirtualNode::onTransmitted(const Uplink& up, bool ok, unsigned long now) {
+    if (!ok) {
+        stats->txFailed++;
+        logOutcome(up.kind, up.msgCtr, "tx_failed");
+        if (up.kind == UPLINK_JOIN) {
+            joinAt = now + computeBackoffDelay(joinAttempts, JOIN_BACKOFF_BASE_MS, JOIN_BACKOFF_MAX_MS, seed);
+        } else if (up.kind == UPLINK_EVENT) {
+            eventRetryAt = now + computeBackoffDelay(eventAttempts, CONFIRMED_BACKOFF_BASE_MS, CONFIRMED_BACKOFF_MAX_MS, seed);
+        } else if (up.kind == UPLINK_ACK) {
+            ackDueAt = now + SWARM_ACK_DELAY_MIN_MS + uniform(SWARM_ACK_DELAY_MAX_MS - SWARM_ACK_DELAY_MIN_MS);
+        }
+        return;
+    }
+
+    stats->sent[up.kind]++;
+    switch (up.kind) {
+        case UPLINK_JOIN:
+            // Résultat connu au JOIN_ACCEPT ou à la fin de la fenêtre
+            joinPending = true;
+            rxUntil = now + JOIN_RX_TIMEOUT_MS;
+            break;
+        case UPLINK_TELEMETRY:
+            rxUntil = now + NODE_RX_WINDOW_MS;
+            logOutcome(up.kind, up.msgCtr, "sent");
+            break;
+        case UPLINK_EVENT:
+            awaitingAck = true;
+            eventAttempts++;
+            rxUntil = now + NODE_RX_WINDOW_MS;
+            break;
+        case UPLINK_ACK:
+            ackPending = false;
+            rxUntil = now + NODE_RX_WINDOW_MS;
+            logOutcome(up.kind, up.msgCtr, "sent msgId=%u", ackMsgId);
+            break;
+        default:
+            break;
+    }
+}
+
+void VirtualNode::onJoinAccept(uint8_t assignedId, unsigned long now) {
+    joinPending = false;
+    rxUntil = now;
+    nodeId = assignedId;
+    // Contrairement aux modules, le compteur n'est pas remis à zéro : la passerelle conserve celui
+    // d'une adresse MAC déjà connue, et un essaim réinstallé serait sinon pris pour un rejeu.
+    stats->joinAccepted++;
+    logOutcome(UPLINK_JOIN, 0, "accepted attempts=%u after=%lums", joinAttempts + 1, now - bootAt);
+    joinAttempts = 0;
+    nextTelemetryAt = now + uniform(reportIntervalMs);
+    nextEventAt = now + exponential(SWARM_EVENT_MEAN_INTERVAL_MS);
+}
+
+void VirtualNode::handleMessage(JsonObjectConst msg, unsigned long now) {
+    const char* type = msg["type"] | "";
+    // Un module réel n'écoute qu'après ses propres émissions
+    if (!isListening(now)) {
+        stats->downlinksMissed++;
+        Serial.printf("SWARM %lu n%02u id=%u DOWNLINK %s missed\n", now, index, nodeId, type);
+        return;
+    }
+
+    if (strcmp(type, "ACK") == 0) {
+        if (awaitingAck && msg["msgCtr"] == eventCtr) {
+            awaitingAck = false;
+            eventActive = false;
+            stats->eventsAcked++;
+            logOutcome(UPLINK_EVENT, eventCtr, "acked attempts=%u", eventAttempts);
+        }
+        // La passerelle peut joindre une commande en attente à son ACK
+        if (msg.containsKey("cmd")) {
+            handleCommand(msg["cmd"], now);
+        }
+    } else if (strcmp(type, "CMD") == 0) {
+        handleCommand(msg, now);
+    } else {
+        // Fragments et mises à jour du firmware ne sont pas simulés par l'essaim
+        Serial.printf("SWARM %lu n%02u id=%u DOWNLINK %s ignored\n", now, index, nodeId, type);
+    }
+}
+
+// Fin des fenêtres d'écoute et arrivée des événements
+void VirtualNode::service(unsigned long now) {
+    if (joinPending && !isListening(now)) {
+        joinPending = false;
+        stats->joinTimeouts++;
+        uint32_t delayMs = computeBackoffDelay(joinAttempts, JOIN_BACKOFF_BASE_MS, JOIN_BACKOFF_MAX_MS, seed);
+        if (joinAttempts < 255) joinAttempts++;
+        joinAt = now + delayMs;
+        logOutcome(UPLINK_JOIN, 0, "timeout attempts=%u retry_in=%ums", joinAttempts, delayMs);
+    }
+
+    if (awaitingAck && !isListening(now)) {
+        awaitingAck = false;
+        if (eventAttempts >= CONFIRMED_MAX_ATTEMPTS) {
+            eventActive = false;
+            stats->eventsDropped++;
+            logOutcome(UPLINK_EVENT, eventCtr, "no_ack dropped attempts=%u", eventAttempts);
+        } else {
+            uint32_t delayMs = computeBackoffDelay(eventAttempts - 1, CONFIRMED_BACKOFF_BASE_MS, CONFIRMED_BACKOFF_MAX_MS, seed);
+            eventRetryAt = now + delayMs;
+            stats->eventRetries++;
+            logOutcome(UPLINK_EVENT, eventCtr, "no_ack attempts=%u retry_in=%ums", eventAttempts, delayMs);
+        }
+    }
+
+    if (SWARM_EVENT_MEAN_INTERVAL_MS && isJoined() && reached(now, nextEventAt)) {
+        nextEventAt = now + exponential(SWARM_EVENT_MEAN_INTERVAL_MS);
+        if (queuedEvents < CONFIRMED_QUEUE_SIZE) {
+            queuedEvents++;
+        } else {
+            // File pleine, comme sur un module : l'événement est perdu
+            stats->eventsDropped++;
+            Serial.printf("SWARM %lu n%02u id=%u EVENT queue_full\n", now, index, nodeId);
+        }
+    }
+}
+
+uint32_t VirtualNode::uniform(uint32_t maxMs) {
+    return maxMs ? nextRandom(seed) % (maxMs + 1) : 0;
+}
+
+// Intervalle d'un processus de Poisson de moyenne meanMs, borné à 20 fois la moyenne
+uint32_t VirtualNode::exponential(uint32_t meanMs) {
+    if (meanMs == 0) return 0;
+    float u = ((nextRandom(seed) >> 8) + 1) / 16777217.0f; // Dans ]0, 1]
+    float delayMs = -logf(u) * meanMs;
+    return delayMs > meanMs * 20.0f ? meanMs * 20 : (uint32_t)delayMs;
+}
+
+void VirtualNode::scheduleTelemetry(unsigned long from) {
+    nextTelemetryAt = from + reportIntervalMs + uniform(reportJitterMs);
+}
+
+void VirtualNode::buildJoin(Uplink& up) {
+    StaticJsonDocument<160> doc;
+    doc["type"] = "JOIN_REQUEST";
+    doc["mac"] = mac;
+    doc["devType"] = devType;
+    doc["jn"] = ++joinNonce;
+    up.kind = UPLINK_JOIN;
+    up.msgCtr = 0;
+    serializeJson(doc, up.plaintext, sizeof(up.plaintext));
+}
+
+void VirtualNode::buildTelemetry(Uplink& up, bool confirmed) {
+    if (confirmed && eventCtr == 0) {
+        eventCtr = ++msgCounter; // Le compteur attribué au premier essai est réutilisé pour les suivants
+    }
+    up.kind = confirmed ? UPLINK_EVENT : UPLINK_TELEMETRY;
+    up.msgCtr = confirmed ? eventCtr : ++msgCounter;
+
+    StaticJsonDocument<192> doc;
+    doc["type"] = "TELEMETRY";
+    doc["nodeId"] = nodeId;
+    doc["msgCtr"] = up.msgCtr;
+    if (confirmed) {
+        doc["conf"] = 1;
+    }
+    JsonObject data = doc.createNestedObject("data");
+    if (confirmed) {
+        // Même contenu que les événements des modules réels
+        if (isWellguard()) data["pump_on"] = pumpOn;
+        else data["level_full"] = levelFull;
+    } else if (isWellguard()) {
+        data["temperature"] = 18.0f + (int32_t)(nextRandom(seed) % 61 - 30) / 10.0f;
+        data["humidity"] = 55.0f + (int32_t)(nextRandom(seed) % 101 - 50) / 10.0f;
+        data["voltage"] = 12.0f + (int32_t)(nextRandom(seed) % 21 - 10) / 100.0f;
+        data["pressure_ok"] = true;
+    } else {
+        data["level_full"] = levelFull;
+        data["voltage"] = 3.3;
+    }
+    serializeJson(doc, up.plaintext, sizeof(up.plaintext));
+}
+
+void VirtualNode::buildAck(Uplink& up) {
+    StaticJsonDocument<128> doc;
+    doc["type"] = "ACK";
+    doc["nodeId"] = nodeId;
+    doc["msgId"] = ackMsgId;
+    doc["msgCtr"] = ++msgCounter;
+    up.kind = UPLINK_ACK;
+    up.msgCtr = msgCounter;
+    serializeJson(doc, up.plaintext, sizeof(up.plaintext));
+}
+
+void VirtualNode::handleCommand(JsonObjectConst cmd, unsigned long now) {
+    const char* method = cmd["method"] | "";
+    stats->commands++;
+    if (strcmp(method, "set_config") == 0) {
+        applyReportConfig(cmd["params"]);
+    } else if (strcmp(method, "setPump") == 0) {
+        pumpOn = cmd["params"]["state"] | pumpOn;
+    }
+    Serial.printf("SWARM %lu n%02u id=%u CMD %s msgId=%u\n", now, index, nodeId, method, (unsigned)(cmd["msgId"] | 0));
+    if (cmd.containsKey("msgId")) {
+        // Une seule commande traitée à la fois : une répétition de la passerelle remplace la précédente
+        ackPending = true;
+        ackMsgId = cmd["msgId"];
+        ackDueAt = now + SWARM_ACK_DELAY_MIN_MS + uniform(SWARM_ACK_DELAY_MAX_MS - SWARM_ACK_DELAY_MIN_MS);
+    }
+}
+
+void VirtualNode::applyReportConfig(JsonObjectConst params) {
+    uint32_t interval = params["interval"] | reportIntervalMs;
+    uint32_t jitter = params["jitter"] | 0;
+    interval = constrain(interval, (uint32_t)REPORT_INTERVAL_MIN_MS, (uint32_t)REPORT_INTERVAL_MAX_MS);
+    if (jitter > interval / 2) jitter = interval / 2;
+    reportIntervalMs = interval;
+    reportJitterMs = jitter;
+}
+
+// Une ligne par émission, une fois son issue connue : "SWARM <ms> n<index> id=<nodeId> <TYPE> ctr=<msgCtr> <issue>"
+void VirtualNode::logOutcome(UplinkKind kind, uint32_t ctr, const char* format, ...) {
+    char outcome[96];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(outcome, sizeof(outcome), format, args);
+    va_end(args);
+    Serial.printf("SWARM %lu n%02u id=%u %s ctr=%u %s\n", millis(), index, nodeId, KIND_NAMES[kind], ctr, outcome);
+}
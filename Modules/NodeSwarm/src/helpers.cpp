@@ -0,0 +1,35 @@
+#include "helpers.h"
+
+// Fonction de calcul du CRC32 (identique à celle de la passerelle)
+uint32_t calculateCRC32(const uint8_t *data, size_t length) {
+    uint32_t crc = 0xffffffff;
+    while (length--) {
+        uint8_t c = *data++;
+        for (uint32_t i = 0x80; i > 0; i >>= 1) {
+            bool bit = crc & 0x80000000;
+            if (c & i) { bit = !bit; }
+            crc <<= 1;
+            if (bit) { crc ^= 0x04c11db7; }
+        }
+    }
+    return crc;
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+    if (seed == 0) seed = 0x9E3779B9; // xorshift ne sort jamais de l'état nul
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+uint32_t computeBackoffDelay(uint8_t attempt, uint32_t baseMs, uint32_t maxMs, uint32_t &seed) {
+    uint32_t ceiling = baseMs;
+    while (attempt-- > 0 && ceiling < maxMs) {
+        ceiling <<= 1;
+    }
+    if (ceiling > maxMs) ceiling = maxMs;
+
+    uint32_t half = ceiling / 2;
+    return half + nextRandom(seed) % (ceiling - half + 1);
+}
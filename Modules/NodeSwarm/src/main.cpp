@@ -0,0 +1,31 @@
+#include <Arduino.h>
+#include <RadioLib.h>
+#include "config.h"
+#include "Swarm.h"
+
+Module mod(LORA_CS, LORA_DIO1, LORA_RST, LORA_BUSY);
+SX1262 radio = &mod;
+Swarm swarm;
+
+void taskLoRa(void* params);
+
+void setup() {
+    Serial.begin(115200);
+    Serial.printf("%s\n", FIRMWARE_VERSION);
+    swarm.init();
+
+    BaseType_t taskLoRaStatus = xTaskCreatePinnedToCore(taskLoRa, "LoRa", 8192, NULL, 1, NULL, 1);
+    if (taskLoRaStatus != pdPASS) {
+        Serial.println("Erreur fatale: Impossible de créer les tâches FreeRTOS !");
+        ESP.restart();
+    }
+}
+
+void loop() { vTaskDelete(NULL); }
+
+// Seule cette tâche accède à la radio et aux modules virtuels
+void taskLoRa(void* params) {
+    for (;;) {
+        swarm.run();
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+#define HISTORY_DATA_LEN 128 // Comme OutboundMessage::data
+
+// Relevé émis, conservé pour être rejoué si la passerelle ne l'a pas reçu
+struct HistoryEntry {
+    uint32_t msgCtr;                 // Compteur de la trame d'origine
+    uint32_t capturedS;              // rtcMillis() / 1000 à la première émission
+    char data[HISTORY_DATA_LEN];     // Objet JSON "data" tel qu'émis
+    uint32_t check;                  // CRC32 des champs précédents
+};
+
+// Historique borné des dernières télémétries émises, en mémoire RTC : il survit à un redémarrage
+// logiciel (watchdog, FUOTA, plantage), pas à une coupure de courant. Les HISTORY_SLOTS entrées
+// sont écrasées à tour de rôle ; la passerelle en redemande une plage de compteurs après une perte.
+class HistoryBuffer {
+public:
+    void begin();
+    void record(uint32_t msgCtr, const char* data);
+    // Plus ancienne entrée dont le compteur est dans [from, to] ; false s'il n'y en a plus
+    bool find(uint32_t from, uint32_t to, HistoryEntry& entry) const;
+    void clear();                    // Nouvelle adhésion : les compteurs repartent de 0
+};
@@ -1,5 +1,42 @@
 #pragma once
 #include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "Fragmentation.h"
+#include "FuotaClient.h"
+#include "HistoryBuffer.h"
+#include "MessageCounter.h"
+
+// Message montant en attente d'émission par la tâche LoRa
+struct OutboundMessage {
+    char data[128];             // Objet JSON "data" déjà sérialisé
+    bool confirmed;
+    uint32_t msgCtr;            // Attribué à la première émission, réutilisé pour les nouveaux essais
+    uint8_t attempts;
+    unsigned long lastAttemptAt;
+    uint32_t retryDelayMs;
+};
+
+// Mesures rapportées par exception, dans l'ordre des paramètres de sendTelemetry()
+enum ReportField : uint8_t { REPORT_TEMPERATURE, REPORT_HUMIDITY, REPORT_VOLTAGE, REPORT_FIELD_COUNT };
+
+// Réglages du rapport, assignés par set_config (tâche LoRa) et lus par la tâche des capteurs
+struct ReportConfig {
+    uint32_t intervalMs = TELEMETRY_INTERVAL_MS; // Écart minimal entre deux rapports
+    uint32_t jitterMs = 0;
+    // Rapport par exception
+    float deadband[REPORT_FIELD_COUNT] = { REPORT_DEADBAND_TEMPERATURE, REPORT_DEADBAND_HUMIDITY, REPORT_DEADBAND_VOLTAGE };
+    float rate[REPORT_FIELD_COUNT] = { REPORT_RATE_TEMPERATURE, REPORT_RATE_HUMIDITY, REPORT_RATE_VOLTAGE };
+    uint32_t heartbeatMs = REPORT_HEARTBEAT_MS;
+    // Lot d'échantillons datés, émis en une trame
+    uint8_t batchSize = REPORT_BATCH_SIZE;
+    uint32_t batchDeadlineMs = REPORT_BATCH_DEADLINE_MS;
+};
+
+// Commande reçue de la passerelle, hors set_config : retourne true si elle est reconnue (la passerelle
+// reçoit alors un ACK). Une commande reconnue mais refusée renseigne refusal, joint à l'ACK ("err") :
+// la passerelle ne la retente pas. Appelée depuis la tâche LoRa.
+typedef bool (*CommandCallback)(const char* method, JsonObjectConst params, const char*& refusal);
 
 class LoraNode {
 public:
@@ -7,18 +44,94 @@ public:
     void run();
     bool isJoined();
     void sendTelemetry(float temp, float humidity, float voltage, bool pressureOk);
+    bool queueUplink(JsonObjectConst data, bool confirmed);
+    void onCommand(CommandCallback callback);
+    long getFirstTxAt() const { return firstTxAt; } // millis() de la première émission, -1 sans émission
 
 private:
     uint8_t nodeId = 0;
-    uint32_t msgCounter = 0;
+    MessageCounter msgCounter;        // Compteur de messages pour la sécurité (anti-rejeu)
     unsigned long lastJoinAttempt = 0;
+    unsigned long nextJoinDelay = 0;  // Délai avant la prochaine tentative d'adhésion
+    uint8_t joinAttempts = 0;         // Tentatives échouées depuis le démarrage
+    uint32_t joinNonce = 0;           // Nonce du dernier JOIN_REQUEST, en NVS
+    uint32_t backoffSeed = 0;         // Graine du backoff, dérivée de l'adresse MAC ; tâche LoRa seule
+    QueueHandle_t confirmedQueue = NULL;
+    QueueHandle_t unconfirmedQueue = NULL;
+    OutboundMessage inFlight;         // Message confirmé en cours (attente d'ACK ou de nouvel essai)
+    bool hasInFlight = false;
+    uint32_t lastAckedCtr = 0;        // Compteur acquitté par le dernier ACK reçu
+    FragmentSender fragmentSender;    // Message montant trop long pour une trame
+    FragmentReassembler reassembler;  // Message descendant fragmenté en cours de réception
+    uint16_t nextTransferId = 0;      // Tiré au démarrage : un redémarrage ne réutilise pas l'identifiant précédent
+    bool fragmentProgress = false;    // Le dernier FACK reçu a acquitté de nouveaux fragments
+    FuotaClient fuota;                // Session de mise à jour du firmware en cours
+    long firstTxAt = -1;              // Jalon du démarrage : temps jusqu'au premier message
     unsigned long lastTelemetryTime = 0;
+    ReportConfig reportConfig;        // Sauvegardé en NVS ; modifié sous reportConfigMux par la tâche LoRa seule
+    portMUX_TYPE reportConfigMux = portMUX_INITIALIZER_UNLOCKED;
+    uint32_t nextReportJitterMs = 0;  // Gigue tirée pour le prochain envoi
+    uint32_t jitterSeed = 0;          // Graine de la gigue, tirée au démarrage ; tâche des capteurs seule
+    float lastSentValue[REPORT_FIELD_COUNT] = { NAN, NAN, NAN };
+    bool lastSentPressureOk = true;
+    bool hasReported = false;         // Le premier rapport, complet, part dès l'adhésion
+    float rateRefValue[REPORT_FIELD_COUNT] = { NAN, NAN, NAN }; // Début de la fenêtre de pente
+    unsigned long rateRefAt = 0;
+    // Lot en cours
+    char batchSamples[REPORT_BATCH_MAX_BYTES]; // "[0,{...}],[5,{...}]"
+    size_t batchLength = 0;
+    uint8_t batchCount = 0;
+    uint32_t batchBase = 0;           // Heure Unix (s) du premier échantillon du lot
+    unsigned long batchStartedAt = 0;
+    // Horloge calée sur l'heure Unix de la passerelle
+    // Écrits ensemble par la tâche LoRa, lus par la tâche des capteurs : sous clockMux
+    int32_t clockOffsetS = 0;         // Heure Unix - rtcMillis(), en secondes
+    bool clockSynced = false;
+    uint64_t clockSyncedAt = 0;       // rtcMillis() de la dernière synchronisation
+    portMUX_TYPE clockMux = portMUX_INITIALIZER_UNLOCKED;
+    uint64_t clockRequestAt = 0;      // rtcMillis() du dernier rapport confirmé pour obtenir l'heure, 0 : aucun
+    // Rattrapage des relevés que la passerelle n'a pas reçus
+    HistoryBuffer history;
+    uint32_t backfillFrom = 0;        // Prochain compteur à rejouer, 0 : aucun rattrapage en cours
+    uint32_t backfillTo = 0;
+    uint32_t backfillSkip[HISTORY_BACKFILL_MAX_SKIP]; // Compteurs de la plage arrivés en retard à la passerelle
+    uint8_t backfillSkipCount = 0;
+    unsigned long lastUplinkAt = 0;   // millis() de la dernière émission
+    CommandCallback commandCallback = nullptr;
 
     void loadConfig();
     void saveConfig();
-    void performJoinRequest();
+    bool performJoinRequest();
+    bool receiveWithTimeout(String& response, unsigned long timeoutMs);
     void listenForCommands();
-    void sendAck(uint16_t msgId);
+    void listenForDownlinks(unsigned long windowMs);
+    void handleDownlink(const String& frame);
+    void handleMessage(JsonObjectConst msg);
+    void handleFragment(JsonObjectConst frag);
+    void sendFragmentAck(uint16_t transferId, uint32_t receivedMask);
+    void serviceFuota();
+    void handleFuotaSetup(JsonObjectConst setup);
+    void sendFuotaStatus();
+    bool sendFragmented(const String& plaintext);
+    bool sendFragmentRound();
+    bool transmitPlaintext(const String& plaintext);
+    void handleCommand(JsonObjectConst cmd);
+    void serviceUplinks();
+    bool isUplinkReady();
+    TickType_t nextUplinkWait();
+    bool transmitUplink(OutboundMessage& msg);
+    void startBackfill(JsonObjectConst params);
+    bool isBackfillDue();
+    bool isBackfillSkipped(uint32_t counter) const;
+    void serviceBackfill();
+    void applyReportConfig(JsonObjectConst params);
+    ReportConfig readReportConfig();
+    void syncClock(JsonObjectConst msg);
+    bool takeClockRequest();
+    bool isClockSynced();
+    bool appendSample(JsonObjectConst values);
+    bool flushBatch(bool confirmed);
+    void sendAck(uint16_t msgId, const char* refusal = nullptr);
     String encryptPayload(const String& plaintext);
     String decryptPayload(const String& b64_ciphertext);
 };
@@ -0,0 +1,32 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Compteur de messages (msgCtr) persistant sans écrire la flash à chaque émission.
+// La NVS ne contient qu'une borne réservée d'avance, relevée de MSG_COUNTER_COMMIT_INTERVAL juste
+// avant que le compteur ne la dépasse : une écriture tous les N messages. Après une coupure de
+// courant, le compteur repart de cette borne : au plus N valeurs sautées, jamais une valeur déjà
+// émise, que l'anti-rejeu de la passerelle refuserait. Après un redémarrage logiciel (watchdog,
+// FUOTA, plantage) ou un réveil, la valeur exacte est reprise de la mémoire RTC.
+// La borne est écrite tour à tour dans MSG_COUNTER_SLOTS clés : la plus grande fait foi, et une
+// écriture interrompue laisse la précédente intacte.
+// Les compteurs sautés ne sont pas des pertes : les MSG_COUNTER_RESTART_FRAMES premiers messages qui
+// suivent un tel redémarrage portent le point de reprise (restartMarker), sur lequel la passerelle se recale.
+class MessageCounter {
+public:
+    void begin();
+    uint32_t next();                 // Compteur du prochain message
+    bool release(uint32_t counter);  // Message jamais émis : rend le compteur s'il est le dernier attribué
+    void reset();                    // Nouvelle adhésion : la passerelle repart de 0
+    uint32_t get() const { return value; }
+    // Compteur repris après le saut d'un redémarrage à froid, 0 hors des premiers messages qui suivent
+    uint32_t restartMarker() const;
+
+private:
+    uint32_t value = 0;              // Dernier compteur attribué
+    uint32_t reserved = 0;           // Borne en NVS : aucun compteur attribué ne la dépasse
+    uint32_t resumedAt = 0;          // Point de reprise après un saut, 0 : aucun
+
+    void commit(uint32_t bound);
+    void saveRtc();
+};
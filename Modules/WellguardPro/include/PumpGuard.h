@@ -0,0 +1,60 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// Cause d'une coupure de la pompe par la protection locale
+enum PumpTrip : uint8_t {
+    PUMP_TRIP_NONE,
+    PUMP_TRIP_DRY_RUN,   // Pression perdue en marche au-delà du délai toléré
+    PUMP_TRIP_MAX_RUN    // Marche continue trop longue
+};
+
+struct PumpTripEvent {
+    PumpTrip reason;
+    uint32_t lowMs;      // Durée de la perte de pression avant la coupure (0 hors marche à sec)
+    // Marche à sec : de l'interruption de perte de pression à la coupure du relais, délai toléré
+    // déduit, soit la latence propre de la protection. 0 sans interruption à l'origine de la
+    // coupure (marche trop longue, pression perdue pendant l'amorçage)
+    uint32_t irqLatencyUs;
+};
+
+// Appelée par la tâche de protection, relais déjà coupé
+typedef void (*PumpTripCallback)(const PumpTripEvent& event);
+
+// Protection locale de la pompe, sans passerelle. Le capteur de pression déclenche une
+// interruption à chaque changement d'état ; une tâche prioritaire, réveillée par l'interruption
+// ou à l'échéance d'une règle, coupe le relais dès qu'une règle est vérifiée. Le défaut est
+// verrouillé, y compris après un redémarrage : la pompe ne redémarre qu'après resetFault().
+// PumpGuard est seul à piloter PUMP_RELAY_PIN.
+class PumpGuard {
+public:
+    void begin(PumpTripCallback callback);
+    bool setPump(bool on);           // false : démarrage refusé, défaut verrouillé
+    bool isPumpOn() const { return pumpOn; }
+    PumpTrip getFault() const { return fault; }
+    void resetFault();
+    // Règles, sauvegardées en NVS : {"enabled": bool, "prime_ms", "delay_ms", "max_run_ms"}
+    void configure(JsonObjectConst params);
+    static const char* tripName(PumpTrip reason);
+
+private:
+    bool enabled = PUMP_GUARD_ENABLED;
+    uint32_t primeMs = PUMP_GUARD_PRIME_MS;
+    uint32_t tripDelayMs = PUMP_GUARD_TRIP_DELAY_MS;
+    uint32_t maxRunMs = PUMP_GUARD_MAX_RUN_MS;
+    volatile bool pumpOn = false;
+    volatile PumpTrip fault = PUMP_TRIP_NONE;
+    int64_t startedAtUs = 0;         // esp_timer_get_time() au démarrage de la pompe
+    int64_t lowSinceUs = 0;          // Début de la perte de pression en cours, 0 : pression présente
+    PumpTripCallback tripCallback = nullptr;
+    TaskHandle_t taskHandle = NULL;
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+    static void IRAM_ATTR pressureInterrupt(void* arg);
+    static void task(void* params);
+    void run();
+    TickType_t evaluate();
+    void trip(PumpTrip reason);
+    void saveConfig();
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// État partagé publié par seqlock : les lecteurs copient la valeur sans verrou et recommencent
+// si une écriture a eu lieu pendant la copie (numéro de séquence impair ou modifié). Les
+// écrivains se succèdent sous un mutex tenu le temps de la copie, jamais pendant une mesure.
+// T doit être trivialement copiable.
+template <typename T>
+class Snapshot {
+public:
+    void begin() { writeLock = xSemaphoreCreateMutex(); }
+
+    T read() const {
+        T copy;
+        uint32_t before, after;
+        do {
+            before = sequence.load(std::memory_order_acquire);
+            memcpy(&copy, (const void*)&value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return copy;
+    }
+
+    // modify reçoit une copie de la valeur courante ; elle est publiée au retour. Le mutex
+    // d'écriture est tenu pendant l'appel : modify ne doit rien faire de lent.
+    template <typename F>
+    void update(F modify) {
+        xSemaphoreTake(writeLock, portMAX_DELAY);
+        T next;
+        memcpy(&next, (const void*)&value, sizeof(T));
+        modify(next);
+        sequence.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy((void*)&value, &next, sizeof(T));
+        sequence.fetch_add(1, std::memory_order_release);
+        xSemaphoreGive(writeLock);
+    }
+
+private:
+    volatile T value = {};
+    std::atomic<uint32_t> sequence{0};
+    SemaphoreHandle_t writeLock = nullptr;
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+
+// Mesure continue de la tension d'alimentation. L'ADC1 échantillonne VOLTAGE_SENSOR_PIN par DMA
+// à VOLTAGE_SAMPLE_RATE_HZ ; chaque trame de VOLTAGE_FRAME_SAMPLES échantillons est moyennée
+// (suréchantillonnage), puis lissée sur les VOLTAGE_FILTER_WINDOW dernières trames par le filtre
+// choisi (VOLTAGE_FILTER). read() rend la dernière valeur filtrée sans jamais attendre l'ADC.
+class VoltageSampler {
+public:
+    bool begin();                    // Démarre le DMA et la tâche de filtrage
+    float read() const;              // En volts ; lecture directe (analogRead) si le DMA n'a pas démarré
+
+private:
+    std::atomic<float> filtered{NAN};
+    float window[VOLTAGE_FILTER_WINDOW];
+    uint8_t windowCount = 0;
+    uint8_t windowNext = 0;
+    uint8_t channel = 0;
+    bool running = false;
+
+    static void task(void* params);
+    void run();
+    float filter(float frameVolts);
+    static float toVolts(float raw);
+};
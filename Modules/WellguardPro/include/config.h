@@ -12,15 +12,148 @@
 #define LORA_FREQ 868.0f
 
 #define PUMP_RELAY_PIN 25      // Pin pour le relais de la pompe
-#define VOLTAGE_SENSOR_PIN 34  // Pin analogique pour le capteur de tension (ADC1_CH6)
+#define VOLTAGE_SENSOR_PIN 7   // Pin analogique pour le capteur de tension (ESP32-S3 : ADC1_CH6, ADC1 = GPIO1-10)
 #define PRESSURE_SENSOR_PIN 26 // Pin pour le capteur de pression (contact)
 #define DHT_PIN 27             // Pin pour le capteur DHT22
 #define DHT_TYPE DHT22
 
+// -- Mesure de la tension (VoltageSampler) --
+// L'ADC1 échantillonne en continu par DMA ; chaque trame est moyennée, puis lissée sur les
+// VOLTAGE_FILTER_WINDOW dernières trames (64 échantillons à 1 kHz : une trame toutes les 64 ms).
+#define VOLTAGE_DIVIDER_RATIO 11.0f
+#define VOLTAGE_SAMPLE_RATE_HZ 1000     // Minimum de l'ADC en mode DMA : 611 Hz
+#define VOLTAGE_FRAME_SAMPLES 64        // Échantillons moyennés par trame (suréchantillonnage)
+#define VOLTAGE_FILTER_MOVING_AVERAGE 0
+#define VOLTAGE_FILTER_MEDIAN 1
+#define VOLTAGE_FILTER VOLTAGE_FILTER_MEDIAN
+#define VOLTAGE_FILTER_WINDOW 15        // Trames, soit ~1 s
+
+// -- Protection locale de la pompe (PumpGuard) --
+// Le contact de pression déclenche une interruption ; une tâche prioritaire coupe le relais dès
+// qu'une règle est vérifiée, sans attendre la passerelle. Le défaut reste verrouillé (NVS) jusqu'à
+// la commande "resetPumpFault". Règles réglables par la commande "setPumpGuard".
+#define PUMP_GUARD_ENABLED true
+#define PUMP_GUARD_PRIME_MS 10000       // Après le démarrage, délai laissé à la pression pour s'établir
+#define PUMP_GUARD_TRIP_DELAY_MS 500    // Perte de pression tolérée en marche (rebonds, coups de bélier)
+#define PUMP_GUARD_MAX_RUN_MS 0         // Marche continue maximale ; 0 : pas de limite
+
+// -- WiFi et interface web --
+// Démarrés en arrière-plan, après la liaison LoRa qui n'en dépend jamais. Avec WIFI_ON_DEMAND,
+// ils ne démarrent qu'à l'appui sur le bouton PRG de la carte.
+#define WIFI_ON_DEMAND 0
+#define WIFI_BUTTON_PIN 0               // Bouton PRG de la Heltec V3
+
 // -- Configuration Système --
 #define LORA_SECRET_KEY "HydrauParkSecretKey2025"
 #define TELEMETRY_INTERVAL_MS 30000  // Envoi de la télémétrie toutes les 30 secondes
 #define SENSOR_READ_INTERVAL_MS 5000 // Lecture des capteurs toutes les 5 secondes
 
+// -- Adhésion au réseau (JOIN) --
+// Backoff exponentiel avec gigue, dont la graine est dérivée de l'adresse MAC :
+// après une coupure de courant, les modules ne retentent pas tous au même instant.
+// L'étalement initial ne s'applique qu'après une mise sous tension ou une chute de tension, seules
+// à redémarrer toute une flotte d'un coup ; après un redémarrage logiciel, l'adhésion part aussitôt.
+#define JOIN_INITIAL_SPREAD_MS 10000  // Première tentative tirée dans [0, 10s] après le démarrage
+#define JOIN_BACKOFF_BASE_MS 8000     // Plafond de la première nouvelle tentative
+#define JOIN_BACKOFF_MAX_MS 300000    // Plafond maximal entre deux tentatives (5 minutes)
+#define JOIN_RX_TIMEOUT_MS 5000       // Fenêtre d'écoute du JOIN_ACCEPT
+// Nonce d'adhésion : croissant, sauvegardé avant chaque JOIN_REQUEST. La passerelle refuse un nonce
+// déjà vu (JOIN_REQUEST rejoué) et ne recale son anti-rejeu que sur un message portant le nonce de la
+// dernière adhésion, joint aux JOIN_NONCE_FRAMES premiers messages qui la suivent
+#define JOIN_NONCE_FRAMES 8
+
+// -- Intervalle de télémétrie piloté par la passerelle --
+// TELEMETRY_INTERVAL_MS n'est que la valeur par défaut : la passerelle assigne l'intervalle
+// et la gigue via la commande "set_config", appliquée immédiatement et sauvegardée en NVS.
+#define REPORT_INTERVAL_MIN_MS 10000   // Bornes de sécurité appliquées à la configuration reçue
+#define REPORT_INTERVAL_MAX_MS 3600000
+#define NODE_RX_WINDOW_MS 1500        // Écoute après chaque émission (ACK et commandes de la passerelle)
+
+// -- Rapport par exception --
+// Une mesure n'est émise que si elle s'écarte du dernier envoi de plus que sa bande morte, ou si
+// sa pente sur REPORT_RATE_WINDOW_MS dépasse son seuil ; seuls les champs concernés partent.
+// L'intervalle de set_config devient l'écart minimal entre deux rapports (une pente ou une perte de
+// pression partent sans attendre, la perte de pression en message confirmé). Sans changement, un
+// rapport complet part après REPORT_HEARTBEAT_MS de silence, à garder sous le délai au-delà duquel
+// la passerelle déclare le module hors ligne (5 minutes). Tout est réglable par set_config.
+#define REPORT_HEARTBEAT_MS 240000       // Silence maximal (4 minutes)
+#define REPORT_RATE_WINDOW_MS 60000      // Pente mesurée sur une minute : le bruit d'un échantillon au suivant ne compte pas
+#define REPORT_DEADBAND_TEMPERATURE 0.5f // °C ; 0 : tout changement est émis
+#define REPORT_DEADBAND_HUMIDITY 3.0f    // %
+#define REPORT_DEADBAND_VOLTAGE 0.3f     // V
+#define REPORT_RATE_TEMPERATURE 2.0f     // °C par minute ; 0 : pas de seuil de pente
+#define REPORT_RATE_HUMIDITY 0.0f
+#define REPORT_RATE_VOLTAGE 1.0f         // V par minute
+
+// -- Rapports par lot --
+// Une fois l'horloge calée sur l'heure de la passerelle (jointe aux JOIN_ACCEPT et aux ACK), les
+// rapports sont regroupés : chaque échantillon est daté par le module, et le lot part en une seule
+// trame quand il compte REPORT_BATCH_SIZE échantillons, quand le plus ancien a attendu
+// REPORT_BATCH_DEADLINE_MS (au moins l'intervalle assigné), ou avec un rapport urgent. Sans heure,
+// les rapports partent un par un, datés par la passerelle, et l'un d'eux est confirmé pour obtenir
+// l'ACK qui la porte. Réglable par set_config ({"batch": n, "batch_ms": ms}).
+// Le lot doit tenir dans une trame : l'objet "data" dispose de LORA_MAX_PLAINTEXT_LEN moins
+// l'enveloppe TELEMETRY, soit 89 octets, dont 24 pour {"t0":...,"b":[]}. Il y tient au plus trois
+// échantillons d'une seule mesure ([0,{"voltage":12.41}] : 21 octets) ; un échantillon qui porte
+// plusieurs mesures en laisse moins, et le lot part dès qu'il est plein.
+#define REPORT_BATCH_SIZE 3              // 1 : pas de lot
+#define REPORT_BATCH_MAX_SIZE 3
+#define REPORT_BATCH_DEADLINE_MS 60000
+// {"type":"TELEMETRY","nodeId":255,"msgCtr":<10 chiffres>,"conf":1,"data":} ; "rst" et "jn" ne
+// suivent qu'un redémarrage ou une adhésion, et un lot qui les porte part alors fragmenté
+#define TELEMETRY_ENVELOPE_LEN 70
+#define REPORT_BATCH_MAX_BYTES (LORA_MAX_PLAINTEXT_LEN - TELEMETRY_ENVELOPE_LEN) // Objet "data" d'un lot
+#define CLOCK_RESYNC_MS 86400000         // Recalage quotidien (dérive de l'oscillateur)
+#define CLOCK_SYNC_RETRY_MS 3600000      // Sans heure dans l'ACK (passerelle sans NTP), nouvelle demande une heure plus tard
+
+// -- Historique et rattrapage --
+// Les dernières télémétries émises sont gardées en mémoire RTC. Quand la passerelle constate un
+// trou dans les compteurs, elle en redemande la plage (commande "backfill") : les relevés retrouvés
+// repartent un par un, en messages HIST, seulement quand aucun autre message n'attend.
+#define HISTORY_SLOTS 24                 // ~3,4 Ko de mémoire RTC
+#define HISTORY_BACKFILL_SPACING_MS 10000 // Écart minimal entre une émission et un relevé rejoué
+#define HISTORY_BACKFILL_MAX_SKIP 4      // Compteurs de la plage déjà reçus par la passerelle ("skip"), à ne pas rejouer
+
+// -- Messages montants confirmés --
+// Les événements critiques sont acquittés par la passerelle et réémis avec backoff
+// tant que l'ACK n'est pas reçu. La télémétrie périodique reste non confirmée.
+#define CONFIRMED_QUEUE_SIZE 4          // Événements confirmés en attente
+#define UNCONFIRMED_QUEUE_SIZE 2        // Télémétries périodiques en attente
+#define CONFIRMED_MAX_ATTEMPTS 6        // Émissions avant abandon (premier essai compris)
+#define CONFIRMED_BACKOFF_BASE_MS 3000
+#define CONFIRMED_BACKOFF_MAX_MS 60000
+
+// -- Fragmentation des messages longs --
+// Au-delà de LORA_MAX_PLAINTEXT_LEN octets en clair, un message ne tient plus dans une trame
+// de 255 octets : il est découpé en fragments, et seuls ceux que la passerelle n'a pas
+// reçus (masque renvoyé dans un FACK) sont réémis.
+#define LORA_MAX_PLAINTEXT_LEN 159
+#define FRAG_CHUNK_SIZE 64               // Octets utiles par fragment
+#define FRAG_MAX_FRAGMENTS 32            // Soit 2048 octets au plus par transfert
+#define FRAG_REASSEMBLY_SLOTS 1          // Un seul transfert descendant à la fois
+#define FRAG_REASSEMBLY_TIMEOUT_MS 30000
+#define FRAG_TX_SPACING_MS 50            // Temps laissé à la passerelle entre deux fragments
+#define FRAG_RX_GAP_MS 1000              // Écoute prolongée tant que des fragments arrivent
+#define FRAG_MAX_ROUNDS 4                // Tours de réémission sans progrès avant abandon
+
+// -- Mises à jour du firmware par LoRa (FUOTA) --
+// La passerelle diffuse l'image par générations de FUOTA_GENERATION_BLOCKS blocs, complétées
+// de lignes de redondance (XOR de blocs). Pendant la session, le module écoute en continu.
+#define FUOTA_BLOCK_SIZE 64              // Doit être identique sur la passerelle
+#define FUOTA_GENERATION_BLOCKS 32       // Doit être identique sur la passerelle
+#define FUOTA_MAX_IMAGE_SIZE 0x180000    // 1,5 Mo, borné en pratique par la partition OTA
+#define FUOTA_OPEN_GENERATIONS 4         // Générations en cours de décodage simultanément (~2,2 Ko chacune)
+#define FUOTA_STATUS_MAX_ENTRIES 16      // Générations incomplètes détaillées par rapport
+#define FUOTA_RX_POLL_MS 500
+#define FUOTA_SESSION_TIMEOUT_MS 600000  // Session abandonnée après 10 minutes sans trame
+#define FUOTA_REBOOT_DELAY_MS 30000      // Image vérifiée : redémarrage une fois la passerelle informée
+
 // Namespace pour la sauvegarde en mémoire non-volatile
 #define NVS_NAMESPACE "node_config"
+
+// -- Persistance du compteur de messages (MessageCounter) --
+// La NVS n'est écrite qu'une fois tous les MSG_COUNTER_COMMIT_INTERVAL messages ; après une coupure
+// de courant, le compteur saute d'au plus autant de valeurs, que la passerelle ne compte pas comme perdues.
+#define MSG_COUNTER_COMMIT_INTERVAL 16
+#define MSG_COUNTER_SLOTS 4              // Clés NVS écrites à tour de rôle
+#define MSG_COUNTER_RESTART_FRAMES 4     // Messages portant le point de reprise ("rst") après une coupure
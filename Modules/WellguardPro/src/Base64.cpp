@@ -38,7 +38,7 @@ String Base64::decode(const String& data) {
     byte char_array_4[4], char_array_3[3];
     String ret;
 
-    while (in_len-- && (data[in_] != '=') && isalnum(data[in_])) {
+    while (in_len-- && (data[in_] != '=') && (isalnum(data[in_]) || data[in_] == '+' || data[in_] == '/')) {
         char_array_4[i++] = data[in_]; in_++;
         if (i == 4) {
             for (i = 0; i < 4; i++) char_array_4[i] = strchr(b64_alphabet, char_array_4[i]) - b64_alphabet;
@@ -61,3 +61,21 @@ String Base64::decode(const String& data) {
 
     return ret;
 }
+
+size_t Base64::decode(const String& data, byte* out, size_t maxLen) {
+    size_t outLen = 0;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (unsigned int i = 0; i < data.length() && data[i] != '='; i++) {
+        const char* pos = strchr(b64_alphabet, data[i]);
+        if (!pos || data[i] == '\0') break;
+        acc = (acc << 6) | (pos - b64_alphabet);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (outLen >= maxLen) return outLen;
+            out[outLen++] = (acc >> bits) & 0xFF;
+        }
+    }
+    return outLen;
+}
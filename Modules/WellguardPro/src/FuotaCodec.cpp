@@ -0,0 +1,70 @@
+#include "FuotaCodec.h"
+
+uint32_t fuotaGenerationCount(uint32_t imageSize) {
+    return (imageSize + FUOTA_GENERATION_SIZE - 1) / FUOTA_GENERATION_SIZE;
+}
+
+uint8_t fuotaBlocksInGeneration(uint32_t imageSize, uint32_t generation) {
+    uint32_t offset = generation * FUOTA_GENERATION_SIZE;
+    if (offset >= imageSize) return 0;
+    uint32_t remaining = imageSize - offset;
+    if (remaining >= FUOTA_GENERATION_SIZE) return FUOTA_GENERATION_BLOCKS;
+    return (remaining + FUOTA_BLOCK_SIZE - 1) / FUOTA_BLOCK_SIZE;
+}
+
+uint32_t fuotaRowMask(uint32_t generation, uint16_t row, uint8_t blocks) {
+    if (blocks == 0) return 0;
+    if (row < blocks) return 1UL << row;
+
+    uint32_t full = blocks >= 32 ? 0xFFFFFFFFUL : ((1UL << blocks) - 1);
+    // xorshift32 amorcé par (génération, ligne) : même tirage sur la passerelle et les modules
+    uint32_t x = (generation * 2654435761UL) ^ ((uint32_t)row * 40503UL) ^ 0x9E3779B9UL;
+    if (x == 0) x = 0x9E3779B9UL;
+    uint32_t mask = 0;
+    for (uint8_t i = 0; i < 4 && mask == 0; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        mask = x & full;
+    }
+    return mask ? mask : 1UL << (row % blocks);
+}
+
+void GenerationDecoder::reset(uint32_t gen, uint8_t blockCount) {
+    generation = gen;
+    blocks = blockCount;
+    pivots = 0;
+}
+
+bool GenerationDecoder::addRow(uint32_t mask, const uint8_t* data) {
+    uint8_t row[FUOTA_BLOCK_SIZE];
+    memcpy(row, data, FUOTA_BLOCK_SIZE);
+    mask &= fullMask();
+
+    while (mask) {
+        uint8_t p = __builtin_ctz(mask);
+        if (!(pivots & (1UL << p))) {
+            masks[p] = mask;
+            memcpy(rows[p], row, FUOTA_BLOCK_SIZE);
+            pivots |= 1UL << p;
+            return true;
+        }
+        mask ^= masks[p];
+        for (int i = 0; i < FUOTA_BLOCK_SIZE; i++) row[i] ^= rows[p][i];
+    }
+    return false; // Combinaison de lignes déjà reçues
+}
+
+const uint8_t* GenerationDecoder::solve() {
+    if (!isComplete()) return nullptr;
+    for (int p = blocks - 1; p >= 0; p--) {
+        uint32_t others = masks[p] & ~(1UL << p);
+        while (others) {
+            uint8_t q = __builtin_ctz(others);
+            others &= others - 1;
+            for (int i = 0; i < FUOTA_BLOCK_SIZE; i++) rows[p][i] ^= rows[q][i];
+        }
+        masks[p] = 1UL << p;
+    }
+    return &rows[0][0];
+}
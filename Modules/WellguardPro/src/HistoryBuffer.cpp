@@ -0,0 +1,66 @@
+#include "HistoryBuffer.h"
+#include "helpers.h"
+#include <esp_system.h>
+
+// Aléatoire après une mise sous tension : chaque entrée porte sa somme de contrôle
+static RTC_NOINIT_ATTR HistoryEntry rtcHistory[HISTORY_SLOTS];
+
+static uint32_t entryCheck(const HistoryEntry& entry) {
+    return calculateCRC32((const uint8_t*)&entry, offsetof(HistoryEntry, check));
+}
+
+static bool isValid(const HistoryEntry& entry) {
+    return entry.msgCtr != 0 && entry.check == entryCheck(entry);
+}
+
+void HistoryBuffer::begin() {
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool warm = reason != ESP_RST_POWERON && reason != ESP_RST_BROWNOUT && reason != ESP_RST_UNKNOWN;
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < HISTORY_SLOTS; i++) {
+        if (warm && isValid(rtcHistory[i])) {
+            kept++;
+        } else {
+            memset(&rtcHistory[i], 0, sizeof(HistoryEntry));
+        }
+    }
+    if (kept) Serial.printf("[HIST] %u entries kept across reboot\n", kept);
+}
+
+// Écrase l'entrée la plus ancienne (ou une entrée libre)
+void HistoryBuffer::record(uint32_t msgCtr, const char* data) {
+    size_t length = strlen(data);
+    if (msgCtr == 0 || length >= HISTORY_DATA_LEN) return;
+
+    uint8_t oldest = 0;
+    for (uint8_t i = 0; i < HISTORY_SLOTS; i++) {
+        if (!isValid(rtcHistory[i])) {
+            oldest = i;
+            break;
+        }
+        if (rtcHistory[i].msgCtr < rtcHistory[oldest].msgCtr) oldest = i;
+    }
+
+    HistoryEntry& entry = rtcHistory[oldest];
+    memset(&entry, 0, sizeof(HistoryEntry));
+    entry.msgCtr = msgCtr;
+    entry.capturedS = (uint32_t)(rtcMillis() / 1000);
+    memcpy(entry.data, data, length);
+    entry.check = entryCheck(entry);
+}
+
+bool HistoryBuffer::find(uint32_t from, uint32_t to, HistoryEntry& entry) const {
+    int8_t found = -1;
+    for (uint8_t i = 0; i < HISTORY_SLOTS; i++) {
+        const HistoryEntry& candidate = rtcHistory[i];
+        if (candidate.msgCtr < from || candidate.msgCtr > to || !isValid(candidate)) continue;
+        if (found < 0 || candidate.msgCtr < rtcHistory[found].msgCtr) found = i;
+    }
+    if (found < 0) return false;
+    entry = rtcHistory[found];
+    return true;
+}
+
+void HistoryBuffer::clear() {
+    memset(rtcHistory, 0, sizeof(rtcHistory));
+}
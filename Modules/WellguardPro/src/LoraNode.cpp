@@ -8,9 +8,9 @@
 #include <Preferences.h>
 #include <WiFi.h>
 #include <AESLib.h>
+#include <esp_system.h>
 
 extern SX1262 radio;
-extern void setPumpState(bool state, bool fromLora);
 Preferences preferences;
 AESLib aesLib;
 
@@ -20,12 +20,39 @@ byte aes_iv[16];
 byte encrypted[256];
 byte decrypted[256];
 
+// Clés JSON des mesures rapportées par exception (télémétrie et paramètres de set_config)
+static const char* const REPORT_FIELD_KEYS[REPORT_FIELD_COUNT] = { "temperature", "humidity", "voltage" };
+#define BATCH_ENVELOPE_LEN 24 // {"t0":<10 chiffres>,"b":[]} autour des échantillons
+
+// Tâche LoRa, réveillée par DIO1 (fin d'émission ou de réception) et par queueUplink
+static TaskHandle_t radioTaskHandle = NULL;
+
+static void IRAM_ATTR radioInterrupt() {
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(radioTaskHandle, &xHigherPriorityTaskWoken);
+    if (xHigherPriorityTaskWoken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
 
 void LoraNode::init() {
     memcpy(aes_key, LORA_SECRET_KEY, 16);
     memcpy(aes_iv, LORA_AES_IV, 16);
 
     loadConfig();
+    history.begin();
+
+    String mac = WiFi.macAddress();
+    backoffSeed = calculateCRC32((const uint8_t*)mac.c_str(), mac.length());
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool powerEvent = reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT;
+    nextJoinDelay = powerEvent ? nextRandom(backoffSeed) % (JOIN_INITIAL_SPREAD_MS + 1) : 0;
+    lastJoinAttempt = millis();
+    nextTransferId = nextRandom(backoffSeed);
+    jitterSeed = nextRandom(backoffSeed);
+
+    confirmedQueue = xQueueCreate(CONFIRMED_QUEUE_SIZE, sizeof(OutboundMessage));
+    unconfirmedQueue = xQueueCreate(UNCONFIRMED_QUEUE_SIZE, sizeof(OutboundMessage));
 
     Serial.print(F("[LORA] Initializing... "));
     int state = radio.begin(LORA_FREQ);
@@ -36,17 +63,40 @@ void LoraNode::init() {
     Serial.println(F("success!"));
 }
 
+// Une itération de la tâche LoRa. Chaque branche bloque (émission, fenêtre d'écoute ou attente
+// d'une notification) : la tâche n'a pas de délai fixe entre deux itérations.
 void LoraNode::run() {
+    if (radioTaskHandle != xTaskGetCurrentTaskHandle()) {
+        radioTaskHandle = xTaskGetCurrentTaskHandle();
+        radio.setDio1Action(radioInterrupt);
+    }
+
     if (nodeId == 0) {
-        if (millis() - lastJoinAttempt > 10000) { // Tenter de joindre toutes les 10s
+        unsigned long elapsed = millis() - lastJoinAttempt;
+        if (elapsed < nextJoinDelay) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(nextJoinDelay - elapsed));
+        } else {
+            if (performJoinRequest()) {
+                joinAttempts = 0;
+            } else {
+                nextJoinDelay = computeBackoffDelay(joinAttempts, JOIN_BACKOFF_BASE_MS, JOIN_BACKOFF_MAX_MS, backoffSeed);
+                if (joinAttempts < 255) joinAttempts++;
+                Serial.printf("[LORA] Join attempt %u failed, next in %lu ms\n", joinAttempts, nextJoinDelay);
+            }
             lastJoinAttempt = millis();
-            performJoinRequest();
         }
+    } else if (fuota.isActive()) {
+        serviceFuota();
     } else {
+        serviceUplinks();
         listenForCommands();
     }
 }
 
+void LoraNode::onCommand(CommandCallback callback) {
+    commandCallback = callback;
+}
+
 bool LoraNode::isJoined() {
     return nodeId != 0;
 }
@@ -54,26 +104,46 @@ bool LoraNode::isJoined() {
 void LoraNode::loadConfig() {
     preferences.begin(NVS_NAMESPACE, false);
     nodeId = preferences.getUChar("nodeId", 0);
-    msgCounter = preferences.getUInt("msgCtr", 0);
+    joinNonce = preferences.getUInt("joinN", 0);
+    reportConfig.intervalMs = preferences.getUInt("txInt", TELEMETRY_INTERVAL_MS);
+    reportConfig.jitterMs = preferences.getUInt("txJit", 0);
+    reportConfig.heartbeatMs = preferences.getUInt("txHb", REPORT_HEARTBEAT_MS);
+    reportConfig.batchSize = constrain(preferences.getUChar("txBat", REPORT_BATCH_SIZE), 1, REPORT_BATCH_MAX_SIZE);
+    reportConfig.batchDeadlineMs = preferences.getUInt("txBatMs", REPORT_BATCH_DEADLINE_MS);
+    preferences.getBytes("txDb", reportConfig.deadband, sizeof(reportConfig.deadband)); // Absentes : valeurs de config.h
+    preferences.getBytes("txRoc", reportConfig.rate, sizeof(reportConfig.rate));
     preferences.end();
-    Serial.printf("[NVS] Node ID: %d, Msg Counter: %u\n", nodeId, msgCounter);
+    msgCounter.begin();
+    Serial.printf("[NVS] Node ID: %d, Msg Counter: %u, Interval: %u ms\n", nodeId, msgCounter.get(), reportConfig.intervalMs);
 }
 
 void LoraNode::saveConfig() {
     preferences.begin(NVS_NAMESPACE, false);
     preferences.putUChar("nodeId", nodeId);
-    preferences.putUInt("msgCtr", msgCounter);
+    preferences.putUInt("txInt", reportConfig.intervalMs); // Tâche LoRa : seule à modifier reportConfig
+    preferences.putUInt("txJit", reportConfig.jitterMs);
+    preferences.putUInt("txHb", reportConfig.heartbeatMs);
+    preferences.putUChar("txBat", reportConfig.batchSize);
+    preferences.putUInt("txBatMs", reportConfig.batchDeadlineMs);
+    preferences.putBytes("txDb", reportConfig.deadband, sizeof(reportConfig.deadband));
+    preferences.putBytes("txRoc", reportConfig.rate, sizeof(reportConfig.rate));
     preferences.end();
-    Serial.printf("[NVS] Config saved. Node ID: %d, Msg Counter: %u\n", nodeId, msgCounter);
+    Serial.printf("[NVS] Config saved. Node ID: %d, Interval: %u ms\n", nodeId, reportConfig.intervalMs);
 }
 
-void LoraNode::performJoinRequest() {
+bool LoraNode::performJoinRequest() {
     Serial.println(F("[LORA] Sending JOIN_REQUEST..."));
     
     StaticJsonDocument<200> doc;
     doc["type"] = "JOIN_REQUEST";
     doc["mac"] = WiFi.macAddress();
     doc["devType"] = DEVICE_TYPE;
+    // Sauvegardé avant l'émission : après une coupure, le nonce émis n'est jamais réutilisé
+    preferences.begin(NVS_NAMESPACE, false);
+    preferences.putUInt("joinN", ++joinNonce);
+    preferences.end();
+    doc["jn"] = joinNonce;
+    doc["hist"] = HISTORY_SLOTS; // Relevés rejouables : la passerelle ne redemande les pertes qu'aux modules qui en gardent
 
     String payloadStr;
     serializeJson(doc, payloadStr);
@@ -87,16 +157,16 @@ void LoraNode::performJoinRequest() {
     String msg;
     serializeJson(finalDoc, msg);
 
+    if (firstTxAt < 0) firstTxAt = millis();
     int state = radio.transmit(msg);
     if (state != RADIOLIB_ERR_NONE) {
         Serial.printf("[LORA] Transmit failed, code %d\n", state);
-        return;
+        return false;
     }
 
-    // Écouter la réponse
+    // Écouter la réponse : la passerelle peut différer l'acceptation pour espacer les JOIN_ACCEPT
     String response;
-    state = radio.receive(response, 5000);
-    if (state == RADIOLIB_ERR_NONE && response.length() > 0) {
+    if (receiveWithTimeout(response, JOIN_RX_TIMEOUT_MS)) {
         StaticJsonDocument<256> rxDoc;
         if (deserializeJson(rxDoc, response) == DeserializationError::Ok && rxDoc.containsKey("p")) {
             String decrypted = decryptPayload(rxDoc["p"]);
@@ -107,9 +177,14 @@ void LoraNode::performJoinRequest() {
 
                     nodeId = joinAcceptDoc["nodeId"];
                     if (nodeId > 0) {
-                        msgCounter = 0; // Réinitialiser le compteur après un join réussi
+                        syncClock(joinAcceptDoc.as<JsonObjectConst>());
+                        msgCounter.reset(); // Réinitialiser le compteur après un join réussi
+                        history.clear();
+                        backfillFrom = 0;
+                        backfillSkipCount = 0;
                         saveConfig();
                         Serial.printf("[LORA] Join successful! Assigned Node ID: %d\n", nodeId);
+                        return true;
                     }
                 }
             }
@@ -117,97 +192,714 @@ void LoraNode::performJoinRequest() {
     } else {
         Serial.println(F("[LORA] No response to JOIN_REQUEST."));
     }
+    return false;
+}
+
+bool LoraNode::receiveWithTimeout(String& response, unsigned long timeoutMs) {
+    // radio.receive() n'attend qu'une centaine de symboles : on ouvre ici une vraie fenêtre temporisée,
+    // pendant laquelle la tâche dort jusqu'à l'interruption DIO1.
+    ulTaskNotifyTake(pdTRUE, 0); // Fin d'émission signalée sur DIO1 : ce n'est pas une réception
+    if (radio.startReceive() != RADIOLIB_ERR_NONE) return false;
+    unsigned long start = millis();
+    bool received = false;
+    for (;;) {
+        if (digitalRead(LORA_DIO1) == HIGH) {
+            int state = radio.readData(response);
+            received = state == RADIOLIB_ERR_NONE && response.length() > 0;
+            break;
+        }
+        unsigned long elapsed = millis() - start;
+        if (elapsed >= timeoutMs) break;
+        // Réveil anticipé possible (queueUplink) : la fenêtre reprend pour le temps restant
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs - elapsed));
+    }
+    radio.standby();
+    return received;
 }
 
+// Entre deux émissions, la radio reste en réception continue : une commande est traitée dès la
+// fin de sa trame, signalée par DIO1. Rend la main dès qu'un message montant est prêt.
 void LoraNode::listenForCommands() {
-    String response;
-    int state = radio.receive(response, 1000); // Écoute non bloquante
-    if (state == RADIOLIB_ERR_NONE && response.length() > 0) {
-        StaticJsonDocument<384> rxDoc;
-        if (deserializeJson(rxDoc, response) != DeserializationError::Ok || !rxDoc.containsKey("p")) return;
-
-        String decrypted = decryptPayload(rxDoc["p"]);
-        if (decrypted.length() == 0) return;
-
-        StaticJsonDocument<256> cmdDoc;
-        if (deserializeJson(cmdDoc, decrypted) != DeserializationError::Ok) return;
-
-        if (cmdDoc["type"] == "CMD" && cmdDoc["nodeId"] == nodeId) {
-            Serial.println("[LORA] Received CMD");
-            if (cmdDoc["method"] == "setPump") {
-                setPumpState(cmdDoc["params"]["state"], true);
-                if (cmdDoc.containsKey("msgId")) {
-                    sendAck(cmdDoc["msgId"]);
-                }
+    ulTaskNotifyTake(pdTRUE, 0);
+    if (radio.startReceive() != RADIOLIB_ERR_NONE) {
+        ulTaskNotifyTake(pdTRUE, nextUplinkWait());
+        return;
+    }
+    while (!isUplinkReady() && !fuota.isActive()) {
+        ulTaskNotifyTake(pdTRUE, nextUplinkWait());
+        if (digitalRead(LORA_DIO1) != HIGH) continue; // Demande d'émission ou échéance d'un nouvel essai
+
+        String response;
+        int state = radio.readData(response);
+        if (state == RADIOLIB_ERR_NONE && response.length() > 0) {
+            handleDownlink(response);
+        }
+        radio.startReceive(); // Réarmée, y compris après un ACK émis par handleDownlink
+    }
+    radio.standby();
+}
+
+bool LoraNode::queueUplink(JsonObjectConst data, bool confirmed) {
+    if (!isJoined()) return false;
+
+    OutboundMessage msg = {};
+    msg.confirmed = confirmed;
+    if (serializeJson(data, msg.data, sizeof(msg.data)) >= sizeof(msg.data) - 1) {
+        Serial.println(F("[LORA] Uplink data too long, dropped"));
+        return false;
+    }
+
+    QueueHandle_t queue = confirmed ? confirmedQueue : unconfirmedQueue;
+    if (xQueueSend(queue, &msg, 0) != pdPASS) {
+        if (!confirmed) return false;
+        // File pleine : l'événement le plus ancien cède sa place au plus récent
+        OutboundMessage dropped;
+        xQueueReceive(queue, &dropped, 0);
+        Serial.printf("[LORA] Confirmed queue full, dropped %s\n", dropped.data);
+        xQueueSend(queue, &msg, 0);
+    }
+    // Réveille la tâche LoRa : le message part sans attendre la fin de son attente
+    if (radioTaskHandle) xTaskNotifyGive(radioTaskHandle);
+    return true;
+}
+
+// Un message montant peut partir sans attendre : télémétrie en file, événement confirmé
+// sans envoi en cours, nouvel essai arrivé à échéance, ou relevé à rejouer sur un canal libre
+bool LoraNode::isUplinkReady() {
+    if (uxQueueMessagesWaiting(unconfirmedQueue) > 0) return true;
+    if (hasInFlight) return millis() - inFlight.lastAttemptAt >= inFlight.retryDelayMs;
+    return uxQueueMessagesWaiting(confirmedQueue) > 0 || isBackfillDue();
+}
+
+// Attente maximale de la tâche LoRa : jusqu'au prochain essai ou au prochain relevé à rejouer,
+// sinon jusqu'à une notification
+TickType_t LoraNode::nextUplinkWait() {
+    if (!hasInFlight) {
+        if (backfillFrom == 0) return portMAX_DELAY;
+        unsigned long elapsed = millis() - lastUplinkAt;
+        return elapsed >= HISTORY_BACKFILL_SPACING_MS ? 0 : pdMS_TO_TICKS(HISTORY_BACKFILL_SPACING_MS - elapsed);
+    }
+    unsigned long elapsed = millis() - inFlight.lastAttemptAt;
+    return elapsed >= inFlight.retryDelayMs ? 0 : pdMS_TO_TICKS(inFlight.retryDelayMs - elapsed);
+}
+
+// Appelé par la tâche LoRa : seule cette tâche émet sur la radio.
+void LoraNode::serviceUplinks() {
+    if (hasInFlight) {
+        if (millis() - inFlight.lastAttemptAt < inFlight.retryDelayMs) {
+            // En attente du prochain essai : la télémétrie périodique peut passer entre-temps
+            OutboundMessage msg;
+            if (xQueueReceive(unconfirmedQueue, &msg, 0) == pdPASS) {
+                transmitUplink(msg);
             }
+            return;
         }
+    } else {
+        OutboundMessage msg;
+        if (xQueueReceive(confirmedQueue, &inFlight, 0) == pdPASS) {
+            hasInFlight = true;
+        } else if (xQueueReceive(unconfirmedQueue, &msg, 0) == pdPASS) {
+            transmitUplink(msg);
+            return;
+        } else {
+            serviceBackfill(); // Rien d'autre n'attend
+            return;
+        }
+    }
+
+    bool acked = transmitUplink(inFlight);
+    inFlight.attempts++;
+    inFlight.lastAttemptAt = millis();
+    if (acked) {
+        Serial.printf("[LORA] Confirmed uplink %u delivered after %u attempt(s)\n", inFlight.msgCtr, inFlight.attempts);
+        hasInFlight = false;
+    } else if (inFlight.attempts >= CONFIRMED_MAX_ATTEMPTS) {
+        Serial.printf("[LORA] Confirmed uplink %u dropped after %u attempts\n", inFlight.msgCtr, inFlight.attempts);
+        hasInFlight = false;
+    } else {
+        inFlight.retryDelayMs = computeBackoffDelay(inFlight.attempts - 1, CONFIRMED_BACKOFF_BASE_MS, CONFIRMED_BACKOFF_MAX_MS, backoffSeed);
+        Serial.printf("[LORA] No ACK for %u, retry in %u ms\n", inFlight.msgCtr, inFlight.retryDelayMs);
     }
 }
 
-void LoraNode::sendAck(uint16_t msgId) {
-    msgCounter++;
-    StaticJsonDocument<128> doc;
-    doc["type"] = "ACK";
+// Émet le message puis écoute la réponse de la passerelle. Retourne true si un ACK correspondant a été reçu.
+bool LoraNode::transmitUplink(OutboundMessage& msg) {
+    bool firstAttempt = msg.msgCtr == 0;
+    if (firstAttempt) {
+        msg.msgCtr = msgCounter.next(); // Incrémenter avant l'envoi
+    }
+
+    StaticJsonDocument<256> doc;
+    doc["type"] = "TELEMETRY";
     doc["nodeId"] = nodeId;
-    doc["msgId"] = msgId;
-    doc["msgCtr"] = msgCounter;
+    doc["msgCtr"] = msg.msgCtr;
+    uint32_t restartedAt = msgCounter.restartMarker();
+    if (restartedAt) doc["rst"] = restartedAt; // Compteurs sautés par une coupure : pas des pertes
+    if (msg.msgCtr <= JOIN_NONCE_FRAMES) doc["jn"] = joinNonce; // Premiers messages de l'adhésion : la passerelle s'y recale
+    if (msg.confirmed) {
+        doc["conf"] = 1;
+    }
+    doc["data"] = serialized(msg.data);
 
     String payloadStr;
     serializeJson(doc, payloadStr);
 
-    String encryptedPayload = encryptPayload(payloadStr);
+    Serial.printf("[LORA] Sending TELEMETRY (msgCtr: %u%s)...\n", msg.msgCtr, msg.confirmed ? ", confirmed" : "");
+    bool sent = payloadStr.length() > LORA_MAX_PLAINTEXT_LEN ? sendFragmented(payloadStr) : transmitPlaintext(payloadStr);
+    if (!sent) {
+        if (msgCounter.release(msg.msgCtr)) { // Annuler l'incrémentation si rien n'est parti depuis
+            msg.msgCtr = 0;
+        }
+        return false;
+    }
+    if (firstAttempt) {
+        history.record(msg.msgCtr, msg.data);
+    }
 
-    StaticJsonDocument<256> finalDoc;
+    // Le module n'écoute qu'après ses propres émissions : c'est là que la passerelle lui répond
+    lastAckedCtr = 0;
+    listenForDownlinks(NODE_RX_WINDOW_MS);
+    return msg.confirmed && lastAckedCtr == msg.msgCtr;
+}
+
+// Chiffre un message clair et l'émet dans une seule trame
+bool LoraNode::transmitPlaintext(const String& plaintext) {
+    String encryptedPayload = encryptPayload(plaintext);
+
+    StaticJsonDocument<384> finalDoc;
     finalDoc["p"] = encryptedPayload;
-    finalDoc["c"] = calculateCRC32((const uint8_t*)payloadStr.c_str(), payloadStr.length());
+    finalDoc["c"] = calculateCRC32((const uint8_t*)plaintext.c_str(), plaintext.length());
 
-    String msg;
-    serializeJson(finalDoc, msg);
+    String frame;
+    serializeJson(finalDoc, frame);
+
+    if (firstTxAt < 0) firstTxAt = millis();
+    int state = radio.transmit(frame);
+    if (state != RADIOLIB_ERR_NONE) {
+        Serial.printf("[LORA] Transmit failed, code %d\n", state);
+        return false;
+    }
+    lastUplinkAt = millis();
+    return true;
+}
 
-    Serial.printf("[LORA] Sending ACK for msgId %d\n", msgId);
-    if (radio.transmit(msg) == RADIOLIB_ERR_NONE) {
-        saveConfig();
+// Plage de compteurs perdus, signalée par la passerelle, et ceux de la plage qu'elle a reçus en
+// retard ("skip"). Une demande reçue pendant un rattrapage l'étend pour couvrir les deux plages.
+void LoraNode::startBackfill(JsonObjectConst params) {
+    uint32_t from = params["from"] | 0;
+    uint32_t to = params["to"] | 0;
+    if (from == 0 || to < from) return;
+    if (backfillFrom != 0) {
+        from = min(from, backfillFrom);
+        to = max(to, backfillTo);
     } else {
-        msgCounter--;
+        backfillSkipCount = 0;
     }
+    backfillFrom = from;
+    backfillTo = to;
+    for (JsonVariantConst skipped : params["skip"].as<JsonArrayConst>()) {
+        if (backfillSkipCount < HISTORY_BACKFILL_MAX_SKIP) backfillSkip[backfillSkipCount++] = skipped | 0u;
+    }
+    Serial.printf("[HIST] Backfill requested for %u..%u\n", from, to);
 }
 
-void LoraNode::sendTelemetry(float temp, float humidity, float voltage, bool pressureOk) {
-    if (!isJoined() || (millis() - lastTelemetryTime < TELEMETRY_INTERVAL_MS)) {
+// Un relevé ne repart qu'une fois tout le reste émis, et jamais juste après une autre émission
+bool LoraNode::isBackfillDue() {
+    return backfillFrom != 0 && !hasInFlight && millis() - lastUplinkAt >= HISTORY_BACKFILL_SPACING_MS;
+}
+
+bool LoraNode::isBackfillSkipped(uint32_t counter) const {
+    for (uint8_t i = 0; i < backfillSkipCount; i++) {
+        if (backfillSkip[i] == counter) return true;
+    }
+    return false;
+}
+
+// Rejoue le plus ancien relevé demandé encore en historique, sous un nouveau compteur ; "oc" est
+// celui de la trame perdue et "age" le temps écoulé depuis, en secondes. Pas de fenêtre d'écoute :
+// la passerelle ne répond pas à un HIST.
+void LoraNode::serviceBackfill() {
+    if (!isBackfillDue()) return;
+    HistoryEntry entry;
+    bool found;
+    while ((found = history.find(backfillFrom, backfillTo, entry)) && isBackfillSkipped(entry.msgCtr) &&
+           entry.msgCtr < backfillTo) {
+        backfillFrom = entry.msgCtr + 1;
+    }
+    if (!found || isBackfillSkipped(entry.msgCtr)) {
+        Serial.printf("[HIST] Backfill done up to %u\n", backfillTo);
+        backfillFrom = 0;
         return;
     }
-    lastTelemetryTime = millis();
-    msgCounter++;
 
+    uint32_t counter = msgCounter.next();
     StaticJsonDocument<256> doc;
-    doc["type"] = "TELEMETRY";
+    doc["type"] = "HIST";
     doc["nodeId"] = nodeId;
-    doc["msgCtr"] = msgCounter;
+    doc["msgCtr"] = counter;
+    doc["oc"] = entry.msgCtr;
+    doc["age"] = (uint32_t)(rtcMillis() / 1000) - entry.capturedS;
+    doc["data"] = serialized(entry.data);
+
+    String payloadStr;
+    serializeJson(doc, payloadStr);
+
+    Serial.printf("[HIST] Replaying msgCtr %u (msgCtr: %u)...\n", entry.msgCtr, counter);
+    bool sent = payloadStr.length() > LORA_MAX_PLAINTEXT_LEN ? sendFragmented(payloadStr) : transmitPlaintext(payloadStr);
+    if (!sent) {
+        msgCounter.release(counter);
+        lastUplinkAt = millis(); // Nouvel essai après l'écart habituel
+        return;
+    }
+    backfillFrom = entry.msgCtr < backfillTo ? entry.msgCtr + 1 : 0;
+}
+
+// Émet un message trop long pour une trame en fragments, puis ne réémet que ceux
+// que la passerelle signale manquants. Retourne true quand tous sont acquittés.
+bool LoraNode::sendFragmented(const String& plaintext) {
+    if (++nextTransferId == 0) nextTransferId = 1;
+    if (!fragmentSender.begin(0, nextTransferId, (const uint8_t*)plaintext.c_str(), plaintext.length())) {
+        Serial.printf("[LORA] Message too long (%u bytes), dropped\n", plaintext.length());
+        return false;
+    }
+
+    uint8_t rounds = 0;
+    while (rounds < FRAG_MAX_ROUNDS) {
+        if (!sendFragmentRound()) break;
+        fragmentProgress = false;
+        String response;
+        if (receiveWithTimeout(response, NODE_RX_WINDOW_MS)) {
+            handleDownlink(response);
+        }
+        if (fragmentSender.isDone()) {
+            fragmentSender.reset();
+            return true;
+        }
+        if (!fragmentProgress) rounds++;
+    }
+    Serial.printf("[LORA] Transfer %u abandoned\n", fragmentSender.getTransferId());
+    fragmentSender.reset();
+    return false;
+}
 
-    JsonObject data = doc.createNestedObject("data");
-    data["temperature"] = temp;
-    data["humidity"] = humidity;
-    data["voltage"] = voltage;
-    data["pressure_ok"] = pressureOk;
+// Émet les fragments non encore acquittés ; le dernier demande un FACK à la passerelle
+bool LoraNode::sendFragmentRound() {
+    uint32_t missing = fragmentSender.getMissingMask();
+    uint8_t last = 31 - __builtin_clz(missing);
+
+    for (uint8_t i = 0; i <= last; i++) {
+        if (!(missing & (1UL << i))) continue;
+        const uint8_t* chunk;
+        size_t chunkLength = fragmentSender.getFragment(i, chunk);
+
+        StaticJsonDocument<192> fragDoc;
+        fragDoc["type"] = "FRAG";
+        fragDoc["nodeId"] = nodeId;
+        fragDoc["x"] = fragmentSender.getTransferId();
+        fragDoc["i"] = i;
+        fragDoc["n"] = fragmentSender.getCount();
+        if (i == last) fragDoc["f"] = 1;
+        fragDoc["d"] = Base64::encode(chunk, chunkLength);
+
+        String payloadStr;
+        serializeJson(fragDoc, payloadStr);
+        if (!transmitPlaintext(payloadStr)) return false;
+        if (i != last) delay(FRAG_TX_SPACING_MS);
+    }
+    Serial.printf("[LORA] Transfer %u: %d fragment(s) sent\n", fragmentSender.getTransferId(), __builtin_popcount(missing));
+    return true;
+}
+
+// Fenêtre d'écoute après une émission, prolongée tant que la passerelle continue d'émettre
+// (fragments d'un message long à la suite d'un ACK, par exemple)
+void LoraNode::listenForDownlinks(unsigned long windowMs) {
+    String response;
+    while (receiveWithTimeout(response, windowMs)) {
+        handleDownlink(response);
+        windowMs = FRAG_RX_GAP_MS;
+    }
+}
+
+void LoraNode::handleDownlink(const String& frame) {
+    StaticJsonDocument<384> rxDoc;
+    if (deserializeJson(rxDoc, frame) != DeserializationError::Ok || !rxDoc.containsKey("p")) return;
+
+    String decrypted = decryptPayload(rxDoc["p"]);
+    if (decrypted.length() == 0) return;
+
+    StaticJsonDocument<384> msgDoc;
+    if (deserializeJson(msgDoc, decrypted) != DeserializationError::Ok) return;
+    handleMessage(msgDoc.as<JsonObjectConst>());
+}
+
+void LoraNode::handleMessage(JsonObjectConst msg) {
+    uint8_t target = msg["nodeId"];
+    // Les blocs de firmware sont diffusés à tout le groupe (nodeId 0)
+    if (target != nodeId && !(target == 0 && msg["type"] == "FUOTA")) return;
+
+    if (msg["type"] == "ACK") {
+        lastAckedCtr = msg["msgCtr"];
+        syncClock(msg);
+        // La passerelle peut joindre une commande en attente à son ACK
+        if (msg.containsKey("cmd")) {
+            handleCommand(msg["cmd"]);
+        }
+    } else if (msg["type"] == "CMD") {
+        handleCommand(msg);
+    } else if (msg["type"] == "FRAG") {
+        handleFragment(msg);
+    } else if (msg["type"] == "FACK") {
+        if (fragmentSender.isActive() && msg["x"] == fragmentSender.getTransferId()) {
+            fragmentProgress = fragmentSender.onStatus(msg["m"]);
+        }
+    } else if (msg["type"] == "FSETUP") {
+        handleFuotaSetup(msg);
+    } else if (msg["type"] == "FUOTA") {
+        if (fuota.isActive() && msg["s"] == fuota.getSessionId()) {
+            uint8_t block[FUOTA_BLOCK_SIZE];
+            size_t length = Base64::decode(msg["d"].as<String>(), block, sizeof(block));
+            fuota.onRow(msg["g"], msg["r"], block, length);
+        }
+    } else if (msg["type"] == "FSREQ") {
+        if (fuota.isActive() && msg["s"] == fuota.getSessionId()) {
+            fuota.touch();
+            sendFuotaStatus();
+        }
+    }
+}
+
+// Pendant une session FUOTA, le module écoute en continu et suspend ses envois périodiques
+void LoraNode::serviceFuota() {
+    String response;
+    if (receiveWithTimeout(response, FUOTA_RX_POLL_MS)) {
+        handleDownlink(response);
+    }
+
+    unsigned long idle = millis() - fuota.getLastActivity();
+    if (fuota.getState() == FUOTA_VERIFIED && idle > FUOTA_REBOOT_DELAY_MS) {
+        Serial.println(F("[FUOTA] Rebooting into the new firmware"));
+        ESP.restart();
+    } else if (idle > FUOTA_SESSION_TIMEOUT_MS) {
+        fuota.abort();
+    }
+}
+
+void LoraNode::handleFuotaSetup(JsonObjectConst setup) {
+    uint8_t sessionId = setup["s"];
+    // Demande répétée (réponse perdue) : la session est déjà ouverte
+    if (!fuota.isActive() || fuota.getSessionId() != sessionId) {
+        uint8_t hash[32];
+        if (Base64::decode(setup["h"].as<String>(), hash, sizeof(hash)) != sizeof(hash)) return;
+        fuota.begin(sessionId, setup["size"], hash);
+    }
+    fuota.touch();
+    sendFuotaStatus();
+}
+
+// Rapport d'avancement : générations incomplètes et nombre de lignes manquantes pour chacune
+void LoraNode::sendFuotaStatus() {
+    uint32_t generations[FUOTA_STATUS_MAX_ENTRIES];
+    uint8_t deficits[FUOTA_STATUS_MAX_ENTRIES];
+    uint32_t remaining;
+    uint8_t count = fuota.getMissing(generations, deficits, FUOTA_STATUS_MAX_ENTRIES, remaining);
+
+    DynamicJsonDocument doc(256 + FUOTA_STATUS_MAX_ENTRIES * 32);
+    doc["type"] = "FSTAT";
+    doc["nodeId"] = nodeId;
+    uint32_t counter = msgCounter.next();
+    doc["msgCtr"] = counter;
+    uint32_t restartedAt = msgCounter.restartMarker();
+    if (restartedAt) doc["rst"] = restartedAt;
+    if (counter <= JOIN_NONCE_FRAMES) doc["jn"] = joinNonce;
+    doc["s"] = fuota.getSessionId();
+    doc["st"] = (int)fuota.getState();
+    doc["left"] = remaining;
+    JsonArray missing = doc.createNestedArray("miss");
+    for (uint8_t i = 0; i < count; i++) {
+        JsonArray entry = missing.createNestedArray();
+        entry.add(generations[i]);
+        entry.add(deficits[i]);
+    }
 
     String payloadStr;
     serializeJson(doc, payloadStr);
-    
-    String encryptedPayload = encryptPayload(payloadStr);
-    
-    StaticJsonDocument<384> finalDoc;
-    finalDoc["p"] = encryptedPayload;
-    finalDoc["c"] = calculateCRC32((const uint8_t*)payloadStr.c_str(), payloadStr.length());
+    delay(FRAG_TX_SPACING_MS); // La passerelle se remet en écoute après sa requête
+    bool sent = payloadStr.length() > LORA_MAX_PLAINTEXT_LEN ? sendFragmented(payloadStr) : transmitPlaintext(payloadStr);
+    if (!sent) {
+        msgCounter.release(counter);
+    }
+}
 
-    String msg;
-    serializeJson(finalDoc, msg);
+void LoraNode::handleFragment(JsonObjectConst frag) {
+    uint16_t transferId = frag["x"];
+    uint8_t index = frag["i"];
+    uint8_t count = frag["n"];
+    String chunk = Base64::decode(frag["d"].as<String>());
+
+    FragmentResult result = reassembler.add(0, transferId, index, count, (const uint8_t*)chunk.c_str(), chunk.length());
+    if (result == FRAG_REJECTED) return;
+    if ((frag["f"] | 0) != 0 || result == FRAG_COMPLETE) {
+        sendFragmentAck(transferId, reassembler.getReceivedMask(0, transferId));
+    }
+    if (result != FRAG_COMPLETE) return;
+
+    size_t length;
+    const char* message = reassembler.getMessage(0, transferId, length);
+    DynamicJsonDocument msgDoc(2 * FRAG_MAX_PAYLOAD_LEN);
+    if (deserializeJson(msgDoc, message, length) != DeserializationError::Ok) return;
+    if (msgDoc["type"] == "FRAG" || msgDoc["type"] == "FACK") return;
+    Serial.printf("[LORA] Transfer %u reassembled (%u bytes)\n", transferId, length);
+    delay(FRAG_TX_SPACING_MS); // La passerelle se remet en écoute après notre FACK
+    handleMessage(msgDoc.as<JsonObjectConst>());
+}
+
+void LoraNode::sendFragmentAck(uint16_t transferId, uint32_t receivedMask) {
+    StaticJsonDocument<128> doc;
+    doc["type"] = "FACK";
+    doc["nodeId"] = nodeId;
+    doc["x"] = transferId;
+    doc["m"] = receivedMask;
+
+    String payloadStr;
+    serializeJson(doc, payloadStr);
+    transmitPlaintext(payloadStr);
+}
+
+void LoraNode::handleCommand(JsonObjectConst cmd) {
+    Serial.println("[LORA] Received CMD");
+    bool handled = false;
+    const char* refusal = nullptr;
+    if (cmd["method"] == "set_config") {
+        applyReportConfig(cmd["params"]);
+        handled = true;
+    } else if (cmd["method"] == "backfill") {
+        startBackfill(cmd["params"]);
+        handled = true;
+    } else if (commandCallback) {
+        // Commandes propres à l'application, traitées dans la tâche LoRa
+        handled = commandCallback(cmd["method"] | "", cmd["params"], refusal);
+    }
+    if (handled && cmd.containsKey("msgId")) {
+        sendAck(cmd["msgId"], refusal);
+    }
+}
+
+// Paramètres absents : inchangés. La passerelle n'envoie que l'intervalle et la gigue ; les seuils
+// du rapport par exception viennent d'une commande set_config de l'opérateur, par exemple
+// {"heartbeat":600000,"deadband":{"temperature":1.0},"rate":{"voltage":0}}
+void LoraNode::applyReportConfig(JsonObjectConst params) {
+    // Valeurs calculées et bornées à part, puis publiées d'un bloc : la tâche des capteurs, sur
+    // l'autre cœur, ne voit jamais un réglage à moitié appliqué
+    ReportConfig config = readReportConfig();
+    if (params.containsKey("interval")) {
+        uint32_t interval = params["interval"];
+        uint32_t jitter = params["jitter"] | 0;
+        interval = constrain(interval, (uint32_t)REPORT_INTERVAL_MIN_MS, (uint32_t)REPORT_INTERVAL_MAX_MS);
+        if (jitter > interval / 2) jitter = interval / 2;
+
+        config.intervalMs = interval;
+        config.jitterMs = jitter;
+    }
+
+    JsonObjectConst deadband = params["deadband"];
+    JsonObjectConst rate = params["rate"];
+    for (uint8_t i = 0; i < REPORT_FIELD_COUNT; i++) {
+        if (deadband.containsKey(REPORT_FIELD_KEYS[i])) config.deadband[i] = max(0.0f, deadband[REPORT_FIELD_KEYS[i]].as<float>());
+        if (rate.containsKey(REPORT_FIELD_KEYS[i])) config.rate[i] = max(0.0f, rate[REPORT_FIELD_KEYS[i]].as<float>());
+    }
+    uint32_t heartbeat = params["heartbeat"] | config.heartbeatMs;
+    config.batchSize = constrain(params["batch"] | (int)config.batchSize, 1, REPORT_BATCH_MAX_SIZE);
+    config.batchDeadlineMs = constrain(params["batch_ms"] | config.batchDeadlineMs, (uint32_t)REPORT_INTERVAL_MIN_MS, heartbeat);
+    config.heartbeatMs = constrain(heartbeat, config.intervalMs, (uint32_t)REPORT_INTERVAL_MAX_MS);
+
+    portENTER_CRITICAL(&reportConfigMux);
+    reportConfig = config;
+    portEXIT_CRITICAL(&reportConfigMux);
+
+    saveConfig();
+    Serial.printf("[LORA] Report interval set to %u ms (jitter %u ms, heartbeat %u ms, batch %u / %u ms)\n",
+                  config.intervalMs, config.jitterMs, config.heartbeatMs, config.batchSize, config.batchDeadlineMs);
+}
+
+ReportConfig LoraNode::readReportConfig() {
+    portENTER_CRITICAL(&reportConfigMux);
+    ReportConfig config = reportConfig;
+    portEXIT_CRITICAL(&reportConfigMux);
+    return config;
+}
+
+// Heure Unix de la passerelle (s), jointe aux JOIN_ACCEPT et aux ACK une fois la sienne réglée par NTP
+void LoraNode::syncClock(JsonObjectConst msg) {
+    uint32_t epochS = msg["t"] | 0;
+    if (epochS == 0) return;
+    uint64_t now = rtcMillis();
+    int32_t offsetS = (int32_t)(epochS - (uint32_t)(now / 1000));
+    portENTER_CRITICAL(&clockMux);
+    clockSyncedAt = now;
+    clockOffsetS = offsetS;
+    clockSynced = true;
+    portEXIT_CRITICAL(&clockMux);
+}
+
+// Un rapport confirmé obtient un ACK, qui porte l'heure : demandée tant que l'horloge n'est pas
+// calée, puis chaque CLOCK_RESYNC_MS, et au plus une fois par CLOCK_SYNC_RETRY_MS
+bool LoraNode::takeClockRequest() {
+    uint64_t now = rtcMillis();
+    portENTER_CRITICAL(&clockMux);
+    bool fresh = clockSynced && now - clockSyncedAt < CLOCK_RESYNC_MS;
+    portEXIT_CRITICAL(&clockMux);
+    if (fresh) return false;
+    if (clockRequestAt && now - clockRequestAt < CLOCK_SYNC_RETRY_MS) return false;
+    clockRequestAt = now;
+    return true;
+}
+
+bool LoraNode::isClockSynced() {
+    portENTER_CRITICAL(&clockMux);
+    bool synced = clockSynced;
+    portEXIT_CRITICAL(&clockMux);
+    return synced;
+}
+
+// Ajoute un échantillon daté au lot ; si le lot n'a plus la place, il part d'abord.
+// Retourne false si l'échantillon ne tient pas seul dans un lot.
+bool LoraNode::appendSample(JsonObjectConst values) {
+    portENTER_CRITICAL(&clockMux);
+    int32_t offsetS = clockOffsetS;
+    portEXIT_CRITICAL(&clockMux);
+    uint32_t epochS = (uint32_t)(rtcMillis() / 1000) + offsetS;
+    size_t valuesLength = measureJson(values);
+    for (;;) {
+        char prefix[16];
+        int prefixLength = snprintf(prefix, sizeof(prefix), "%s[%u,", batchCount ? "," : "", batchCount ? epochS - batchBase : 0);
+        size_t length = prefixLength + valuesLength + 1;
+        if (batchLength + length <= REPORT_BATCH_MAX_BYTES - BATCH_ENVELOPE_LEN) {
+            if (batchCount == 0) {
+                batchBase = epochS;
+                batchStartedAt = millis();
+            }
+            memcpy(batchSamples + batchLength, prefix, prefixLength);
+            serializeJson(values, batchSamples + batchLength + prefixLength, valuesLength + 1);
+            batchLength += length;
+            batchSamples[batchLength - 1] = ']';
+            batchSamples[batchLength] = '\0';
+            batchCount++;
+            return true;
+        }
+        if (batchCount == 0) return false;
+        flushBatch(false);
+    }
+}
+
+// Le lot part en une trame : {"t0": <heure Unix (s)>, "b": [[<s depuis t0>, {...}], ...]}
+bool LoraNode::flushBatch(bool confirmed) {
+    if (batchCount == 0) return true;
+    String samples = "[";
+    samples += batchSamples;
+    samples += "]";
+    StaticJsonDocument<160> data; // Deux membres et la copie de samples (REPORT_BATCH_MAX_BYTES)
+    data["t0"] = batchBase;
+    data["b"] = serialized(samples);
+    uint8_t count = batchCount;
+    batchCount = 0;
+    batchLength = 0;
+
+    if (!queueUplink(data.as<JsonObjectConst>(), confirmed || takeClockRequest())) {
+        Serial.printf("[LORA] Batch of %u samples dropped, queue full\n", count);
+        return false;
+    }
+    lastTelemetryTime = millis();
+    uint32_t jitterMs = readReportConfig().jitterMs;
+    nextReportJitterMs = jitterMs ? nextRandom(jitterSeed) % (jitterMs + 1) : 0;
+    return true;
+}
+
+void LoraNode::sendAck(uint16_t msgId, const char* refusal) {
+    uint32_t counter = msgCounter.next();
+    StaticJsonDocument<128> doc;
+    doc["type"] = "ACK";
+    doc["nodeId"] = nodeId;
+    doc["msgId"] = msgId;
+    doc["msgCtr"] = counter;
+    uint32_t restartedAt = msgCounter.restartMarker();
+    if (restartedAt) doc["rst"] = restartedAt;
+    if (counter <= JOIN_NONCE_FRAMES) doc["jn"] = joinNonce;
+    if (refusal) doc["err"] = refusal;
+
+    String payloadStr;
+    serializeJson(doc, payloadStr);
+
+    Serial.printf("[LORA] Sending ACK for msgId %d%s%s\n", msgId, refusal ? ", refused: " : "", refusal ? refusal : "");
+    if (!transmitPlaintext(payloadStr)) {
+        msgCounter.release(counter);
+    }
+}
+
+// Appelée à chaque lecture des capteurs : n'émet que ce qui a changé (rapport par exception)
+void LoraNode::sendTelemetry(float temp, float humidity, float voltage, bool pressureOk) {
+    if (!isJoined()) return;
+    unsigned long now = millis();
+    const float values[REPORT_FIELD_COUNT] = { temp, humidity, voltage };
+    const ReportConfig config = readReportConfig();
+    // Gigue réduite par set_config depuis le dernier tirage : tirée à nouveau, ici, dans la tâche des capteurs
+    if (nextReportJitterMs > config.jitterMs) {
+        nextReportJitterMs = config.jitterMs ? nextRandom(jitterSeed) % (config.jitterMs + 1) : 0;
+    }
+
+    bool heartbeat = !hasReported || now - lastTelemetryTime >= config.heartbeatMs;
+    bool rateWindow = now - rateRefAt >= REPORT_RATE_WINDOW_MS;
+    bool steep = false;
+    uint8_t fields = 0; // Bit i : mesure i à émettre
+    for (uint8_t i = 0; i < REPORT_FIELD_COUNT; i++) {
+        if (std::isnan(values[i])) continue; // Lecture du capteur en échec
+        if (heartbeat || std::isnan(lastSentValue[i]) || fabsf(values[i] - lastSentValue[i]) > config.deadband[i]) {
+            fields |= 1 << i;
+        }
+        if (rateWindow && config.rate[i] > 0 && !std::isnan(rateRefValue[i]) &&
+            fabsf(values[i] - rateRefValue[i]) * 60000.0f / (now - rateRefAt) >= config.rate[i]) {
+            fields |= 1 << i;
+            steep = true;
+        }
+    }
+    if (rateWindow) {
+        memcpy(rateRefValue, values, sizeof(rateRefValue));
+        rateRefAt = now;
+    }
+    bool pressureChanged = heartbeat || pressureOk != lastSentPressureOk;
+    bool pressureLost = !pressureOk && lastSentPressureOk;
+    bool urgent = steep || pressureLost;
+    bool batching = config.batchSize > 1 && isClockSynced();
+    bool batchDue = batchCount && now - batchStartedAt >= max(config.batchDeadlineMs, config.intervalMs);
+
+    if (!heartbeat && !urgent && !fields && !pressureChanged) {
+        if (batchDue) flushBatch(false);
+        return;
+    }
+    // Hors urgence et hors lot, l'intervalle assigné par la passerelle reste l'écart minimal entre deux rapports
+    if (!heartbeat && !urgent && !batching && now - lastTelemetryTime < config.intervalMs + nextReportJitterMs) return;
+
+    StaticJsonDocument<128> data;
+    for (uint8_t i = 0; i < REPORT_FIELD_COUNT; i++) {
+        if (fields & (1 << i)) data[REPORT_FIELD_KEYS[i]] = serialized(String(values[i], 2));
+    }
+    if (pressureChanged) data["pressure_ok"] = pressureOk;
 
-    Serial.printf("[LORA] Sending TELEMETRY (msgCtr: %u)...\n", msgCounter);
-    if (radio.transmit(msg) == RADIOLIB_ERR_NONE) {
-        saveConfig();
+    // Perte de pression : événement confirmé, comme un changement local de la pompe
+    if (batching && !heartbeat && appendSample(data.as<JsonObjectConst>())) {
+        if ((urgent || batchDue || batchCount >= config.batchSize) && !flushBatch(pressureLost)) return;
     } else {
-        msgCounter--;
+        // Heartbeat (état complet) ou horloge non calée : rapport seul, daté par la passerelle
+        flushBatch(false);
+        if (!queueUplink(data.as<JsonObjectConst>(), pressureLost || takeClockRequest())) return;
+        lastTelemetryTime = now;
+        nextReportJitterMs = config.jitterMs ? nextRandom(jitterSeed) % (config.jitterMs + 1) : 0;
+    }
+
+    for (uint8_t i = 0; i < REPORT_FIELD_COUNT; i++) {
+        if (fields & (1 << i)) lastSentValue[i] = values[i];
     }
+    lastSentPressureOk = pressureOk;
+    hasReported = true;
 }
 
 String LoraNode::encryptPayload(const String& plaintext) {
@@ -0,0 +1,99 @@
+#include "MessageCounter.h"
+#include <Preferences.h>
+#include <esp_system.h>
+
+#define MSG_COUNTER_RTC_MAGIC 0x4D534743UL // "MSGC"
+
+// Copie en mémoire RTC : conservée par un redémarrage logiciel et le sommeil profond, aléatoire
+// après une mise sous tension, d'où la somme de contrôle
+struct MessageCounterRtc {
+    uint32_t magic;
+    uint32_t value;
+    uint32_t check;                  // ~value ^ magic
+};
+
+static RTC_NOINIT_ATTR MessageCounterRtc rtcCounter;
+
+static void slotKey(char* key, size_t size, uint8_t slot) {
+    snprintf(key, size, "msgCtr%u", slot);
+}
+
+void MessageCounter::begin() {
+    Preferences prefs;
+    prefs.begin(NVS_NAMESPACE, true);
+    reserved = prefs.getUInt("msgCtr", 0); // Ancien format : compteur écrit après chaque envoi
+    for (uint8_t slot = 0; slot < MSG_COUNTER_SLOTS; slot++) {
+        char key[12];
+        slotKey(key, sizeof(key), slot);
+        uint32_t bound = prefs.getUInt(key, 0);
+        if (bound > reserved) reserved = bound;
+    }
+    prefs.end();
+
+    // La copie RTC n'est retenue que si elle est cohérente avec la borne : au plus N en dessous
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool warm = reason != ESP_RST_POWERON && reason != ESP_RST_BROWNOUT && reason != ESP_RST_UNKNOWN;
+    if (warm && rtcCounter.magic == MSG_COUNTER_RTC_MAGIC && rtcCounter.check == (~rtcCounter.value ^ MSG_COUNTER_RTC_MAGIC) &&
+        rtcCounter.value <= reserved && rtcCounter.value + MSG_COUNTER_COMMIT_INTERVAL >= reserved) {
+        value = rtcCounter.value;
+        resumedAt = 0;
+    } else {
+        value = reserved; // Les compteurs jusqu'à la borne ont pu être émis
+        resumedAt = reserved;
+    }
+    saveRtc();
+}
+
+uint32_t MessageCounter::next() {
+    value++;
+    if (value > reserved) {
+        commit(value + MSG_COUNTER_COMMIT_INTERVAL - 1);
+    }
+    saveRtc();
+    return value;
+}
+
+// Répété sur plusieurs messages : le premier peut se perdre, et la passerelle ignore un recalage déjà fait
+uint32_t MessageCounter::restartMarker() const {
+    return (resumedAt != 0 && value <= resumedAt + MSG_COUNTER_RESTART_FRAMES) ? resumedAt : 0;
+}
+
+bool MessageCounter::release(uint32_t counter) {
+    if (counter == 0 || counter != value) return false;
+    value--;
+    saveRtc();
+    return true;
+}
+
+void MessageCounter::reset() {
+    Preferences prefs;
+    prefs.begin(NVS_NAMESPACE, false);
+    prefs.remove("msgCtr");
+    for (uint8_t slot = 0; slot < MSG_COUNTER_SLOTS; slot++) {
+        char key[12];
+        slotKey(key, sizeof(key), slot);
+        prefs.remove(key);
+    }
+    prefs.end();
+    value = 0;
+    reserved = 0;
+    resumedAt = 0;
+    saveRtc();
+}
+
+// Écrite avant l'émission du message qui la franchit : la borne en NVS n'est jamais en retard
+void MessageCounter::commit(uint32_t bound) {
+    char key[12];
+    slotKey(key, sizeof(key), (bound / MSG_COUNTER_COMMIT_INTERVAL) % MSG_COUNTER_SLOTS);
+    Preferences prefs;
+    prefs.begin(NVS_NAMESPACE, false);
+    prefs.putUInt(key, bound);
+    prefs.end();
+    reserved = bound;
+}
+
+void MessageCounter::saveRtc() {
+    rtcCounter.magic = MSG_COUNTER_RTC_MAGIC;
+    rtcCounter.value = value;
+    rtcCounter.check = ~value ^ MSG_COUNTER_RTC_MAGIC;
+}
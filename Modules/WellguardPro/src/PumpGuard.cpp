@@ -0,0 +1,190 @@
+#include "PumpGuard.h"
+#include <Preferences.h>
+#include <driver/gpio.h>
+#include <esp_timer.h>
+
+void PumpGuard::begin(PumpTripCallback callback) {
+    tripCallback = callback;
+
+    Preferences prefs;
+    prefs.begin(NVS_NAMESPACE, true);
+    enabled = prefs.getBool("pgOn", PUMP_GUARD_ENABLED);
+    primeMs = prefs.getUInt("pgPrime", PUMP_GUARD_PRIME_MS);
+    tripDelayMs = prefs.getUInt("pgDelay", PUMP_GUARD_TRIP_DELAY_MS);
+    maxRunMs = prefs.getUInt("pgMaxRun", PUMP_GUARD_MAX_RUN_MS);
+    fault = (PumpTrip)prefs.getUChar("pgFault", PUMP_TRIP_NONE);
+    prefs.end();
+    if (fault != PUMP_TRIP_NONE) {
+        Serial.printf("[GUARD] Fault %s latched, pump locked out\n", tripName(fault));
+    }
+
+    pinMode(PUMP_RELAY_PIN, OUTPUT);
+    digitalWrite(PUMP_RELAY_PIN, LOW);
+    pinMode(PRESSURE_SENSOR_PIN, INPUT_PULLUP);
+    lowSinceUs = digitalRead(PRESSURE_SENSOR_PIN) == LOW ? esp_timer_get_time() : 0;
+
+    // Au-dessus de toutes les autres tâches du module, sur le cœur qui n'exécute pas le WiFi
+    if (xTaskCreatePinnedToCore(task, "PumpGuard", 4096, this, 3, &taskHandle, 1) != pdPASS) {
+        Serial.println("[GUARD] Impossible de créer la tâche de protection !");
+        ESP.restart();
+    }
+    attachInterruptArg(digitalPinToInterrupt(PRESSURE_SENSOR_PIN), pressureInterrupt, this, CHANGE);
+}
+
+bool PumpGuard::setPump(bool on) {
+    portENTER_CRITICAL(&mux);
+    if (on && fault != PUMP_TRIP_NONE) {
+        portEXIT_CRITICAL(&mux);
+        return false;
+    }
+    if (on && !pumpOn) startedAtUs = esp_timer_get_time();
+    pumpOn = on;
+    digitalWrite(PUMP_RELAY_PIN, on ? HIGH : LOW);
+    portEXIT_CRITICAL(&mux);
+    if (taskHandle) xTaskNotifyGive(taskHandle); // Nouvelles échéances
+    return true;
+}
+
+// Lève le verrouillage ; la pompe reste arrêtée jusqu'à la prochaine commande
+void PumpGuard::resetFault() {
+    fault = PUMP_TRIP_NONE;
+    Preferences prefs;
+    prefs.begin(NVS_NAMESPACE, false);
+    prefs.remove("pgFault");
+    prefs.end();
+    Serial.println("[GUARD] Fault cleared");
+}
+
+// Paramètres absents : inchangés
+void PumpGuard::configure(JsonObjectConst params) {
+    enabled = params["enabled"] | enabled;
+    primeMs = params["prime_ms"] | primeMs;
+    tripDelayMs = params["delay_ms"] | tripDelayMs;
+    maxRunMs = params["max_run_ms"] | maxRunMs;
+    saveConfig();
+    if (taskHandle) xTaskNotifyGive(taskHandle);
+    Serial.printf("[GUARD] %s, prime %u ms, dry-run delay %u ms, max run %u ms\n",
+                  enabled ? "Enabled" : "Disabled", primeMs, tripDelayMs, maxRunMs);
+}
+
+const char* PumpGuard::tripName(PumpTrip reason) {
+    switch (reason) {
+        case PUMP_TRIP_DRY_RUN: return "dry_run";
+        case PUMP_TRIP_MAX_RUN: return "max_run";
+        default: return "none";
+    }
+}
+
+// Chaque changement du contact de pression est daté ici ; les rebonds remettent simplement à zéro
+// le début de la perte de pression
+void IRAM_ATTR PumpGuard::pressureInterrupt(void* arg) {
+    PumpGuard* self = static_cast<PumpGuard*>(arg);
+    int64_t now = esp_timer_get_time();
+    bool low = gpio_get_level((gpio_num_t)PRESSURE_SENSOR_PIN) == 0;
+    portENTER_CRITICAL_ISR(&self->mux);
+    if (!low) {
+        self->lowSinceUs = 0;
+    } else if (self->lowSinceUs == 0) {
+        self->lowSinceUs = now;
+    }
+    portEXIT_CRITICAL_ISR(&self->mux);
+
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(self->taskHandle, &xHigherPriorityTaskWoken);
+    if (xHigherPriorityTaskWoken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void PumpGuard::task(void* params) {
+    static_cast<PumpGuard*>(params)->run();
+}
+
+// Réveillée par l'interruption, par setPump() ou à l'échéance de la prochaine règle
+void PumpGuard::run() {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, evaluate());
+    }
+}
+
+// Vérifie les règles ; retourne l'attente jusqu'à la prochaine échéance
+TickType_t PumpGuard::evaluate() {
+    portENTER_CRITICAL(&mux);
+    bool running = pumpOn;
+    int64_t startedAt = startedAtUs;
+    int64_t lowSince = lowSinceUs;
+    portEXIT_CRITICAL(&mux);
+    if (!running || !enabled) return portMAX_DELAY;
+
+    int64_t dueAt = INT64_MAX;
+    PumpTrip reason = PUMP_TRIP_NONE;
+    if (lowSince != 0) {
+        // Pendant l'amorçage, la pression n'est pas encore établie : le délai part de sa fin
+        int64_t primedAt = startedAt + (int64_t)primeMs * 1000;
+        dueAt = (lowSince > primedAt ? lowSince : primedAt) + (int64_t)tripDelayMs * 1000;
+        reason = PUMP_TRIP_DRY_RUN;
+    }
+    if (maxRunMs > 0 && startedAt + (int64_t)maxRunMs * 1000 < dueAt) {
+        dueAt = startedAt + (int64_t)maxRunMs * 1000;
+        reason = PUMP_TRIP_MAX_RUN;
+    }
+    if (reason == PUMP_TRIP_NONE) return portMAX_DELAY;
+
+    int64_t now = esp_timer_get_time();
+    if (now >= dueAt) {
+        trip(reason);
+        return portMAX_DELAY;
+    }
+    // Arrondi à la milliseconde supérieure : la tâche ne se réveille pas avant l'échéance
+    TickType_t wait = pdMS_TO_TICKS((dueAt - now + 999) / 1000);
+    return wait > 0 ? wait : 1;
+}
+
+// Coupe le relais, puis verrouille le défaut et prévient l'application
+void PumpGuard::trip(PumpTrip reason) {
+    portENTER_CRITICAL(&mux);
+    if (!pumpOn) { // Arrêtée entre-temps par une commande
+        portEXIT_CRITICAL(&mux);
+        return;
+    }
+    digitalWrite(PUMP_RELAY_PIN, LOW);
+    int64_t cutAt = esp_timer_get_time();
+    pumpOn = false;
+    fault = reason;
+    int64_t lowSince = lowSinceUs;
+    int64_t startedAt = startedAtUs;
+    portEXIT_CRITICAL(&mux);
+
+    PumpTripEvent event;
+    event.reason = reason;
+    event.lowMs = 0;
+    event.irqLatencyUs = 0;
+    if (reason == PUMP_TRIP_DRY_RUN && lowSince != 0) {
+        event.lowMs = (uint32_t)((cutAt - lowSince) / 1000);
+        // Mesurée depuis l'horodatage de l'interruption ; une perte commencée pendant l'amorçage
+        // n'a pas d'interruption à l'origine de l'échéance
+        if (lowSince >= startedAt + (int64_t)primeMs * 1000) {
+            int64_t latency = cutAt - lowSince - (int64_t)tripDelayMs * 1000;
+            event.irqLatencyUs = latency > 0 ? (uint32_t)latency : 0;
+        }
+    }
+    Serial.printf("[GUARD] Pump tripped (%s), %u us after the pressure interrupt plus the trip delay\n",
+                  tripName(reason), event.irqLatencyUs);
+
+    Preferences prefs;
+    prefs.begin(NVS_NAMESPACE, false);
+    prefs.putUChar("pgFault", reason);
+    prefs.end();
+
+    if (tripCallback) tripCallback(event);
+}
+
+void PumpGuard::saveConfig() {
+    Preferences prefs;
+    prefs.begin(NVS_NAMESPACE, false);
+    prefs.putBool("pgOn", enabled);
+    prefs.putUInt("pgPrime", primeMs);
+    prefs.putUInt("pgDelay", tripDelayMs);
+    prefs.putUInt("pgMaxRun", maxRunMs);
+    prefs.end();
+}
@@ -0,0 +1,114 @@
+#include "VoltageSampler.h"
+#include <driver/adc.h>
+
+#define VOLTAGE_FRAME_BYTES (VOLTAGE_FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES)
+
+// Seul l'ADC1 est utilisable en DMA pendant que le WiFi est actif ; sur l'ESP32-S3, il couvre GPIO1 à GPIO10
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && (VOLTAGE_SENSOR_PIN < 1 || VOLTAGE_SENSOR_PIN > 10)
+#error "VOLTAGE_SENSOR_PIN doit être sur l'ADC1 de l'ESP32-S3 (GPIO1 à GPIO10)"
+#endif
+
+bool VoltageSampler::begin() {
+    // Vérifié à la compilation pour l'ESP32-S3 ; garde-fou pour les autres cibles
+    int8_t analogChannel = digitalPinToAnalogChannel(VOLTAGE_SENSOR_PIN);
+    if (analogChannel < 0 || analogChannel >= SOC_ADC_CHANNEL_NUM(0)) {
+        Serial.println("[ADC] ERREUR : VOLTAGE_SENSOR_PIN n'est pas sur l'ADC1, DMA impossible");
+        return false;
+    }
+    channel = analogChannel;
+
+    adc_digi_init_config_t init = {};
+    init.max_store_buf_size = VOLTAGE_FRAME_BYTES * 4;
+    init.conv_num_each_intr = VOLTAGE_FRAME_BYTES;
+    init.adc1_chan_mask = BIT(channel);
+    init.adc2_chan_mask = 0;
+
+    adc_digi_pattern_config_t pattern = {};
+    pattern.atten = ADC_ATTEN_DB_11;
+    pattern.channel = channel;
+    pattern.unit = 0; // ADC1
+    pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+    adc_digi_configuration_t config = {};
+    config.conv_limit_en = ADC_CONV_LIMIT_EN;
+    config.conv_limit_num = 250;
+    config.pattern_num = 1;
+    config.adc_pattern = &pattern;
+    config.sample_freq_hz = VOLTAGE_SAMPLE_RATE_HZ;
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+
+    if (adc_digi_initialize(&init) != ESP_OK) {
+        Serial.println("[ADC] Initialisation du DMA impossible : lecture directe");
+        return false;
+    }
+    if (adc_digi_controller_configure(&config) != ESP_OK || adc_digi_start() != ESP_OK ||
+        xTaskCreatePinnedToCore(task, "ADC", 3072, this, 1, NULL, 0) != pdPASS) {
+        Serial.println("[ADC] Démarrage du DMA impossible : lecture directe");
+        adc_digi_deinitialize();
+        return false;
+    }
+    running = true;
+    return true;
+}
+
+float VoltageSampler::read() const {
+    // Pas d'analogRead() pendant le DMA : l'ADC1 lui est réservé (NAN avant la première trame)
+    return running ? filtered.load(std::memory_order_relaxed) : toVolts(analogRead(VOLTAGE_SENSOR_PIN));
+}
+
+void VoltageSampler::task(void* params) {
+    static_cast<VoltageSampler*>(params)->run();
+}
+
+void VoltageSampler::run() {
+    static uint8_t frame[VOLTAGE_FRAME_BYTES];
+    for (;;) {
+        uint32_t length = 0;
+        // ESP_ERR_INVALID_STATE : tampon du pilote plein, des trames ont été perdues mais celle-ci est valide
+        esp_err_t err = adc_digi_read_bytes(frame, sizeof(frame), &length, ADC_MAX_DELAY);
+        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) continue;
+
+        uint32_t sum = 0;
+        uint32_t count = 0;
+        for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= length; i += SOC_ADC_DIGI_RESULT_BYTES) {
+            const adc_digi_output_data_t* sample = reinterpret_cast<const adc_digi_output_data_t*>(&frame[i]);
+            if (sample->type2.unit != 0 || sample->type2.channel != channel) continue;
+            sum += sample->type2.data;
+            count++;
+        }
+        if (count == 0) continue;
+        filtered.store(filter(toVolts((float)sum / count)), std::memory_order_relaxed);
+    }
+}
+
+// Moyenne glissante, ou médiane qui écarte les creux brefs (appel de courant au démarrage de la pompe)
+float VoltageSampler::filter(float frameVolts) {
+    window[windowNext] = frameVolts;
+    windowNext = (windowNext + 1) % VOLTAGE_FILTER_WINDOW;
+    if (windowCount < VOLTAGE_FILTER_WINDOW) windowCount++;
+
+#if VOLTAGE_FILTER == VOLTAGE_FILTER_MEDIAN
+    float sorted[VOLTAGE_FILTER_WINDOW];
+    for (uint8_t i = 0; i < windowCount; i++) {
+        uint8_t j = i;
+        for (; j > 0 && sorted[j - 1] > window[i]; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = window[i];
+    }
+    return (windowCount & 1) ? sorted[windowCount / 2]
+                             : (sorted[windowCount / 2 - 1] + sorted[windowCount / 2]) / 2;
+#else
+    float sum = 0;
+    for (uint8_t i = 0; i < windowCount; i++) {
+        sum += window[i];
+    }
+    return sum / windowCount;
+#endif
+}
+
+// Pont diviseur 1/11 devant l'ADC
+float VoltageSampler::toVolts(float raw) {
+    return raw * (3.3f / 4095.0f) * VOLTAGE_DIVIDER_RATIO;
+}
@@ -1,4 +1,5 @@
 #include "helpers.h"
+#include <sys/time.h>
 
 // Fonction de calcul du CRC32 (identique à celle de la passerelle)
 uint32_t calculateCRC32(const uint8_t *data, size_t length) {
@@ -14,3 +15,28 @@ uint32_t calculateCRC32(const uint8_t *data, size_t length) {
     }
     return crc;
 }
+
+uint32_t nextRandom(uint32_t &seed) {
+    if (seed == 0) seed = 0x9E3779B9; // xorshift ne sort jamais de l'état nul
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+uint32_t computeBackoffDelay(uint8_t attempt, uint32_t baseMs, uint32_t maxMs, uint32_t &seed) {
+    uint32_t ceiling = baseMs;
+    while (attempt-- > 0 && ceiling < maxMs) {
+        ceiling <<= 1;
+    }
+    if (ceiling > maxMs) ceiling = maxMs;
+
+    uint32_t half = ceiling / 2;
+    return half + nextRandom(seed) % (ceiling - half + 1);
+}
+
+uint64_t rtcMillis() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
@@ -9,16 +9,22 @@
 #include "LoraNode.h"
 #include "helpers.h"
 #include "Base64.h"
+#include "Snapshot.h"
+#include "VoltageSampler.h"
+#include "PumpGuard.h"
 
 // ===================== OBJETS GLOBAUX =====================
 Module mod(LORA_CS, LORA_DIO1, LORA_RST, LORA_BUSY);
 SX1262 radio = &mod;
 LoraNode loraNode;
 DHT dht(DHT_PIN, DHT_TYPE);
+VoltageSampler voltageSampler;
+PumpGuard pumpGuard;
 AsyncWebServer server(80);
 AsyncWebSocket ws("/ws");
 
-// Structure pour l'état partagé entre les tâches
+// État partagé entre les tâches, publié par instantané : la lecture ne bloque jamais, et la
+// commande de la pompe n'attend jamais une mesure
 struct SharedState {
     bool pumpOn = false;
     bool pressureOk = false;
@@ -26,8 +32,7 @@ struct SharedState {
     float humidity = 0.0;
     float voltage = 0.0;
 };
-SharedState sharedState;
-SemaphoreHandle_t stateMutex;
+Snapshot<SharedState> sharedState;
 
 // Contenu HTML/JS complet de l'interface web
 const char* HTML_CONTENT = R"rawliteral(
@@ -74,29 +79,33 @@ pumpSwitch.addEventListener('change',()=>{ws.send(JSON.stringify({action:'setPum
 // ===================== PROTOTYPES =====================
 void taskLoRa(void* params);
 void taskSensors(void* params);
-void connectWiFi();
+void taskWiFi(void* params);
+void bootPhase(const char* phase, unsigned long at = millis());
 void setupWebServer();
-void setPumpState(bool state, bool fromLora = false);
+bool setPumpState(bool state, bool fromLora = false);
+void onPumpTrip(const PumpTripEvent& event);
+bool handleLoraCommand(const char* method, JsonObjectConst params, const char*& refusal);
 void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len);
 
 
 void setup() {
     Serial.begin(115200);
-    pinMode(PUMP_RELAY_PIN, OUTPUT);
-    digitalWrite(PUMP_RELAY_PIN, LOW);
-    pinMode(PRESSURE_SENSOR_PIN, INPUT_PULLUP);
+    sharedState.begin();
+    pumpGuard.begin(onPumpTrip); // Relais au repos avant tout le reste
     dht.begin();
-    
-    stateMutex = xSemaphoreCreateMutex();
+    voltageSampler.begin();
 
-    connectWiFi();
-    setupWebServer();
+    // LoRa d'abord : le premier message part sans attendre le WiFi
     loraNode.init();
+    loraNode.onCommand(handleLoraCommand);
+    bootPhase("lora");
 
     BaseType_t taskSensorsStatus = xTaskCreatePinnedToCore(taskSensors, "Sensors", 4096, NULL, 1, NULL, 0);
     BaseType_t taskLoRaStatus = xTaskCreatePinnedToCore(taskLoRa, "LoRa", 4096, NULL, 1, NULL, 1);
+    BaseType_t taskWiFiStatus = xTaskCreatePinnedToCore(taskWiFi, "WiFi", 4096, NULL, 0, NULL, 0);
+    bootPhase("tasks");
 
-    if (taskSensorsStatus != pdPASS || taskLoRaStatus != pdPASS) {
+    if (taskSensorsStatus != pdPASS || taskLoRaStatus != pdPASS || taskWiFiStatus != pdPASS) {
         Serial.println("Erreur fatale: Impossible de créer les tâches FreeRTOS !");
         ESP.restart();
     }
@@ -104,23 +113,50 @@ void setup() {
 
 void loop() { vTaskDelete(NULL); }
 
-void connectWiFi() {
-    Serial.print("Connexion au WiFi...");
+// Jalon du démarrage, en ms depuis le lancement de l'application
+void bootPhase(const char* phase, unsigned long at) {
+    Serial.printf("[BOOT] %-8s %6lu ms\n", phase, at);
+}
+
+// WiFi et interface web, en arrière-plan : la liaison LoRa n'en dépend jamais
+void taskWiFi(void* params) {
+#if WIFI_ON_DEMAND
+    pinMode(WIFI_BUTTON_PIN, INPUT_PULLUP);
+    while (digitalRead(WIFI_BUTTON_PIN) != LOW) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+#endif
+    Serial.println("Connexion au WiFi...");
     WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
     while (WiFi.status() != WL_CONNECTED) {
-        delay(500);
-        Serial.print(".");
+        vTaskDelay(pdMS_TO_TICKS(250));
     }
-    Serial.println(" Connecté!");
+    bootPhase("wifi");
     Serial.print("IP Address: ");
     Serial.println(WiFi.localIP());
+
+    setupWebServer();
+    bootPhase("web");
+    vTaskDelete(NULL);
 }
 
-void setPumpState(bool state, bool fromLora) {
-    xSemaphoreTake(stateMutex, portMAX_DELAY);
-    sharedState.pumpOn = state;
-    digitalWrite(PUMP_RELAY_PIN, state ? HIGH : LOW);
-    xSemaphoreGive(stateMutex);
+// Retourne false si le démarrage est refusé (défaut de la protection verrouillé)
+bool setPumpState(bool state, bool fromLora) {
+    bool applied = false;
+    sharedState.update([&](SharedState& s) {
+        applied = pumpGuard.setPump(state);
+        s.pumpOn = pumpGuard.isPumpOn();
+    });
+    if (!applied) {
+        Serial.printf("Démarrage de la pompe refusé : défaut %s verrouillé\n", PumpGuard::tripName(pumpGuard.getFault()));
+        StaticJsonDocument<64> doc;
+        doc["pumpOn"] = false;
+        doc["fault"] = PumpGuard::tripName(pumpGuard.getFault());
+        String output;
+        serializeJson(doc, output);
+        ws.textAll(output);
+        return false;
+    }
     
     Serial.printf("Pompe mise à %s (source: %s)\n", state ? "ON" : "OFF", fromLora ? "LoRa" : "Web");
     
@@ -129,18 +165,69 @@ void setPumpState(bool state, bool fromLora) {
     String output;
     serializeJson(doc, output);
     ws.textAll(output);
+
+    // Un changement local doit parvenir à la passerelle : événement confirmé
+    if (!fromLora && loraNode.isJoined()) {
+        StaticJsonDocument<32> event;
+        event["pump_on"] = state;
+        loraNode.queueUplink(event.as<JsonObjectConst>(), true);
+    }
+    return true;
+}
+
+// Coupure par la protection locale (tâche PumpGuard, relais déjà coupé) : événement confirmé,
+// avec le temps de réponse mesuré entre la règle vérifiée et la coupure
+void onPumpTrip(const PumpTripEvent& event) {
+    sharedState.update([](SharedState& s) { s.pumpOn = false; });
+
+    StaticJsonDocument<64> doc;
+    doc["pumpOn"] = false;
+    doc["fault"] = PumpGuard::tripName(event.reason);
+    String output;
+    serializeJson(doc, output);
+    ws.textAll(output);
+
+    if (loraNode.isJoined()) {
+        StaticJsonDocument<96> uplink;
+        uplink["pump_on"] = false;
+        uplink["fault"] = PumpGuard::tripName(event.reason);
+        if (event.reason == PUMP_TRIP_DRY_RUN) uplink["low_ms"] = event.lowMs;
+        if (event.irqLatencyUs > 0) uplink["irq_lat_us"] = event.irqLatencyUs;
+        loraNode.queueUplink(uplink.as<JsonObjectConst>(), true);
+    }
+}
+
+// Commandes de la passerelle, traitées dans la tâche LoRa
+bool handleLoraCommand(const char* method, JsonObjectConst params, const char*& refusal) {
+    if (strcmp(method, "setPump") == 0) {
+        // Défaut verrouillé : refus acquitté, la passerelle le remonte sans retenter
+        if (!setPumpState(params["state"], true)) refusal = "pump_fault";
+        return true;
+    }
+    if (strcmp(method, "resetPumpFault") == 0) {
+        pumpGuard.resetFault();
+        StaticJsonDocument<32> event;
+        event["fault"] = PumpGuard::tripName(PUMP_TRIP_NONE);
+        loraNode.queueUplink(event.as<JsonObjectConst>(), false);
+        return true;
+    }
+    if (strcmp(method, "setPumpGuard") == 0) {
+        pumpGuard.configure(params);
+        return true;
+    }
+    return false;
 }
 
 void onWsEvent(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type, void *arg, uint8_t *data, size_t len) {
     if (type == WS_EVT_CONNECT) {
+        SharedState state = sharedState.read();
         StaticJsonDocument<128> doc;
-        xSemaphoreTake(stateMutex, portMAX_DELAY);
-        doc["pumpOn"] = sharedState.pumpOn;
-        doc["temperature"] = sharedState.temperature;
-        doc["humidity"] = sharedState.humidity;
-        doc["voltage"] = sharedState.voltage;
-        doc["pressureOk"] = sharedState.pressureOk;
-        xSemaphoreGive(stateMutex);
+        doc["pumpOn"] = state.pumpOn;
+        doc["temperature"] = state.temperature;
+        doc["humidity"] = state.humidity;
+        doc["voltage"] = state.voltage;
+        doc["pressureOk"] = state.pressureOk;
+        doc["fault"] = PumpGuard::tripName(pumpGuard.getFault());
         String output;
         serializeJson(doc, output);
         client->text(output);
@@ -165,33 +252,40 @@ void setupWebServer() {
 
 void taskSensors(void* params) {
     for(;;) {
-        vTaskDelay(pdMS_TO_TICKS(SENSOR_READ_INTERVAL_MS));
-
-        SharedState stateCopy;
-        xSemaphoreTake(stateMutex, portMAX_DELAY);
-        sharedState.humidity = dht.readHumidity();
-        sharedState.temperature = dht.readTemperature();
-        sharedState.pressureOk = (digitalRead(PRESSURE_SENSOR_PIN) == HIGH);
-        sharedState.voltage = analogRead(VOLTAGE_SENSOR_PIN) * (3.3 / 4095.0) * 11.0;
-        stateCopy = sharedState;
-        xSemaphoreGive(stateMutex);
-        
+        // Mesures hors verrou : le DHT22 occupe la ligne plusieurs millisecondes, la tension est
+        // la dernière valeur filtrée par VoltageSampler
+        float humidity = dht.readHumidity();
+        float temperature = dht.readTemperature();
+        bool pressureOk = (digitalRead(PRESSURE_SENSOR_PIN) == HIGH);
+        float voltage = voltageSampler.read();
+        sharedState.update([&](SharedState& s) {
+            s.humidity = humidity;
+            s.temperature = temperature;
+            s.pressureOk = pressureOk;
+            s.voltage = voltage;
+        });
+
         StaticJsonDocument<128> doc;
-        doc["temperature"] = stateCopy.temperature;
-        doc["humidity"] = stateCopy.humidity;
-        doc["voltage"] = stateCopy.voltage;
-        doc["pressureOk"] = stateCopy.pressureOk;
+        doc["temperature"] = temperature;
+        doc["humidity"] = humidity;
+        doc["voltage"] = voltage;
+        doc["pressureOk"] = pressureOk;
         String output;
         serializeJson(doc, output);
         ws.textAll(output);
 
-        loraNode.sendTelemetry(stateCopy.temperature, stateCopy.humidity, stateCopy.voltage, stateCopy.pressureOk);
+        loraNode.sendTelemetry(temperature, humidity, voltage, pressureOk);
+        vTaskDelay(pdMS_TO_TICKS(SENSOR_READ_INTERVAL_MS)); // Première lecture dès le démarrage
     }
 }
 
 void taskLoRa(void* params) {
+    bool firstTxReported = false;
     for(;;) {
-        loraNode.run();
-        vTaskDelay(pdMS_TO_TICKS(100));
+        loraNode.run(); // Bloque jusqu'à DIO1, une demande d'émission ou la prochaine échéance
+        if (!firstTxReported && loraNode.getFirstTxAt() >= 0) {
+            bootPhase("first_tx", loraNode.getFirstTxAt());
+            firstTxReported = true;
+        }
     }
 }
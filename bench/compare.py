@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+# Compare deux relevés du banc (lignes JSON de `pio run -e native -t exec` ou du moniteur série)
+# Usage : compare.py avant.jsonl apres.jsonl [--threshold 5]
+import argparse
+import json
+import sys
+
+
+def load(path):
+    results = {}
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            line = line.strip()
+            start = line.find("{")
+            if start < 0:
+                continue
+            try:
+                record = json.loads(line[start:])
+            except ValueError:
+                continue
+            if "bench" in record:
+                results[(record["target"], record["frame"], record["bench"])] = record
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("before")
+    parser.add_argument("after")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="variation (%%) au-delà de laquelle une mesure est signalée")
+    args = parser.parse_args()
+
+    before = load(args.before)
+    after = load(args.after)
+    keys = sorted(set(before) & set(after))
+    if not keys:
+        print("Aucune mesure commune entre les deux relevés", file=sys.stderr)
+        return 1
+
+    # Sur la carte, les cycles sont plus stables que le temps mesuré
+    metric = lambda r: r.get("cycles_per_op") or r["ns_per_op"]
+    regressions = 0
+    print("%-8s %-10s %-16s %14s %14s %8s" % ("target", "frame", "bench", "before", "after", "delta"))
+    for key in keys:
+        old, new = metric(before[key]), metric(after[key])
+        delta = (new - old) / old * 100 if old else 0.0
+        flag = ""
+        if delta > args.threshold:
+            flag = "  slower"
+            regressions += 1
+        elif delta < -args.threshold:
+            flag = "  faster"
+        print("%-8s %-10s %-16s %14.1f %14.1f %+7.1f%%%s" % (key + (old, new, delta, flag)))
+    for key in sorted(set(before) ^ set(after)):
+        print("%-8s %-10s %-16s  absent de l'un des relevés" % key)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+
+// Chaque mesure est répétée BENCH_SAMPLES fois ; un échantillon enchaîne assez d'itérations
+// pour durer au moins BENCH_MIN_SAMPLE_US. Le résultat retenu est la médiane des échantillons.
+#ifndef BENCH_SAMPLES
+#define BENCH_SAMPLES 7
+#endif
+#ifndef BENCH_MIN_SAMPLE_US
+#define BENCH_MIN_SAMPLE_US 20000
+#endif
+
+#ifdef BENCH_NATIVE
+#define BENCH_TARGET "native"
+#else
+#define BENCH_TARGET "esp32s3"
+#endif
+
+typedef void (*BenchFn)(const void* context);
+
+struct BenchResult {
+    uint32_t iterations;     // Itérations par échantillon
+    double nsPerOp;          // Médiane des échantillons
+    double minNsPerOp;
+    double cyclesPerOp;      // Médiane, sur la carte uniquement (0 sur l'hôte)
+};
+
+BenchResult runBench(BenchFn fn, const void* context);
+
+// Une ligne JSON par mesure, sur stdout (hôte) ou le port série (carte) ; voir compare.py
+void reportHeader();
+void reportBench(const char* bench, const char* frame, size_t bytes, const BenchResult& result);
+void reportError(const char* frame, const char* message);
+
+// Consomme un résultat pour que le compilateur ne supprime pas le travail mesuré
+void benchSink(uint32_t value);
@@ -0,0 +1,18 @@
+#pragma once
+#include <Arduino.h>
+#include "types.h"
+
+// Trame de télémétrie telle qu'un module l'émet, préparée une fois pour toutes les mesures
+struct BenchFrame {
+    const char* name;        // Module d'origine : "wellguard", "aqua"
+    uint8_t nodeId;
+    String plaintext;        // JSON clair (TELEMETRY)
+    String ciphertext;       // Base64(AES-CBC(PKCS7(plaintext))), champ "p"
+    uint8_t encrypted[256];  // Chiffré brut, entrée du déchiffrement AES seul
+    size_t encryptedLen;
+    String raw;              // Trame complète {"p":..,"c":..}, comme la rend radio.readData
+    LoRaMessage message;     // Ce que la tâche LoRa place dans loraRxQueue pour MqttHandler
+};
+
+// Chiffre et encadre le message clair exactement comme LoraNode::transmitPlaintext
+void buildFrame(BenchFrame& frame, const char* name, uint8_t nodeId, const char* plaintext);
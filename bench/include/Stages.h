@@ -0,0 +1,9 @@
+#pragma once
+#include "Frames.h"
+
+// Vérifie que la trame suit tout le chemin de réception, puis prépare les entrées intermédiaires
+bool prepareStages(BenchFrame& frame);
+
+// Mesure chaque étape du chemin de réception de la passerelle, puis le chemin complet
+// (trame brute -> message MQTT), pour une trame donnée
+void runStages(const BenchFrame& frame);
@@ -0,0 +1,10 @@
+#pragma once
+
+// Identifiants du banc : seule la clé LoRa sert, et doit être celle des modules
+// (Modules/*/include/credentials.h) pour que les trames mesurées soient réalistes.
+#define WIFI_SSID "bench"
+#define WIFI_PASSWORD "bench"
+#define TB_SERVER "127.0.0.1"
+#define TB_GATEWAY_TOKEN "bench"
+#define LORA_SECRET_KEY "HydrauParkSecretKey2025"
+#define LORA_AES_IV "INITIALVECTORIV0"
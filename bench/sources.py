@@ -0,0 +1,24 @@
+# Compile les sources de la passerelle nécessaires au chemin de réception (LoRaHandler et ses
+# dépendances) ; l'environnement natif y ajoute les substituts et le noyau du simulateur.
+import os
+
+Import("env")
+
+ROOT = os.path.dirname(env.subst("$PROJECT_DIR"))
+GATEWAY = os.path.join(ROOT, "gateway")
+SIMULATOR = os.path.join(ROOT, "simulator")
+
+# MQTT, écran, profileur, serveur de métriques et main.cpp restent hors du banc : le formatage MQTT est reproduit dans Stages.cpp
+env.Append(CPPPATH=[os.path.join(GATEWAY, "include")])
+env.BuildSources(
+    os.path.join("$BUILD_DIR", "gateway"),
+    os.path.join(GATEWAY, "src"),
+    src_filter="+<*> -<main.cpp> -<MqttHandler.cpp> -<OledDisplay.cpp> -<RuntimeProfiler.cpp> -<MetricsServer.cpp>",
+)
+
+if env.subst("$PIOENV") == "native":
+    env.BuildSources(
+        os.path.join("$BUILD_DIR", "simulator"),
+        os.path.join(SIMULATOR, "src"),
+        src_filter="+<shim/> +<Kernel.cpp> +<Channel.cpp> +<Device.cpp>",
+    )
@@ -0,0 +1,115 @@
+#include "Bench.h"
+#include <ArduinoJson.h>
+#include <stdio.h>
+
+#ifdef BENCH_NATIVE
+#include <chrono>
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t cycleCount() { return 0; }
+#else
+#include <esp_timer.h>
+
+static uint64_t nowNs() { return (uint64_t)esp_timer_get_time() * 1000; }
+
+// Compteur 32 bits : il reboucle en ~18 s à 240 MHz, bien au-delà d'un échantillon
+static uint32_t cycleCount() { return ESP.getCycleCount(); }
+#endif
+
+static volatile uint32_t sink;
+
+void benchSink(uint32_t value) {
+    sink = sink + value;
+}
+
+struct Sample {
+    uint64_t ns;
+    uint32_t cycles;
+};
+
+static Sample runSample(BenchFn fn, const void* context, uint32_t iterations) {
+    uint64_t start = nowNs();
+    uint32_t startCycles = cycleCount();
+    for (uint32_t i = 0; i < iterations; i++) {
+        fn(context);
+    }
+    uint32_t cycles = cycleCount() - startCycles;
+    return { nowNs() - start, cycles };
+}
+
+static void sortAscending(double* values, int count) {
+    for (int i = 1; i < count; i++) {
+        double v = values[i];
+        int j = i - 1;
+        while (j >= 0 && values[j] > v) {
+            values[j + 1] = values[j];
+            j--;
+        }
+        values[j + 1] = v;
+    }
+}
+
+BenchResult runBench(BenchFn fn, const void* context) {
+    // Calibrage : on double le nombre d'itérations jusqu'à atteindre la durée minimale d'un échantillon
+    uint32_t iterations = 1;
+    for (;;) {
+        Sample sample = runSample(fn, context, iterations);
+        if (sample.ns >= (uint64_t)BENCH_MIN_SAMPLE_US * 1000 || iterations >= (1u << 30)) break;
+        iterations *= 2;
+    }
+
+    double ns[BENCH_SAMPLES];
+    double cycles[BENCH_SAMPLES];
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        Sample sample = runSample(fn, context, iterations);
+        ns[i] = (double)sample.ns / iterations;
+        cycles[i] = (double)sample.cycles / iterations;
+        yield();
+    }
+    sortAscending(ns, BENCH_SAMPLES);
+    sortAscending(cycles, BENCH_SAMPLES);
+    return { iterations, ns[BENCH_SAMPLES / 2], ns[0], cycles[BENCH_SAMPLES / 2] };
+}
+
+static void emit(const char* line) {
+#ifdef BENCH_NATIVE
+    puts(line);
+    fflush(stdout);
+#else
+    Serial.println(line);
+#endif
+}
+
+void reportHeader() {
+    char line[160];
+    int length = snprintf(line, sizeof(line), "{\"suite\":\"gateway_rx\",\"target\":\"%s\",\"arduinojson\":\"%s\",\"samples\":%d",
+                          BENCH_TARGET, ARDUINOJSON_VERSION, BENCH_SAMPLES);
+#ifndef BENCH_NATIVE
+    length += snprintf(line + length, sizeof(line) - length, ",\"cpu_mhz\":%u", (unsigned)ESP.getCpuFreqMHz());
+#endif
+    snprintf(line + length, sizeof(line) - length, "}");
+    emit(line);
+}
+
+void reportBench(const char* bench, const char* frame, size_t bytes, const BenchResult& result) {
+    char line[256];
+    int length = snprintf(line, sizeof(line),
+                          "{\"bench\":\"%s\",\"frame\":\"%s\",\"target\":\"%s\",\"bytes\":%u,\"iterations\":%u,"
+                          "\"ns_per_op\":%.1f,\"min_ns_per_op\":%.1f,\"ops_per_s\":%.0f",
+                          bench, frame, BENCH_TARGET, (unsigned)bytes, (unsigned)result.iterations,
+                          result.nsPerOp, result.minNsPerOp, result.nsPerOp > 0 ? 1e9 / result.nsPerOp : 0.0);
+#ifndef BENCH_NATIVE
+    length += snprintf(line + length, sizeof(line) - length, ",\"cycles_per_op\":%.0f", result.cyclesPerOp);
+#endif
+    snprintf(line + length, sizeof(line) - length, "}");
+    emit(line);
+}
+
+void reportError(const char* frame, const char* message) {
+    char line[160];
+    snprintf(line, sizeof(line), "{\"error\":\"%s\",\"frame\":\"%s\",\"target\":\"%s\"}", message, frame, BENCH_TARGET);
+    emit(line);
+}
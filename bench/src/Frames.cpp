@@ -0,0 +1,38 @@
+#include "Frames.h"
+#include "credentials.h"
+#include "helpers.h"
+#include <AESLib.h>
+#include <Base64.h>
+
+static AESLib frameAes;
+
+void buildFrame(BenchFrame& frame, const char* name, uint8_t nodeId, const char* plaintext) {
+    frame.name = name;
+    frame.nodeId = nodeId;
+    frame.plaintext = plaintext;
+
+    // Bourrage PKCS7 : un bloc complet est ajouté quand la longueur est déjà multiple de 16
+    int plaintextLen = frame.plaintext.length();
+    int paddedLen = (plaintextLen / 16 + 1) * 16;
+    byte padded[256];
+    memcpy(padded, frame.plaintext.c_str(), plaintextLen);
+    for (int i = plaintextLen; i < paddedLen; i++) {
+        padded[i] = paddedLen - plaintextLen;
+    }
+
+    byte key[16];
+    byte iv[16];
+    memcpy(key, LORA_SECRET_KEY, 16);
+    memcpy(iv, LORA_AES_IV, 16);
+    frameAes.encrypt(padded, paddedLen, frame.encrypted, key, sizeof(key), iv);
+    frame.encryptedLen = paddedLen;
+
+    char b64[base64_enc_len(paddedLen) + 1];
+    base64_encode(b64, (char*)frame.encrypted, paddedLen);
+    frame.ciphertext = b64;
+
+    char raw[400];
+    snprintf(raw, sizeof(raw), "{\"p\":\"%s\",\"c\":%u}", b64,
+             (unsigned)calculateCRC32((const uint8_t*)frame.plaintext.c_str(), plaintextLen));
+    frame.raw = raw;
+}
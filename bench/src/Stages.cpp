@@ -0,0 +1,158 @@
+#include "Stages.h"
+#include "Bench.h"
+#include "config.h"
+#include "credentials.h"
+#include "helpers.h"
+#include "DeviceManager.h"
+#include "LoRaHandler.h"
+#include <ArduinoJson.h>
+#include <AESLib.h>
+#include <Base64.h>
+
+// Qualité de signal fixe : la radio n'est pas interrogée pendant les mesures
+#define BENCH_RSSI -97.5f
+#define BENCH_SNR 6.25f
+
+static AESLib stageAes;
+static JsonDocument rxDoc; // Comme dans taskLoRaHandler, le document de la trame externe est réutilisé
+
+// Reprend le traitement de loraRxQueue dans taskMqttHandler (MqttHandler.cpp, qui dépend de
+// PubSubClient et n'est pas compilé ici) ; seule la publication est omise
+static size_t formatTelemetry(const LoRaMessage& rxMsg, char* mqttPayload, size_t size) {
+    JsonDocument telemetryDoc;
+    deserializeJson(telemetryDoc, rxMsg.payload);
+
+    const char* deviceName = deviceManager.getDeviceName(rxMsg.nodeId);
+    JsonObject data = telemetryDoc[LORA_KEY_DATA];
+    String dataStr;
+    serializeJson(data, dataStr);
+
+    uint64_t epochMs;
+    if (epochMillisAt(rxMsg.timestamps.irqAt, epochMs)) {
+        return snprintf(mqttPayload, size, "{\"%s\":[{\"ts\":%llu, \"values\":%s}]}",
+            deviceName, (unsigned long long)epochMs, dataStr.c_str());
+    }
+    return snprintf(mqttPayload, size, "{\"%s\":[%s]}", deviceName, dataStr.c_str());
+}
+
+// Chemin complet, dans l'ordre de taskLoRaHandler puis de taskMqttHandler
+static size_t processFrame(const String& raw, char* mqttPayload, size_t size) {
+    String rxStr(raw); // radio.readData remplit un String à chaque trame
+    JsonDocument decryptedDoc;
+    if (!openUplink(rxStr, rxDoc, decryptedDoc)) return 0;
+
+    const char* type = decryptedDoc[LORA_KEY_TYPE] | "";
+    if (strcmp(type, LORA_MSG_TYPE_TELEMETRY) != 0) return 0;
+    uint8_t nodeId = decryptedDoc[LORA_KEY_NODE_ID];
+    if (!deviceManager.isDeviceRegistered(nodeId)) return 0;
+
+    LoRaMessage msg;
+    msg.timestamps = { micros(), 0, 0, 0, 0 };
+    if (!packTelemetry(decryptedDoc, nodeId, BENCH_RSSI, BENCH_SNR, msg)) return 0;
+    return formatTelemetry(msg, mqttPayload, size);
+}
+
+static void benchCrc32(const void* context) {
+    const BenchFrame& frame = *(const BenchFrame*)context;
+    benchSink(calculateCRC32((const uint8_t*)frame.plaintext.c_str(), frame.plaintext.length()));
+}
+
+static void benchBase64Decode(const void* context) {
+    const BenchFrame& frame = *(const BenchFrame*)context;
+    char input[400];
+    frame.ciphertext.toCharArray(input, sizeof(input));
+    char decoded[300];
+    benchSink(base64_decode(decoded, input, frame.ciphertext.length()));
+}
+
+static void benchAesDecrypt(const void* context) {
+    const BenchFrame& frame = *(const BenchFrame*)context;
+    byte key[16];
+    byte iv[16];
+    memcpy(key, LORA_SECRET_KEY, 16);
+    memcpy(iv, LORA_AES_IV, 16);
+    byte decrypted[256];
+    stageAes.decrypt((byte*)frame.encrypted, frame.encryptedLen, decrypted, key, sizeof(key), iv);
+    benchSink(decrypted[0]);
+}
+
+static void benchOuterParse(const void* context) {
+    const BenchFrame& frame = *(const BenchFrame*)context;
+    benchSink(deserializeJson(rxDoc, frame.raw) == DeserializationError::Ok);
+}
+
+static void benchDecryptPayload(const void* context) {
+    const BenchFrame& frame = *(const BenchFrame*)context;
+    benchSink(decrypt_payload(frame.ciphertext).length());
+}
+
+static void benchInnerParse(const void* context) {
+    const BenchFrame& frame = *(const BenchFrame*)context;
+    JsonDocument decryptedDoc;
+    benchSink(deserializeJson(decryptedDoc, frame.plaintext) == DeserializationError::Ok);
+}
+
+static void benchOpenUplink(const void* context) {
+    const BenchFrame& frame = *(const BenchFrame*)context;
+    JsonDocument decryptedDoc;
+    benchSink(openUplink(frame.raw, rxDoc, decryptedDoc));
+}
+
+static void benchPackTelemetry(const void* context) {
+    const BenchFrame& frame = *(const BenchFrame*)context;
+    JsonDocument decryptedDoc;
+    deserializeJson(decryptedDoc, frame.plaintext);
+    LoRaMessage msg;
+    benchSink(packTelemetry(decryptedDoc, frame.nodeId, BENCH_RSSI, BENCH_SNR, msg));
+}
+
+static void benchMqttFormat(const void* context) {
+    const BenchFrame& frame = *(const BenchFrame*)context;
+    char mqttPayload[640];
+    benchSink(formatTelemetry(frame.message, mqttPayload, sizeof(mqttPayload)));
+}
+
+static void benchPipeline(const void* context) {
+    const BenchFrame& frame = *(const BenchFrame*)context;
+    char mqttPayload[640];
+    benchSink(processFrame(frame.raw, mqttPayload, sizeof(mqttPayload)));
+}
+
+bool prepareStages(BenchFrame& frame) {
+    char mqttPayload[640];
+    if (processFrame(frame.raw, mqttPayload, sizeof(mqttPayload)) == 0) {
+        reportError(frame.name, "frame rejected by the gateway receive path");
+        return false;
+    }
+
+    JsonDocument decryptedDoc;
+    deserializeJson(decryptedDoc, frame.plaintext);
+    packTelemetry(decryptedDoc, frame.nodeId, BENCH_RSSI, BENCH_SNR, frame.message);
+    return true;
+}
+
+struct Stage {
+    const char* name;
+    BenchFn fn;
+};
+
+// pack_telemetry comprend l'analyse du message clair, nécessaire pour repartir d'un document intact
+static const Stage STAGES[] = {
+    { "crc32", benchCrc32 },
+    { "base64_decode", benchBase64Decode },
+    { "aes_decrypt", benchAesDecrypt },
+    { "outer_parse", benchOuterParse },
+    { "decrypt_payload", benchDecryptPayload },
+    { "inner_parse", benchInnerParse },
+    { "open_uplink", benchOpenUplink },
+    { "pack_telemetry", benchPackTelemetry },
+    { "mqtt_format", benchMqttFormat },
+    { "pipeline", benchPipeline },
+};
+
+void runStages(const BenchFrame& frame) {
+    for (const Stage& stage : STAGES) {
+        BenchResult result = runBench(stage.fn, &frame);
+        reportBench(stage.name, frame.name, frame.raw.length(), result);
+    }
+}
@@ -0,0 +1,67 @@
+// Microbenchmarks du chemin de réception de la passerelle : voir README.md, section « Microbenchmarks »
+#include <Arduino.h>
+#include <RadioLib.h>
+#include "config.h"
+#include "types.h"
+#include "DeviceManager.h"
+#include "Bench.h"
+#include "Frames.h"
+#include "Stages.h"
+
+// Objets globaux attendus par LoRaHandler.cpp ; la radio et les files ne servent pas pendant les mesures
+SX1262 radio = new Module(LORA_CS, LORA_DIO1, LORA_RST, LORA_BUSY);
+SystemStatus systemStatus = { WIFI_DISCONNECTED, GW_MQTT_DISCONNECTED, 0, 0 };
+
+QueueHandle_t loraTxQueue;
+QueueHandle_t loraRxQueue;
+QueueHandle_t systemQueue;
+QueueHandle_t rpcResultQueue;
+QueueHandle_t bulkTxQueue;
+
+// Relevés typiques des deux modules, sérialisés comme LoraNode::transmitUplink (%u : nodeId)
+static const char* WELLGUARD_TELEMETRY =
+    "{\"type\":\"TELEMETRY\",\"nodeId\":%u,\"msgCtr\":18342,"
+    "\"data\":{\"temperature\":23.75,\"humidity\":61.2,\"voltage\":3.71,\"pressure_ok\":true}}";
+static const char* AQUA_TELEMETRY =
+    "{\"type\":\"TELEMETRY\",\"nodeId\":%u,\"msgCtr\":955,\"conf\":1,"
+    "\"data\":{\"level_full\":false,\"voltage\":3.3}}";
+
+static BenchFrame frames[2];
+
+static void prepareFrame(BenchFrame& frame, const char* name, const char* mac, const char* type, const char* format) {
+    // Déjà enregistré lors d'une mesure précédente : un second JOIN au même nonce serait refusé
+    uint8_t nodeId = deviceManager.findNodeIdByName(mac);
+    if (nodeId == 0) nodeId = deviceManager.registerDevice(mac, type, 0, 1);
+    char plaintext[200];
+    snprintf(plaintext, sizeof(plaintext), format, (unsigned)nodeId);
+    buildFrame(frame, name, nodeId, plaintext);
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(1000);
+
+    // Les modules doivent être connus pour que leur télémétrie soit transmise à ThingsBoard.
+    // Sur la carte, l'enregistrement est écrit en NVS : utiliser une carte dédiée au banc.
+    deviceManager.init();
+    prepareFrame(frames[0], "wellguard", "24:6F:28:A1:B2:C3", "WELL_PUMP_STATION", WELLGUARD_TELEMETRY);
+    prepareFrame(frames[1], "aqua", "24:6F:28:D4:E5:F6", "RESERVOIR_SENSOR", AQUA_TELEMETRY);
+
+    reportHeader();
+    for (BenchFrame& frame : frames) {
+        if (prepareStages(frame)) {
+            runStages(frame);
+        }
+    }
+}
+
+void loop() {
+    vTaskDelay(portMAX_DELAY);
+}
+
+#ifdef BENCH_NATIVE
+int main() {
+    setup();
+    return 0;
+}
+#endif
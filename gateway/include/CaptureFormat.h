@@ -0,0 +1,75 @@
+#pragma once
+#include <stdint.h>
+
+// Format des captures de trames (.lcap), écrit par FrameCapture et relu par le rejeu du simulateur
+// et tools/capture.py. Comme pcap : un en-tête de fichier, puis des enregistrements horodatés à la
+// microseconde depuis le démarrage de la passerelle. Entiers et flottants en petit-boutiste.
+// Chaque démarrage commence par un enregistrement SESSION suivi d'un DEVICE par module connu :
+// de quoi reconstituer la passerelle telle qu'elle était avant la première trame.
+
+#define CAPTURE_MAGIC "LCAP"
+#define CAPTURE_VERSION 1
+
+struct __attribute__((packed)) CaptureFileHeader {
+    char magic[4];               // CAPTURE_MAGIC
+    uint16_t version;
+    uint16_t reserved;
+};
+
+enum CaptureRecordType : uint8_t {
+    CAPTURE_RECORD_SESSION = 'S',   // CaptureSession
+    CAPTURE_RECORD_DEVICE = 'D',    // CaptureDevice
+    CAPTURE_RECORD_FRAME = 'F',     // CaptureFrame, puis les octets reçus
+    CAPTURE_RECORD_TELEMETRY = 'T', // CaptureTelemetry, puis le JSON remis à la tâche MQTT
+};
+
+struct __attribute__((packed)) CaptureRecordHeader {
+    uint8_t type;                // CaptureRecordType
+    uint8_t reserved;
+    uint16_t length;             // Octets qui suivent l'en-tête
+    uint64_t timeUs;             // Depuis le démarrage ; pour une trame, instant de l'interruption radio
+};
+
+// Configuration du modem et de la passerelle au démarrage
+struct __attribute__((packed)) CaptureSession {
+    uint32_t frequencyHz;
+    uint32_t bandwidthHz;
+    uint8_t spreadingFactor;
+    uint8_t codingRate;          // 5 à 8 pour 4/5 à 4/8
+    uint8_t syncWord;
+    uint8_t reserved;
+    uint16_t preambleLength;
+    uint16_t maxDevices;
+    char firmware[16];           // FIRMWARE_VERSION
+};
+
+// Module enregistré (NVS) au début de la session
+struct __attribute__((packed)) CaptureDevice {
+    uint8_t nodeId;
+    uint8_t reserved;
+    uint32_t reportFloorMs;
+    char deviceName[20];
+    char deviceType[24];
+};
+
+struct __attribute__((packed)) CaptureFrame {
+    float rssi;
+    float snr;
+    int16_t radioState;          // Code RadioLib de readData (RADIOLIB_ERR_CRC_MISMATCH...)
+};
+
+struct __attribute__((packed)) CaptureTelemetry {
+    uint8_t nodeId;
+};
+
+// Charge utile la plus longue : une télémétrie (LoRaMessage::payload) ou une trame de 255 octets
+#define CAPTURE_MAX_DATA (sizeof(CaptureTelemetry) + 512)
+
+// Anneau en flash : chaque secteur commence par cet en-tête, suivi d'enregistrements complets ;
+// la fin des données est le premier octet effacé (0xFF) à la place d'un type d'enregistrement.
+#define CAPTURE_SECTOR_MAGIC 0x4553434CUL // "LCSE"
+
+struct __attribute__((packed)) CaptureSectorHeader {
+    uint32_t magic;
+    uint32_t sequence;           // Croissante : le secteur le plus ancien a la plus petite
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include "config.h"
+#include "types.h"
+
+// Estime l'occupation du canal et attribue à chaque module son intervalle de télémétrie (AIMD).
+// Toutes les méthodes de mise à jour sont appelées depuis la tâche LoRa uniquement ;
+// les accesseurs de lecture peuvent être appelés depuis les autres tâches.
+class CongestionController {
+public:
+    CongestionController();
+    void onFrameReceived(uint32_t airtimeUs);
+    void onFrameTransmitted(uint32_t airtimeUs);
+    void onRxError();
+    void onUplink(uint8_t nodeId, uint32_t counterGap);
+    void onConfigAck(uint8_t nodeId, uint16_t msgId);
+    void evaluate();
+    bool getPendingConfig(uint8_t nodeId, uint32_t& intervalMs, uint32_t& jitterMs);
+    void markConfigSent(uint8_t nodeId, uint16_t msgId);
+    float getUtilization() const { return utilization; }
+    float getLossRatio() const { return lossRatio; }
+    uint32_t getAssignedInterval(uint8_t nodeId) const;
+
+private:
+    struct NodeState {
+        bool seen;
+        uint32_t assignedIntervalMs;
+        uint32_t confirmedIntervalMs; // 0 = configuration du module inconnue
+        uint16_t pendingMsgId;        // Commande set_config en attente d'ACK, 0 = aucune
+    };
+    NodeState nodes[MAX_DEVICES];
+
+    unsigned long windowStart;
+    uint64_t windowAirtimeUs;
+    uint32_t windowDelivered;
+    uint32_t windowLost;
+    uint32_t windowErrors;
+    volatile float utilization;
+    volatile float lossRatio;
+
+    uint32_t floorFor(uint8_t nodeId);
+};
+
+extern CongestionController congestionController;
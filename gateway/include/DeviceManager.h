@@ -7,12 +7,25 @@ class DeviceManager {
 public:
     DeviceManager();
     void init();
-    int8_t registerDevice(const char* mac, const char* type);
+    // Retourne le nodeId, 0 si joinNonce n'est pas supérieur au dernier accepté (rejeu), -1 si plus de place
+    int8_t registerDevice(const char* mac, const char* type, uint8_t historyDepth, uint32_t joinNonce);
     bool isDeviceRegistered(uint8_t nodeId);
-    bool isValidMessageCounter(uint8_t nodeId, uint32_t counter);
+    bool isValidMessageCounter(uint8_t nodeId, uint32_t counter, uint32_t* gap = nullptr);
+    // restartedAt : point de reprise annoncé par le module (LORA_KEY_RESTART), 0 si aucun.
+    // joinNonce : nonce d'adhésion porté par le message (LORA_KEY_JOIN_NONCE), 0 si aucun.
+    CounterCheck checkMessageCounter(uint8_t nodeId, uint32_t counter, uint32_t* gap = nullptr,
+                                     uint32_t restartedAt = 0, uint32_t joinNonce = 0);
+    // Plage de compteurs perdus depuis le dernier appel, à redemander au module, et ceux de la plage
+    // arrivés depuis en retard (skip, BACKFILL_MAX_SKIP au plus) ; false si aucune
+    bool takeMissingRange(uint8_t nodeId, uint32_t& from, uint32_t& to, uint32_t* skip, uint8_t& skipCount);
+    void setReportFloor(uint8_t nodeId, uint32_t floorMs);
+    uint32_t getReportFloor(uint8_t nodeId);
     void updateDeviceSignalInfo(uint8_t nodeId, float rssi, float snr);
     const char* getDeviceName(uint8_t nodeId);
+    const char* getDeviceType(uint8_t nodeId);
     uint8_t findNodeIdByName(const char* name);
+    // Modules actifs de ce type ; retourne leur nombre
+    uint8_t findNodeIdsByType(const char* type, uint8_t* nodeIds, uint8_t maxCount);
     uint8_t getOnlineDeviceCount();
     void getAllActiveDeviceNames(JsonArray& deviceList);
     const DeviceInfo* getDeviceInfo(uint8_t index);
@@ -22,6 +35,10 @@ private:
     SemaphoreHandle_t mutex;
     void loadFromNVS();
     void saveToNVS(uint8_t slotIndex);
+    void saveCounter(uint8_t slotIndex);
+    void resetCounter(uint8_t slotIndex);
+    static void clearMissing(DeviceInfo& device);
+    static void forgetMissing(DeviceInfo& device, uint32_t counter);
     uint8_t findEmptySlot();
     int8_t findDeviceByMac(const char* mac);
 
@@ -0,0 +1,77 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// Fragmentation des messages trop longs pour une seule trame LoRa.
+// Un transfert est identifié par (pair, transferId) ; chaque fragment porte son index
+// et le nombre total de fragments. Le destinataire renvoie un masque des fragments
+// reçus (bit i = fragment i), et l'émetteur ne réémet que ceux qui manquent.
+// Ce module ne connaît ni JSON ni radio : le codage des trames reste au LoRaHandler / LoraNode.
+
+#define FRAG_MAX_PAYLOAD_LEN (FRAG_CHUNK_SIZE * FRAG_MAX_FRAGMENTS)
+
+static_assert(FRAG_MAX_FRAGMENTS <= 32, "Le masque des fragments reçus tient sur 32 bits");
+
+enum FragmentResult {
+    FRAG_ACCEPTED,   // Nouveau fragment stocké
+    FRAG_DUPLICATE,  // Déjà reçu (ou transfert déjà complet)
+    FRAG_COMPLETE,   // Ce fragment complète le message
+    FRAG_REJECTED    // Fragment invalide ou aucun tampon disponible
+};
+
+// Côté émetteur : conserve une copie du message et l'état d'acquittement de chaque fragment.
+class FragmentSender {
+public:
+    FragmentSender();
+    bool begin(uint8_t peerId, uint16_t transferId, const uint8_t* data, size_t length);
+    void reset() { active = false; }
+    bool isActive() const { return active; }
+    bool isDone() const { return active && ackedMask == fullMask(); }
+    uint8_t getPeer() const { return peerId; }
+    uint16_t getTransferId() const { return transferId; }
+    uint8_t getCount() const { return count; }
+    size_t getFragment(uint8_t index, const uint8_t*& chunk) const;
+    uint32_t getMissingMask() const { return fullMask() & ~ackedMask; }
+    bool onStatus(uint32_t receivedMask); // Retourne true si le masque a progressé
+
+private:
+    bool active;
+    uint8_t peerId;
+    uint16_t transferId;
+    uint8_t count;
+    size_t length;
+    uint32_t ackedMask;
+    uint8_t buffer[FRAG_MAX_PAYLOAD_LEN];
+
+    uint32_t fullMask() const { return count >= 32 ? 0xFFFFFFFFUL : ((1UL << count) - 1); }
+};
+
+// Côté destinataire : tampons de réassemblage bornés (un transfert par pair au plus),
+// libérés après FRAG_REASSEMBLY_TIMEOUT_MS d'inactivité.
+class FragmentReassembler {
+public:
+    FragmentReassembler();
+    FragmentResult add(uint8_t peerId, uint16_t transferId, uint8_t index, uint8_t count,
+                       const uint8_t* chunk, size_t chunkLength);
+    uint32_t getReceivedMask(uint8_t peerId, uint16_t transferId) const;
+    const char* getMessage(uint8_t peerId, uint16_t transferId, size_t& length) const;
+    void expire();
+
+private:
+    struct Slot {
+        bool used;
+        bool complete;
+        uint8_t peerId;
+        uint16_t transferId;
+        uint8_t count;
+        uint32_t receivedMask;
+        size_t length;               // Connue dès réception du dernier fragment
+        unsigned long lastActivity;
+        char data[FRAG_MAX_PAYLOAD_LEN + 1];
+    };
+    Slot slots[FRAG_REASSEMBLY_SLOTS];
+
+    Slot* findSlot(uint8_t peerId, uint16_t transferId);
+    const Slot* findSlot(uint8_t peerId, uint16_t transferId) const;
+    Slot* allocateSlot(uint8_t peerId);
+};
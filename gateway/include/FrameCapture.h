@@ -0,0 +1,58 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+#include "CaptureFormat.h"
+
+#if CAPTURE_MODE
+
+#if CAPTURE_MODE == CAPTURE_FLASH
+#include <esp_partition.h>
+#endif
+
+// Capture des trames reçues pour le rejeu (CAPTURE_MODE). onFrame et onTelemetry copient
+// l'enregistrement dans une file sans attendre ; une tâche de faible priorité l'écrit sur le port
+// série ou en flash. File pleine : l'enregistrement est perdu et compté.
+class FrameCapture {
+public:
+    bool begin();  // Après deviceManager.init() : la session décrit les modules déjà enregistrés
+    void onFrame(const uint8_t* data, size_t length, int16_t radioState, float rssi, float snr, uint32_t irqAt);
+    void onTelemetry(const LoRaMessage& msg);
+    uint32_t getDropped() const { return dropped; }
+
+#if CAPTURE_MODE == CAPTURE_FLASH
+    // Contenu brut de l'anneau, pour GET /capture
+    uint32_t getFlashSize() const { return partition ? sectorCount * SPI_FLASH_SEC_SIZE : 0; }
+    size_t readFlash(uint32_t offset, uint8_t* buffer, size_t length);
+#endif
+
+private:
+    struct Item {
+        CaptureRecordHeader header;
+        uint8_t data[CAPTURE_MAX_DATA];
+    };
+
+    QueueHandle_t queue = nullptr;
+    volatile uint32_t dropped = 0;
+
+    void enqueue(Item& item);
+    static void task(void* params);
+    void run();
+    void write(const Item& item);
+
+#if CAPTURE_MODE == CAPTURE_FLASH
+    const esp_partition_t* partition = nullptr;
+    SemaphoreHandle_t flashMutex = nullptr;  // Écriture (tâche Capture) contre lecture (serveur HTTP)
+    uint32_t sectorCount = 0;
+    uint32_t currentSector = 0;
+    uint32_t sectorOffset = 0;               // Prochain octet libre dans le secteur courant
+    uint32_t sequence = 0;
+
+    bool openFlash();
+    void startSector(uint32_t sector);
+#endif
+};
+
+extern FrameCapture frameCapture;
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+#include <ArduinoJson.h>
+#include <esp_partition.h>
+#include "config.h"
+#include "types.h"
+#include "FuotaCodec.h"
+
+// Session de mise à jour du firmware d'un module ou d'un groupe de modules.
+// start() est appelé par la tâche MQTT (RPC "fuota_start") et lance le téléchargement
+// dans une tâche dédiée ; toutes les autres méthodes sont appelées par la tâche LoRa.
+class FuotaServer {
+public:
+    FuotaServer();
+    RpcFailure start(const char* url, const char* sha256Hex, const uint8_t* nodeIds, uint8_t count,
+                     uint8_t requesterId, int32_t rpcId);
+    bool isBusy() const { return phase != PHASE_IDLE; }
+    void service(JsonDocument& txDoc);
+    bool onUplink(uint8_t nodeId, JsonDocument& txDoc);
+    void onStatus(uint8_t nodeId, JsonObjectConst status);
+
+private:
+    enum Phase {
+        PHASE_IDLE,
+        PHASE_DOWNLOADING,
+        PHASE_SETUP,
+        PHASE_BROADCAST,
+        PHASE_STATUS,
+        PHASE_REPAIR
+    };
+    struct Target {
+        uint8_t nodeId;
+        bool ready;
+        bool done;
+        bool failed;
+        unsigned long lastSetupAt;
+    };
+    struct Repair {
+        uint32_t generation;
+        uint8_t count;
+    };
+
+    volatile Phase phase;
+    Target targets[MAX_DEVICES];
+    uint8_t targetCount;
+    uint8_t requesterId;
+    int32_t rpcId;
+    unsigned long requestedAt;
+
+    char url[160];
+    uint8_t expectedHash[32];
+    uint32_t imageSize;
+    uint32_t generationCount;
+    const esp_partition_t* storage;
+    uint8_t sessionId;
+    unsigned long phaseStartedAt;
+    unsigned long lastFrameAt;
+
+    uint32_t generation;              // Diffusion : position courante
+    uint16_t row;
+    uint8_t statusIndex;              // Interrogation : module courant
+    uint8_t statusAttempts;
+    bool statusReceived;
+    unsigned long statusRequestedAt;
+    Repair repairs[FUOTA_REPAIR_LIST_SIZE];
+    uint8_t repairCount;
+    uint8_t repairIndex;
+    uint8_t repairRound;
+
+    uint32_t cachedGeneration;        // Génération lue en flash pour calculer les lignes
+    bool cacheValid;
+    uint8_t cache[FUOTA_GENERATION_SIZE];
+
+    static void downloadTask(void* param);
+    bool download();
+    Target* findTarget(uint8_t nodeId);
+    uint8_t destination() const;
+    void sendSetup(uint8_t nodeId, JsonDocument& txDoc);
+    void sendStatusRequest(uint8_t nodeId, JsonDocument& txDoc);
+    void sendRow(uint32_t gen, uint16_t rowIndex, JsonDocument& txDoc);
+    void addRepair(uint32_t gen, uint8_t deficit);
+    void enterPhase(Phase next);
+    void finish();
+};
+
+extern FuotaServer fuotaServer;
@@ -0,0 +1,111 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+
+// Trames montantes déchiffrées, par type de message
+enum UplinkType {
+    UPLINK_TYPE_JOIN,
+    UPLINK_TYPE_TELEMETRY,
+    UPLINK_TYPE_ACK,
+    UPLINK_TYPE_FRAGMENT,
+    UPLINK_TYPE_FRAGMENT_ACK,
+    UPLINK_TYPE_FUOTA_STATUS,
+    UPLINK_TYPE_HISTORY,
+    UPLINK_TYPE_OTHER,
+    UPLINK_TYPE_COUNT
+};
+
+// Raisons d'abandon d'une trame montante, de la radio jusqu'à la file MQTT
+enum RxReject {
+    REJECT_RADIO_CRC,        // CRC matériel de la SX1262
+    REJECT_RADIO_ERROR,      // Autre erreur de lecture radio
+    REJECT_JSON_INVALID,     // Trame externe illisible
+    REJECT_FORMAT_INVALID,   // "p" ou "c" absent
+    REJECT_DECRYPT_FAILED,
+    REJECT_CRC_MISMATCH,     // CRC32 du message clair
+    REJECT_PAYLOAD_INVALID,  // Message clair illisible, ou message réassemblé incohérent
+    REJECT_UNKNOWN_NODE,
+    REJECT_REPLAY,           // Compteur trop ancien
+    REJECT_DUPLICATE,        // Compteur déjà reçu (un doublon confirmé est tout de même ré-acquitté)
+    REJECT_FRAGMENT,         // Fragment refusé par le réassemblage
+    REJECT_TOO_LONG,         // Télémétrie trop longue pour LoRaMessage
+    REJECT_RX_QUEUE_FULL,
+    REJECT_JOIN_QUEUE_FULL,
+    REJECT_COUNT
+};
+
+// Trames descendantes, par usage
+enum TxKind {
+    TX_JOIN_ACCEPT,
+    TX_ACK,
+    TX_COMMAND,
+    TX_COMMAND_RETRY,
+    TX_FRAGMENT,             // Fragments et FACK
+    TX_FUOTA,
+    TX_KIND_COUNT
+};
+
+// Qualité de signal d'un module, en dixièmes de dB
+struct NodeSignalSnapshot {
+    uint32_t packets;
+    int32_t rssiLast, rssiMin, rssiMax, rssiAvg;
+    int32_t snrLast, snrMin, snrMax, snrAvg;
+};
+
+// Compteurs du protocole, exposés sur /metrics (MetricsServer). Atomiques et sans verrou : la tâche
+// LoRa les incrémente sur son chemin critique, le serveur HTTP les lit depuis sa propre tâche.
+// Les statistiques de signal n'ont qu'un écrivain (la tâche LoRa) et ne passent pas par
+// DeviceManager.
+class GatewayMetrics {
+public:
+    void onUplink(UplinkType type);
+    void onReject(RxReject reason);
+    void onForwarded();
+    void onTransmit(TxKind kind, bool ok, uint32_t airtimeUs);
+    void onReceiveAirtime(uint32_t airtimeUs);
+    void onAckRetry();
+    void onCommandAcked();
+    void onAckTimeout();
+    void onSignal(uint8_t nodeId, float rssi, float snr);
+
+    uint32_t getUplinks(UplinkType type) const { return uplinks[type].load(std::memory_order_relaxed); }
+    uint32_t getRejects(RxReject reason) const { return rejects[reason].load(std::memory_order_relaxed); }
+    uint32_t getForwarded() const { return forwarded.load(std::memory_order_relaxed); }
+    uint32_t getTxOk(TxKind kind) const { return txOk[kind].load(std::memory_order_relaxed); }
+    uint32_t getTxFailed(TxKind kind) const { return txFailed[kind].load(std::memory_order_relaxed); }
+    uint32_t getTxAirtimeMs() const { return txAirtimeMs.load(std::memory_order_relaxed); }
+    uint32_t getRxAirtimeMs() const { return rxAirtimeMs.load(std::memory_order_relaxed); }
+    uint32_t getAckRetries() const { return ackRetries.load(std::memory_order_relaxed); }
+    uint32_t getCommandsAcked() const { return commandsAcked.load(std::memory_order_relaxed); }
+    uint32_t getAckTimeouts() const { return ackTimeouts.load(std::memory_order_relaxed); }
+    bool getSignal(uint8_t nodeId, NodeSignalSnapshot& out) const; // false si aucun paquet reçu
+
+    static const char* uplinkTypeName(UplinkType type);
+    static const char* rejectName(RxReject reason);
+    static const char* txKindName(TxKind kind);
+
+private:
+    struct NodeSignal {
+        std::atomic<uint32_t> packets{0};
+        std::atomic<int32_t> rssiLast{0}, rssiMin{0}, rssiMax{0}, rssiAvg{0};
+        std::atomic<int32_t> snrLast{0}, snrMin{0}, snrMax{0}, snrAvg{0};
+    };
+
+    std::atomic<uint32_t> uplinks[UPLINK_TYPE_COUNT] = {};
+    std::atomic<uint32_t> rejects[REJECT_COUNT] = {};
+    std::atomic<uint32_t> forwarded{0};
+    std::atomic<uint32_t> txOk[TX_KIND_COUNT] = {};
+    std::atomic<uint32_t> txFailed[TX_KIND_COUNT] = {};
+    std::atomic<uint32_t> txAirtimeMs{0};
+    std::atomic<uint32_t> rxAirtimeMs{0};
+    std::atomic<uint32_t> ackRetries{0};
+    std::atomic<uint32_t> commandsAcked{0};
+    std::atomic<uint32_t> ackTimeouts{0};
+    NodeSignal signals[MAX_DEVICES + 1]; // Indexé par nodeId
+
+    static void updateStat(std::atomic<int32_t>& last, std::atomic<int32_t>& min, std::atomic<int32_t>& max,
+                           std::atomic<int32_t>& avg, int32_t value, bool first);
+};
+
+extern GatewayMetrics gatewayMetrics;
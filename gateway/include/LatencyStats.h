@@ -0,0 +1,70 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+#define LATENCY_BUCKETS ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+
+// Étapes du chemin de réception, chacune entre deux horodatages de PacketTimestamps
+enum LatencyStage {
+    STAGE_DECODE,   // Interruption DIO1 -> trame déchiffrée et vérifiée
+    STAGE_ENQUEUE,  // Trame déchiffrée -> placée dans loraRxQueue (compteur, ACK, mise en forme)
+    STAGE_QUEUE,    // Attente dans loraRxQueue
+    STAGE_PUBLISH,  // Formatage et publication MQTT
+    STAGE_TOTAL,    // Interruption -> publication
+    STAGE_COUNT
+};
+
+// Histogramme log-linéaire : les valeurs inférieures à 2^LATENCY_SUB_BITS µs ont chacune leur
+// intervalle, puis chaque puissance de deux est découpée en 2^LATENCY_SUB_BITS intervalles égaux.
+// L'erreur relative est ainsi bornée quelle que soit l'échelle, pour un tableau de taille fixe.
+class LatencyHistogram {
+public:
+    void record(uint32_t valueUs);
+    void reset();
+    uint32_t getCount() const { return count; }
+    uint32_t getMax() const { return maxUs; }
+    uint32_t percentile(float p) const; // Borne supérieure de l'intervalle contenant ce rang
+
+private:
+    uint32_t buckets[LATENCY_BUCKETS] = {0};
+    uint32_t count = 0;
+    uint32_t maxUs = 0;
+
+    static uint16_t bucketOf(uint32_t valueUs);
+    static uint32_t bucketUpperBound(uint16_t bucket);
+};
+
+struct LatencySummary {
+    uint32_t count;
+    uint32_t p50Us;
+    uint32_t p90Us;
+    uint32_t p99Us;
+    uint32_t maxUs;
+};
+
+// Résumé de la dernière fenêtre close
+struct LatencyReport {
+    LatencySummary stages[STAGE_COUNT];
+    uint32_t windowMs;
+    uint32_t publishFailures;
+};
+
+// Agrégation par fenêtres de LATENCY_REPORT_INTERVAL_MS. record, onPublishFailed et closeWindow
+// sont appelés par la tâche MQTT ; getReport peut l'être depuis n'importe quelle tâche (écran).
+class LatencyStats {
+public:
+    void record(const PacketTimestamps& ts);
+    void onPublishFailed();
+    bool closeWindow();   // true quand une fenêtre vient d'être close : son résumé est à publier
+    LatencyReport getReport();
+    static const char* stageName(LatencyStage stage);
+
+private:
+    LatencyHistogram histograms[STAGE_COUNT];
+    uint32_t publishFailures = 0;
+    unsigned long windowStart = 0;
+    LatencyReport report = {};
+};
+
+extern LatencyStats latencyStats;
@@ -1,9 +1,29 @@
 #pragma once
 #include <Arduino.h>
+#include <ArduinoJson.h>
+#include "types.h"
+#include "GatewayMetrics.h"
 
 void taskLoRaHandler(void *pvParameters);
 void loraInterrupt();
+// Réveille la tâche LoRa en dehors de l'interruption radio (trames du mode de charge synthétique)
+void wakeLoRaTask();
 
 // Fonctions pour le chiffrement AES
 String encrypt_payload(const String& plaintext);
 String decrypt_payload(const String& b64_ciphertext);
+
+// Chemin de réception d'une trame montante, découpé pour être mesuré séparément (voir bench/)
+// JSON externe, déchiffrement et CRC32 : le message clair est placé dans decryptedDoc
+bool openUplink(const String& rxStr, JsonDocument& rxDoc, JsonDocument& decryptedDoc);
+// Ajoute RSSI/SNR à la télémétrie et la sérialise dans le message destiné à ThingsBoard
+bool packTelemetry(JsonDocument& decryptedDoc, uint8_t nodeId, float rssi, float snr, LoRaMessage& msg);
+
+// Chiffre un message clair et l'émet dans une seule trame (tâche LoRa uniquement)
+bool transmitPlaintext(const String& plaintext, JsonDocument& txDoc, TxKind kind);
+
+// Construction d'une commande descendante chiffrée (CMD) prête à être placée dans loraTxQueue
+uint16_t allocateCommandMsgId();
+bool buildCommand(LoRaTxCommand& cmd, uint8_t nodeId, const char* method, JsonVariantConst params, bool requireAck);
+// Commande trop longue pour une trame (LORA_MAX_PLAINTEXT_LEN) : émise en fragments via bulkTxQueue
+bool buildBulkCommand(LoRaBulkCommand& cmd, uint8_t nodeId, const char* method, JsonVariantConst params);
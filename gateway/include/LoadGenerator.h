@@ -0,0 +1,85 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "types.h"
+
+#if LOAD_TEST_ENABLED
+
+// Trame synthétique remise à la tâche LoRa comme si la radio venait de la recevoir
+struct SyntheticFrame {
+    char payload[256];
+    float rssi;
+    float snr;
+    unsigned long injectedAt; // micros(), origine de la latence jusqu'à MQTT
+};
+
+// Chiffres de la dernière fenêtre de mesure (LOAD_TEST_REPORT_INTERVAL_MS)
+struct LoadTestReport {
+    float injectedPps;          // Produites par le générateur
+    float processedPps;         // Traitées par la tâche LoRa
+    float publishedPps;         // Télémétries des modules virtuels publiées sur MQTT
+    uint32_t injectDrops;       // File d'injection pleine : la tâche LoRa ne suit pas (cumul)
+    uint32_t rxQueueDrops;      // loraRxQueue pleine : la tâche MQTT ne suit pas (cumul)
+    uint32_t publishFailures;   // Cumul
+    uint8_t injectHighWater;    // Remplissage maximal des files sur la fenêtre
+    uint8_t rxQueueHighWater;
+    uint32_t latencyAvgUs;      // Injection -> publication MQTT
+    uint32_t latencyMaxUs;
+    uint8_t joinedNodes;
+};
+
+// Modules virtuels pour mesurer le débit soutenable de la passerelle. Le générateur tourne dans sa
+// propre tâche ; takeFrame, onFrameProcessed et onRxQueueFull sont appelés par la tâche LoRa,
+// onPublished par la tâche MQTT.
+class LoadGenerator {
+public:
+    LoadGenerator();
+    bool begin();
+    bool takeFrame(SyntheticFrame& frame);
+    void onFrameProcessed();
+    void onRxQueueFull();
+    void onPublished(const LoRaMessage& msg, bool ok);
+    bool isVirtualNode(uint8_t nodeId) const;
+    LoadTestReport getReport();
+
+private:
+    enum FrameKind { KIND_TELEMETRY, KIND_JOIN, KIND_ACK, KIND_JUNK };
+
+    struct VirtualNode {
+        char mac[18];
+        uint8_t nodeId;    // 0 tant que la passerelle ne l'a pas enregistré
+        uint32_t msgCtr;
+    };
+    VirtualNode nodes[LOAD_TEST_VIRTUAL_NODES];
+    bool virtualIds[MAX_DEVICES + 1];
+
+    QueueHandle_t queue;
+
+    // Compteurs de la fenêtre en cours (section critique de LoadGenerator.cpp)
+    uint32_t injected;
+    uint32_t processed;
+    uint32_t published;
+    uint64_t latencySumUs;
+    uint32_t latencyMaxUs;
+    uint8_t injectHighWater;
+    uint8_t rxQueueHighWater;
+    // Cumuls
+    uint32_t injectDrops;
+    uint32_t rxQueueDrops;
+    uint32_t publishFailures;
+
+    LoadTestReport report;
+    unsigned long windowStart;
+
+    static void task(void* params);
+    void run();
+    FrameKind pickKind();
+    bool buildFrame(FrameKind kind, VirtualNode& node, SyntheticFrame& frame);
+    bool encryptFrame(const char* plaintext, SyntheticFrame& frame, bool corruptCrc);
+    void buildJunk(SyntheticFrame& frame);
+    void publishReport();
+};
+
+extern LoadGenerator loadGenerator;
+
+#endif
@@ -0,0 +1,164 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+#include "config.h"
+
+// Journal différé : LOGE/LOGW/LOGI/LOGD copient le format (un pointeur) et les arguments dans un
+// tampon circulaire sans verrou, en quelques centaines de nanosecondes ; une tâche de faible
+// priorité les met en forme et les écrit sur le port série. Un tampon plein fait perdre la ligne
+// (comptée) au lieu de bloquer l'appelant. Niveaux et modules exclus à la compilation (LOG_LEVEL,
+// LOG_MODULES) ne coûtent rien. Les formats doivent être des littéraux, sans '\n' final.
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+enum LogModule : uint8_t {
+    LOG_MOD_SYSTEM   = 1 << 0,
+    LOG_MOD_LORA     = 1 << 1,
+    LOG_MOD_MQTT     = 1 << 2,
+    LOG_MOD_CC       = 1 << 3,   // Contrôle de congestion
+    LOG_MOD_DEVICES  = 1 << 4,
+    LOG_MOD_FUOTA    = 1 << 5,
+    LOG_MOD_RULES    = 1 << 6,   // Règles locales
+};
+
+#if LOG_DEFERRED
+
+// En-tête d'une entrée du tampon, suivi des arguments : un octet de type puis la valeur
+struct LogRecord {
+    uint8_t state;          // LOG_SLOT_*, lu et écrit atomiquement
+    uint8_t level;
+    uint8_t module;
+    uint8_t argCount;
+    uint16_t size;          // Entrée complète, en-tête compris, arrondie à l'alignement
+    uint16_t argBytes;
+    uint32_t timestampMs;
+    const char* format;     // Reste valide : les formats sont des littéraux en flash
+};
+
+// Types des arguments enregistrés
+#define LOG_ARG_INT32 'i'
+#define LOG_ARG_UINT32 'u'
+#define LOG_ARG_INT64 'q'
+#define LOG_ARG_UINT64 'Q'
+#define LOG_ARG_DOUBLE 'd'
+#define LOG_ARG_STRING 's'  // Longueur sur un octet, puis les caractères (tronqués à LOG_MAX_STRING)
+
+class Logger {
+public:
+    bool begin();
+    LogRecord* reserve(uint8_t level, uint8_t module, const char* format, uint8_t argCount, size_t argBytes);
+    void commit(LogRecord* record);
+    uint32_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    alignas(LogRecord) uint8_t buffer[LOG_BUFFER_SIZE] = {0};
+    std::atomic<uint32_t> writeIndex{0};  // Index libres, ramenés au tampon par masque
+    std::atomic<uint32_t> readIndex{0};
+    std::atomic<uint32_t> dropped{0};
+    uint32_t reportedDropped = 0;
+
+    static void task(void* params);
+    void run();
+    bool drainOne();
+    void output(const LogRecord* record);
+};
+
+extern Logger logger;
+
+// Taille et copie de chaque argument, selon son type C++
+namespace logargs {
+
+inline size_t stringSize(const char* text) {
+    size_t length = text ? strnlen(text, LOG_MAX_STRING) : 0;
+    return 2 + length;
+}
+
+template <typename T>
+inline size_t size(T) {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "LOG: argument de type non pris en charge");
+    return 1 + ((std::is_floating_point<T>::value || sizeof(T) > 4) ? 8 : 4);
+}
+inline size_t size(const char* text) { return stringSize(text); }
+inline size_t size(char* text) { return stringSize(text); }
+
+template <typename T>
+inline void pack(uint8_t*& out, T value) {
+    if (std::is_floating_point<T>::value) {
+        double d = value;
+        *out++ = LOG_ARG_DOUBLE;
+        memcpy(out, &d, 8);
+        out += 8;
+    } else if (sizeof(T) > 4) {
+        *out++ = std::is_signed<T>::value ? LOG_ARG_INT64 : LOG_ARG_UINT64;
+        uint64_t v = (uint64_t)value;
+        memcpy(out, &v, 8);
+        out += 8;
+    } else {
+        *out++ = std::is_signed<T>::value ? LOG_ARG_INT32 : LOG_ARG_UINT32;
+        uint32_t v = (uint32_t)value;
+        memcpy(out, &v, 4);
+        out += 4;
+    }
+}
+inline void packString(uint8_t*& out, const char* text) {
+    size_t length = text ? strnlen(text, LOG_MAX_STRING) : 0;
+    *out++ = LOG_ARG_STRING;
+    *out++ = (uint8_t)length;
+    memcpy(out, text, length);
+    out += length;
+}
+inline void pack(uint8_t*& out, const char* text) { packString(out, text); }
+inline void pack(uint8_t*& out, char* text) { packString(out, text); }
+
+inline size_t totalSize() { return 0; }
+template <typename T, typename... Rest>
+inline size_t totalSize(T first, Rest... rest) { return size(first) + totalSize(rest...); }
+
+inline void packAll(uint8_t*&) {}
+template <typename T, typename... Rest>
+inline void packAll(uint8_t*& out, T first, Rest... rest) {
+    pack(out, first);
+    packAll(out, rest...);
+}
+
+} // namespace logargs
+
+template <typename... Args>
+inline void logWrite(uint8_t level, uint8_t module, const char* format, Args... args) {
+    LogRecord* record = logger.reserve(level, module, format, sizeof...(args), logargs::totalSize(args...));
+    if (!record) return;
+    uint8_t* out = (uint8_t*)(record + 1);
+    logargs::packAll(out, args...);
+    logger.commit(record);
+}
+
+// Jamais appelée : fait vérifier le format et les arguments par le compilateur
+inline void logCheckFormat(const char*, ...) __attribute__((format(printf, 1, 2)));
+inline void logCheckFormat(const char*, ...) {}
+
+#define LOG_EMIT(level, module, format, ...) do { \
+        if (false) logCheckFormat(format, ##__VA_ARGS__); \
+        logWrite(level, module, format, ##__VA_ARGS__); \
+    } while (0)
+
+#else
+
+// Sortie directe (simulateur) : écriture immédiate, mêmes filtres
+#define LOG_EMIT(level, module, format, ...) Serial.printf(format "\n", ##__VA_ARGS__)
+
+#endif
+
+#define LOG_ENABLED(level, module) (LOG_LEVEL >= (level) && (LOG_MODULES & (module)))
+#define LOG_AT(level, module, format, ...) do { \
+        if (LOG_ENABLED(level, module)) LOG_EMIT(level, module, format, ##__VA_ARGS__); \
+    } while (0)
+
+#define LOGE(module, format, ...) LOG_AT(LOG_LEVEL_ERROR, module, format, ##__VA_ARGS__)
+#define LOGW(module, format, ...) LOG_AT(LOG_LEVEL_WARN, module, format, ##__VA_ARGS__)
+#define LOGI(module, format, ...) LOG_AT(LOG_LEVEL_INFO, module, format, ##__VA_ARGS__)
+#define LOGD(module, format, ...) LOG_AT(LOG_LEVEL_DEBUG, module, format, ##__VA_ARGS__)
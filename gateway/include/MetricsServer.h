@@ -0,0 +1,6 @@
+#pragma once
+#include <Arduino.h>
+
+// Serveur HTTP exposant gatewayMetrics au format texte Prometheus sur /metrics.
+// Il tourne dans la tâche de la pile TCP asynchrone et ne fait que lire des compteurs atomiques.
+void startMetricsServer();
@@ -0,0 +1,20 @@
+#pragma once
+#include "config.h"
+
+// Estimation du temps d'aller-retour commande -> ACK par module (SRTT/RTTVAR, RFC 6298).
+// Utilisé uniquement par la tâche LoRa.
+class RttEstimator {
+public:
+    RttEstimator();
+    uint32_t getTimeout(uint8_t nodeId, uint32_t seedRttMs) const;
+    void addSample(uint8_t nodeId, uint32_t rttMs);
+    uint32_t getSmoothedRtt(uint8_t nodeId) const;
+
+private:
+    struct State {
+        bool valid;
+        uint32_t srttMs;
+        uint32_t rttvarMs;
+    };
+    State nodes[MAX_DEVICES];
+};
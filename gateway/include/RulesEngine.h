@@ -0,0 +1,59 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+#include "types.h"
+
+// Comparaison d'une règle : "==", "!=", "<", "<=", ">", ">="
+enum RuleOp : uint8_t {
+    RULE_OP_EQ,
+    RULE_OP_NE,
+    RULE_OP_LT,
+    RULE_OP_LE,
+    RULE_OP_GT,
+    RULE_OP_GE
+};
+
+// Forme compilée d'une règle, sauvegardée telle quelle en NVS
+struct EdgeRule {
+    char sourceType[sizeof(DeviceInfo::deviceType)]; // Type des modules dont la télémétrie est évaluée
+    char field[RULES_FIELD_LEN];
+    RuleOp op;
+    float value;                                     // Booléens : 1 ou 0
+    char target[sizeof(DeviceInfo::deviceType)];     // Nom d'un module (MAC_..), sinon type des destinataires
+    char method[RULES_METHOD_LEN];
+    char params[RULES_PARAMS_LEN];                   // JSON sérialisé, vide : pas de paramètres
+};
+
+// Règles locales de la passerelle. Source, l'attribut partagé TB_ATTR_EDGE_RULES :
+//   [{"type":"RESERVOIR_SENSOR","field":"isFull","op":"==","value":true,
+//     "target":"WELL_PUMP_STATION","method":"setPump","params":{"state":false}}]
+// Chaque télémétrie reçue en direct (pas les relevés rejoués) est comparée aux règles de son type de
+// module ; une règle se déclenche quand son prédicat devient vrai pour ce module, et sa commande,
+// confirmée, part dans loraTxQueue sans passer par ThingsBoard. Un champ absent d'un rapport par
+// exception laisse l'état inchangé. update() est appelée par la tâche MQTT, evaluate() par la tâche LoRa.
+class RulesEngine {
+public:
+    RulesEngine();
+    void init();                                  // Règles sauvegardées, disponibles avant tout réseau
+    // Remplace toutes les règles ; un tableau invalide est rejeté en entier (retourne -1).
+    // Retourne le nombre de règles en vigueur.
+    int update(JsonVariantConst source);
+    void evaluate(uint8_t nodeId, JsonObjectConst data, uint32_t irqAt);
+    uint8_t getRuleCount() const { return count; }
+
+private:
+    EdgeRule rules[RULES_MAX];
+    EdgeRule staged[RULES_MAX];                   // Compilation en cours (hors de la pile de la tâche MQTT)
+    uint8_t count;
+    bool matched[RULES_MAX][MAX_DEVICES];         // Prédicat vrai au dernier relevé du module
+    SemaphoreHandle_t mutex;
+
+    bool compile(JsonObjectConst source, EdgeRule& rule);
+    void evaluateSample(uint8_t nodeId, const char* type, JsonObjectConst sample, uint32_t irqAt);
+    void fire(const EdgeRule& rule, uint8_t sourceId, uint32_t irqAt);
+    void loadFromNVS();
+    void saveToNVS();
+};
+
+extern RulesEngine rulesEngine;
@@ -0,0 +1,74 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+struct TaskProfile {
+    const char* name;
+    uint32_t stackSize;      // Octets alloués à la création
+    uint32_t stackFreeMin;   // Marge minimale de pile depuis la création (octets)
+    float cpuPercent;        // Part d'un cœur sur la fenêtre
+    bool running;            // Tâche présente lors du relevé (FUOTA n'existe que pendant une mise à jour)
+};
+
+struct QueueProfile {
+    const char* name;
+    uint16_t size;
+    uint16_t depth;          // Remplissage au moment du relevé
+    uint16_t peak;           // Maximum échantillonné sur la fenêtre
+};
+
+// Relevé d'une fenêtre de PROFILER_REPORT_INTERVAL_MS
+struct ProfilerReport {
+    TaskProfile tasks[PROFILER_MAX_TASKS];
+    uint8_t taskCount;
+    QueueProfile queues[PROFILER_MAX_QUEUES];
+    uint8_t queueCount;
+    bool cpuAvailable;       // Faux si FreeRTOS est compilé sans statistiques d'exécution
+    float idlePercent;       // Temps passé dans les tâches IDLE, tous cœurs confondus
+    uint32_t heapFree;
+    uint32_t heapMinFree;    // Minimum depuis le démarrage
+    uint32_t heapLargestBlock;
+    uint32_t windowMs;
+};
+
+// Les tâches et files à suivre sont déclarées avant begin(). Les tâches sont retrouvées par leur
+// nom dans le relevé du noyau, ce qui couvre celles créées et détruites en cours de route.
+// Le profileur tourne dans sa propre tâche ; takeReport est appelé par la tâche MQTT.
+class RuntimeProfiler {
+public:
+    void watchTask(const char* name, uint32_t stackSize);
+    void watchQueue(const char* name, QueueHandle_t queue, uint16_t size);
+    bool begin();
+    bool takeReport(ProfilerReport& out); // true une fois par fenêtre close
+
+private:
+    struct WatchedTask {
+        const char* name;
+        uint32_t stackSize;
+        uint32_t lastRunTime;
+    };
+    struct WatchedQueue {
+        const char* name;
+        QueueHandle_t queue;
+        uint16_t size;
+        uint16_t peak;
+    };
+    WatchedTask tasks[PROFILER_MAX_TASKS];
+    uint8_t taskCount = 0;
+    WatchedQueue queues[PROFILER_MAX_QUEUES];
+    uint8_t queueCount = 0;
+
+    uint32_t lastTotalRunTime = 0;
+    uint32_t lastIdleRunTime = 0;
+    unsigned long windowStart = 0;
+
+    ProfilerReport report = {};
+    bool reportReady = false;
+
+    static void task(void* params);
+    void run();
+    void sampleQueues();
+    void closeWindow(bool publish);
+};
+
+extern RuntimeProfiler runtimeProfiler;
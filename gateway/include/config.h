@@ -20,28 +20,244 @@
 // -------- Configuration MQTT pour ThingsBoard --------
 #define TB_PORT 1883
 #define MQTT_RECONNECT_INTERVAL_MS 5000         // Tentative de reconnexion toutes les 5s
+#define MQTT_BUFFER_SIZE 2048                   // PubSubClient limite les paquets à 256 octets par défaut ; les règles locales en demandent davantage
+#define TB_GATEWAY_TELEMETRY_TOPIC "v1/devices/me/telemetry" // Télémétrie propre de la passerelle
+
+// -------- Heure (horodatage des télémétries) --------
+// Le "ts" publié est l'instant de l'interruption radio, converti en heure Unix une fois l'horloge
+// réglée par NTP. Avant cela, il est omis et ThingsBoard date la valeur à sa réception.
+#define NTP_SERVER "pool.ntp.org"
+#define NTP_MIN_VALID_EPOCH_S 1700000000 // En deçà, l'horloge n'a pas encore été réglée
+
+// -------- Instrumentation de la latence --------
+// Chaque télémétrie porte ses horodatages, de l'interruption radio à la publication MQTT. La tâche
+// MQTT les agrège par étape dans des histogrammes log-linéaires, résumés à chaque fenêtre sur le
+// port série, sur la page STATS SYSTEME de l'écran et dans la télémétrie de la passerelle.
+#define LATENCY_REPORT_INTERVAL_MS 60000
+#define LATENCY_SUB_BITS 3               // 8 intervalles par puissance de deux : 12,5 % d'erreur au plus
+#define LATENCY_MAX_BITS 25              // Au-delà de 2^25 µs (~33 s), les valeurs sont regroupées
 
 // -------- Configuration LoRa --------
 #define LORA_FREQ 868.0f
+// Modulation : valeurs par défaut de RadioLib, celles des modules (radio.begin(LORA_FREQ))
+#define LORA_BANDWIDTH_KHZ 125.0f
+#define LORA_SPREADING_FACTOR 9
+#define LORA_CODING_RATE 7               // 4/7
+#define LORA_SYNC_WORD 0x12              // Réseau privé
+#define LORA_TX_POWER_DBM 10
+#define LORA_PREAMBLE_LENGTH 8
 #define LORA_CS 8
 #define LORA_DIO1 14
 #define LORA_RST 12
 #define LORA_BUSY 13
 
+// -------- Adhésions (JOIN) --------
+// Les JOIN_ACCEPT ne sont plus émis depuis le chemin de réception : ils passent par
+// une file espacée, pour qu'une tempête d'adhésions (redémarrage, coupure secteur)
+// ne sature pas le canal ni ne bloque la réception.
+#define JOIN_ACCEPT_QUEUE_SIZE 8        // Adhésions en attente de réponse
+#define JOIN_ACCEPT_RX_DELAY_MS 50      // Délai minimal après la requête (bascule TX->RX du module)
+#define JOIN_ACCEPT_PACING_MS 400       // Espacement minimal entre deux JOIN_ACCEPT
+#define JOIN_ACCEPT_MAX_AGE_MS 4000     // Au-delà, le module n'écoute plus : réponse abandonnée
+
+// -------- Contrôle de congestion (intervalles de télémétrie) --------
+// La passerelle estime l'occupation du canal (temps d'antenne observé, erreurs CRC,
+// trous dans les compteurs) et ajuste l'intervalle de chaque module en AIMD :
+// doublement en cas de congestion, diminution par pas fixe sinon, jusqu'au plancher.
+#define CC_EVAL_PERIOD_MS 60000          // Fenêtre d'estimation de l'occupation du canal
+#define CC_TARGET_UTILIZATION 0.10f      // Occupation visée (ALOHA s'effondre au-delà de ~18%)
+#define CC_MAX_LOSS_RATIO 0.10f          // Taux de pertes toléré avant de ralentir la flotte
+#define CC_MIN_SAMPLES 5                 // Trames minimales pour considérer le taux de pertes
+#define CC_DEFAULT_INTERVAL_MS 30000     // Intervalle nominal, plancher des modules sans attribut ThingsBoard
+#define CC_MIN_INTERVAL_MS 10000         // Plancher absolu accepté depuis un attribut ThingsBoard
+#define CC_MAX_INTERVAL_MS 900000        // Plafond : 15 minutes
+#define CC_MD_FACTOR 2                   // Facteur multiplicatif en cas de congestion
+#define CC_AI_STEP_MS 5000               // Pas de réduction de l'intervalle hors congestion
+#define CC_JITTER_PERCENT 10             // Gigue assignée, en % de l'intervalle
+#define CC_HYSTERESIS_PERCENT 10         // Écart minimal avant d'envoyer une nouvelle configuration
+
+// -------- Acquittement des commandes --------
+// Le délai d'attente d'un ACK est estimé par module à partir des RTT mesurés (RFC 6298),
+// initialisé à partir du temps d'antenne calculé de l'ACK, puis doublé à chaque nouvel essai.
+#define ACK_MAX_RETRIES 3
+#define ACK_RTO_MIN_MS 400               // Bornes du délai d'attente
+#define ACK_RTO_MAX_MS 15000
+#define ACK_NODE_TURNAROUND_MS 300       // Traitement de la commande et bascule RX->TX côté module
+#define ACK_FRAME_LEN_ESTIMATE 110       // Taille typique d'une trame ACK chiffrée, pour l'amorçage
+#define RPC_RESULT_QUEUE_SIZE 10         // Résultats RPC en attente de publication
+
+// -------- Fragmentation des messages longs --------
+// Une trame LoRa ne dépasse pas 255 octets : une fois chiffré, encodé en base64 et encadré
+// ({"p":...,"c":...}), un message clair ne doit pas dépasser LORA_MAX_PLAINTEXT_LEN.
+// Au-delà, il est découpé en fragments ; le destinataire renvoie le masque des fragments
+// reçus et seuls les manquants sont réémis.
+#define LORA_MAX_PLAINTEXT_LEN 159
+#define FRAG_CHUNK_SIZE 64               // Octets utiles par fragment (88 caractères en base64)
+#define FRAG_MAX_FRAGMENTS 32            // Soit 2048 octets au plus par transfert
+#define FRAG_REASSEMBLY_SLOTS 4          // Transferts montants réassemblés simultanément
+#define FRAG_REASSEMBLY_TIMEOUT_MS 30000 // Tampon libéré après ce délai d'inactivité
+#define FRAG_TX_SPACING_MS 50            // Temps laissé au module pour se remettre en écoute entre deux trames
+#define FRAG_MAX_ROUNDS 4                // Tours de réémission sans progrès avant abandon
+#define BULK_TX_QUEUE_SIZE 1             // Messages longs en attente d'émission (un transfert à la fois)
+
+// -------- Mises à jour du firmware des modules par LoRa (FUOTA) --------
+// L'image est téléchargée dans la partition OTA inactive de la passerelle, puis diffusée
+// par générations de FUOTA_GENERATION_BLOCKS blocs suivies de lignes de redondance (XOR).
+// Les modules signalent les générations incomplètes et le nombre de lignes manquantes :
+// seules celles-ci sont rediffusées, une fois pour tout le groupe.
+#define FUOTA_BLOCK_SIZE 64              // Doit être identique sur les modules
+#define FUOTA_GENERATION_BLOCKS 32       // Doit être identique sur les modules
+#define FUOTA_REDUNDANCY_PERCENT 20      // Lignes de redondance émises d'emblée par génération
+#define FUOTA_REPAIR_MARGIN 2            // Lignes ajoutées au déficit signalé (lignes dépendantes)
+#define FUOTA_FRAME_SPACING_MS 100       // Temps laissé aux modules pour se remettre en écoute
+#define FUOTA_SETUP_RETRY_MS 10000       // Relance de l'invitation aux modules qui n'ont pas répondu
+#define FUOTA_SETUP_TIMEOUT_MS 120000    // Au-delà, la diffusion part avec les modules prêts
+#define FUOTA_STATUS_TIMEOUT_MS 8000     // Attente d'un rapport (éventuellement fragmenté)
+#define FUOTA_STATUS_ATTEMPTS 3
+#define FUOTA_MAX_REPAIR_ROUNDS 10
+#define FUOTA_REPAIR_LIST_SIZE 64        // Générations à réparer par tour, tous modules confondus
+#define FUOTA_DOWNLOAD_TIMEOUT_MS 15000
+
+// -------- Mode de charge synthétique --------
+// Activé par l'environnement `loadtest` de platformio.ini. Des modules virtuels produisent des trames
+// chiffrées, injectées dans le chemin de réception juste après la radio, pour mesurer le plafond de la
+// passerelle sans matériel. Ils sont enregistrés comme de vrais modules (NVS) : effacer la mémoire ensuite.
+#ifndef LOAD_TEST_ENABLED
+#define LOAD_TEST_ENABLED 0
+#endif
+#ifndef LOAD_TEST_VIRTUAL_NODES
+#define LOAD_TEST_VIRTUAL_NODES 16      // Au plus MAX_DEVICES, modules réels compris
+#endif
+#ifndef LOAD_TEST_RATE_PPS
+#define LOAD_TEST_RATE_PPS 20           // Trames injectées par seconde, tous types confondus
+#endif
+// Répartition des trames (en %, le reste en télémétrie)
+#ifndef LOAD_TEST_JOIN_PERCENT
+#define LOAD_TEST_JOIN_PERCENT 2
+#endif
+#ifndef LOAD_TEST_ACK_PERCENT
+#define LOAD_TEST_ACK_PERCENT 8
+#endif
+#ifndef LOAD_TEST_JUNK_PERCENT
+#define LOAD_TEST_JUNK_PERCENT 5        // JSON invalide, CRC faux, chiffré illisible
+#endif
+#ifndef LOAD_TEST_CONFIRMED_PERCENT
+#define LOAD_TEST_CONFIRMED_PERCENT 0   // Part de télémétrie confirmée : chaque ACK est une vraie émission radio
+#endif
+#define LOAD_TEST_QUEUE_SIZE 16         // Trames injectées en attente de la tâche LoRa
+#define LOAD_TEST_REPORT_INTERVAL_MS 5000
+
 // -------- Configuration Matérielle (OLED Heltec V3) --------
 #define DIAG_BUTTON_PIN 0 // Bouton "PRG" sur la carte Heltec
 
 // -------- Configuration Système --------
-#define MAX_DEVICES 20                   // Nombre maximum de modules gérables
+#ifndef MAX_DEVICES                      // Relevé par le simulateur pour les essais de capacité
+#define MAX_DEVICES 20                   // Nombre maximum de modules gérables (127 au plus : identifiants int8_t)
+#endif
 #define WATCHDOG_TIMEOUT_S 30            // Timeout du watchdog en secondes
 #define DEVICE_OFFLINE_TIMEOUT_MS 300000 // 5 minutes
+#define REPLAY_WINDOW_SIZE 32            // Compteurs récents mémorisés pour reconnaître les doublons
+// Le compteur de chaque module est sauvegardé tous les COUNTER_SAVE_INTERVAL messages : après un
+// redémarrage, les messages perdus pendant l'arrêt apparaissent comme un trou et sont redemandés
+// (au plus COUNTER_SAVE_INTERVAL - 1 relevés déjà reçus repartent aussi vers ThingsBoard).
+#define COUNTER_SAVE_INTERVAL 8
+#define BACKFILL_MAX_RANGE 64            // Compteurs redemandés au plus, et au plus l'historique annoncé par le module
+#define BACKFILL_MAX_SKIP 4              // Compteurs de la plage reçus en retard, que le module ne doit pas rejouer
+// -------- Règles locales (RulesEngine) --------
+// Règles « si <champ> d'un module de <type> <op> <valeur>, alors <commande> à un module ou à un type »,
+// reçues de l'attribut partagé TB_ATTR_EDGE_RULES de la passerelle. Compilées en table de taille fixe et
+// sauvegardées en NVS, elles sont évaluées par la tâche LoRa à chaque télémétrie, WiFi coupé compris.
+#define RULES_MAX 16
+#define RULES_FIELD_LEN 16               // Longueur maximale (zéro final compris) du champ évalué
+#define RULES_METHOD_LEN 20
+#define RULES_PARAMS_LEN 64              // Paramètres de la commande, en JSON sérialisé
+#define RULES_NVS_NAMESPACE "rules"
+
 #define TX_QUEUE_SIZE 10                 // Taille de la file d'attente des commandes LoRa à envoyer
 #define RX_QUEUE_SIZE 10                 // Taille de la file d'attente des messages LoRa reçus
+#define SYSTEM_QUEUE_SIZE 5              // Événements système (nouveaux modules) en attente de MQTT
+
+// Piles des tâches FreeRTOS (en octets), à ajuster d'après les marges relevées par le profileur
+#define OLED_TASK_STACK_SIZE 3072
+#define MQTT_TASK_STACK_SIZE 4096
+#define LORA_TASK_STACK_SIZE 4096
+#define LOAD_TEST_TASK_STACK_SIZE 4096
+#define FUOTA_TASK_STACK_SIZE 8192
+#define PROFILER_TASK_STACK_SIZE 2560
+#define LOG_TASK_STACK_SIZE 3072
+#define CAPTURE_TASK_STACK_SIZE 4096
+
+// -------- Métriques (format texte Prometheus) --------
+// Compteurs du protocole et signal des modules, servis en HTTP sur l'interface WiFi :
+// http://<ip-passerelle>:METRICS_HTTP_PORT/metrics
+#ifndef METRICS_HTTP_PORT
+#define METRICS_HTTP_PORT 9100
+#endif
+
+// -------- Profileur d'exécution --------
+// Relève l'occupation CPU et la marge de pile des tâches, le remplissage des files et l'état du tas,
+// et les publie dans la télémétrie de la passerelle. Les files sont échantillonnées toutes les
+// PROFILER_SAMPLE_MS pour en connaître le maximum ; le reste n'est lu qu'une fois par fenêtre.
+#ifndef PROFILER_REPORT_INTERVAL_MS
+#define PROFILER_REPORT_INTERVAL_MS 60000 // 0 : profileur désactivé
+#endif
+#define PROFILER_SAMPLE_MS 20
+#define PROFILER_MAX_TASKS 8             // Tâches suivies
+#define PROFILER_MAX_QUEUES 8            // Files suivies
+#define PROFILER_MAX_SYSTEM_TASKS 32     // Capacité du relevé de toutes les tâches du système
+
+// -------- Journal (port série) --------
+// Les tâches LoRa et MQTT n'écrivent plus sur le port série : les lignes sont enregistrées dans un
+// tampon circulaire (format + arguments) et écrites par une tâche de faible priorité. Tampon plein :
+// la ligne est perdue et comptée, l'appelant n'attend jamais l'UART.
+#ifndef LOG_LEVEL                        // LOG_LEVEL_NONE, _ERROR, _WARN, _INFO ou _DEBUG (voir Log.h)
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef LOG_MODULES                      // Masque des modules journalisés (LogModule)
+#define LOG_MODULES 0xFF
+#endif
+#ifndef LOG_DEFERRED                     // 0 : écriture directe (simulateur)
+#define LOG_DEFERRED 1
+#endif
+#ifndef LOG_OUTPUT_BINARY                // 1 : trames binaires, à décoder par tools/log_decode.py
+#define LOG_OUTPUT_BINARY 0
+#endif
+#define LOG_BUFFER_SIZE 8192             // Puissance de 2
+#define LOG_MAX_STRING 96                // Longueur maximale d'un argument chaîne
+#define LOG_DRAIN_INTERVAL_MS 10
+
+// -------- Capture des trames reçues --------
+// Pour rejouer un incident de terrain dans le simulateur (--replay) : chaque trame reçue est enregistrée
+// brute, avec l'instant de l'interruption, le RSSI, le SNR et l'issue de la lecture radio, ainsi que
+// chaque télémétrie remise à la tâche MQTT. Format .lcap décrit dans CaptureFormat.h.
+//   CAPTURE_SERIAL : lignes "CAP <base64>" sur le port série, à extraire avec tools/capture.py
+//   CAPTURE_FLASH  : anneau dans la partition de données CAPTURE_PARTITION_LABEL, lu par GET /capture
+#define CAPTURE_OFF 0
+#define CAPTURE_SERIAL 1
+#define CAPTURE_FLASH 2
+#ifndef CAPTURE_MODE
+#define CAPTURE_MODE CAPTURE_OFF
+#endif
+#define CAPTURE_PARTITION_LABEL "spiffs" // Inutilisée par la passerelle : écrasée par la capture
+#define CAPTURE_QUEUE_SIZE 16            // Enregistrements en attente d'écriture
 
 // Topics MQTT pour l'API Gateway de ThingsBoard
 #define TB_TELEMETRY_TOPIC "v1/gateway/telemetry"
 #define TB_CONNECT_TOPIC "v1/gateway/connect"
 #define TB_RPC_TOPIC "v1/gateway/rpc"
+#define TB_ATTRIBUTES_TOPIC "v1/gateway/attributes"
+#define TB_ATTRIBUTES_REQUEST_TOPIC "v1/gateway/attributes/request"
+#define TB_ATTRIBUTES_RESPONSE_TOPIC "v1/gateway/attributes/response"
+
+// Attribut partagé ThingsBoard fixant le plancher d'intervalle d'un module (en secondes)
+#define TB_ATTR_MIN_REPORT_INTERVAL "minReportInterval"
+
+// Attributs propres de la passerelle (API Device) : les réponses arrivent sur <préfixe><id de la requête>
+#define TB_GATEWAY_ATTRIBUTES_TOPIC "v1/devices/me/attributes"
+#define TB_GATEWAY_ATTRIBUTES_REQUEST_TOPIC "v1/devices/me/attributes/request/1"
+#define TB_GATEWAY_ATTRIBUTES_RESPONSE_PREFIX "v1/devices/me/attributes/response/"
+// Attribut partagé de la passerelle portant les règles locales (tableau JSON, voir RulesEngine.h)
+#define TB_ATTR_EDGE_RULES "edgeRules"
 
 // Namespace pour le stockage NVS
 #define NVS_NAMESPACE "devices"
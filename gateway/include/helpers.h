@@ -10,3 +10,13 @@
  * @return Le checksum CRC32 calculé.
  */
 uint32_t calculateCRC32(const uint8_t *data, size_t length);
+
+/**
+ * @brief Convertit un horodatage micros() en heure Unix (millisecondes), d'après l'horloge
+ *        système synchronisée par NTP.
+ *
+ * @param microsTimestamp Instant à convertir, pris avec micros() (au plus ~71 minutes dans le passé).
+ * @param epochMs Heure Unix correspondante, en millisecondes.
+ * @return false tant que l'heure n'a pas été obtenue par NTP.
+ */
+bool epochMillisAt(uint32_t microsTimestamp, uint64_t& epochMs);
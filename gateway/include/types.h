@@ -1,5 +1,6 @@
 #pragma once
 #include <Arduino.h>
+#include "config.h"
 
 // Énumération pour l'état de la connexion WiFi
 enum WiFiStatus {
@@ -44,20 +45,82 @@ struct DeviceInfo {
     float lastRssi;
     float lastSnr;
     uint32_t lastMsgCounter; // Pour la prévention des attaques par rejeu
+    uint32_t recentCounterMask; // Bit i : compteur (lastMsgCounter - i) déjà reçu (fenêtre anti-rejeu)
+    uint32_t reportFloorMs;  // Plancher d'intervalle de télémétrie (attribut ThingsBoard), 0 = aucun
+    uint32_t savedMsgCounter; // lastMsgCounter tel que sauvegardé en NVS
+    uint32_t missingFrom;    // Compteurs perdus à redemander au module, 0 = aucun
+    uint32_t missingTo;
+    uint32_t missingSkip[BACKFILL_MAX_SKIP]; // Compteurs de la plage reçus en retard (fenêtre glissante)
+    uint8_t missingSkipCount;
+    uint8_t historyDepth;    // Relevés que le module sait rejouer (annoncé au JOIN), 0 = pas de rattrapage
+    uint32_t joinNonce;      // Nonce du dernier JOIN_REQUEST accepté : un nonce inférieur ou égal est un rejeu
+    bool rejoinPending;      // Adhésion acceptée, anti-rejeu pas encore recalé sur un message de la nouvelle session
+};
+
+// Résultat de la vérification du compteur de messages d'un module
+enum CounterCheck {
+    COUNTER_OK,         // Nouveau message
+    COUNTER_DUPLICATE,  // Déjà reçu (nouvel essai d'un message confirmé dont l'ACK s'est perdu)
+    COUNTER_REPLAY      // Trop ancien : rejeté
 };
 
 // Structure pour les messages dans la file d'attente LoRa Tx
 struct LoRaTxCommand {
     uint8_t targetNodeId;
-    char payload[192]; // Le payload est un JSON sérialisé
+    char payload[256]; // Le payload est un JSON sérialisé (une trame LoRa complète)
     uint16_t msgId;
     bool requireAck;
+    int32_t rpcId;              // Identifiant de la requête RPC ThingsBoard, -1 si aucune
+    unsigned long enqueuedAt;   // Pour mesurer la latence de livraison de bout en bout
+};
+
+// Issue d'une commande RPC, remontée à ThingsBoard par le MqttHandler
+enum RpcFailure {
+    RPC_OK,
+    RPC_ERR_UNKNOWN_DEVICE,
+    RPC_ERR_QUEUE_FULL,
+    RPC_ERR_ENCODING,
+    RPC_ERR_TX_FAILED,
+    RPC_ERR_ACK_TIMEOUT,
+    RPC_ERR_BUSY,
+    RPC_ERR_UPDATE_FAILED,
+    RPC_ERR_REFUSED             // Acquittée par le module avec un refus (LORA_KEY_ERROR)
+};
+
+struct RpcResult {
+    uint8_t nodeId;
+    int32_t rpcId;
+    RpcFailure status;
+    uint32_t latencyMs;  // De la réception du RPC à l'ACK du module
+    uint32_t rttMs;      // De la dernière émission à l'ACK
+    uint8_t retries;
+    char reason[16];     // RPC_ERR_REFUSED : raison donnée par le module, vide sinon
+};
+
+// Message long à émettre en fragments (commande RPC dont le JSON dépasse une trame)
+struct LoRaBulkCommand {
+    uint8_t targetNodeId;
+    uint16_t msgId;
+    int32_t rpcId;
+    unsigned long enqueuedAt;
+    uint16_t length;
+    char plaintext[FRAG_CHUNK_SIZE * FRAG_MAX_FRAGMENTS]; // Message en clair, chiffré fragment par fragment
+};
+
+// Horodatages d'une télémétrie le long du chemin de réception (micros()), agrégés par LatencyStats
+struct PacketTimestamps {
+    uint32_t irqAt;        // Interruption DIO1 (loraInterrupt), ou injection par le générateur de charge
+    uint32_t decodedAt;    // Trame déchiffrée et vérifiée (openUplink)
+    uint32_t enqueuedAt;   // Placée dans loraRxQueue
+    uint32_t dequeuedAt;   // Retirée par la tâche MQTT
+    uint32_t publishedAt;  // Publication MQTT terminée
 };
 
 // Structure pour les messages LoRa reçus à passer au MqttHandler
 struct LoRaMessage {
     uint8_t nodeId;
-    char payload[256]; // Le payload est le JSON des données de télémétrie
+    PacketTimestamps timestamps;
+    char payload[512]; // Le payload est le JSON des données de télémétrie (messages réassemblés compris)
 };
 
 // =================================================================
@@ -70,9 +133,17 @@ constexpr const char* LORA_MSG_TYPE_JOIN_ACCEPT = "JOIN_ACCEPT";
 constexpr const char* LORA_MSG_TYPE_TELEMETRY = "TELEMETRY";
 constexpr const char* LORA_MSG_TYPE_CMD = "CMD";
 constexpr const char* LORA_MSG_TYPE_ACK = "ACK";
+constexpr const char* LORA_MSG_TYPE_FRAGMENT = "FRAG";
+constexpr const char* LORA_MSG_TYPE_FRAGMENT_ACK = "FACK";
+constexpr const char* LORA_MSG_TYPE_FUOTA_SETUP = "FSETUP";
+constexpr const char* LORA_MSG_TYPE_FUOTA_DATA = "FUOTA";
+constexpr const char* LORA_MSG_TYPE_FUOTA_STATUS_REQUEST = "FSREQ";
+constexpr const char* LORA_MSG_TYPE_FUOTA_STATUS = "FSTAT";
+constexpr const char* LORA_MSG_TYPE_HISTORY = "HIST";        // Relevé rejoué après une perte
 
 // Clés JSON du protocole LoRa
 constexpr const char* LORA_KEY_MSG_ID = "msgId";
+constexpr const char* LORA_KEY_ERROR = "err";              // ACK : commande reconnue mais refusée par le module
 constexpr const char* LORA_KEY_PAYLOAD = "p";
 constexpr const char* LORA_KEY_CRC = "c";
 constexpr const char* LORA_KEY_TYPE = "type";
@@ -85,5 +156,48 @@ constexpr const char* LORA_KEY_MSG_COUNTER = "msgCtr";
 constexpr const char* LORA_KEY_METHOD = "method";
 constexpr const char* LORA_KEY_PARAMS = "params";
 
+constexpr const char* LORA_KEY_CONFIRMED = "conf";
+// Point de reprise du compteur d'un module redémarré à froid : les compteurs jusque-là ont été sautés, pas perdus
+constexpr const char* LORA_KEY_RESTART = "rst";
+constexpr const char* LORA_KEY_CMD = "cmd";
+constexpr const char* LORA_KEY_INTERVAL = "interval";
+constexpr const char* LORA_KEY_JITTER = "jitter";
+// Heure Unix de la passerelle (s), jointe aux JOIN_ACCEPT et aux ACK une fois réglée par NTP :
+// les modules y calent l'horloge qui date leurs échantillons
+constexpr const char* LORA_KEY_TIME = "t";
+// Lot d'échantillons datés par le module : "data": {"t0": <heure Unix (s)>, "b": [[<s depuis t0>, {...}], ...]}
+constexpr const char* LORA_KEY_BATCH_BASE = "t0";
+constexpr const char* LORA_KEY_BATCH = "b";
+// Relevé rejoué (HIST) : compteur de la trame perdue, et secondes écoulées depuis sa première émission
+constexpr const char* LORA_KEY_ORIGINAL_COUNTER = "oc";
+constexpr const char* LORA_KEY_AGE = "age";
+// Plage de compteurs à rejouer (commande "backfill")
+constexpr const char* LORA_KEY_FROM = "from";
+constexpr const char* LORA_KEY_HISTORY_DEPTH = "hist";  // JOIN_REQUEST : taille de l'historique du module, absente sans historique
+constexpr const char* LORA_KEY_JOIN_NONCE = "jn";      // JOIN_REQUEST, puis premiers messages de la session : nonce d'adhésion
+constexpr const char* LORA_KEY_TO = "to";
+constexpr const char* LORA_KEY_SKIP = "skip";  // Compteurs de la plage déjà reçus, à ne pas rejouer
+
+// Clés des fragments (courtes : chaque octet compte dans une trame de fragment)
+constexpr const char* LORA_KEY_TRANSFER_ID = "x";
+constexpr const char* LORA_KEY_FRAG_INDEX = "i";
+constexpr const char* LORA_KEY_FRAG_COUNT = "n";
+constexpr const char* LORA_KEY_FRAG_DATA = "d";
+constexpr const char* LORA_KEY_FRAG_POLL = "f";   // Demande un FACK au destinataire
+constexpr const char* LORA_KEY_FRAG_MASK = "m";   // Fragments reçus (bit i = fragment i)
+
+// Clés FUOTA
+constexpr const char* LORA_KEY_SESSION = "s";
+constexpr const char* LORA_KEY_GENERATION = "g";
+constexpr const char* LORA_KEY_ROW = "r";
+constexpr const char* LORA_KEY_IMAGE_SIZE = "size";
+constexpr const char* LORA_KEY_IMAGE_HASH = "h";      // SHA-256 de l'image, en base64
+constexpr const char* LORA_KEY_STATE = "st";          // 0 réception, 1 image vérifiée, 2 échec
+constexpr const char* LORA_KEY_REMAINING = "left";    // Générations encore incomplètes
+constexpr const char* LORA_KEY_MISSING = "miss";      // [[génération, lignes manquantes], ...]
+
 // Méthodes RPC reconnues
 constexpr const char* LORA_METHOD_SET_CONFIG = "set_config";
+constexpr const char* LORA_METHOD_BACKFILL = "backfill";
+// Traitée par la passerelle : {"url":"http://...","sha256":"<hex>","group":["MAC_..", ...]}
+constexpr const char* LORA_METHOD_FUOTA_START = "fuota_start";
@@ -0,0 +1,134 @@
+#include "CongestionController.h"
+#include "DeviceManager.h"
+#include "Log.h"
+
+CongestionController congestionController;
+
+CongestionController::CongestionController() {
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        nodes[i] = { false, CC_DEFAULT_INTERVAL_MS, 0, 0 };
+    }
+    windowStart = 0;
+    windowAirtimeUs = 0;
+    windowDelivered = 0;
+    windowLost = 0;
+    windowErrors = 0;
+    utilization = 0.0f;
+    lossRatio = 0.0f;
+}
+
+void CongestionController::onFrameReceived(uint32_t airtimeUs) {
+    windowAirtimeUs += airtimeUs;
+}
+
+void CongestionController::onFrameTransmitted(uint32_t airtimeUs) {
+    windowAirtimeUs += airtimeUs;
+}
+
+void CongestionController::onRxError() {
+    windowErrors++;
+}
+
+void CongestionController::onUplink(uint8_t nodeId, uint32_t counterGap) {
+    if (nodeId < 1 || nodeId > MAX_DEVICES) return;
+    NodeState& node = nodes[nodeId - 1];
+    if (!node.seen) {
+        node.seen = true;
+        uint32_t floorMs = floorFor(nodeId);
+        if (node.assignedIntervalMs < floorMs) node.assignedIntervalMs = floorMs;
+    }
+    windowDelivered++;
+    windowLost += counterGap;
+}
+
+void CongestionController::onConfigAck(uint8_t nodeId, uint16_t msgId) {
+    if (nodeId < 1 || nodeId > MAX_DEVICES) return;
+    NodeState& node = nodes[nodeId - 1];
+    if (node.pendingMsgId != 0 && node.pendingMsgId == msgId) {
+        node.confirmedIntervalMs = node.assignedIntervalMs;
+        node.pendingMsgId = 0;
+        LOGI(LOG_MOD_CC, "CC: Node %d confirmed interval %u ms", nodeId, node.confirmedIntervalMs);
+    }
+}
+
+void CongestionController::evaluate() {
+    unsigned long now = millis();
+    if (windowStart == 0) {
+        windowStart = now;
+        return;
+    }
+    unsigned long elapsed = now - windowStart;
+    if (elapsed < CC_EVAL_PERIOD_MS) return;
+
+    utilization = (float)windowAirtimeUs / (elapsed * 1000.0f);
+
+    // Une trame corrompue réapparaît en général comme un trou de compteur :
+    // on retient le plus fort des deux signaux pour ne pas la compter deux fois.
+    uint32_t lost = windowLost > windowErrors ? windowLost : windowErrors;
+    uint32_t samples = windowDelivered + lost;
+    lossRatio = samples > 0 ? (float)lost / samples : 0.0f;
+
+    bool congested = utilization > CC_TARGET_UTILIZATION ||
+                     (samples >= CC_MIN_SAMPLES && lossRatio > CC_MAX_LOSS_RATIO);
+
+    for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+        NodeState& node = nodes[i];
+        if (!node.seen) continue;
+        uint32_t floorMs = floorFor(i + 1);
+        uint32_t interval = node.assignedIntervalMs;
+        if (congested) {
+            interval = (interval > CC_MAX_INTERVAL_MS / CC_MD_FACTOR) ? CC_MAX_INTERVAL_MS : interval * CC_MD_FACTOR;
+        } else {
+            interval = (interval > floorMs + CC_AI_STEP_MS) ? interval - CC_AI_STEP_MS : floorMs;
+        }
+        if (interval < floorMs) interval = floorMs;
+        node.assignedIntervalMs = interval;
+    }
+
+    LOGI(LOG_MOD_CC, "CC: util=%.1f%% loss=%.1f%% (%u ok, %u lost, %u err) -> %s",
+                     utilization * 100.0f, lossRatio * 100.0f, windowDelivered, windowLost, windowErrors,
+                     congested ? "backoff" : "probe");
+
+    windowStart = now;
+    windowAirtimeUs = 0;
+    windowDelivered = 0;
+    windowLost = 0;
+    windowErrors = 0;
+}
+
+bool CongestionController::getPendingConfig(uint8_t nodeId, uint32_t& intervalMs, uint32_t& jitterMs) {
+    if (nodeId < 1 || nodeId > MAX_DEVICES) return false;
+    const NodeState& node = nodes[nodeId - 1];
+    if (!node.seen) return false;
+
+    if (node.confirmedIntervalMs != 0) {
+        uint32_t diff = node.assignedIntervalMs > node.confirmedIntervalMs
+                            ? node.assignedIntervalMs - node.confirmedIntervalMs
+                            : node.confirmedIntervalMs - node.assignedIntervalMs;
+        // Hystérésis, sauf si le module est sous son plancher (attribut modifié)
+        if (diff * 100 < (uint64_t)node.confirmedIntervalMs * CC_HYSTERESIS_PERCENT &&
+            node.confirmedIntervalMs >= floorFor(nodeId)) {
+            return false;
+        }
+    }
+    intervalMs = node.assignedIntervalMs;
+    jitterMs = intervalMs / 100 * CC_JITTER_PERCENT;
+    return true;
+}
+
+void CongestionController::markConfigSent(uint8_t nodeId, uint16_t msgId) {
+    if (nodeId < 1 || nodeId > MAX_DEVICES) return;
+    nodes[nodeId - 1].pendingMsgId = msgId;
+}
+
+uint32_t CongestionController::getAssignedInterval(uint8_t nodeId) const {
+    if (nodeId < 1 || nodeId > MAX_DEVICES) return 0;
+    return nodes[nodeId - 1].assignedIntervalMs;
+}
+
+uint32_t CongestionController::floorFor(uint8_t nodeId) {
+    // Sans attribut ThingsBoard, un canal libre ramène le module à l'intervalle nominal
+    uint32_t floorMs = deviceManager.getReportFloor(nodeId);
+    if (floorMs == 0) return CC_DEFAULT_INTERVAL_MS;
+    return floorMs > CC_MIN_INTERVAL_MS ? floorMs : CC_MIN_INTERVAL_MS;
+}
@@ -1,5 +1,6 @@
 #include "DeviceManager.h"
 #include "config.h"
+#include "Log.h"
 #include <Preferences.h>
 #include <ArduinoJson.h>
 
@@ -16,6 +17,13 @@ void DeviceManager::init() {
         devices[i].isActive = false;
         devices[i].nodeId = i + 1; // nodeId de 1 à MAX_DEVICES
         devices[i].lastMsgCounter = 0;
+        devices[i].recentCounterMask = 0;
+        devices[i].reportFloorMs = 0;
+        devices[i].savedMsgCounter = 0;
+        clearMissing(devices[i]);
+        devices[i].historyDepth = 0;
+        devices[i].joinNonce = 0;
+        devices[i].rejoinPending = false;
     }
     unlock();
     loadFromNVS();
@@ -35,7 +43,15 @@ void DeviceManager::loadFromNVS() {
                 devices[i].deviceName[sizeof(devices[i].deviceName) - 1] = '\0';
                 strncpy(devices[i].deviceType, doc["type"], sizeof(devices[i].deviceType) - 1);
                 devices[i].deviceType[sizeof(devices[i].deviceType) - 1] = '\0';
-                Serial.printf("NVS Loaded: Slot %d, MAC: %s, Type: %s\n", i, devices[i].deviceName, devices[i].deviceType);
+                devices[i].reportFloorMs = doc["floor"] | 0;
+                devices[i].historyDepth = doc["hist"] | 0;
+                devices[i].joinNonce = doc["jn"] | 0;
+                devices[i].rejoinPending = doc["rj"] | false;
+                // Les compteurs de la fenêtre ont pu être reçus avant l'arrêt : tenus pour déjà vus
+                devices[i].lastMsgCounter = preferences.getUInt(("ctr_" + String(i)).c_str(), 0);
+                devices[i].savedMsgCounter = devices[i].lastMsgCounter;
+                devices[i].recentCounterMask = devices[i].lastMsgCounter ? UINT32_MAX : 0;
+                LOGI(LOG_MOD_DEVICES, "NVS Loaded: Slot %d, MAC: %s, Type: %s", i, devices[i].deviceName, devices[i].deviceType);
             }
         }
     }
@@ -50,22 +66,88 @@ void DeviceManager::saveToNVS(uint8_t slotIndex) {
     JsonDocument doc;
     doc["mac"] = devices[slotIndex].deviceName;
     doc["type"] = devices[slotIndex].deviceType;
+    if (devices[slotIndex].reportFloorMs > 0) {
+        doc["floor"] = devices[slotIndex].reportFloorMs;
+    }
+    if (devices[slotIndex].historyDepth > 0) {
+        doc["hist"] = devices[slotIndex].historyDepth;
+    }
+    doc["jn"] = devices[slotIndex].joinNonce;
+    if (devices[slotIndex].rejoinPending) {
+        doc["rj"] = true;
+    }
 
     String buffer;
     serializeJson(doc, buffer);
 
     preferences.putString(key.c_str(), buffer);
     preferences.end();
-    Serial.printf("NVS Saved: Slot %d, Data: %s\n", slotIndex, buffer.c_str());
+    LOGI(LOG_MOD_DEVICES, "NVS Saved: Slot %d, Data: %s", slotIndex, buffer.c_str());
+}
+
+void DeviceManager::saveCounter(uint8_t slotIndex) {
+    preferences.begin(NVS_NAMESPACE, false);
+    preferences.putUInt(("ctr_" + String(slotIndex)).c_str(), devices[slotIndex].lastMsgCounter);
+    preferences.end();
+    devices[slotIndex].savedMsgCounter = devices[slotIndex].lastMsgCounter;
+}
+
+// Le module repart du compteur 0 après chaque adhésion : appelée au premier message de la nouvelle session
+void DeviceManager::resetCounter(uint8_t slotIndex) {
+    devices[slotIndex].lastMsgCounter = 0;
+    devices[slotIndex].recentCounterMask = 0;
+    clearMissing(devices[slotIndex]);
+    saveCounter(slotIndex);
+}
+
+void DeviceManager::clearMissing(DeviceInfo& device) {
+    device.missingFrom = 0;
+    device.missingTo = 0;
+    device.missingSkipCount = 0;
 }
 
-int8_t DeviceManager::registerDevice(const char* mac, const char* type) {
+// Compteur de la plage perdue finalement reçu (message tardif) : une extrémité resserre la plage ; au
+// milieu, le compteur est signalé au module pour qu'il ne le rejoue pas (au-delà de BACKFILL_MAX_SKIP,
+// le relevé repart une seconde fois vers ThingsBoard)
+void DeviceManager::forgetMissing(DeviceInfo& device, uint32_t counter) {
+    if (device.missingFrom == 0 || counter < device.missingFrom || counter > device.missingTo) return;
+    if (device.missingFrom == device.missingTo) {
+        clearMissing(device);
+    } else if (counter == device.missingFrom) {
+        device.missingFrom++;
+    } else if (counter == device.missingTo) {
+        device.missingTo--;
+    } else if (device.missingSkipCount < BACKFILL_MAX_SKIP) {
+        device.missingSkip[device.missingSkipCount++] = counter;
+    }
+}
+
+// Un JOIN_REQUEST rejoué (nonce déjà vu) est refusé. Pour un module déjà connu, l'anti-rejeu n'est
+// pas remis à zéro ici : il ne l'est qu'au premier message portant ce nonce (checkMessageCounter),
+// preuve que le module a bien reçu le JOIN_ACCEPT et ouvert la nouvelle session.
+int8_t DeviceManager::registerDevice(const char* mac, const char* type, uint8_t historyDepth, uint32_t joinNonce) {
     lock();
     int8_t existingId = findDeviceByMac(mac);
     if (existingId != -1) {
+        DeviceInfo& device = devices[existingId - 1];
+        if (joinNonce <= device.joinNonce) {
+            uint32_t lastNonce = device.joinNonce;
+            unlock();
+            LOGW(LOG_MOD_DEVICES, "JOIN from %s refused: nonce %u already used (last %u)", mac, joinNonce, lastNonce);
+            return 0;
+        }
+        device.joinNonce = joinNonce;
+        device.rejoinPending = true;
+        device.historyDepth = historyDepth; // Un module mis à jour peut gagner (ou perdre) son historique
+        saveToNVS(existingId - 1);
         unlock();
         return existingId;
     }
+    if (joinNonce == 0) {
+        unlock();
+        LOGW(LOG_MOD_DEVICES, "JOIN from %s refused: no nonce", mac);
+        return 0;
+    }
     
     uint8_t slot = findEmptySlot();
     if (slot == 255) {
@@ -79,9 +161,14 @@ int8_t DeviceManager::registerDevice(const char* mac, const char* type) {
     strncpy(devices[slot].deviceType, type, sizeof(devices[slot].deviceType));
     devices[slot].deviceType[sizeof(devices[slot].deviceType) - 1] = '\0';
     devices[slot].lastSeen = millis();
+    devices[slot].reportFloorMs = 0;
+    devices[slot].historyDepth = historyDepth;
+    devices[slot].joinNonce = joinNonce;
+    devices[slot].rejoinPending = false;
     uint8_t newId = devices[slot].nodeId;
     
     saveToNVS(slot); // Sauvegarder immédiatement le nouvel appareil
+    resetCounter(slot);
     unlock();
     return newId;
 }
@@ -94,16 +181,101 @@ bool DeviceManager::isDeviceRegistered(uint8_t nodeId) {
     return status;
 }
 
-bool DeviceManager::isValidMessageCounter(uint8_t nodeId, uint32_t counter) {
+bool DeviceManager::isValidMessageCounter(uint8_t nodeId, uint32_t counter, uint32_t* gap) {
+    return checkMessageCounter(nodeId, counter, gap) == COUNTER_OK;
+}
+
+CounterCheck DeviceManager::checkMessageCounter(uint8_t nodeId, uint32_t counter, uint32_t* gap, uint32_t restartedAt, uint32_t joinNonce) {
+    if (nodeId < 1 || nodeId > MAX_DEVICES) return COUNTER_REPLAY;
+    lock();
+    DeviceInfo& device = devices[nodeId - 1];
+    if (device.rejoinPending && joinNonce == device.joinNonce) {
+        // Premier message de la session ouverte par la dernière adhésion : le module est reparti de 0
+        device.rejoinPending = false;
+        saveToNVS(nodeId - 1);
+        resetCounter(nodeId - 1);
+    }
+    if (restartedAt > device.lastMsgCounter && restartedAt < counter) {
+        // Redémarrage à froid du module : il a sauté les compteurs jusqu'à restartedAt sans les émettre.
+        // Recalage sans perte comptée ; son historique est effacé, la plage en attente n'a plus d'objet.
+        device.lastMsgCounter = restartedAt;
+        device.recentCounterMask = UINT32_MAX;
+        clearMissing(device);
+    }
+    uint32_t last = device.lastMsgCounter;
+    CounterCheck result = COUNTER_REPLAY;
+
+    if (counter > last) {
+        // Messages perdus entre les deux compteurs (inconnu juste après un redémarrage)
+        if (gap) *gap = (last == 0) ? 0 : counter - last - 1;
+        uint32_t shift = counter - last;
+        if (last != 0 && shift > 1 && device.historyDepth > 0) {
+            // Plage à redemander au module, bornée à ce qu'il garde en historique ; aucune pour un module
+            // sans historique, à qui une commande backfill coûterait une trame pour rien
+            uint32_t maxRange = device.historyDepth < BACKFILL_MAX_RANGE ? device.historyDepth : BACKFILL_MAX_RANGE;
+            if (device.missingFrom == 0) device.missingFrom = last + 1;
+            device.missingTo = counter - 1;
+            if (device.missingTo - device.missingFrom >= maxRange) {
+                device.missingFrom = device.missingTo - maxRange + 1;
+            }
+        }
+        device.recentCounterMask = (last == 0 || shift >= REPLAY_WINDOW_SIZE) ? 1 : (device.recentCounterMask << shift) | 1;
+        device.lastMsgCounter = counter;
+        if (counter - device.savedMsgCounter >= COUNTER_SAVE_INTERVAL) {
+            saveCounter(nodeId - 1);
+        }
+        result = COUNTER_OK;
+    } else if (counter != 0 && last - counter < REPLAY_WINDOW_SIZE) {
+        // Fenêtre glissante (type IPsec) : un message plus ancien n'est accepté qu'une seule fois
+        uint32_t bit = 1UL << (last - counter);
+        if (device.recentCounterMask & bit) {
+            result = COUNTER_DUPLICATE;
+        } else {
+            device.recentCounterMask |= bit;
+            forgetMissing(device, counter);
+            if (gap) *gap = 0;
+            result = COUNTER_OK;
+        }
+    }
+    unlock();
+    return result;
+}
+
+bool DeviceManager::takeMissingRange(uint8_t nodeId, uint32_t& from, uint32_t& to, uint32_t* skip, uint8_t& skipCount) {
     if (nodeId < 1 || nodeId > MAX_DEVICES) return false;
     lock();
-    if (counter > devices[nodeId - 1].lastMsgCounter) {
-        devices[nodeId - 1].lastMsgCounter = counter;
-        unlock();
-        return true;
+    DeviceInfo& device = devices[nodeId - 1];
+    bool pending = device.missingFrom != 0;
+    if (pending) {
+        from = device.missingFrom;
+        to = device.missingTo;
+        skipCount = 0;
+        for (uint8_t i = 0; i < device.missingSkipCount; i++) {
+            // Une plage rognée par BACKFILL_MAX_RANGE a pu laisser des compteurs hors de ses bornes
+            if (device.missingSkip[i] >= from && device.missingSkip[i] <= to) skip[skipCount++] = device.missingSkip[i];
+        }
+        clearMissing(device);
     }
     unlock();
-    return false;
+    return pending;
+}
+
+void DeviceManager::setReportFloor(uint8_t nodeId, uint32_t floorMs) {
+    if (nodeId < 1 || nodeId > MAX_DEVICES) return;
+    lock();
+    if (devices[nodeId - 1].isActive && devices[nodeId - 1].reportFloorMs != floorMs) {
+        devices[nodeId - 1].reportFloorMs = floorMs;
+        saveToNVS(nodeId - 1);
+    }
+    unlock();
+}
+
+uint32_t DeviceManager::getReportFloor(uint8_t nodeId) {
+    if (nodeId < 1 || nodeId > MAX_DEVICES) return 0;
+    lock();
+    uint32_t floorMs = devices[nodeId - 1].reportFloorMs;
+    unlock();
+    return floorMs;
 }
 
 void DeviceManager::updateDeviceSignalInfo(uint8_t nodeId, float rssi, float snr) {
@@ -120,6 +292,11 @@ const char* DeviceManager::getDeviceName(uint8_t nodeId) {
     return devices[nodeId - 1].deviceName;
 }
 
+const char* DeviceManager::getDeviceType(uint8_t nodeId) {
+    if (!isDeviceRegistered(nodeId)) return "";
+    return devices[nodeId - 1].deviceType;
+}
+
 const DeviceInfo* DeviceManager::getDeviceInfo(uint8_t index) {
     if (index >= MAX_DEVICES) return nullptr;
     return &devices[index];
@@ -138,6 +315,18 @@ uint8_t DeviceManager::findNodeIdByName(const char* name) {
     return 0; // 0 signifie non trouvé
 }
 
+uint8_t DeviceManager::findNodeIdsByType(const char* type, uint8_t* nodeIds, uint8_t maxCount) {
+    uint8_t count = 0;
+    lock();
+    for (int i = 0; i < MAX_DEVICES && count < maxCount; i++) {
+        if (devices[i].isActive && strcmp(devices[i].deviceType, type) == 0) {
+            nodeIds[count++] = devices[i].nodeId;
+        }
+    }
+    unlock();
+    return count;
+}
+
 uint8_t DeviceManager::getOnlineDeviceCount() {
     uint8_t count = 0;
     lock();
@@ -0,0 +1,176 @@
+#include "FrameCapture.h"
+
+#if CAPTURE_MODE
+
+#include "DeviceManager.h"
+#include "Log.h"
+#include <esp_timer.h>
+#include <Base64.h>
+#include <RadioLib.h>
+
+FrameCapture frameCapture;
+
+// Ligne série : "CAP " + enregistrement complet en base64 + '\n'
+#define CAPTURE_LINE_SIZE (4 + (sizeof(CaptureRecordHeader) + CAPTURE_MAX_DATA + 2) / 3 * 4 + 2)
+
+bool FrameCapture::begin() {
+    queue = xQueueCreate(CAPTURE_QUEUE_SIZE, sizeof(Item));
+    if (!queue) return false;
+#if CAPTURE_MODE == CAPTURE_FLASH
+    if (!openFlash()) {
+        LOGE(LOG_MOD_SYSTEM, "CAPTURE: no '%s' data partition", CAPTURE_PARTITION_LABEL);
+        return false;
+    }
+#endif
+    if (xTaskCreatePinnedToCore(task, "Capture", CAPTURE_TASK_STACK_SIZE, this, 1, NULL, 0) != pdPASS) return false;
+
+    // Au démarrage, la file peut attendre : la session et la liste des modules ne doivent pas être perdues
+    static Item item;
+    uint64_t now = esp_timer_get_time();
+    CaptureSession session = {};
+    session.frequencyHz = (uint32_t)(LORA_FREQ * 1e6f);
+    session.bandwidthHz = (uint32_t)(LORA_BANDWIDTH_KHZ * 1e3f);
+    session.spreadingFactor = LORA_SPREADING_FACTOR;
+    session.codingRate = LORA_CODING_RATE;
+    session.syncWord = LORA_SYNC_WORD;
+    session.preambleLength = LORA_PREAMBLE_LENGTH;
+    session.maxDevices = MAX_DEVICES;
+    strncpy(session.firmware, FIRMWARE_VERSION, sizeof(session.firmware));
+    item.header = { CAPTURE_RECORD_SESSION, 0, sizeof(session), now };
+    memcpy(item.data, &session, sizeof(session));
+    xQueueSend(queue, &item, portMAX_DELAY);
+
+    for (uint8_t i = 0; i < MAX_DEVICES; i++) {
+        const DeviceInfo* info = deviceManager.getDeviceInfo(i);
+        if (!info || !info->isActive) continue;
+        CaptureDevice device = {};
+        device.nodeId = info->nodeId;
+        device.reportFloorMs = info->reportFloorMs;
+        memcpy(device.deviceName, info->deviceName, sizeof(device.deviceName));
+        memcpy(device.deviceType, info->deviceType, sizeof(device.deviceType));
+        item.header = { CAPTURE_RECORD_DEVICE, 0, sizeof(device), now };
+        memcpy(item.data, &device, sizeof(device));
+        xQueueSend(queue, &item, portMAX_DELAY);
+    }
+    return true;
+}
+
+void FrameCapture::enqueue(Item& item) {
+    if (xQueueSend(queue, &item, 0) != pdPASS) dropped++;
+}
+
+// Appelé par la tâche LoRa uniquement : l'élément statique épargne sa pile
+void FrameCapture::onFrame(const uint8_t* data, size_t length, int16_t radioState, float rssi, float snr, uint32_t irqAt) {
+    static Item item;
+    if (!queue) return;
+    if (length > RADIOLIB_SX126X_MAX_PACKET_LENGTH) length = RADIOLIB_SX126X_MAX_PACKET_LENGTH;
+    // micros() est le compteur esp_timer tronqué : on retrouve l'instant de l'interruption sur 64 bits
+    uint64_t irqTimeUs = esp_timer_get_time() - (uint32_t)(micros() - irqAt);
+    CaptureFrame frame = { rssi, snr, radioState };
+    item.header = { CAPTURE_RECORD_FRAME, 0, (uint16_t)(sizeof(frame) + length), irqTimeUs };
+    memcpy(item.data, &frame, sizeof(frame));
+    memcpy(item.data + sizeof(frame), data, length);
+    enqueue(item);
+}
+
+// Appelé par la tâche MQTT uniquement
+void FrameCapture::onTelemetry(const LoRaMessage& msg) {
+    static Item item;
+    if (!queue) return;
+    size_t length = strnlen(msg.payload, sizeof(msg.payload));
+    CaptureTelemetry telemetry = { msg.nodeId };
+    item.header = { CAPTURE_RECORD_TELEMETRY, 0, (uint16_t)(sizeof(telemetry) + length), (uint64_t)esp_timer_get_time() };
+    memcpy(item.data, &telemetry, sizeof(telemetry));
+    memcpy(item.data + sizeof(telemetry), msg.payload, length);
+    enqueue(item);
+}
+
+void FrameCapture::task(void* params) {
+    static_cast<FrameCapture*>(params)->run();
+}
+
+void FrameCapture::run() {
+    static Item item;
+    uint32_t reportedDropped = 0;
+    for (;;) {
+        if (xQueueReceive(queue, &item, pdMS_TO_TICKS(1000)) == pdPASS) {
+            write(item);
+        }
+        if (dropped != reportedDropped) {
+            LOGW(LOG_MOD_SYSTEM, "CAPTURE: %u record(s) dropped (queue full)", dropped - reportedDropped);
+            reportedDropped = dropped;
+        }
+    }
+}
+
+#if CAPTURE_MODE == CAPTURE_SERIAL
+
+void FrameCapture::write(const Item& item) {
+    static char line[CAPTURE_LINE_SIZE];
+    memcpy(line, "CAP ", 4);
+    int encoded = base64_encode(line + 4, (char*)&item, sizeof(item.header) + item.header.length);
+    line[4 + encoded] = '\n';
+    Serial.write(line, 4 + encoded + 1); // Un seul appel : la ligne n'est pas coupée par le journal
+}
+
+#else
+
+bool FrameCapture::openFlash() {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, CAPTURE_PARTITION_LABEL);
+    if (!partition) return false;
+    sectorCount = partition->size / SPI_FLASH_SEC_SIZE;
+    if (sectorCount < 2) return false;
+    flashMutex = xSemaphoreCreateMutex();
+
+    // Reprise après le secteur le plus récent d'une session précédente
+    uint32_t newest = sectorCount - 1;
+    bool found = false;
+    for (uint32_t sector = 0; sector < sectorCount; sector++) {
+        CaptureSectorHeader header;
+        esp_partition_read(partition, sector * SPI_FLASH_SEC_SIZE, &header, sizeof(header));
+        if (header.magic != CAPTURE_SECTOR_MAGIC || (found && header.sequence <= sequence)) continue;
+        sequence = header.sequence;
+        newest = sector;
+        found = true;
+    }
+    sequence = found ? sequence + 1 : 1;
+    startSector((newest + 1) % sectorCount);
+    return true;
+}
+
+// Efface le secteur suivant et y écrit son en-tête. L'effacement bloque la flash quelques dizaines
+// de ms : il a lieu dans la tâche Capture, jamais sur le chemin de réception.
+void FrameCapture::startSector(uint32_t sector) {
+    CaptureSectorHeader header = { CAPTURE_SECTOR_MAGIC, sequence++ };
+    esp_partition_erase_range(partition, sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE);
+    esp_partition_write(partition, sector * SPI_FLASH_SEC_SIZE, &header, sizeof(header));
+    currentSector = sector;
+    sectorOffset = sizeof(header);
+}
+
+void FrameCapture::write(const Item& item) {
+    uint32_t size = sizeof(item.header) + item.header.length;
+    xSemaphoreTake(flashMutex, portMAX_DELAY);
+    if (sectorOffset + size > SPI_FLASH_SEC_SIZE) {
+        startSector((currentSector + 1) % sectorCount);
+    }
+    esp_partition_write(partition, currentSector * SPI_FLASH_SEC_SIZE + sectorOffset, &item, size);
+    sectorOffset += size;
+    xSemaphoreGive(flashMutex);
+}
+
+// Lecture brute, dans l'ordre physique : tools/capture.py remet les secteurs dans l'ordre de leur numéro
+size_t FrameCapture::readFlash(uint32_t offset, uint8_t* buffer, size_t length) {
+    if (!partition || offset >= getFlashSize()) return 0;
+    uint32_t within = offset % SPI_FLASH_SEC_SIZE;
+    if (length > SPI_FLASH_SEC_SIZE - within) length = SPI_FLASH_SEC_SIZE - within;
+    // Sous le verrou : jamais de secteur à moitié effacé
+    xSemaphoreTake(flashMutex, portMAX_DELAY);
+    esp_partition_read(partition, offset, buffer, length);
+    xSemaphoreGive(flashMutex);
+    return length;
+}
+
+#endif
+
+#endif
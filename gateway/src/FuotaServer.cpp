@@ -0,0 +1,384 @@
+#include "FuotaServer.h"
+#include "DeviceManager.h"
+#include "LoRaHandler.h"
+#include "Log.h"
+#include <HTTPClient.h>
+#include <RadioLib.h>
+#include <Base64.h>
+#include <esp_ota_ops.h>
+#include <esp_task_wdt.h>
+#include <mbedtls/sha256.h>
+
+extern SX1262 radio;
+extern QueueHandle_t rpcResultQueue;
+
+FuotaServer fuotaServer;
+
+FuotaServer::FuotaServer() {
+    phase = PHASE_IDLE;
+    targetCount = 0;
+    sessionId = 0;
+    cacheValid = false;
+}
+
+static bool parseHexHash(const char* hex, uint8_t* out) {
+    if (!hex || strlen(hex) != 64) return false;
+    for (int i = 0; i < 32; i++) {
+        char byteStr[3] = { hex[2 * i], hex[2 * i + 1], 0 };
+        char* end;
+        out[i] = strtoul(byteStr, &end, 16);
+        if (*end != 0) return false;
+    }
+    return true;
+}
+
+RpcFailure FuotaServer::start(const char* imageUrl, const char* sha256Hex, const uint8_t* nodeIds, uint8_t count,
+                              uint8_t requester, int32_t requestRpcId) {
+    if (phase != PHASE_IDLE) return RPC_ERR_BUSY;
+    if (!imageUrl || strlen(imageUrl) >= sizeof(url) || !parseHexHash(sha256Hex, expectedHash) || count == 0) {
+        return RPC_ERR_ENCODING;
+    }
+
+    strcpy(url, imageUrl);
+    targetCount = 0;
+    for (uint8_t i = 0; i < count && targetCount < MAX_DEVICES; i++) {
+        if (nodeIds[i] == 0 || findTarget(nodeIds[i])) continue;
+        targets[targetCount++] = { nodeIds[i], false, false, false, 0 };
+    }
+    requesterId = requester;
+    rpcId = requestRpcId;
+    requestedAt = millis();
+
+    phase = PHASE_DOWNLOADING;
+    if (xTaskCreatePinnedToCore(downloadTask, "FUOTA", FUOTA_TASK_STACK_SIZE, this, 1, NULL, 0) != pdPASS) {
+        phase = PHASE_IDLE;
+        return RPC_ERR_BUSY;
+    }
+    return RPC_OK;
+}
+
+void FuotaServer::downloadTask(void* param) {
+    FuotaServer* server = static_cast<FuotaServer*>(param);
+    if (server->download()) {
+        server->enterPhase(PHASE_SETUP);
+    } else {
+        server->finish();
+    }
+    vTaskDelete(NULL);
+}
+
+// Télécharge l'image dans la partition OTA inactive de la passerelle, qui sert de stockage
+// pendant la session, en vérifiant son empreinte au passage
+bool FuotaServer::download() {
+    storage = esp_ota_get_next_update_partition(NULL);
+    if (!storage) {
+        LOGE(LOG_MOD_FUOTA, "FUOTA: no spare partition to store the image");
+        return false;
+    }
+
+    HTTPClient http;
+    http.setTimeout(FUOTA_DOWNLOAD_TIMEOUT_MS);
+    http.begin(url);
+    int code = http.GET();
+    int size = http.getSize();
+    if (code != HTTP_CODE_OK || size <= 0 || (uint32_t)size > storage->size) {
+        LOGE(LOG_MOD_FUOTA, "FUOTA: download failed (HTTP %d, %d bytes)", code, size);
+        http.end();
+        return false;
+    }
+
+    uint32_t eraseSize = (size + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+    esp_partition_erase_range(storage, 0, eraseSize);
+
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+
+    WiFiClient* stream = http.getStreamPtr();
+    uint8_t buffer[512];
+    uint32_t received = 0;
+    unsigned long lastData = millis();
+    while (received < (uint32_t)size && millis() - lastData < FUOTA_DOWNLOAD_TIMEOUT_MS) {
+        size_t available = stream->available();
+        if (available == 0) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+            continue;
+        }
+        int n = stream->readBytes(buffer, available < sizeof(buffer) ? available : sizeof(buffer));
+        esp_partition_write(storage, received, buffer, n);
+        mbedtls_sha256_update(&ctx, buffer, n);
+        received += n;
+        lastData = millis();
+    }
+    http.end();
+
+    uint8_t hash[32];
+    mbedtls_sha256_finish(&ctx, hash);
+    mbedtls_sha256_free(&ctx);
+    if (received != (uint32_t)size || memcmp(hash, expectedHash, sizeof(hash)) != 0) {
+        LOGE(LOG_MOD_FUOTA, "FUOTA: image rejected (%u/%d bytes, hash %s)", received, size,
+                            received == (uint32_t)size ? "mismatch" : "n/a");
+        return false;
+    }
+
+    imageSize = size;
+    generationCount = fuotaGenerationCount(imageSize);
+    cacheValid = false;
+    if (++sessionId == 0) sessionId = 1;
+    LOGI(LOG_MOD_FUOTA, "FUOTA: session %u, %u bytes, %u generations, %u target(s)", sessionId, imageSize, generationCount, targetCount);
+    return true;
+}
+
+FuotaServer::Target* FuotaServer::findTarget(uint8_t nodeId) {
+    for (uint8_t i = 0; i < targetCount; i++) {
+        if (targets[i].nodeId == nodeId) return &targets[i];
+    }
+    return nullptr;
+}
+
+// Un seul module : diffusion adressée ; un groupe : diffusion à tous (nodeId 0)
+uint8_t FuotaServer::destination() const {
+    return targetCount == 1 ? targets[0].nodeId : 0;
+}
+
+void FuotaServer::enterPhase(Phase next) {
+    phase = next;
+    phaseStartedAt = millis();
+    if (next == PHASE_BROADCAST) {
+        generation = 0;
+        row = 0;
+    } else if (next == PHASE_STATUS) {
+        statusIndex = 0;
+        statusAttempts = 0;
+        statusReceived = false;
+        repairCount = 0;
+    } else if (next == PHASE_REPAIR) {
+        repairIndex = 0;
+        row = 0;
+        repairRound++;
+    } else if (next == PHASE_SETUP) {
+        repairRound = 0;
+    }
+}
+
+void FuotaServer::sendSetup(uint8_t nodeId, JsonDocument& txDoc) {
+    char hashB64[base64_enc_len(sizeof(expectedHash)) + 1];
+    base64_encode(hashB64, (char*)expectedHash, sizeof(expectedHash));
+
+    JsonDocument doc;
+    doc[LORA_KEY_TYPE] = LORA_MSG_TYPE_FUOTA_SETUP;
+    doc[LORA_KEY_NODE_ID] = nodeId;
+    doc[LORA_KEY_SESSION] = sessionId;
+    doc[LORA_KEY_IMAGE_SIZE] = imageSize;
+    doc[LORA_KEY_IMAGE_HASH] = hashB64;
+
+    String plaintext;
+    serializeJson(doc, plaintext);
+    transmitPlaintext(plaintext, txDoc, TX_FUOTA);
+    radio.startReceive();
+    LOGI(LOG_MOD_FUOTA, "FUOTA: setup sent to Node %d", nodeId);
+}
+
+void FuotaServer::sendStatusRequest(uint8_t nodeId, JsonDocument& txDoc) {
+    JsonDocument doc;
+    doc[LORA_KEY_TYPE] = LORA_MSG_TYPE_FUOTA_STATUS_REQUEST;
+    doc[LORA_KEY_NODE_ID] = nodeId;
+    doc[LORA_KEY_SESSION] = sessionId;
+
+    String plaintext;
+    serializeJson(doc, plaintext);
+    transmitPlaintext(plaintext, txDoc, TX_FUOTA);
+    radio.startReceive();
+}
+
+void FuotaServer::sendRow(uint32_t gen, uint16_t rowIndex, JsonDocument& txDoc) {
+    if (!cacheValid || cachedGeneration != gen) {
+        uint32_t offset = gen * FUOTA_GENERATION_SIZE;
+        uint32_t length = imageSize - offset < FUOTA_GENERATION_SIZE ? imageSize - offset : FUOTA_GENERATION_SIZE;
+        memset(cache, 0, sizeof(cache)); // Le dernier bloc est complété par des zéros
+        esp_partition_read(storage, offset, cache, length);
+        cachedGeneration = gen;
+        cacheValid = true;
+    }
+
+    uint8_t blocks = fuotaBlocksInGeneration(imageSize, gen);
+    uint32_t mask = fuotaRowMask(gen, rowIndex, blocks);
+    uint8_t block[FUOTA_BLOCK_SIZE] = {0};
+    for (uint8_t b = 0; b < blocks; b++) {
+        if (!(mask & (1UL << b))) continue;
+        for (int i = 0; i < FUOTA_BLOCK_SIZE; i++) block[i] ^= cache[b * FUOTA_BLOCK_SIZE + i];
+    }
+    char b64[base64_enc_len(FUOTA_BLOCK_SIZE) + 1];
+    base64_encode(b64, (char*)block, FUOTA_BLOCK_SIZE);
+
+    JsonDocument doc;
+    doc[LORA_KEY_TYPE] = LORA_MSG_TYPE_FUOTA_DATA;
+    doc[LORA_KEY_NODE_ID] = destination();
+    doc[LORA_KEY_SESSION] = sessionId;
+    doc[LORA_KEY_GENERATION] = gen;
+    doc[LORA_KEY_ROW] = rowIndex;
+    doc[LORA_KEY_FRAG_DATA] = b64;
+
+    String plaintext;
+    serializeJson(doc, plaintext);
+    transmitPlaintext(plaintext, txDoc, TX_FUOTA);
+    radio.startReceive();
+    lastFrameAt = millis();
+}
+
+// Le déficit retenu pour une génération est le plus grand signalé : une même ligne codée
+// profite à tous les modules à qui il manque quelque chose dans cette génération
+void FuotaServer::addRepair(uint32_t gen, uint8_t deficit) {
+    if (gen >= generationCount || deficit == 0) return;
+    uint8_t count = deficit + FUOTA_REPAIR_MARGIN;
+    for (uint8_t i = 0; i < repairCount; i++) {
+        if (repairs[i].generation == gen) {
+            if (count > repairs[i].count) repairs[i].count = count;
+            return;
+        }
+    }
+    if (repairCount < FUOTA_REPAIR_LIST_SIZE) {
+        repairs[repairCount++] = { gen, count };
+    }
+}
+
+void FuotaServer::onStatus(uint8_t nodeId, JsonObjectConst status) {
+    Target* target = findTarget(nodeId);
+    if (!target || phase == PHASE_IDLE || phase == PHASE_DOWNLOADING || status[LORA_KEY_SESSION] != sessionId) return;
+
+    int state = status[LORA_KEY_STATE] | 0;
+    uint32_t remaining = status[LORA_KEY_REMAINING] | 0;
+    target->ready = true;
+    if (state == 1) {
+        target->done = true;
+    } else if (state == 2) {
+        target->failed = true;
+    } else if (phase == PHASE_STATUS) {
+        for (JsonArrayConst entry : status[LORA_KEY_MISSING].as<JsonArrayConst>()) {
+            addRepair(entry[0], entry[1]);
+        }
+    }
+    LOGI(LOG_MOD_FUOTA, "FUOTA: Node %d state %d, %u generation(s) incomplete", nodeId, state, remaining);
+
+    if (phase == PHASE_STATUS && statusIndex < targetCount && targets[statusIndex].nodeId == nodeId) {
+        statusReceived = true;
+    }
+}
+
+// Classe A : un module qui n'écoute qu'après ses émissions reçoit son invitation à ce moment-là
+bool FuotaServer::onUplink(uint8_t nodeId, JsonDocument& txDoc) {
+    if (phase != PHASE_SETUP) return false;
+    Target* target = findTarget(nodeId);
+    if (!target || target->ready) return false;
+    sendSetup(nodeId, txDoc);
+    target->lastSetupAt = millis();
+    return true;
+}
+
+void FuotaServer::service(JsonDocument& txDoc) {
+    switch (phase) {
+        case PHASE_IDLE:
+        case PHASE_DOWNLOADING:
+            return;
+
+        case PHASE_SETUP: {
+            uint8_t ready = 0;
+            Target* due = nullptr;
+            for (uint8_t i = 0; i < targetCount; i++) {
+                if (targets[i].ready) {
+                    ready++;
+                } else if (!due && millis() - targets[i].lastSetupAt >= FUOTA_SETUP_RETRY_MS) {
+                    due = &targets[i];
+                }
+            }
+            if (ready == targetCount || millis() - phaseStartedAt > FUOTA_SETUP_TIMEOUT_MS) {
+                if (ready == 0) {
+                    LOGW(LOG_MOD_FUOTA, "FUOTA: no target answered the setup");
+                    finish();
+                } else {
+                    enterPhase(PHASE_BROADCAST);
+                }
+            } else if (due) {
+                sendSetup(due->nodeId, txDoc);
+                due->lastSetupAt = millis();
+            }
+            return;
+        }
+
+        case PHASE_BROADCAST: {
+            if (millis() - lastFrameAt < FUOTA_FRAME_SPACING_MS) return;
+            uint8_t blocks = fuotaBlocksInGeneration(imageSize, generation);
+            uint16_t rows = blocks + (blocks * FUOTA_REDUNDANCY_PERCENT + 99) / 100;
+            sendRow(generation, row, txDoc);
+            if (++row >= rows) {
+                row = 0;
+                if (++generation >= generationCount) {
+                    enterPhase(PHASE_STATUS);
+                }
+            }
+            return;
+        }
+
+        case PHASE_STATUS: {
+            if (statusIndex >= targetCount) {
+                if (repairCount > 0 && repairRound < FUOTA_MAX_REPAIR_ROUNDS) {
+                    enterPhase(PHASE_REPAIR);
+                } else {
+                    finish();
+                }
+                return;
+            }
+            Target& target = targets[statusIndex];
+            if (!target.ready || target.done || target.failed || statusReceived) {
+                statusIndex++;
+                statusAttempts = 0;
+                statusReceived = false;
+                return;
+            }
+            if (statusAttempts == 0 || millis() - statusRequestedAt > FUOTA_STATUS_TIMEOUT_MS) {
+                if (statusAttempts >= FUOTA_STATUS_ATTEMPTS) {
+                    LOGW(LOG_MOD_FUOTA, "FUOTA: Node %d does not answer", target.nodeId);
+                    target.failed = true;
+                    return;
+                }
+                sendStatusRequest(target.nodeId, txDoc);
+                statusAttempts++;
+                statusRequestedAt = millis();
+            }
+            return;
+        }
+
+        case PHASE_REPAIR: {
+            if (millis() - lastFrameAt < FUOTA_FRAME_SPACING_MS) return;
+            if (repairIndex >= repairCount) {
+                enterPhase(PHASE_STATUS);
+                return;
+            }
+            // Les lignes de réparation d'un tour ne recouvrent jamais celles déjà émises
+            uint16_t rowBase = FUOTA_GENERATION_BLOCKS * (1 + repairRound);
+            sendRow(repairs[repairIndex].generation, rowBase + row, txDoc);
+            if (++row >= repairs[repairIndex].count) {
+                row = 0;
+                repairIndex++;
+            }
+            return;
+        }
+    }
+}
+
+void FuotaServer::finish() {
+    uint8_t done = 0;
+    for (uint8_t i = 0; i < targetCount; i++) {
+        if (targets[i].done) done++;
+        LOGI(LOG_MOD_FUOTA, "FUOTA: Node %d %s", targets[i].nodeId, targets[i].done ? "updated" : "NOT updated");
+    }
+    LOGI(LOG_MOD_FUOTA, "FUOTA: session %u finished, %u/%u node(s) updated after %u repair round(s)",
+                        sessionId, done, targetCount, repairRound);
+
+    if (rpcId >= 0) {
+        RpcResult result = { requesterId, rpcId, (done == targetCount && targetCount > 0) ? RPC_OK : RPC_ERR_UPDATE_FAILED,
+                             (uint32_t)(millis() - requestedAt), 0, repairRound };
+        xQueueSend(rpcResultQueue, &result, 0);
+    }
+    phase = PHASE_IDLE;
+}
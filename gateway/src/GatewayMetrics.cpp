@@ -0,0 +1,129 @@
+#include "GatewayMetrics.h"
+
+GatewayMetrics gatewayMetrics;
+
+// Poids de la nouvelle mesure dans la moyenne glissante du signal : 1/8
+#define SIGNAL_AVG_SHIFT 3
+
+void GatewayMetrics::onUplink(UplinkType type) {
+    uplinks[type].fetch_add(1, std::memory_order_relaxed);
+}
+
+void GatewayMetrics::onReject(RxReject reason) {
+    rejects[reason].fetch_add(1, std::memory_order_relaxed);
+}
+
+void GatewayMetrics::onForwarded() {
+    forwarded.fetch_add(1, std::memory_order_relaxed);
+}
+
+void GatewayMetrics::onTransmit(TxKind kind, bool ok, uint32_t airtimeUs) {
+    if (!ok) {
+        txFailed[kind].fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    txOk[kind].fetch_add(1, std::memory_order_relaxed);
+    txAirtimeMs.fetch_add((airtimeUs + 500) / 1000, std::memory_order_relaxed);
+}
+
+void GatewayMetrics::onReceiveAirtime(uint32_t airtimeUs) {
+    rxAirtimeMs.fetch_add((airtimeUs + 500) / 1000, std::memory_order_relaxed);
+}
+
+void GatewayMetrics::onAckRetry() {
+    ackRetries.fetch_add(1, std::memory_order_relaxed);
+}
+
+void GatewayMetrics::onCommandAcked() {
+    commandsAcked.fetch_add(1, std::memory_order_relaxed);
+}
+
+void GatewayMetrics::onAckTimeout() {
+    ackTimeouts.fetch_add(1, std::memory_order_relaxed);
+}
+
+void GatewayMetrics::updateStat(std::atomic<int32_t>& last, std::atomic<int32_t>& min, std::atomic<int32_t>& max,
+                                std::atomic<int32_t>& avg, int32_t value, bool first) {
+    last.store(value, std::memory_order_relaxed);
+    if (first) {
+        min.store(value, std::memory_order_relaxed);
+        max.store(value, std::memory_order_relaxed);
+        avg.store(value, std::memory_order_relaxed);
+        return;
+    }
+    if (value < min.load(std::memory_order_relaxed)) min.store(value, std::memory_order_relaxed);
+    if (value > max.load(std::memory_order_relaxed)) max.store(value, std::memory_order_relaxed);
+    int32_t previous = avg.load(std::memory_order_relaxed);
+    avg.store(previous + (value - previous) / (1 << SIGNAL_AVG_SHIFT), std::memory_order_relaxed);
+}
+
+// Un seul écrivain (la tâche LoRa) : les lectures-modifications n'ont pas besoin d'être atomiques
+// dans leur ensemble, seules les valeurs lues par le serveur HTTP doivent l'être
+void GatewayMetrics::onSignal(uint8_t nodeId, float rssi, float snr) {
+    if (nodeId < 1 || nodeId > MAX_DEVICES) return;
+    NodeSignal& signal = signals[nodeId];
+    bool first = signal.packets.load(std::memory_order_relaxed) == 0;
+    updateStat(signal.rssiLast, signal.rssiMin, signal.rssiMax, signal.rssiAvg, lroundf(rssi * 10), first);
+    updateStat(signal.snrLast, signal.snrMin, signal.snrMax, signal.snrAvg, lroundf(snr * 10), first);
+    // Publié en dernier : un lecteur qui voit packets > 0 voit aussi des valeurs initialisées
+    signal.packets.fetch_add(1, std::memory_order_release);
+}
+
+bool GatewayMetrics::getSignal(uint8_t nodeId, NodeSignalSnapshot& out) const {
+    if (nodeId < 1 || nodeId > MAX_DEVICES) return false;
+    const NodeSignal& signal = signals[nodeId];
+    out.packets = signal.packets.load(std::memory_order_acquire);
+    if (out.packets == 0) return false;
+    out.rssiLast = signal.rssiLast.load(std::memory_order_relaxed);
+    out.rssiMin = signal.rssiMin.load(std::memory_order_relaxed);
+    out.rssiMax = signal.rssiMax.load(std::memory_order_relaxed);
+    out.rssiAvg = signal.rssiAvg.load(std::memory_order_relaxed);
+    out.snrLast = signal.snrLast.load(std::memory_order_relaxed);
+    out.snrMin = signal.snrMin.load(std::memory_order_relaxed);
+    out.snrMax = signal.snrMax.load(std::memory_order_relaxed);
+    out.snrAvg = signal.snrAvg.load(std::memory_order_relaxed);
+    return true;
+}
+
+const char* GatewayMetrics::uplinkTypeName(UplinkType type) {
+    switch (type) {
+        case UPLINK_TYPE_JOIN: return "join";
+        case UPLINK_TYPE_TELEMETRY: return "telemetry";
+        case UPLINK_TYPE_ACK: return "ack";
+        case UPLINK_TYPE_FRAGMENT: return "fragment";
+        case UPLINK_TYPE_FRAGMENT_ACK: return "fragment_ack";
+        case UPLINK_TYPE_FUOTA_STATUS: return "fuota_status";
+        case UPLINK_TYPE_HISTORY: return "history";
+        default: return "other";
+    }
+}
+
+const char* GatewayMetrics::rejectName(RxReject reason) {
+    switch (reason) {
+        case REJECT_RADIO_CRC: return "radio_crc";
+        case REJECT_RADIO_ERROR: return "radio_error";
+        case REJECT_JSON_INVALID: return "json_invalid";
+        case REJECT_FORMAT_INVALID: return "format_invalid";
+        case REJECT_DECRYPT_FAILED: return "decrypt_failed";
+        case REJECT_CRC_MISMATCH: return "crc_mismatch";
+        case REJECT_PAYLOAD_INVALID: return "payload_invalid";
+        case REJECT_UNKNOWN_NODE: return "unknown_node";
+        case REJECT_REPLAY: return "replay";
+        case REJECT_DUPLICATE: return "duplicate";
+        case REJECT_FRAGMENT: return "fragment_rejected";
+        case REJECT_TOO_LONG: return "too_long";
+        case REJECT_RX_QUEUE_FULL: return "rx_queue_full";
+        default: return "join_queue_full";
+    }
+}
+
+const char* GatewayMetrics::txKindName(TxKind kind) {
+    switch (kind) {
+        case TX_JOIN_ACCEPT: return "join_accept";
+        case TX_ACK: return "ack";
+        case TX_COMMAND: return "command";
+        case TX_COMMAND_RETRY: return "command_retry";
+        case TX_FRAGMENT: return "fragment";
+        default: return "fuota";
+    }
+}
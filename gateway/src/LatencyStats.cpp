@@ -0,0 +1,103 @@
+#include "LatencyStats.h"
+
+LatencyStats latencyStats;
+
+static portMUX_TYPE reportMux = portMUX_INITIALIZER_UNLOCKED;
+
+static const uint32_t SUB_BUCKETS = 1UL << LATENCY_SUB_BITS;
+
+void LatencyHistogram::record(uint32_t valueUs) {
+    buckets[bucketOf(valueUs)]++;
+    count++;
+    if (valueUs > maxUs) maxUs = valueUs;
+}
+
+void LatencyHistogram::reset() {
+    memset(buckets, 0, sizeof(buckets));
+    count = 0;
+    maxUs = 0;
+}
+
+uint32_t LatencyHistogram::percentile(float p) const {
+    if (count == 0) return 0;
+    uint32_t rank = (uint32_t)ceilf(p / 100.0f * count);
+    if (rank == 0) rank = 1;
+    uint32_t seen = 0;
+    for (uint16_t b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen >= rank) {
+            uint32_t bound = bucketUpperBound(b);
+            return bound < maxUs ? bound : maxUs;
+        }
+    }
+    return maxUs;
+}
+
+uint16_t LatencyHistogram::bucketOf(uint32_t valueUs) {
+    if (valueUs >= (1UL << LATENCY_MAX_BITS)) valueUs = (1UL << LATENCY_MAX_BITS) - 1;
+    if (valueUs < SUB_BUCKETS) return valueUs;
+    uint8_t msb = 31 - __builtin_clz(valueUs);
+    uint8_t shift = msb - LATENCY_SUB_BITS;
+    uint32_t sub = (valueUs >> shift) & (SUB_BUCKETS - 1);
+    return ((shift + 1) << LATENCY_SUB_BITS) + sub;
+}
+
+uint32_t LatencyHistogram::bucketUpperBound(uint16_t bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    uint8_t shift = (bucket >> LATENCY_SUB_BITS) - 1;
+    uint32_t sub = bucket & (SUB_BUCKETS - 1);
+    return ((SUB_BUCKETS + sub) << shift) + (1UL << shift) - 1;
+}
+
+void LatencyStats::record(const PacketTimestamps& ts) {
+    // Différences non signées : correctes malgré le débordement de micros()
+    histograms[STAGE_DECODE].record(ts.decodedAt - ts.irqAt);
+    histograms[STAGE_ENQUEUE].record(ts.enqueuedAt - ts.decodedAt);
+    histograms[STAGE_QUEUE].record(ts.dequeuedAt - ts.enqueuedAt);
+    histograms[STAGE_PUBLISH].record(ts.publishedAt - ts.dequeuedAt);
+    histograms[STAGE_TOTAL].record(ts.publishedAt - ts.irqAt);
+}
+
+void LatencyStats::onPublishFailed() {
+    publishFailures++;
+}
+
+bool LatencyStats::closeWindow() {
+    unsigned long now = millis();
+    if (windowStart == 0) windowStart = now;
+    if (now - windowStart < LATENCY_REPORT_INTERVAL_MS) return false;
+
+    LatencyReport closed;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        LatencyHistogram& histogram = histograms[i];
+        closed.stages[i] = { histogram.getCount(), histogram.percentile(50), histogram.percentile(90),
+                             histogram.percentile(99), histogram.getMax() };
+        histogram.reset();
+    }
+    closed.windowMs = now - windowStart;
+    closed.publishFailures = publishFailures;
+    publishFailures = 0;
+    windowStart = now;
+
+    portENTER_CRITICAL(&reportMux);
+    report = closed;
+    portEXIT_CRITICAL(&reportMux);
+    return true;
+}
+
+LatencyReport LatencyStats::getReport() {
+    portENTER_CRITICAL(&reportMux);
+    LatencyReport copy = report;
+    portEXIT_CRITICAL(&reportMux);
+    return copy;
+}
+
+const char* LatencyStats::stageName(LatencyStage stage) {
+    switch (stage) {
+        case STAGE_DECODE: return "decode";
+        case STAGE_ENQUEUE: return "enqueue";
+        case STAGE_QUEUE: return "queue";
+        case STAGE_PUBLISH: return "publish";
+        default: return "total";
+    }
+}
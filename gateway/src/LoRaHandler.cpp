@@ -2,7 +2,16 @@
 #include "config.h"
 #include "types.h"
 #include "DeviceManager.h"
+#include "CongestionController.h"
+#include "RttEstimator.h"
+#include "Fragmentation.h"
+#include "FuotaServer.h"
 #include "helpers.h"
+#include "LoadGenerator.h"
+#include "GatewayMetrics.h"
+#include "Log.h"
+#include "FrameCapture.h"
+#include "RulesEngine.h"
 #include <RadioLib.h>
 #include <ArduinoJson.h>
 #include <AESLib.h>
@@ -15,11 +24,436 @@ extern SX1262 radio;
 extern QueueHandle_t loraTxQueue;
 extern QueueHandle_t loraRxQueue;
 extern QueueHandle_t systemQueue;
+extern QueueHandle_t rpcResultQueue;
+extern QueueHandle_t bulkTxQueue;
 extern SystemStatus systemStatus;
 
 static TaskHandle_t loraTaskHandle = NULL;
+static volatile uint32_t lastIrqAt = 0;   // micros() de la dernière interruption DIO1
+static RttEstimator rttEstimator;
+
+// Transferts fragmentés : réassemblage des messages montants, et un seul message long descendant à la fois
+static FragmentReassembler reassembler;
+static FragmentSender bulkSender;
+static LoRaBulkCommand bulkCmd;
+static unsigned long bulkRoundSentAt = 0;
+static uint32_t bulkTimeoutMs = 0;
+static uint8_t bulkRounds = 0;            // Tours sans progrès du masque
+static uint16_t nextTransferId = 0;
+
+// Commande en attente d'acquittement (une seule à la fois)
+static LoRaTxCommand pendingAckCmd;
+static bool waitingForAck = false;
+static uint8_t ackRetries = 0;
+static unsigned long ackSentTime = 0;
+static uint32_t ackTimeoutMs = 0;
+
+// File des JOIN_ACCEPT en attente d'émission (tampon circulaire, accédé uniquement par la tâche LoRa)
+struct PendingJoinAccept {
+    uint8_t nodeId;
+    unsigned long requestTime;
+};
+static PendingJoinAccept joinAcceptQueue[JOIN_ACCEPT_QUEUE_SIZE];
+static uint8_t joinAcceptHead = 0;
+static uint8_t joinAcceptCount = 0;
+static unsigned long lastJoinAcceptTime = 0;
+
+static bool queueJoinAccept(uint8_t nodeId) {
+    // Une requête répétée pour un module déjà en file ne fait que rafraîchir son échéance
+    for (uint8_t i = 0; i < joinAcceptCount; i++) {
+        PendingJoinAccept& pending = joinAcceptQueue[(joinAcceptHead + i) % JOIN_ACCEPT_QUEUE_SIZE];
+        if (pending.nodeId == nodeId) {
+            pending.requestTime = millis();
+            return true;
+        }
+    }
+    if (joinAcceptCount >= JOIN_ACCEPT_QUEUE_SIZE) {
+        gatewayMetrics.onReject(REJECT_JOIN_QUEUE_FULL);
+        return false;
+    }
+    joinAcceptQueue[(joinAcceptHead + joinAcceptCount) % JOIN_ACCEPT_QUEUE_SIZE] = { nodeId, millis() };
+    joinAcceptCount++;
+    return true;
+}
+
+static void popJoinAccept() {
+    joinAcceptHead = (joinAcceptHead + 1) % JOIN_ACCEPT_QUEUE_SIZE;
+    joinAcceptCount--;
+}
+
+static void sendJoinAccept(uint8_t nodeId, JsonDocument& txDoc) {
+    JsonDocument responseDoc;
+    JsonObject p = responseDoc[LORA_KEY_PAYLOAD].to<JsonObject>();
+    p[LORA_KEY_TYPE] = LORA_MSG_TYPE_JOIN_ACCEPT;
+    p[LORA_KEY_NODE_ID] = nodeId;
+    uint64_t epochMs;
+    if (epochMillisAt(micros(), epochMs)) {
+        p[LORA_KEY_TIME] = (uint32_t)(epochMs / 1000);
+    }
+
+    String responsePayloadStr;
+    serializeJson(p, responsePayloadStr);
+
+    String encryptedResponse = encrypt_payload(responsePayloadStr);
+    txDoc.clear();
+    txDoc[LORA_KEY_PAYLOAD] = encryptedResponse;
+    txDoc[LORA_KEY_CRC] = calculateCRC32((const uint8_t*)responsePayloadStr.c_str(), responsePayloadStr.length());
+
+    String response;
+    serializeJson(txDoc, response);
+    uint32_t airtimeUs = radio.getTimeOnAir(response.length());
+    gatewayMetrics.onTransmit(TX_JOIN_ACCEPT, radio.transmit(response) == RADIOLIB_ERR_NONE, airtimeUs);
+    congestionController.onFrameTransmitted(airtimeUs);
+    radio.startReceive();
+    LOGI(LOG_MOD_LORA, "LORA TX -> JOIN_ACCEPT (encrypted) sent for Node %d", nodeId);
+
+    SystemEvent event = { NEW_DEVICE_REGISTERED, nodeId };
+    xQueueSend(systemQueue, &event, 0);
+}
+
+// Émet au plus un JOIN_ACCEPT par appel, en respectant le délai de bascule du module et l'espacement minimal.
+static void serviceJoinAcceptQueue(JsonDocument& txDoc) {
+    while (joinAcceptCount > 0) {
+        const PendingJoinAccept& next = joinAcceptQueue[joinAcceptHead];
+        unsigned long age = millis() - next.requestTime;
+        if (age > JOIN_ACCEPT_MAX_AGE_MS) {
+            LOGW(LOG_MOD_LORA, "LORA JOIN: accept for Node %d expired after %lu ms", next.nodeId, age);
+            popJoinAccept();
+            continue;
+        }
+        if (age < JOIN_ACCEPT_RX_DELAY_MS || millis() - lastJoinAcceptTime < JOIN_ACCEPT_PACING_MS) {
+            return;
+        }
+        sendJoinAccept(next.nodeId, txDoc);
+        lastJoinAcceptTime = millis();
+        popJoinAccept();
+        return;
+    }
+}
+
+// Après une trame montante, envoie au module sa nouvelle configuration d'intervalle si elle a changé.
+// Le module écoute juste après son émission : la commande est émise à la prochaine itération.
+static bool queueConfigDownlink(uint8_t nodeId) {
+    uint32_t intervalMs, jitterMs;
+    if (!congestionController.getPendingConfig(nodeId, intervalMs, jitterMs)) return false;
+
+    JsonDocument paramsDoc;
+    paramsDoc[LORA_KEY_INTERVAL] = intervalMs;
+    paramsDoc[LORA_KEY_JITTER] = jitterMs;
+
+    LoRaTxCommand cmd;
+    if (!buildCommand(cmd, nodeId, LORA_METHOD_SET_CONFIG, paramsDoc.as<JsonVariantConst>(), false)) return false;
+    if (xQueueSend(loraTxQueue, &cmd, 0) != pdPASS) return false;
+    congestionController.markConfigSent(nodeId, cmd.msgId);
+    LOGI(LOG_MOD_CC, "CC: Node %d -> interval %u ms, jitter %u ms (msgId %d)", nodeId, intervalMs, jitterMs, cmd.msgId);
+    return true;
+}
+
+// Redemande au module les relevés perdus (trou dans ses compteurs) : il les rejoue en messages
+// HIST quand il n'a rien d'autre à émettre. Une demande perdue n'est pas renouvelée. Seuls les modules
+// qui ont annoncé un historique au JOIN ont une plage en attente.
+static void queueBackfillDownlink(uint8_t nodeId) {
+    uint32_t from, to;
+    uint32_t skip[BACKFILL_MAX_SKIP];
+    uint8_t skipCount;
+    if (!deviceManager.takeMissingRange(nodeId, from, to, skip, skipCount)) return;
+
+    JsonDocument paramsDoc;
+    paramsDoc[LORA_KEY_FROM] = from;
+    paramsDoc[LORA_KEY_TO] = to;
+    if (skipCount > 0) {
+        JsonArray skipped = paramsDoc[LORA_KEY_SKIP].to<JsonArray>();
+        for (uint8_t i = 0; i < skipCount; i++) skipped.add(skip[i]);
+    }
+
+    LoRaTxCommand cmd;
+    if (!buildCommand(cmd, nodeId, LORA_METHOD_BACKFILL, paramsDoc.as<JsonVariantConst>(), false)) return;
+    if (xQueueSend(loraTxQueue, &cmd, 0) == pdPASS) {
+        LOGI(LOG_MOD_LORA, "LORA TX -> backfill %u..%u queued for Node %d", from, to, nodeId);
+    }
+}
+
+// RTT attendu pour un module encore jamais mesuré : temps d'antenne calculé de l'ACK + traitement côté module
+static uint32_t seedAckRtt() {
+    return radio.getTimeOnAir(ACK_FRAME_LEN_ESTIMATE) / 1000 + ACK_NODE_TURNAROUND_MS;
+}
+
+static void reportRpcResult(const LoRaTxCommand& cmd, RpcFailure status, uint8_t retries, uint32_t rttMs,
+                            const char* reason = nullptr) {
+    if (cmd.rpcId < 0) return;
+    RpcResult result = { cmd.targetNodeId, cmd.rpcId, status, (uint32_t)(millis() - cmd.enqueuedAt), rttMs, retries };
+    if (reason) {
+        strncpy(result.reason, reason, sizeof(result.reason) - 1);
+        result.reason[sizeof(result.reason) - 1] = '\0';
+    }
+    if (xQueueSend(rpcResultQueue, &result, 0) != pdPASS) {
+        LOGW(LOG_MOD_LORA, "RPC result queue is full!");
+    }
+}
+
+static void reportRpcResult(const LoRaBulkCommand& cmd, RpcFailure status, uint8_t retries, uint32_t rttMs) {
+    if (cmd.rpcId < 0) return;
+    RpcResult result = { cmd.targetNodeId, cmd.rpcId, status, (uint32_t)(millis() - cmd.enqueuedAt), rttMs, retries };
+    if (xQueueSend(rpcResultQueue, &result, 0) != pdPASS) {
+        LOGW(LOG_MOD_LORA, "RPC result queue is full!");
+    }
+}
+
+// Commande en tête de loraTxQueue destinée à ce module, relue en clair pour être jointe à l'ACK.
+// Seule la tâche LoRa retire de la file : la commande lue reste la prochaine à sortir.
+static bool peekQueuedCommand(uint8_t nodeId, LoRaTxCommand& cmd, JsonDocument& plaintextDoc) {
+    if (waitingForAck || xQueuePeek(loraTxQueue, &cmd, 0) != pdPASS || cmd.targetNodeId != nodeId) return false;
+    JsonDocument frameDoc;
+    if (deserializeJson(frameDoc, cmd.payload)) return false;
+    String plaintext = decrypt_payload(frameDoc[LORA_KEY_PAYLOAD] | "");
+    return plaintext.length() > 0 && !deserializeJson(plaintextDoc, plaintext);
+}
+
+// Acquitte un message confirmé dans la fenêtre d'écoute du module. Une configuration en attente
+// pour ce module, sinon la prochaine commande de loraTxQueue qui lui est destinée, est jointe à
+// l'ACK plutôt que d'occuper une trame de plus.
+static void sendUplinkAck(uint8_t nodeId, uint32_t msgCtr, JsonDocument& txDoc) {
+    JsonDocument ackDoc;
+    ackDoc[LORA_KEY_TYPE] = LORA_MSG_TYPE_ACK;
+    ackDoc[LORA_KEY_NODE_ID] = nodeId;
+    ackDoc[LORA_KEY_MSG_COUNTER] = msgCtr;
+    uint64_t epochMs;
+    if (epochMillisAt(micros(), epochMs)) {
+        ackDoc[LORA_KEY_TIME] = (uint32_t)(epochMs / 1000); // Synchronise l'horloge du module
+    }
+
+    uint16_t cmdMsgId = 0;
+    uint32_t intervalMs, jitterMs;
+    if (congestionController.getPendingConfig(nodeId, intervalMs, jitterMs)) {
+        cmdMsgId = allocateCommandMsgId();
+        JsonObject cmd = ackDoc[LORA_KEY_CMD].to<JsonObject>();
+        cmd[LORA_KEY_MSG_ID] = cmdMsgId;
+        cmd[LORA_KEY_METHOD] = LORA_METHOD_SET_CONFIG;
+        JsonObject params = cmd[LORA_KEY_PARAMS].to<JsonObject>();
+        params[LORA_KEY_INTERVAL] = intervalMs;
+        params[LORA_KEY_JITTER] = jitterMs;
+    }
+
+    LoRaTxCommand queued;
+    bool carriesQueued = false;
+    JsonDocument queuedDoc;
+    if (cmdMsgId == 0 && peekQueuedCommand(nodeId, queued, queuedDoc)) {
+        JsonObject cmd = ackDoc[LORA_KEY_CMD].to<JsonObject>();
+        cmd[LORA_KEY_MSG_ID] = queued.msgId;
+        cmd[LORA_KEY_METHOD] = queuedDoc[LORA_KEY_METHOD];
+        if (!queuedDoc[LORA_KEY_PARAMS].isNull()) cmd[LORA_KEY_PARAMS] = queuedDoc[LORA_KEY_PARAMS];
+        // Trop longue pour partager la trame : elle partira seule, après l'ACK
+        carriesQueued = measureJson(ackDoc) <= LORA_MAX_PLAINTEXT_LEN;
+        if (!carriesQueued) ackDoc.remove(LORA_KEY_CMD);
+    }
+
+    String ackPayloadStr;
+    serializeJson(ackDoc, ackPayloadStr);
+    String encryptedAck = encrypt_payload(ackPayloadStr);
+    if (encryptedAck.length() == 0) return;
+    if (carriesQueued) xQueueReceive(loraTxQueue, &queued, 0); // Portée par l'ACK : retirée de la file
+
+    txDoc.clear();
+    txDoc[LORA_KEY_PAYLOAD] = encryptedAck;
+    txDoc[LORA_KEY_CRC] = calculateCRC32((const uint8_t*)ackPayloadStr.c_str(), ackPayloadStr.length());
+
+    String frame;
+    serializeJson(txDoc, frame);
+    bool sent = radio.transmit(frame) == RADIOLIB_ERR_NONE;
+    gatewayMetrics.onTransmit(TX_ACK, sent, radio.getTimeOnAir(frame.length()));
+    if (sent) {
+        congestionController.onFrameTransmitted(radio.getTimeOnAir(frame.length()));
+        if (cmdMsgId != 0) {
+            congestionController.markConfigSent(nodeId, cmdMsgId);
+        }
+        if (carriesQueued && queued.requireAck) {
+            waitingForAck = true;
+            pendingAckCmd = queued;
+            ackRetries = 0;
+            ackSentTime = millis();
+            ackTimeoutMs = rttEstimator.getTimeout(nodeId, seedAckRtt());
+        }
+        LOGD(LOG_MOD_LORA, "LORA TX -> ACK msgCtr %u to Node %d%s", msgCtr, nodeId,
+                           cmdMsgId ? " (+set_config)" : carriesQueued ? " (+queued command)" : "");
+    } else if (carriesQueued && xQueueSendToFront(loraTxQueue, &queued, 0) != pdPASS) {
+        reportRpcResult(queued, RPC_ERR_TX_FAILED, 0, 0);
+    }
+    radio.startReceive();
+}
+
+// Chiffre un message clair et l'émet dans une seule trame
+bool transmitPlaintext(const String& plaintext, JsonDocument& txDoc, TxKind kind) {
+    String encrypted = encrypt_payload(plaintext);
+    if (encrypted.length() == 0) return false;
+
+    txDoc.clear();
+    txDoc[LORA_KEY_PAYLOAD] = encrypted;
+    txDoc[LORA_KEY_CRC] = calculateCRC32((const uint8_t*)plaintext.c_str(), plaintext.length());
+
+    String frame;
+    serializeJson(txDoc, frame);
+    int state = radio.transmit(frame);
+    gatewayMetrics.onTransmit(kind, state == RADIOLIB_ERR_NONE, radio.getTimeOnAir(frame.length()));
+    if (state != RADIOLIB_ERR_NONE) {
+        LOGE(LOG_MOD_LORA, "LORA TX failed, code: %d", state);
+        return false;
+    }
+    congestionController.onFrameTransmitted(radio.getTimeOnAir(frame.length()));
+    return true;
+}
+
+// Indique au module les fragments reçus pour qu'il ne réémette que les manquants
+static void sendFragmentAck(uint8_t nodeId, uint16_t transferId, uint32_t receivedMask, JsonDocument& txDoc) {
+    JsonDocument fackDoc;
+    fackDoc[LORA_KEY_TYPE] = LORA_MSG_TYPE_FRAGMENT_ACK;
+    fackDoc[LORA_KEY_NODE_ID] = nodeId;
+    fackDoc[LORA_KEY_TRANSFER_ID] = transferId;
+    fackDoc[LORA_KEY_FRAG_MASK] = receivedMask;
+
+    String plaintext;
+    serializeJson(fackDoc, plaintext);
+    transmitPlaintext(plaintext, txDoc, TX_FRAGMENT);
+    radio.startReceive();
+}
+
+// Émet les fragments encore non acquittés du transfert descendant ; le dernier demande un FACK
+static void sendFragmentRound(JsonDocument& txDoc) {
+    uint32_t missing = bulkSender.getMissingMask();
+    if (missing == 0) return;
+    uint8_t last = 31 - __builtin_clz(missing);
+
+    for (uint8_t i = 0; i <= last; i++) {
+        if (!(missing & (1UL << i))) continue;
+        const uint8_t* chunk;
+        size_t chunkLength = bulkSender.getFragment(i, chunk);
+        char b64[base64_enc_len(FRAG_CHUNK_SIZE) + 1];
+        base64_encode(b64, (char*)chunk, chunkLength);
+
+        JsonDocument fragDoc;
+        fragDoc[LORA_KEY_TYPE] = LORA_MSG_TYPE_FRAGMENT;
+        fragDoc[LORA_KEY_NODE_ID] = bulkSender.getPeer();
+        fragDoc[LORA_KEY_TRANSFER_ID] = bulkSender.getTransferId();
+        fragDoc[LORA_KEY_FRAG_INDEX] = i;
+        fragDoc[LORA_KEY_FRAG_COUNT] = bulkSender.getCount();
+        if (i == last) fragDoc[LORA_KEY_FRAG_POLL] = 1;
+        fragDoc[LORA_KEY_FRAG_DATA] = b64;
+
+        String plaintext;
+        serializeJson(fragDoc, plaintext);
+        transmitPlaintext(plaintext, txDoc, TX_FRAGMENT);
+        esp_task_wdt_reset();
+        if (i != last) vTaskDelay(pdMS_TO_TICKS(FRAG_TX_SPACING_MS));
+    }
+    LOGI(LOG_MOD_LORA, "LORA TX -> Transfer %u to Node %d: %d fragment(s) sent",
+                       bulkSender.getTransferId(), bulkSender.getPeer(), __builtin_popcount(missing));
+    bulkRoundSentAt = millis();
+    radio.startReceive();
+}
+
+// Réception d'un fragment montant. Retourne true lorsque le message est complet :
+// decryptedDoc contient alors le message réassemblé, à traiter comme une trame ordinaire.
+static bool handleFragment(JsonDocument& decryptedDoc, JsonDocument& txDoc) {
+    uint8_t nodeId = decryptedDoc[LORA_KEY_NODE_ID];
+    uint16_t transferId = decryptedDoc[LORA_KEY_TRANSFER_ID];
+    uint8_t index = decryptedDoc[LORA_KEY_FRAG_INDEX];
+    uint8_t count = decryptedDoc[LORA_KEY_FRAG_COUNT];
+    bool poll = (decryptedDoc[LORA_KEY_FRAG_POLL] | 0) != 0;
+    const char* b64 = decryptedDoc[LORA_KEY_FRAG_DATA] | "";
+
+    if (!deviceManager.isDeviceRegistered(nodeId)) {
+        gatewayMetrics.onReject(REJECT_UNKNOWN_NODE);
+        return false;
+    }
+
+    size_t b64Length = strlen(b64);
+    if (b64Length == 0 || base64_dec_len((char*)b64, b64Length) > FRAG_CHUNK_SIZE) {
+        gatewayMetrics.onReject(REJECT_FRAGMENT);
+        congestionController.onRxError();
+        return false;
+    }
+    uint8_t chunk[FRAG_CHUNK_SIZE];
+    int chunkLength = base64_decode((char*)chunk, (char*)b64, b64Length);
+
+    FragmentResult result = reassembler.add(nodeId, transferId, index, count, chunk, chunkLength);
+    if (result == FRAG_REJECTED) {
+        gatewayMetrics.onReject(REJECT_FRAGMENT);
+        LOGW(LOG_MOD_LORA, "LORA RX: Fragment %u/%u of transfer %u from Node %d rejected", index + 1, count, transferId, nodeId);
+        return false;
+    }
+    if (poll || result == FRAG_COMPLETE) {
+        sendFragmentAck(nodeId, transferId, reassembler.getReceivedMask(nodeId, transferId), txDoc);
+    }
+    if (result != FRAG_COMPLETE) return false;
+
+    size_t length;
+    const char* message = reassembler.getMessage(nodeId, transferId, length);
+    decryptedDoc.clear();
+    if (deserializeJson(decryptedDoc, message, length) != DeserializationError::Ok || decryptedDoc[LORA_KEY_NODE_ID] != nodeId) {
+        gatewayMetrics.onReject(REJECT_PAYLOAD_INVALID);
+        LOGW(LOG_MOD_LORA, "LORA RX: Reassembled transfer %u from Node %d is invalid", transferId, nodeId);
+        return false;
+    }
+    LOGI(LOG_MOD_LORA, "LORA RX: Transfer %u from Node %d reassembled (%u bytes, %u fragments)", transferId, nodeId, length, count);
+    // Une réponse éventuelle (ACK) suit le FACK : laisser au module le temps de se remettre en écoute
+    vTaskDelay(pdMS_TO_TICKS(FRAG_TX_SPACING_MS));
+    return true;
+}
+
+// Masque de réception renvoyé par un module pour le transfert descendant en cours
+static void handleFragmentAck(JsonDocument& decryptedDoc, JsonDocument& txDoc) {
+    uint8_t nodeId = decryptedDoc[LORA_KEY_NODE_ID];
+    uint16_t transferId = decryptedDoc[LORA_KEY_TRANSFER_ID];
+    uint32_t mask = decryptedDoc[LORA_KEY_FRAG_MASK];
+
+    if (!bulkSender.isActive() || nodeId != bulkSender.getPeer() || transferId != bulkSender.getTransferId()) return;
+    if (bulkSender.onStatus(mask)) {
+        bulkRounds = 0;
+    }
+    if (bulkSender.isDone()) {
+        LOGI(LOG_MOD_LORA, "LORA TX -> Transfer %u to Node %d complete", transferId, nodeId);
+        reportRpcResult(bulkCmd, RPC_OK, bulkRounds, millis() - bulkRoundSentAt);
+        bulkSender.reset();
+        return;
+    }
+    // Le module vient d'émettre : il écoute encore, les fragments manquants partent tout de suite
+    vTaskDelay(pdMS_TO_TICKS(FRAG_TX_SPACING_MS));
+    sendFragmentRound(txDoc);
+}
+
+// Démarre le prochain message long en attente, ou relance le tour en cours faute de FACK
+static void serviceBulkTransfer(JsonDocument& txDoc) {
+    if (!bulkSender.isActive()) {
+        if (xQueueReceive(bulkTxQueue, &bulkCmd, 0) != pdPASS) return;
+        if (++nextTransferId == 0) nextTransferId = 1;
+        if (!bulkSender.begin(bulkCmd.targetNodeId, nextTransferId, (const uint8_t*)bulkCmd.plaintext, bulkCmd.length)) {
+            reportRpcResult(bulkCmd, RPC_ERR_ENCODING, 0, 0);
+            return;
+        }
+        bulkRounds = 0;
+        bulkTimeoutMs = rttEstimator.getTimeout(bulkCmd.targetNodeId, seedAckRtt());
+        sendFragmentRound(txDoc);
+        return;
+    }
+    if (millis() - bulkRoundSentAt <= bulkTimeoutMs) return;
+    if (++bulkRounds >= FRAG_MAX_ROUNDS) {
+        LOGW(LOG_MOD_LORA, "LORA TX -> Transfer %u to Node %d abandoned", bulkSender.getTransferId(), bulkSender.getPeer());
+        reportRpcResult(bulkCmd, RPC_ERR_ACK_TIMEOUT, bulkRounds, 0);
+        bulkSender.reset();
+        return;
+    }
+    bulkTimeoutMs = (bulkTimeoutMs > ACK_RTO_MAX_MS / 2) ? ACK_RTO_MAX_MS : bulkTimeoutMs * 2;
+    sendFragmentRound(txDoc);
+}
+
+
+void wakeLoRaTask() {
+    if (loraTaskHandle) {
+        xTaskNotifyGive(loraTaskHandle);
+    }
+}
 
 void IRAM_ATTR loraInterrupt() {
+    lastIrqAt = micros();
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
     vTaskNotifyGiveFromISR(loraTaskHandle, &xHigherPriorityTaskWoken);
     if (xHigherPriorityTaskWoken == pdTRUE) {
@@ -27,163 +461,404 @@ void IRAM_ATTR loraInterrupt() {
     }
 }
 
+bool openUplink(const String& rxStr, JsonDocument& rxDoc, JsonDocument& decryptedDoc) {
+    DeserializationError error = deserializeJson(rxDoc, rxStr);
+
+    if (error) {
+        gatewayMetrics.onReject(REJECT_JSON_INVALID);
+        LOGW(LOG_MOD_LORA, "LORA RX: JSON parsing failed! Msg: %s", rxStr.c_str());
+        congestionController.onRxError();
+        return false;
+    }
+
+    if (rxDoc[LORA_KEY_PAYLOAD].isNull() || rxDoc[LORA_KEY_CRC].isNull()) {
+        gatewayMetrics.onReject(REJECT_FORMAT_INVALID);
+        LOGW(LOG_MOD_LORA, "LORA RX: Invalid message format. Msg: %s", rxStr.c_str());
+        congestionController.onRxError();
+        return false;
+    }
+
+    String encryptedPayload = rxDoc[LORA_KEY_PAYLOAD];
+    String decryptedPayload = decrypt_payload(encryptedPayload);
+
+    if (decryptedPayload.length() == 0) {
+        gatewayMetrics.onReject(REJECT_DECRYPT_FAILED);
+        LOGW(LOG_MOD_LORA, "LORA RX: Decryption failed!");
+        congestionController.onRxError();
+        return false;
+    }
+
+    uint32_t receivedCrc = rxDoc[LORA_KEY_CRC];
+    uint32_t calculatedCrc = calculateCRC32((const uint8_t*)decryptedPayload.c_str(), decryptedPayload.length());
+
+    if (receivedCrc != calculatedCrc) {
+        gatewayMetrics.onReject(REJECT_CRC_MISMATCH);
+        LOGW(LOG_MOD_LORA, "LORA RX: CRC mismatch! RX: %u, CALC: %u. Payload: %s", receivedCrc, calculatedCrc, decryptedPayload.c_str());
+        congestionController.onRxError();
+        return false;
+    }
+
+    if (deserializeJson(decryptedDoc, decryptedPayload) != DeserializationError::Ok) {
+        gatewayMetrics.onReject(REJECT_PAYLOAD_INVALID);
+        LOGW(LOG_MOD_LORA, "LORA RX: Decrypted payload JSON parsing failed! Payload: %s", decryptedPayload.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool packTelemetry(JsonDocument& decryptedDoc, uint8_t nodeId, float rssi, float snr, LoRaMessage& msg) {
+    JsonObject data = decryptedDoc[LORA_KEY_DATA];
+    if (!data.isNull()) {
+        data["rssi"] = rssi;
+        data["snr"] = snr;
+    }
+
+    msg.nodeId = nodeId;
+    if (measureJson(decryptedDoc) >= sizeof(msg.payload)) {
+        return false;
+    }
+    serializeJson(decryptedDoc, msg.payload, sizeof(msg.payload));
+    return true;
+}
+
+static UplinkType uplinkTypeOf(const char* type) {
+    if (strcmp(type, LORA_MSG_TYPE_JOIN_REQUEST) == 0) return UPLINK_TYPE_JOIN;
+    if (strcmp(type, LORA_MSG_TYPE_TELEMETRY) == 0) return UPLINK_TYPE_TELEMETRY;
+    if (strcmp(type, LORA_MSG_TYPE_ACK) == 0) return UPLINK_TYPE_ACK;
+    if (strcmp(type, LORA_MSG_TYPE_FRAGMENT) == 0) return UPLINK_TYPE_FRAGMENT;
+    if (strcmp(type, LORA_MSG_TYPE_FRAGMENT_ACK) == 0) return UPLINK_TYPE_FRAGMENT_ACK;
+    if (strcmp(type, LORA_MSG_TYPE_FUOTA_STATUS) == 0) return UPLINK_TYPE_FUOTA_STATUS;
+    if (strcmp(type, LORA_MSG_TYPE_HISTORY) == 0) return UPLINK_TYPE_HISTORY;
+    return UPLINK_TYPE_OTHER;
+}
+
+// Vérifie l'émetteur et le compteur d'un message ; les rejets sont comptés
+static CounterCheck checkSender(uint8_t nodeId, uint32_t msgCtr, uint32_t* gap, JsonDocument& decryptedDoc) {
+    if (!deviceManager.isDeviceRegistered(nodeId)) {
+        gatewayMetrics.onReject(REJECT_UNKNOWN_NODE);
+        return COUNTER_REPLAY;
+    }
+    CounterCheck check = deviceManager.checkMessageCounter(nodeId, msgCtr, gap, decryptedDoc[LORA_KEY_RESTART] | 0u,
+                                                           decryptedDoc[LORA_KEY_JOIN_NONCE] | 0u);
+    if (check == COUNTER_REPLAY) {
+        gatewayMetrics.onReject(REJECT_REPLAY);
+    } else if (check == COUNTER_DUPLICATE) {
+        gatewayMetrics.onReject(REJECT_DUPLICATE);
+    }
+    return check;
+}
+
+// Remet une télémétrie (ou un relevé rejoué) à la tâche MQTT
+static void forwardTelemetry(JsonDocument& decryptedDoc, uint8_t nodeId, float rssi, float snr, uint32_t irqAt, uint32_t decodedAt) {
+    deviceManager.updateDeviceSignalInfo(nodeId, rssi, snr);
+    gatewayMetrics.onSignal(nodeId, rssi, snr);
+
+    LoRaMessage msg;
+    msg.timestamps = { irqAt, decodedAt, 0, 0, 0 };
+    if (!packTelemetry(decryptedDoc, nodeId, rssi, snr, msg)) {
+        gatewayMetrics.onReject(REJECT_TOO_LONG);
+        LOGW(LOG_MOD_LORA, "LORA RX: Telemetry from Node %d too long to forward", nodeId);
+        return;
+    }
+    msg.timestamps.enqueuedAt = micros();
+    if (xQueueSend(loraRxQueue, &msg, pdMS_TO_TICKS(10)) != pdPASS) {
+        gatewayMetrics.onReject(REJECT_RX_QUEUE_FULL);
+        LOGW(LOG_MOD_LORA, "LoRa RX Queue is full!");
+#if LOAD_TEST_ENABLED
+        loadGenerator.onRxQueueFull();
+#endif
+    } else {
+        gatewayMetrics.onForwarded();
+    }
+}
+
+// Traite une trame montante : reçue par la radio, ou injectée par le mode de charge synthétique
+static void handleUplink(const String& rxStr, float rssi, float snr, uint32_t irqAt, JsonDocument& rxDoc, JsonDocument& txDoc) {
+    JsonDocument decryptedDoc;
+    if (!openUplink(rxStr, rxDoc, decryptedDoc)) {
+        return;
+    }
+    uint32_t decodedAt = micros();
+
+    const char* type = decryptedDoc[LORA_KEY_TYPE] | "";
+    gatewayMetrics.onUplink(uplinkTypeOf(type));
+    LOGD(LOG_MOD_LORA, "LORA RX Decrypted: Type=%s", type);
+
+    if (strcmp(type, LORA_MSG_TYPE_FRAGMENT) == 0) {
+        // Le message réassemblé suit ensuite le même chemin qu'une trame unique
+        if (!handleFragment(decryptedDoc, txDoc)) return;
+        type = decryptedDoc[LORA_KEY_TYPE] | "";
+    } else if (strcmp(type, LORA_MSG_TYPE_FRAGMENT_ACK) == 0) {
+        handleFragmentAck(decryptedDoc, txDoc);
+        return;
+    }
+
+    if (strcmp(type, LORA_MSG_TYPE_JOIN_REQUEST) == 0) {
+        int8_t newId = deviceManager.registerDevice(decryptedDoc[LORA_KEY_MAC], decryptedDoc[LORA_KEY_DEV_TYPE],
+                                                   decryptedDoc[LORA_KEY_HISTORY_DEPTH] | 0, decryptedDoc[LORA_KEY_JOIN_NONCE] | 0u);
+        if (newId == 0) {
+            gatewayMetrics.onReject(REJECT_REPLAY); // JOIN_REQUEST rejoué : ni JOIN_ACCEPT, ni remise à zéro
+        } else if (newId > 0 && !queueJoinAccept((uint8_t)newId)) {
+            LOGW(LOG_MOD_LORA, "LORA JOIN: accept queue full, request from Node %d dropped", newId);
+        }
+    } else if (strcmp(type, LORA_MSG_TYPE_ACK) == 0) {
+        uint8_t nodeId = decryptedDoc[LORA_KEY_NODE_ID];
+        uint16_t ackMsgId = decryptedDoc[LORA_KEY_MSG_ID];
+        uint32_t msgCtr = decryptedDoc[LORA_KEY_MSG_COUNTER];
+        uint32_t gap = 0;
+
+        // Les ACK consomment aussi le compteur du module : sans cette mise à jour, ils apparaîtraient comme des pertes
+        if (checkSender(nodeId, msgCtr, &gap, decryptedDoc) != COUNTER_OK) {
+            return;
+        }
+        congestionController.onUplink(nodeId, gap);
+        if (waitingForAck && ackMsgId == pendingAckCmd.msgId && nodeId == pendingAckCmd.targetNodeId) {
+            uint32_t rttMs = millis() - ackSentTime;
+            // Algorithme de Karn : après un nouvel essai, on ne sait pas quelle émission est acquittée
+            if (ackRetries == 0) {
+                rttEstimator.addSample(nodeId, rttMs);
+            }
+            const char* refusal = decryptedDoc[LORA_KEY_ERROR];
+            LOGI(LOG_MOD_LORA, "LORA ACK %s for msgId %d (rtt %u ms, srtt %u ms, retries %d)", refusal ? refusal : "OK",
+                               ackMsgId, rttMs, rttEstimator.getSmoothedRtt(nodeId), ackRetries);
+            waitingForAck = false;
+            gatewayMetrics.onCommandAcked();
+            // Refus du module (défaut verrouillé...) : acquitté, donc ni nouvel essai ni ack_timeout
+            reportRpcResult(pendingAckCmd, refusal ? RPC_ERR_REFUSED : RPC_OK, ackRetries, rttMs, refusal);
+        } else {
+            congestionController.onConfigAck(nodeId, ackMsgId);
+        }
+    } else if (strcmp(type, LORA_MSG_TYPE_TELEMETRY) == 0) {
+        uint8_t nodeId = decryptedDoc[LORA_KEY_NODE_ID];
+        uint32_t msgCtr = decryptedDoc[LORA_KEY_MSG_COUNTER];
+        bool confirmed = (decryptedDoc[LORA_KEY_CONFIRMED] | 0) != 0; // Transmis comme 0/1
+        uint32_t gap = 0;
+
+        CounterCheck counterCheck = checkSender(nodeId, msgCtr, &gap, decryptedDoc);
+        if (counterCheck == COUNTER_DUPLICATE && confirmed) {
+            // Le message est déjà parvenu mais notre ACK s'est perdu : on acquitte sans retransmettre à ThingsBoard
+            LOGI(LOG_MOD_LORA, "LORA RX: Duplicate confirmed msgCtr %u from Node %d, re-ACK", msgCtr, nodeId);
+            sendUplinkAck(nodeId, msgCtr, txDoc);
+        } else if (counterCheck == COUNTER_OK) {
+            congestionController.onUplink(nodeId, gap);
+            if (confirmed) {
+                sendUplinkAck(nodeId, msgCtr, txDoc);
+            }
+            // Règles locales avant la remise à MQTT : leurs commandes n'attendent ni le réseau ni ThingsBoard
+            rulesEngine.evaluate(nodeId, decryptedDoc[LORA_KEY_DATA].as<JsonObjectConst>(), irqAt);
+            forwardTelemetry(decryptedDoc, nodeId, rssi, snr, irqAt, decodedAt);
+
+            // Le module écoute après son émission : une invitation à une mise à jour en cours passe en premier
+            if (fuotaServer.onUplink(nodeId, txDoc)) {
+                return;
+            }
+            if (bulkSender.isActive() && bulkSender.getPeer() == nodeId && !waitingForAck) {
+                // Occasion de pousser les fragments manquants
+                sendFragmentRound(txDoc);
+            } else if (!confirmed && !queueConfigDownlink(nodeId)) {
+                queueBackfillDownlink(nodeId);
+            }
+        }
+    } else if (strcmp(type, LORA_MSG_TYPE_HISTORY) == 0) {
+        uint8_t nodeId = decryptedDoc[LORA_KEY_NODE_ID];
+        uint32_t msgCtr = decryptedDoc[LORA_KEY_MSG_COUNTER];
+        uint32_t gap = 0;
+
+        // Nouveau compteur : le relevé rejoué ne heurte pas l'anti-rejeu. Ni réponse, ni règle locale : il est périmé.
+        if (checkSender(nodeId, msgCtr, &gap, decryptedDoc) != COUNTER_OK) {
+            return;
+        }
+        congestionController.onUplink(nodeId, gap);
+        LOGI(LOG_MOD_LORA, "LORA RX: Node %d replayed msgCtr %u (%u s old)", nodeId,
+                           decryptedDoc[LORA_KEY_ORIGINAL_COUNTER].as<uint32_t>(), decryptedDoc[LORA_KEY_AGE].as<uint32_t>());
+        forwardTelemetry(decryptedDoc, nodeId, rssi, snr, irqAt, decodedAt);
+    } else if (strcmp(type, LORA_MSG_TYPE_FUOTA_STATUS) == 0) {
+        uint8_t nodeId = decryptedDoc[LORA_KEY_NODE_ID];
+        uint32_t msgCtr = decryptedDoc[LORA_KEY_MSG_COUNTER];
+        uint32_t gap = 0;
+
+        if (checkSender(nodeId, msgCtr, &gap, decryptedDoc) != COUNTER_OK) {
+            return;
+        }
+        congestionController.onUplink(nodeId, gap);
+        fuotaServer.onStatus(nodeId, decryptedDoc.as<JsonObjectConst>());
+    }
+}
+
+#if LOAD_TEST_ENABLED
+// Trames du générateur de charge : elles entrent dans le chemin de réception juste après la radio
+static void serviceSyntheticUplinks(JsonDocument& rxDoc, JsonDocument& txDoc) {
+    SyntheticFrame frame;
+    for (int i = 0; i < LOAD_TEST_QUEUE_SIZE && loadGenerator.takeFrame(frame); i++) {
+        handleUplink(String(frame.payload), frame.rssi, frame.snr, frame.injectedAt, rxDoc, txDoc);
+        loadGenerator.onFrameProcessed();
+    }
+}
+#endif
+
 void taskLoRaHandler(void *pvParameters) {
     loraTaskHandle = xTaskGetCurrentTaskHandle();
     esp_task_wdt_add(NULL);
-    Serial.println("LoRa Task started");
+    LOGI(LOG_MOD_LORA, "LoRa Task started");
     JsonDocument txDoc;
     JsonDocument rxDoc;
 
-    LoRaTxCommand pendingAckCmd;
-    bool waitingForAck = false;
-    uint8_t ackRetries = 0;
-    unsigned long ackSentTime = 0;
-    const uint8_t MAX_ACK_RETRIES = 3;
-    const unsigned long ACK_TIMEOUT_MS = 5000;
-
     radio.startReceive();
 
     for (;;) {
         esp_task_wdt_reset();
 
+        serviceJoinAcceptQueue(txDoc);
+        congestionController.evaluate();
+        reassembler.expire();
+
         if (!waitingForAck) {
+            serviceBulkTransfer(txDoc);
+            fuotaServer.service(txDoc);
+
             LoRaTxCommand cmd;
             if (xQueueReceive(loraTxQueue, &cmd, 0) == pdPASS) {
                 int state = radio.transmit(cmd.payload, strlen(cmd.payload));
+                gatewayMetrics.onTransmit(TX_COMMAND, state == RADIOLIB_ERR_NONE, radio.getTimeOnAir(strlen(cmd.payload)));
                 if (state == RADIOLIB_ERR_NONE) {
-                    Serial.printf("LORA TX -> Node %d: %s\n", cmd.targetNodeId, cmd.payload);
+                    congestionController.onFrameTransmitted(radio.getTimeOnAir(strlen(cmd.payload)));
+                    LOGD(LOG_MOD_LORA, "LORA TX -> Node %d: %s", cmd.targetNodeId, cmd.payload);
                     if (cmd.requireAck) {
                         waitingForAck = true;
                         pendingAckCmd = cmd;
                         ackRetries = 0;
                         ackSentTime = millis();
+                        ackTimeoutMs = rttEstimator.getTimeout(cmd.targetNodeId, seedAckRtt());
                     }
                 } else {
-                    Serial.printf("LORA TX failed, code: %d\n", state);
+                    LOGE(LOG_MOD_LORA, "LORA TX failed, code: %d", state);
+                    reportRpcResult(cmd, RPC_ERR_TX_FAILED, 0, 0);
                 }
                 radio.startReceive();
             }
         } else {
-            if (millis() - ackSentTime > ACK_TIMEOUT_MS) {
-                if (ackRetries < MAX_ACK_RETRIES) {
+            if (millis() - ackSentTime > ackTimeoutMs) {
+                if (ackRetries < ACK_MAX_RETRIES) {
                     ackRetries++;
-                    Serial.printf("LORA ACK TIMEOUT -> Retrying (%d/%d) for msgId %d\n", ackRetries, MAX_ACK_RETRIES, pendingAckCmd.msgId);
+                    gatewayMetrics.onAckRetry();
+                    // Backoff exponentiel : le délai double à chaque nouvel essai
+                    ackTimeoutMs = (ackTimeoutMs > ACK_RTO_MAX_MS / 2) ? ACK_RTO_MAX_MS : ackTimeoutMs * 2;
+                    LOGW(LOG_MOD_LORA, "LORA ACK TIMEOUT -> Retrying (%d/%d) for msgId %d, timeout %u ms", ackRetries, ACK_MAX_RETRIES, pendingAckCmd.msgId, ackTimeoutMs);
                     int state = radio.transmit(pendingAckCmd.payload, strlen(pendingAckCmd.payload));
+                    gatewayMetrics.onTransmit(TX_COMMAND_RETRY, state == RADIOLIB_ERR_NONE,
+                                              radio.getTimeOnAir(strlen(pendingAckCmd.payload)));
                     if (state != RADIOLIB_ERR_NONE) {
-                         Serial.printf("LORA TX (retry) failed, code: %d\n", state);
+                         LOGE(LOG_MOD_LORA, "LORA TX (retry) failed, code: %d", state);
+                    } else {
+                        congestionController.onFrameTransmitted(radio.getTimeOnAir(strlen(pendingAckCmd.payload)));
                     }
                     ackSentTime = millis();
                     radio.startReceive();
                 } else {
-                    Serial.printf("LORA ACK FAIL -> Max retries reached for msgId %d\n", pendingAckCmd.msgId);
+                    LOGE(LOG_MOD_LORA, "LORA ACK FAIL -> Max retries reached for msgId %d", pendingAckCmd.msgId);
                     waitingForAck = false;
+                    gatewayMetrics.onAckTimeout();
+                    reportRpcResult(pendingAckCmd, RPC_ERR_ACK_TIMEOUT, ackRetries, 0);
                 }
             }
         }
 
         if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50))) {
+#if LOAD_TEST_ENABLED
+            serviceSyntheticUplinks(rxDoc, txDoc);
+            // Réveil par le seul générateur : DIO1 au repos, la radio n'a rien reçu
+            if (digitalRead(LORA_DIO1) == LOW) continue;
+#endif
             String rxStr;
             int state = radio.readData(rxStr);
+#if CAPTURE_MODE
+            // Avant tout traitement, trames en erreur CRC comprises : le rejeu refait le même chemin
+            frameCapture.onFrame((const uint8_t*)rxStr.c_str(), rxStr.length(), state, radio.getRSSI(), radio.getSNR(), lastIrqAt);
+#endif
 
             if (state == RADIOLIB_ERR_NONE && rxStr.length() > 0) {
                 systemStatus.lastLoRaRxTime = millis();
-                DeserializationError error = deserializeJson(rxDoc, rxStr);
-
-                if (error) {
-                    Serial.printf("LORA RX: JSON parsing failed! Msg: %s\n", rxStr.c_str());
-                    continue; // Skip this message
-                }
-
-                if (rxDoc[LORA_KEY_PAYLOAD].isNull() || rxDoc[LORA_KEY_CRC].isNull()) {
-                    Serial.printf("LORA RX: Invalid message format. Msg: %s\n", rxStr.c_str());
-                    continue;
-                }
-
-                String encryptedPayload = rxDoc[LORA_KEY_PAYLOAD];
-                String decryptedPayload = decrypt_payload(encryptedPayload);
-
-                if (decryptedPayload.length() == 0) {
-                    Serial.println("LORA RX: Decryption failed!");
-                    continue;
-                }
-
-                uint32_t receivedCrc = rxDoc[LORA_KEY_CRC];
-                uint32_t calculatedCrc = calculateCRC32((const uint8_t*)decryptedPayload.c_str(), decryptedPayload.length());
-
-                if (receivedCrc != calculatedCrc) {
-                    Serial.printf("LORA RX: CRC mismatch! RX: %u, CALC: %u. Payload: %s\n", receivedCrc, calculatedCrc, decryptedPayload.c_str());
-                    continue;
-                }
-
-                JsonDocument decryptedDoc;
-                if (deserializeJson(decryptedDoc, decryptedPayload) != DeserializationError::Ok) {
-                    Serial.printf("LORA RX: Decrypted payload JSON parsing failed! Payload: %s\n", decryptedPayload.c_str());
-                    continue;
+                congestionController.onFrameReceived(radio.getTimeOnAir(rxStr.length()));
+                gatewayMetrics.onReceiveAirtime(radio.getTimeOnAir(rxStr.length()));
+                handleUplink(rxStr, radio.getRSSI(), radio.getSNR(), lastIrqAt, rxDoc, txDoc);
+            } else if (state != RADIOLIB_ERR_RX_TIMEOUT && state != RADIOLIB_ERR_NONE) {
+                LOGW(LOG_MOD_LORA, "LORA RX failed, code: %d", state);
+                if (state == RADIOLIB_ERR_CRC_MISMATCH) {
+                    gatewayMetrics.onReject(REJECT_RADIO_CRC);
+                    congestionController.onRxError();
+                } else {
+                    gatewayMetrics.onReject(REJECT_RADIO_ERROR);
                 }
+            }
+            radio.startReceive();
+        }
+    }
+}
 
-                const char* type = decryptedDoc[LORA_KEY_TYPE];
-                Serial.printf("LORA RX Decrypted: Type=%s\n", type);
+uint16_t allocateCommandMsgId() {
+    static portMUX_TYPE msgIdMux = portMUX_INITIALIZER_UNLOCKED;
+    static uint16_t msgIdCounter = 0;
+    portENTER_CRITICAL(&msgIdMux);
+    if (++msgIdCounter == 0) msgIdCounter = 1; // 0 est réservé (« aucune commande »)
+    uint16_t id = msgIdCounter;
+    portEXIT_CRITICAL(&msgIdMux);
+    return id;
+}
 
-                if (strcmp(type, LORA_MSG_TYPE_JOIN_REQUEST) == 0) {
-                    int8_t newId = deviceManager.registerDevice(decryptedDoc[LORA_KEY_MAC], decryptedDoc[LORA_KEY_DEV_TYPE]);
-                    if (newId > 0) {
-                        JsonDocument responseDoc;
-                        JsonObject p = responseDoc[LORA_KEY_PAYLOAD].to<JsonObject>();
-                        p[LORA_KEY_TYPE] = LORA_MSG_TYPE_JOIN_ACCEPT;
-                        p[LORA_KEY_NODE_ID] = newId;
+bool buildCommand(LoRaTxCommand& cmd, uint8_t nodeId, const char* method, JsonVariantConst params, bool requireAck) {
+    cmd.targetNodeId = nodeId;
+    cmd.msgId = allocateCommandMsgId();
+    cmd.requireAck = requireAck;
+    cmd.rpcId = -1;
+    cmd.enqueuedAt = millis();
+
+    JsonDocument plaintextDoc;
+    plaintextDoc[LORA_KEY_TYPE] = LORA_MSG_TYPE_CMD;
+    plaintextDoc[LORA_KEY_NODE_ID] = nodeId;
+    plaintextDoc[LORA_KEY_MSG_ID] = cmd.msgId;
+    plaintextDoc[LORA_KEY_METHOD] = method;
+    plaintextDoc[LORA_KEY_PARAMS] = params;
+    String plaintextStr;
+    serializeJson(plaintextDoc, plaintextStr);
+    if (plaintextStr.length() > LORA_MAX_PLAINTEXT_LEN) {
+        return false; // Ne tient pas dans une trame : passer par buildBulkCommand
+    }
 
-                        String responsePayloadStr;
-                        serializeJson(p, responsePayloadStr);
+    String encryptedPayload = encrypt_payload(plaintextStr);
+    if (encryptedPayload.length() == 0) return false;
 
-                        String encryptedResponse = encrypt_payload(responsePayloadStr);
-                        txDoc.clear();
-                        txDoc[LORA_KEY_PAYLOAD] = encryptedResponse;
-                        txDoc[LORA_KEY_CRC] = calculateCRC32((const uint8_t*)responsePayloadStr.c_str(), responsePayloadStr.length());
+    JsonDocument loraDoc;
+    loraDoc[LORA_KEY_PAYLOAD] = encryptedPayload;
+    loraDoc[LORA_KEY_CRC] = calculateCRC32((const uint8_t*)plaintextStr.c_str(), plaintextStr.length());
 
-                        String response;
-                        serializeJson(txDoc, response);
-                        radio.transmit(response);
-                        Serial.printf("LORA TX -> JOIN_ACCEPT (encrypted) sent for Node %d\n", newId);
+    size_t len = serializeJson(loraDoc, cmd.payload, sizeof(cmd.payload));
+    if (len == 0 || len >= sizeof(cmd.payload) - 1) {
+        LOGW(LOG_MOD_LORA, "LORA CMD: frame too long for Node %d (%s)", nodeId, method);
+        return false;
+    }
+    return true;
+}
 
-                        SystemEvent event = { NEW_DEVICE_REGISTERED, (uint8_t)newId };
-                        xQueueSend(systemQueue, &event, 0);
-                    }
-                } else if (waitingForAck && strcmp(type, LORA_MSG_TYPE_ACK) == 0) {
-                    uint16_t ackMsgId = decryptedDoc[LORA_KEY_MSG_ID];
-                    if (ackMsgId == pendingAckCmd.msgId) {
-                        Serial.printf("LORA ACK OK for msgId %d\n", ackMsgId);
-                        waitingForAck = false;
-                    }
-                } else if (strcmp(type, LORA_MSG_TYPE_TELEMETRY) == 0) {
-                    uint8_t nodeId = decryptedDoc[LORA_KEY_NODE_ID];
-                    uint32_t msgCtr = decryptedDoc[LORA_KEY_MSG_COUNTER];
-
-                    if (deviceManager.isDeviceRegistered(nodeId) && deviceManager.isValidMessageCounter(nodeId, msgCtr)) {
-                        float rssi = radio.getRSSI();
-                        float snr = radio.getSNR();
-                        deviceManager.updateDeviceSignalInfo(nodeId, rssi, snr);
-
-                        JsonObject data = decryptedDoc[LORA_KEY_DATA];
-                        if (!data.isNull()) {
-                            data["rssi"] = rssi;
-                            data["snr"] = snr;
-                        }
-
-                        LoRaMessage msg;
-                        msg.nodeId = nodeId;
-                        serializeJson(decryptedDoc, msg.payload, sizeof(msg.payload));
-
-                        if (xQueueSend(loraRxQueue, &msg, pdMS_TO_TICKS(10)) != pdPASS) {
-                            Serial.println("LoRa RX Queue is full!");
-                        }
-                    }
-                }
-            } else if (state != RADIOLIB_ERR_RX_TIMEOUT && state != RADIOLIB_ERR_NONE) {
-                Serial.printf("LORA RX failed, code: %d\n", state);
-            }
-            radio.startReceive();
-        }
+bool buildBulkCommand(LoRaBulkCommand& cmd, uint8_t nodeId, const char* method, JsonVariantConst params) {
+    cmd.targetNodeId = nodeId;
+    cmd.msgId = allocateCommandMsgId();
+    cmd.rpcId = -1;
+    cmd.enqueuedAt = millis();
+
+    JsonDocument plaintextDoc;
+    plaintextDoc[LORA_KEY_TYPE] = LORA_MSG_TYPE_CMD;
+    plaintextDoc[LORA_KEY_NODE_ID] = nodeId;
+    plaintextDoc[LORA_KEY_MSG_ID] = cmd.msgId;
+    plaintextDoc[LORA_KEY_METHOD] = method;
+    plaintextDoc[LORA_KEY_PARAMS] = params;
+
+    size_t len = serializeJson(plaintextDoc, cmd.plaintext, sizeof(cmd.plaintext));
+    if (len == 0 || len >= sizeof(cmd.plaintext) - 1) {
+        LOGW(LOG_MOD_LORA, "LORA CMD: message too long for Node %d (%s)", nodeId, method);
+        return false;
     }
+    cmd.length = len;
+    return true;
 }
 
 String encrypt_payload(const String& plaintext) {
@@ -196,7 +871,7 @@ String encrypt_payload(const String& plaintext) {
     int paddedLen = (plaintextLen / 16 + (plaintextLen % 16 == 0 ? 0 : 1)) * 16;
 
     if (paddedLen > 256) {
-        Serial.println("Error: Plaintext too long for encryption buffer!");
+        LOGE(LOG_MOD_LORA, "Error: Plaintext too long for encryption buffer!");
         return "";
     }
 
@@ -220,7 +895,7 @@ String decrypt_payload(const String& b64_ciphertext) {
     memcpy(iv, LORA_AES_IV, 16);
 
     if (b64_ciphertext.length() > 342) { // 256 bytes padded to 272, then base64 to ~363. Safety margin.
-        Serial.println("Error: Ciphertext too long for decryption buffer!");
+        LOGE(LOG_MOD_LORA, "Error: Ciphertext too long for decryption buffer!");
         return "";
     }
 
@@ -229,7 +904,7 @@ String decrypt_payload(const String& b64_ciphertext) {
 
     int decodedLen = base64_dec_len(b64_input, sizeof(b64_input));
     if (decodedLen > 256) {
-        Serial.println("Error: Decoded length exceeds buffer size!");
+        LOGE(LOG_MOD_LORA, "Error: Decoded length exceeds buffer size!");
         return "";
     }
 
@@ -0,0 +1,284 @@
+#include "LoadGenerator.h"
+
+#if LOAD_TEST_ENABLED
+#include "DeviceManager.h"
+#include "LoRaHandler.h"
+#include "RuntimeProfiler.h"
+#include "helpers.h"
+#include <AESLib.h>
+#include <Base64.h>
+
+extern QueueHandle_t loraRxQueue;
+
+LoadGenerator loadGenerator;
+
+static AESLib generatorAes; // Distinct de celui de la tâche LoRa : AESLib n'est pas partagé entre tâches
+static portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+
+LoadGenerator::LoadGenerator()
+    : queue(NULL), injected(0), processed(0), published(0), latencySumUs(0), latencyMaxUs(0),
+      injectHighWater(0), rxQueueHighWater(0), injectDrops(0), rxQueueDrops(0), publishFailures(0),
+      report{}, windowStart(0) {
+    memset(virtualIds, 0, sizeof(virtualIds));
+    for (int i = 0; i < LOAD_TEST_VIRTUAL_NODES; i++) {
+        // Adresses administrées localement : elles ne peuvent pas être celles d'un vrai module
+        snprintf(nodes[i].mac, sizeof(nodes[i].mac), "02:4C:54:00:00:%02X", i + 1);
+        nodes[i].nodeId = 0;
+        nodes[i].msgCtr = 0;
+    }
+}
+
+bool LoadGenerator::begin() {
+    queue = xQueueCreate(LOAD_TEST_QUEUE_SIZE, sizeof(SyntheticFrame));
+    if (!queue) return false;
+    windowStart = millis();
+    runtimeProfiler.watchTask("LoadGen", LOAD_TEST_TASK_STACK_SIZE);
+    runtimeProfiler.watchQueue("inject", queue, LOAD_TEST_QUEUE_SIZE);
+    return xTaskCreatePinnedToCore(task, "LoadGen", LOAD_TEST_TASK_STACK_SIZE, this, 1, NULL, 0) == pdPASS;
+}
+
+void LoadGenerator::task(void* params) {
+    static_cast<LoadGenerator*>(params)->run();
+}
+
+bool LoadGenerator::takeFrame(SyntheticFrame& frame) {
+    return queue && xQueueReceive(queue, &frame, 0) == pdPASS;
+}
+
+void LoadGenerator::onFrameProcessed() {
+    uint8_t waiting = uxQueueMessagesWaiting(loraRxQueue);
+    portENTER_CRITICAL(&statsMux);
+    processed++;
+    if (waiting > rxQueueHighWater) rxQueueHighWater = waiting;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+void LoadGenerator::onRxQueueFull() {
+    portENTER_CRITICAL(&statsMux);
+    rxQueueDrops++;
+    portEXIT_CRITICAL(&statsMux);
+}
+
+void LoadGenerator::onPublished(const LoRaMessage& msg, bool ok) {
+    if (!isVirtualNode(msg.nodeId)) return;
+    uint32_t latencyUs = micros() - msg.timestamps.irqAt;
+    portENTER_CRITICAL(&statsMux);
+    if (ok) {
+        published++;
+        latencySumUs += latencyUs;
+        if (latencyUs > latencyMaxUs) latencyMaxUs = latencyUs;
+    } else {
+        publishFailures++;
+    }
+    portEXIT_CRITICAL(&statsMux);
+}
+
+bool LoadGenerator::isVirtualNode(uint8_t nodeId) const {
+    return nodeId >= 1 && nodeId <= MAX_DEVICES && virtualIds[nodeId];
+}
+
+LoadTestReport LoadGenerator::getReport() {
+    portENTER_CRITICAL(&statsMux);
+    LoadTestReport copy = report;
+    portEXIT_CRITICAL(&statsMux);
+    return copy;
+}
+
+void LoadGenerator::run() {
+    const uint32_t periodUs = 1000000UL / (LOAD_TEST_RATE_PPS > 0 ? LOAD_TEST_RATE_PPS : 1);
+    unsigned long nextAt = micros();
+    uint8_t next = 0;
+    SyntheticFrame frame;
+
+    for (;;) {
+        // Rythme fixe ; un retard est rattrapé en rafale, dans la limite d'une file pleine
+        uint8_t burst = 0;
+        while ((long)(micros() - nextAt) >= 0 && burst < LOAD_TEST_QUEUE_SIZE) {
+            nextAt += periodUs;
+            burst++;
+
+            VirtualNode& node = nodes[next];
+            next = (next + 1) % LOAD_TEST_VIRTUAL_NODES;
+            uint32_t msgCtr = node.msgCtr;
+            if (!buildFrame(pickKind(), node, frame)) continue;
+
+            frame.injectedAt = micros();
+            if (xQueueSend(queue, &frame, 0) != pdPASS) {
+                node.msgCtr = msgCtr; // Jamais parvenue à la passerelle : le compteur n'est pas consommé
+                portENTER_CRITICAL(&statsMux);
+                injectDrops++;
+                portEXIT_CRITICAL(&statsMux);
+                continue;
+            }
+            uint8_t waiting = uxQueueMessagesWaiting(queue);
+            portENTER_CRITICAL(&statsMux);
+            injected++;
+            if (waiting > injectHighWater) injectHighWater = waiting;
+            portEXIT_CRITICAL(&statsMux);
+            wakeLoRaTask();
+        }
+        if (burst == LOAD_TEST_QUEUE_SIZE) {
+            nextAt = micros(); // Retard durable : on ne cherche pas à le rattraper
+        }
+
+        if (millis() - windowStart >= LOAD_TEST_REPORT_INTERVAL_MS) {
+            publishReport();
+        }
+        vTaskDelay(1);
+    }
+}
+
+LoadGenerator::FrameKind LoadGenerator::pickKind() {
+    uint32_t draw = esp_random() % 100;
+    if (draw < LOAD_TEST_JOIN_PERCENT) return KIND_JOIN;
+    draw -= LOAD_TEST_JOIN_PERCENT;
+    if (draw < LOAD_TEST_ACK_PERCENT) return KIND_ACK;
+    draw -= LOAD_TEST_ACK_PERCENT;
+    if (draw < LOAD_TEST_JUNK_PERCENT) return KIND_JUNK;
+    return KIND_TELEMETRY;
+}
+
+bool LoadGenerator::buildFrame(FrameKind kind, VirtualNode& node, SyntheticFrame& frame) {
+    frame.rssi = -60.0f - (float)(esp_random() % 600) / 10.0f;
+    frame.snr = -10.0f + (float)(esp_random() % 200) / 10.0f;
+
+    if (kind == KIND_JUNK) {
+        buildJunk(frame);
+        return true;
+    }
+
+    if (node.nodeId == 0) {
+        node.nodeId = deviceManager.findNodeIdByName(node.mac);
+        if (node.nodeId != 0) {
+            virtualIds[node.nodeId] = true;
+        } else {
+            kind = KIND_JOIN; // Tant qu'il n'est pas enregistré, le module ne peut que demander à rejoindre
+        }
+    }
+
+    // Les modules pairs ressemblent à WellguardPro, les impairs à AquaReservPro
+    bool wellguard = (&node - nodes) % 2 == 0;
+    char plaintext[200];
+    switch (kind) {
+        case KIND_JOIN:
+            // Module inconnu de la passerelle : tout nonce non nul est neuf
+            snprintf(plaintext, sizeof(plaintext), "{\"type\":\"JOIN_REQUEST\",\"mac\":\"%s\",\"devType\":\"%s\",\"jn\":1}",
+                     node.mac, wellguard ? "WELL_PUMP_STATION" : "RESERVOIR_SENSOR");
+            break;
+        case KIND_ACK:
+            snprintf(plaintext, sizeof(plaintext), "{\"type\":\"ACK\",\"nodeId\":%u,\"msgId\":%u,\"msgCtr\":%u}",
+                     node.nodeId, (unsigned)(esp_random() % 65535 + 1), ++node.msgCtr);
+            break;
+        default: {
+            const char* confirmed = (esp_random() % 100) < LOAD_TEST_CONFIRMED_PERCENT ? ",\"conf\":1" : "";
+            if (wellguard) {
+                snprintf(plaintext, sizeof(plaintext),
+                         "{\"type\":\"TELEMETRY\",\"nodeId\":%u,\"msgCtr\":%u%s,\"data\":{\"temperature\":%.2f,"
+                         "\"humidity\":%.1f,\"voltage\":%.2f,\"pressure_ok\":%s}}",
+                         node.nodeId, ++node.msgCtr, confirmed, 15.0f + (esp_random() % 1500) / 100.0f,
+                         40.0f + (esp_random() % 400) / 10.0f, 3.5f + (esp_random() % 70) / 100.0f,
+                         esp_random() % 20 ? "true" : "false");
+            } else {
+                snprintf(plaintext, sizeof(plaintext),
+                         "{\"type\":\"TELEMETRY\",\"nodeId\":%u,\"msgCtr\":%u%s,\"data\":{\"level_full\":%s,\"voltage\":3.3}}",
+                         node.nodeId, ++node.msgCtr, confirmed, esp_random() % 2 ? "true" : "false");
+            }
+            break;
+        }
+    }
+    return encryptFrame(plaintext, frame, false);
+}
+
+// Chiffrement identique à LoraNode::encryptPayload (bourrage PKCS7), puis encadrement {"p":..,"c":..}
+bool LoadGenerator::encryptFrame(const char* plaintext, SyntheticFrame& frame, bool corruptCrc) {
+    int plaintextLen = strlen(plaintext);
+    int paddedLen = (plaintextLen / 16 + 1) * 16;
+    if (paddedLen > 176) return false; // Le base64 doit tenir dans la trame
+
+    byte padded[paddedLen];
+    memcpy(padded, plaintext, plaintextLen);
+    for (int i = plaintextLen; i < paddedLen; i++) {
+        padded[i] = paddedLen - plaintextLen;
+    }
+
+    byte key[16];
+    byte iv[16];
+    memcpy(key, LORA_SECRET_KEY, 16);
+    memcpy(iv, LORA_AES_IV, 16);
+    byte encrypted[paddedLen];
+    generatorAes.encrypt(padded, paddedLen, encrypted, key, sizeof(key), iv);
+
+    char b64[base64_enc_len(paddedLen) + 1];
+    base64_encode(b64, (char*)encrypted, paddedLen);
+
+    uint32_t crc = calculateCRC32((const uint8_t*)plaintext, plaintextLen);
+    if (corruptCrc) crc ^= 0x00010000;
+    snprintf(frame.payload, sizeof(frame.payload), "{\"p\":\"%s\",\"c\":%u}", b64, crc);
+    return true;
+}
+
+// Trames que la passerelle doit rejeter : JSON illisible, CRC faux, ou chiffré aléatoire
+void LoadGenerator::buildJunk(SyntheticFrame& frame) {
+    switch (esp_random() % 3) {
+        case 0: {
+            int length = 20 + esp_random() % 100;
+            for (int i = 0; i < length; i++) {
+                frame.payload[i] = 'A' + esp_random() % 26;
+            }
+            frame.payload[length] = '\0';
+            break;
+        }
+        case 1:
+            encryptFrame("{\"type\":\"TELEMETRY\",\"nodeId\":1,\"msgCtr\":1,\"data\":{}}", frame, true);
+            break;
+        default: {
+            byte noise[48];
+            for (size_t i = 0; i < sizeof(noise); i++) {
+                noise[i] = esp_random() & 0xFF;
+            }
+            char b64[base64_enc_len(sizeof(noise)) + 1];
+            base64_encode(b64, (char*)noise, sizeof(noise));
+            snprintf(frame.payload, sizeof(frame.payload), "{\"p\":\"%s\",\"c\":%u}", b64, (unsigned)esp_random());
+            break;
+        }
+    }
+}
+
+void LoadGenerator::publishReport() {
+    unsigned long now = millis();
+    float seconds = (now - windowStart) / 1000.0f;
+    windowStart = now;
+
+    uint8_t joined = 0;
+    for (int i = 0; i < LOAD_TEST_VIRTUAL_NODES; i++) {
+        if (nodes[i].nodeId != 0) joined++;
+    }
+
+    portENTER_CRITICAL(&statsMux);
+    report.injectedPps = injected / seconds;
+    report.processedPps = processed / seconds;
+    report.publishedPps = published / seconds;
+    report.injectDrops = injectDrops;
+    report.rxQueueDrops = rxQueueDrops;
+    report.publishFailures = publishFailures;
+    report.injectHighWater = injectHighWater;
+    report.rxQueueHighWater = rxQueueHighWater;
+    report.latencyAvgUs = published ? latencySumUs / published : 0;
+    report.latencyMaxUs = latencyMaxUs;
+    report.joinedNodes = joined;
+    injected = processed = published = 0;
+    latencySumUs = 0;
+    latencyMaxUs = 0;
+    injectHighWater = rxQueueHighWater = 0;
+    LoadTestReport copy = report;
+    portEXIT_CRITICAL(&statsMux);
+
+    Serial.printf("LOADTEST: inj %.1f/s proc %.1f/s pub %.1f/s | drops inj %u rxq %u pub %u | "
+                  "hwm inj %u/%d rxq %u/%d | lat avg %.1f ms max %.1f ms | nodes %u/%d\n",
+                  copy.injectedPps, copy.processedPps, copy.publishedPps,
+                  copy.injectDrops, copy.rxQueueDrops, copy.publishFailures,
+                  copy.injectHighWater, LOAD_TEST_QUEUE_SIZE, copy.rxQueueHighWater, RX_QUEUE_SIZE,
+                  copy.latencyAvgUs / 1000.0f, copy.latencyMaxUs / 1000.0f, copy.joinedNodes, LOAD_TEST_VIRTUAL_NODES);
+}
+
+#endif
@@ -0,0 +1,216 @@
+#include "Log.h"
+
+#if LOG_DEFERRED
+
+Logger logger;
+
+#define LOG_BUFFER_MASK (LOG_BUFFER_SIZE - 1)
+#define LOG_ALIGN 8
+#define LOG_LINE_SIZE 256
+
+static_assert((LOG_BUFFER_SIZE & LOG_BUFFER_MASK) == 0, "LOG_BUFFER_SIZE doit être une puissance de 2");
+static_assert(LOG_MAX_STRING <= 255, "LOG_MAX_STRING dépasse la longueur codable sur un octet");
+
+// États d'une entrée. Le tampon consommé est remis à zéro : une entrée réservée mais pas encore
+// écrite reste LOG_SLOT_FREE, et la tâche de sortie l'attend.
+enum : uint8_t {
+    LOG_SLOT_FREE = 0,
+    LOG_SLOT_READY,
+    LOG_SLOT_PADDING,   // Fin du tampon sautée pour garder une entrée d'un seul tenant
+};
+
+// Entrée la plus longue acceptée : au-delà, une seule ligne occuperait une bonne partie du tampon
+#define LOG_MAX_RECORD (LOG_BUFFER_SIZE / 4)
+
+static inline uint32_t alignSize(size_t size) {
+    return (size + LOG_ALIGN - 1) & ~(uint32_t)(LOG_ALIGN - 1);
+}
+
+bool Logger::begin() {
+    return xTaskCreatePinnedToCore(task, "Log", LOG_TASK_STACK_SIZE, this, 1, NULL, 0) == pdPASS;
+}
+
+// Plusieurs écrivains (toutes les tâches) : la place est réservée par compare-and-swap sur l'index
+// d'écriture, puis remplie sans verrou. Jamais d'attente : faute de place, la ligne est perdue.
+LogRecord* Logger::reserve(uint8_t level, uint8_t module, const char* format, uint8_t argCount, size_t argBytes) {
+    uint32_t size = alignSize(sizeof(LogRecord) + argBytes);
+    if (size > LOG_MAX_RECORD) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    uint32_t write = writeIndex.load(std::memory_order_relaxed);
+    uint32_t offset, padding;
+    for (;;) {
+        uint32_t read = readIndex.load(std::memory_order_acquire);
+        offset = write & LOG_BUFFER_MASK;
+        padding = LOG_BUFFER_SIZE - offset < size ? LOG_BUFFER_SIZE - offset : 0;
+        if (write + padding + size - read > LOG_BUFFER_SIZE) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        if (writeIndex.compare_exchange_weak(write, write + padding + size, std::memory_order_relaxed)) break;
+    }
+
+    if (padding) {
+        // Seuls les 8 premiers octets de l'en-tête sont écrits : le reste peut dépasser du tampon
+        LogRecord* pad = (LogRecord*)(buffer + offset);
+        pad->size = padding;
+        __atomic_store_n(&pad->state, LOG_SLOT_PADDING, __ATOMIC_RELEASE);
+        offset = 0;
+    }
+
+    LogRecord* record = (LogRecord*)(buffer + offset);
+    record->level = level;
+    record->module = module;
+    record->argCount = argCount;
+    record->size = size;
+    record->argBytes = argBytes;
+    record->timestampMs = millis();
+    record->format = format;
+    return record;
+}
+
+void Logger::commit(LogRecord* record) {
+    __atomic_store_n(&record->state, LOG_SLOT_READY, __ATOMIC_RELEASE);
+}
+
+void Logger::task(void* params) {
+    static_cast<Logger*>(params)->run();
+}
+
+void Logger::run() {
+    for (;;) {
+        while (drainOne()) {}
+
+        uint32_t lost = dropped.load(std::memory_order_relaxed);
+        if (lost != reportedDropped) {
+            Serial.printf("LOG: %u line(s) dropped (buffer full)\n", lost - reportedDropped);
+            reportedDropped = lost;
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+    }
+}
+
+// Un seul lecteur : l'entrée est écrite sur le port série, remise à zéro, puis rendue aux écrivains
+bool Logger::drainOne() {
+    uint32_t read = readIndex.load(std::memory_order_relaxed);
+    if (read == writeIndex.load(std::memory_order_acquire)) return false;
+
+    LogRecord* record = (LogRecord*)(buffer + (read & LOG_BUFFER_MASK));
+    uint8_t state = __atomic_load_n(&record->state, __ATOMIC_ACQUIRE);
+    if (state == LOG_SLOT_FREE) return false; // Écrivain interrompu en cours de copie
+
+    uint32_t size = record->size;
+    if (state == LOG_SLOT_READY) output(record);
+    memset(record, 0, size);
+    readIndex.store(read + size, std::memory_order_release);
+    return true;
+}
+
+#if LOG_OUTPUT_BINARY
+
+// Trame : A5 5A, longueur (LE, octets suivants), horodatage, niveau, module, adresse du format,
+// nombre d'arguments, arguments tels qu'enregistrés. tools/log_decode.py retrouve le texte du
+// format dans l'ELF du firmware. Le texte hors trame (démarrage, rapports) passe tel quel.
+void Logger::output(const LogRecord* record) {
+    uint8_t header[15];
+    uint16_t length = sizeof(header) - 4 + record->argBytes;
+    uint32_t formatAddress = (uint32_t)(uintptr_t)record->format;
+    header[0] = 0xA5;
+    header[1] = 0x5A;
+    memcpy(header + 2, &length, 2);
+    memcpy(header + 4, &record->timestampMs, 4);
+    header[8] = record->level;
+    header[9] = record->module;
+    memcpy(header + 10, &formatAddress, 4);
+    header[14] = record->argCount;
+    Serial.write(header, sizeof(header));
+    Serial.write((const uint8_t*)(record + 1), record->argBytes);
+}
+
+#else
+
+// Met en forme une conversion printf avec l'argument enregistré. Les modificateurs de longueur du
+// format sont remplacés d'après le type réellement enregistré.
+static int formatArgument(char* out, size_t size, const char* spec, size_t specLength, char conversion,
+                          const uint8_t*& arg) {
+    char fmt[16];
+    if (specLength > sizeof(fmt) - 4) specLength = sizeof(fmt) - 4;
+    memcpy(fmt, spec, specLength);
+    char* end = fmt + specLength;
+
+    char tag = *arg++;
+    if (tag == LOG_ARG_STRING) {
+        char text[LOG_MAX_STRING + 1];
+        uint8_t length = *arg++;
+        memcpy(text, arg, length);
+        text[length] = '\0';
+        arg += length;
+        *end++ = 's';
+        *end = '\0';
+        return snprintf(out, size, fmt, text);
+    }
+    if (tag == LOG_ARG_DOUBLE) {
+        double value;
+        memcpy(&value, arg, 8);
+        arg += 8;
+        *end++ = strchr("eEfFgGaA", conversion) ? conversion : 'f';
+        *end = '\0';
+        return snprintf(out, size, fmt, value);
+    }
+    if (tag == LOG_ARG_INT64 || tag == LOG_ARG_UINT64) {
+        uint64_t value;
+        memcpy(&value, arg, 8);
+        arg += 8;
+        *end++ = 'l';
+        *end++ = 'l';
+        *end++ = strchr("diuxXoc", conversion) ? conversion : 'd';
+        *end = '\0';
+        return tag == LOG_ARG_INT64 ? snprintf(out, size, fmt, (long long)value)
+                                    : snprintf(out, size, fmt, (unsigned long long)value);
+    }
+    uint32_t value;
+    memcpy(&value, arg, 4);
+    arg += 4;
+    *end++ = strchr("diuxXoc", conversion) ? conversion : (tag == LOG_ARG_INT32 ? 'd' : 'u');
+    *end = '\0';
+    return tag == LOG_ARG_INT32 ? snprintf(out, size, fmt, (int)value) : snprintf(out, size, fmt, (unsigned)value);
+}
+
+void Logger::output(const LogRecord* record) {
+    char line[LOG_LINE_SIZE];
+    size_t length = snprintf(line, sizeof(line), "[%lu] ", (unsigned long)record->timestampMs);
+    const uint8_t* arg = (const uint8_t*)(record + 1);
+    uint8_t remaining = record->argCount;
+
+    for (const char* p = record->format; *p && length < sizeof(line) - 1; p++) {
+        if (*p != '%') {
+            line[length++] = *p;
+            continue;
+        }
+        if (p[1] == '%') {
+            line[length++] = '%';
+            p++;
+            continue;
+        }
+        const char* spec = p;
+        p++;
+        while (*p && strchr("-+ #0123456789.", *p)) p++;
+        size_t specLength = p - spec;
+        while (*p && strchr("hlLqjzt", *p)) p++;
+        if (!*p) break;
+        if (remaining == 0) continue; // Format et arguments désaccordés : vérifiés à la compilation
+        remaining--;
+        int written = formatArgument(line + length, sizeof(line) - length, spec, specLength, *p, arg);
+        if (written > 0) length += written;
+        if (length > sizeof(line) - 1) length = sizeof(line) - 1;
+    }
+
+    line[length++] = '\n';
+    Serial.write(line, length);
+}
+
+#endif
+
+#endif
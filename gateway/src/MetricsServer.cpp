@@ -0,0 +1,118 @@
+#include "MetricsServer.h"
+#include "config.h"
+#include "GatewayMetrics.h"
+#include "Log.h"
+#include "FrameCapture.h"
+#include <ESPAsyncWebServer.h>
+
+static AsyncWebServer metricsServer(METRICS_HTTP_PORT);
+
+static void printHeader(AsyncResponseStream* out, const char* name, const char* type, const char* help) {
+    out->printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// Dixièmes de dB vers une valeur décimale, sans passer par les flottants
+static void printTenths(AsyncResponseStream* out, const char* name, uint8_t nodeId, const char* stat, int32_t tenths) {
+    out->printf("%s{node=\"%u\",stat=\"%s\"} %s%ld.%ld\n", name, nodeId, stat,
+                tenths < 0 ? "-" : "", (long)(abs(tenths) / 10), (long)(abs(tenths) % 10));
+}
+
+static void handleMetrics(AsyncWebServerRequest* request) {
+    AsyncResponseStream* out = request->beginResponseStream("text/plain; version=0.0.4");
+
+    printHeader(out, "lora_gateway_uptime_seconds", "gauge", "Time since the gateway booted.");
+    out->printf("lora_gateway_uptime_seconds %lu\n", millis() / 1000);
+#if LOG_DEFERRED
+    printHeader(out, "lora_gateway_log_dropped_total", "counter", "Serial log lines lost because the log buffer was full.");
+    out->printf("lora_gateway_log_dropped_total %u\n", logger.getDropped());
+#endif
+#if CAPTURE_MODE
+    printHeader(out, "lora_gateway_capture_dropped_total", "counter", "Capture records lost because the capture queue was full.");
+    out->printf("lora_gateway_capture_dropped_total %u\n", frameCapture.getDropped());
+#endif
+
+    printHeader(out, "lora_uplinks_total", "counter", "Uplink frames decrypted and verified, by message type.");
+    for (int i = 0; i < UPLINK_TYPE_COUNT; i++) {
+        UplinkType type = (UplinkType)i;
+        out->printf("lora_uplinks_total{type=\"%s\"} %u\n", GatewayMetrics::uplinkTypeName(type), gatewayMetrics.getUplinks(type));
+    }
+
+    printHeader(out, "lora_rx_rejected_total", "counter", "Uplink frames dropped, by reason.");
+    for (int i = 0; i < REJECT_COUNT; i++) {
+        RxReject reason = (RxReject)i;
+        out->printf("lora_rx_rejected_total{reason=\"%s\"} %u\n", GatewayMetrics::rejectName(reason), gatewayMetrics.getRejects(reason));
+    }
+
+    printHeader(out, "lora_telemetry_forwarded_total", "counter", "Telemetry messages handed to the MQTT task.");
+    out->printf("lora_telemetry_forwarded_total %u\n", gatewayMetrics.getForwarded());
+
+    printHeader(out, "lora_tx_frames_total", "counter", "Downlink frames, by kind and radio outcome.");
+    for (int i = 0; i < TX_KIND_COUNT; i++) {
+        TxKind kind = (TxKind)i;
+        const char* name = GatewayMetrics::txKindName(kind);
+        out->printf("lora_tx_frames_total{kind=\"%s\",result=\"ok\"} %u\n", name, gatewayMetrics.getTxOk(kind));
+        out->printf("lora_tx_frames_total{kind=\"%s\",result=\"failed\"} %u\n", name, gatewayMetrics.getTxFailed(kind));
+    }
+
+    printHeader(out, "lora_tx_airtime_seconds_total", "counter", "Time on air of transmitted frames.");
+    uint32_t txMs = gatewayMetrics.getTxAirtimeMs();
+    out->printf("lora_tx_airtime_seconds_total %u.%03u\n", txMs / 1000, txMs % 1000);
+    printHeader(out, "lora_rx_airtime_seconds_total", "counter", "Time on air of received frames.");
+    uint32_t rxMs = gatewayMetrics.getRxAirtimeMs();
+    out->printf("lora_rx_airtime_seconds_total %u.%03u\n", rxMs / 1000, rxMs % 1000);
+
+    printHeader(out, "lora_commands_acked_total", "counter", "Confirmed commands acknowledged by their node.");
+    out->printf("lora_commands_acked_total %u\n", gatewayMetrics.getCommandsAcked());
+    printHeader(out, "lora_command_ack_retries_total", "counter", "Confirmed commands retransmitted after an ACK timeout.");
+    out->printf("lora_command_ack_retries_total %u\n", gatewayMetrics.getAckRetries());
+    printHeader(out, "lora_command_ack_timeouts_total", "counter", "Confirmed commands abandoned after the last retry.");
+    out->printf("lora_command_ack_timeouts_total %u\n", gatewayMetrics.getAckTimeouts());
+
+    printHeader(out, "lora_node_packets_total", "counter", "Telemetry messages accepted from each node.");
+    for (uint8_t nodeId = 1; nodeId <= MAX_DEVICES; nodeId++) {
+        NodeSignalSnapshot signal;
+        if (gatewayMetrics.getSignal(nodeId, signal)) {
+            out->printf("lora_node_packets_total{node=\"%u\"} %u\n", nodeId, signal.packets);
+        }
+    }
+    printHeader(out, "lora_node_rssi_dbm", "gauge", "RSSI of each node's telemetry: last, min and max since boot, moving average.");
+    for (uint8_t nodeId = 1; nodeId <= MAX_DEVICES; nodeId++) {
+        NodeSignalSnapshot signal;
+        if (!gatewayMetrics.getSignal(nodeId, signal)) continue;
+        printTenths(out, "lora_node_rssi_dbm", nodeId, "last", signal.rssiLast);
+        printTenths(out, "lora_node_rssi_dbm", nodeId, "min", signal.rssiMin);
+        printTenths(out, "lora_node_rssi_dbm", nodeId, "max", signal.rssiMax);
+        printTenths(out, "lora_node_rssi_dbm", nodeId, "avg", signal.rssiAvg);
+    }
+    printHeader(out, "lora_node_snr_db", "gauge", "SNR of each node's telemetry: last, min and max since boot, moving average.");
+    for (uint8_t nodeId = 1; nodeId <= MAX_DEVICES; nodeId++) {
+        NodeSignalSnapshot signal;
+        if (!gatewayMetrics.getSignal(nodeId, signal)) continue;
+        printTenths(out, "lora_node_snr_db", nodeId, "last", signal.snrLast);
+        printTenths(out, "lora_node_snr_db", nodeId, "min", signal.snrMin);
+        printTenths(out, "lora_node_snr_db", nodeId, "max", signal.snrMax);
+        printTenths(out, "lora_node_snr_db", nodeId, "avg", signal.snrAvg);
+    }
+
+    request->send(out);
+}
+
+#if CAPTURE_MODE == CAPTURE_FLASH
+// Anneau de capture brut ; tools/capture.py extract en refait un fichier .lcap
+static void handleCapture(AsyncWebServerRequest* request) {
+    AsyncWebServerResponse* response = request->beginResponse("application/octet-stream", frameCapture.getFlashSize(),
+        [](uint8_t* buffer, size_t maxLen, size_t index) -> size_t {
+            return frameCapture.readFlash(index, buffer, maxLen);
+        });
+    response->addHeader("Content-Disposition", "attachment; filename=\"capture.bin\"");
+    request->send(response);
+}
+#endif
+
+void startMetricsServer() {
+    metricsServer.on("/metrics", HTTP_GET, handleMetrics);
+#if CAPTURE_MODE == CAPTURE_FLASH
+    metricsServer.on("/capture", HTTP_GET, handleCapture);
+#endif
+    metricsServer.begin();
+}
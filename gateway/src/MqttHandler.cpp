@@ -3,7 +3,14 @@
 #include "types.h"
 #include "DeviceManager.h"
 #include "LoRaHandler.h" // Pour les fonctions de chiffrement
+#include "FuotaServer.h"
 #include "helpers.h"
+#include "LoadGenerator.h"
+#include "LatencyStats.h"
+#include "RuntimeProfiler.h"
+#include "Log.h"
+#include "FrameCapture.h"
+#include "RulesEngine.h"
 #include <WiFi.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
@@ -14,52 +21,270 @@ extern PubSubClient mqttClient;
 extern QueueHandle_t loraTxQueue;
 extern QueueHandle_t loraRxQueue;
 extern QueueHandle_t systemQueue;
+extern QueueHandle_t rpcResultQueue;
+extern QueueHandle_t bulkTxQueue;
 extern SystemStatus systemStatus;
 
 void mqttCallback(char* topic, byte* payload, unsigned int length);
 
+static const char* rpcFailureToString(RpcFailure status) {
+    switch (status) {
+        case RPC_ERR_UNKNOWN_DEVICE: return "unknown_device";
+        case RPC_ERR_QUEUE_FULL: return "queue_full";
+        case RPC_ERR_ENCODING: return "encoding_failed";
+        case RPC_ERR_TX_FAILED: return "tx_failed";
+        case RPC_ERR_ACK_TIMEOUT: return "ack_timeout";
+        case RPC_ERR_BUSY: return "busy";
+        case RPC_ERR_UPDATE_FAILED: return "update_failed";
+        case RPC_ERR_REFUSED: return "refused";
+        default: return "ok";
+    }
+}
+
+// Réponse RPC via l'API Gateway : {"device":"...","id":1,"data":{...}}
+static void publishRpcResult(const char* deviceName, const RpcResult& result) {
+    char payloadBuffer[192];
+    if (result.status == RPC_OK) {
+        snprintf(payloadBuffer, sizeof(payloadBuffer),
+            "{\"device\":\"%s\",\"id\":%ld,\"data\":{\"success\":true,\"latencyMs\":%u,\"rttMs\":%u,\"retries\":%u}}",
+            deviceName, (long)result.rpcId, result.latencyMs, result.rttMs, result.retries);
+    } else if (result.status == RPC_ERR_REFUSED) {
+        snprintf(payloadBuffer, sizeof(payloadBuffer),
+            "{\"device\":\"%s\",\"id\":%ld,\"data\":{\"success\":false,\"error\":\"%s\",\"reason\":\"%s\",\"latencyMs\":%u,\"retries\":%u}}",
+            deviceName, (long)result.rpcId, rpcFailureToString(result.status), result.reason, result.latencyMs, result.retries);
+    } else {
+        snprintf(payloadBuffer, sizeof(payloadBuffer),
+            "{\"device\":\"%s\",\"id\":%ld,\"data\":{\"success\":false,\"error\":\"%s\",\"latencyMs\":%u,\"retries\":%u}}",
+            deviceName, (long)result.rpcId, rpcFailureToString(result.status), result.latencyMs, result.retries);
+    }
+    if (!mqttClient.publish(TB_RPC_TOPIC, payloadBuffer)) {
+        LOGW(LOG_MOD_MQTT, "MQTT RPC response publish failed!");
+    }
+}
+
+// Lot d'échantillons : une entrée par échantillon, datée par l'horloge du module. La qualité du
+// lien est celle de la trame : elle est datée de l'interruption radio, comme une télémétrie simple.
+static size_t formatBatch(const char* deviceName, JsonObject data, const LoRaMessage& rxMsg, char* mqttPayload, size_t size) {
+    JsonDocument out;
+    JsonArray entries = out[deviceName].to<JsonArray>();
+    uint64_t base = data[LORA_KEY_BATCH_BASE].as<uint32_t>();
+    for (JsonArrayConst sample : data[LORA_KEY_BATCH].as<JsonArrayConst>()) {
+        JsonObject entry = entries.add<JsonObject>();
+        entry["ts"] = (base + sample[0].as<uint32_t>()) * 1000;
+        entry["values"] = sample[1];
+    }
+
+    JsonObject link = entries.add<JsonObject>();
+    uint64_t epochMs;
+    if (epochMillisAt(rxMsg.timestamps.irqAt, epochMs)) {
+        link["ts"] = epochMs;
+        link = link["values"].to<JsonObject>();
+    }
+    link["rssi"] = data["rssi"];
+    link["snr"] = data["snr"];
+
+    if (measureJson(out) >= size) {
+        LOGW(LOG_MOD_MQTT, "MQTT: batch from Node %d too large, truncated", rxMsg.nodeId);
+    }
+    return serializeJson(out, mqttPayload, size);
+}
+
+// Relevé rejoué (HIST) : daté de sa première émission, "age" secondes avant la réception, tandis
+// que le signal est celui de la trame de rattrapage. Sans heure NTP, il ne peut être daté : écarté.
+static size_t formatHistory(const char* deviceName, JsonObject data, uint32_t ageS, const LoRaMessage& rxMsg, char* mqttPayload, size_t size) {
+    uint64_t epochMs;
+    if (!epochMillisAt(rxMsg.timestamps.irqAt, epochMs)) {
+        LOGW(LOG_MOD_MQTT, "MQTT: replayed sample from Node %d dropped, no NTP time", rxMsg.nodeId);
+        return 0;
+    }
+
+    JsonDocument out;
+    JsonArray entries = out[deviceName].to<JsonArray>();
+    JsonObject link = entries.add<JsonObject>();
+    link["ts"] = epochMs;
+    JsonObject linkValues = link["values"].to<JsonObject>();
+    linkValues["rssi"] = data["rssi"];
+    linkValues["snr"] = data["snr"];
+    data.remove("rssi");
+    data.remove("snr");
+
+    JsonObject sample = entries.add<JsonObject>();
+    sample["ts"] = epochMs - (uint64_t)ageS * 1000;
+    sample["values"] = data;
+    return serializeJson(out, mqttPayload, size);
+}
+
+// Télémétrie ThingsBoard datée de l'interruption radio ; sans heure NTP, "ts" est omis.
+// Retourne 0 s'il n'y a rien à publier.
+static size_t formatTelemetry(const LoRaMessage& rxMsg, char* mqttPayload, size_t size) {
+    JsonDocument telemetryDoc;
+    deserializeJson(telemetryDoc, rxMsg.payload);
+
+    const char* deviceName = deviceManager.getDeviceName(rxMsg.nodeId);
+    JsonObject data = telemetryDoc[LORA_KEY_DATA];
+    if (data[LORA_KEY_BATCH].is<JsonArray>()) {
+        return formatBatch(deviceName, data, rxMsg, mqttPayload, size); // Lot rejoué compris : il est daté par le module
+    }
+    if (strcmp(telemetryDoc[LORA_KEY_TYPE] | "", LORA_MSG_TYPE_HISTORY) == 0) {
+        return formatHistory(deviceName, data, telemetryDoc[LORA_KEY_AGE] | 0u, rxMsg, mqttPayload, size);
+    }
+    String dataStr;
+    serializeJson(data, dataStr);
+
+    uint64_t epochMs;
+    if (epochMillisAt(rxMsg.timestamps.irqAt, epochMs)) {
+        return snprintf(mqttPayload, size, "{\"%s\":[{\"ts\":%llu, \"values\":%s}]}",
+            deviceName, (unsigned long long)epochMs, dataStr.c_str());
+    }
+    return snprintf(mqttPayload, size, "{\"%s\":[%s]}", deviceName, dataStr.c_str());
+}
+
+static void publishGatewayTelemetry(JsonDocument& doc) {
+    static char payloadBuffer[MQTT_BUFFER_SIZE - 64]; // Trop volumineux pour la pile de la tâche MQTT
+    serializeJson(doc, payloadBuffer, sizeof(payloadBuffer));
+    if (!mqttClient.publish(TB_GATEWAY_TELEMETRY_TOPIC, payloadBuffer)) {
+        LOGW(LOG_MOD_MQTT, "MQTT gateway telemetry publish failed!");
+    }
+}
+
+// Résumé de la fenêtre close : une ligne série, et la télémétrie de la passerelle si connectée
+static void publishLatencyReport() {
+    LatencyReport report = latencyStats.getReport();
+    const LatencySummary& total = report.stages[STAGE_TOTAL];
+    Serial.printf("LATENCY window=%ums n=%u publish_failed=%u", report.windowMs, total.count, report.publishFailures);
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const LatencySummary& stage = report.stages[i];
+        Serial.printf(" %s=%u/%u/%u/%u", LatencyStats::stageName((LatencyStage)i),
+                      stage.p50Us, stage.p90Us, stage.p99Us, stage.maxUs);
+    }
+    Serial.println(" (p50/p90/p99/max us)");
+
+    if (!mqttClient.connected()) return;
+    JsonDocument doc;
+    doc["lat_count"] = total.count;
+    doc["lat_publish_failed"] = report.publishFailures;
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        const LatencySummary& stage = report.stages[i];
+        const char* name = LatencyStats::stageName((LatencyStage)i);
+        char key[32];
+        snprintf(key, sizeof(key), "lat_%s_p50_us", name);
+        doc[key] = stage.p50Us;
+        snprintf(key, sizeof(key), "lat_%s_p90_us", name);
+        doc[key] = stage.p90Us;
+        snprintf(key, sizeof(key), "lat_%s_p99_us", name);
+        doc[key] = stage.p99Us;
+        snprintf(key, sizeof(key), "lat_%s_max_us", name);
+        doc[key] = stage.maxUs;
+    }
+    publishGatewayTelemetry(doc);
+}
+
+// Clé de télémétrie "<prefix>_<nom en minuscules>_<suffix>"
+static const char* profileKey(char* key, size_t size, const char* prefix, const char* name, const char* suffix) {
+    snprintf(key, size, "%s_%s_%s", prefix, name, suffix);
+    for (char* c = key; *c; c++) *c = tolower(*c);
+    return key;
+}
+
+// Relevé du profileur : lignes série, puis deux messages (tâches ; files et tas) pour rester sous
+// MQTT_BUFFER_SIZE
+static void publishProfilerReport(const ProfilerReport& report) {
+    Serial.printf("PROFILE window=%ums heap_free=%u heap_min=%u heap_block=%u", report.windowMs,
+                  report.heapFree, report.heapMinFree, report.heapLargestBlock);
+    if (report.cpuAvailable) Serial.printf(" idle=%.1f%%", report.idlePercent);
+    Serial.println();
+    for (uint8_t i = 0; i < report.taskCount; i++) {
+        const TaskProfile& task = report.tasks[i];
+        if (!task.running) continue;
+        Serial.printf("PROFILE task=%s stack_free=%u/%u", task.name, task.stackFreeMin, task.stackSize);
+        if (report.cpuAvailable) Serial.printf(" cpu=%.1f%%", task.cpuPercent);
+        Serial.println();
+    }
+    for (uint8_t i = 0; i < report.queueCount; i++) {
+        const QueueProfile& queue = report.queues[i];
+        Serial.printf("PROFILE queue=%s depth=%u peak=%u/%u\n", queue.name, queue.depth, queue.peak, queue.size);
+    }
+
+    if (!mqttClient.connected()) return;
+    char key[40];
+    JsonDocument doc;
+    for (uint8_t i = 0; i < report.taskCount; i++) {
+        const TaskProfile& task = report.tasks[i];
+        if (!task.running) continue;
+        doc[profileKey(key, sizeof(key), "task", task.name, "stack_free")] = task.stackFreeMin;
+        if (report.cpuAvailable) {
+            doc[profileKey(key, sizeof(key), "task", task.name, "cpu_pct")] = serialized(String(task.cpuPercent, 1));
+        }
+    }
+    publishGatewayTelemetry(doc);
+
+    doc.clear();
+    for (uint8_t i = 0; i < report.queueCount; i++) {
+        const QueueProfile& queue = report.queues[i];
+        doc[profileKey(key, sizeof(key), "queue", queue.name, "depth")] = queue.depth;
+        doc[profileKey(key, sizeof(key), "queue", queue.name, "peak")] = queue.peak;
+    }
+    doc["heap_free"] = report.heapFree;
+    doc["heap_min_free"] = report.heapMinFree;
+    doc["heap_largest_block"] = report.heapLargestBlock;
+    if (report.cpuAvailable) doc["cpu_idle_pct"] = serialized(String(report.idlePercent, 1));
+    publishGatewayTelemetry(doc);
+}
+
 void connectWiFi() {
     if (WiFi.status() == WL_CONNECTED) return;
     systemStatus.wifi = WIFI_CONNECTING;
-    Serial.println("Connecting to WiFi...");
+    LOGI(LOG_MOD_MQTT, "Connecting to WiFi...");
     WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
 }
 
 void connectMqtt() {
     if (mqttClient.connected()) return;
     systemStatus.mqtt = GW_MQTT_CONNECTING;
-    Serial.println("Connecting to MQTT broker...");
+    LOGI(LOG_MOD_MQTT, "Connecting to MQTT broker...");
 
     if (mqttClient.connect("Gateway_HeltecV3", TB_GATEWAY_TOKEN, NULL)) {
         systemStatus.mqtt = GW_MQTT_CONNECTED;
-        Serial.println("MQTT Connected.");
+        LOGI(LOG_MOD_MQTT, "MQTT Connected.");
         mqttClient.subscribe(TB_RPC_TOPIC);
+        mqttClient.subscribe(TB_ATTRIBUTES_TOPIC);
+        mqttClient.subscribe(TB_ATTRIBUTES_RESPONSE_TOPIC);
+        mqttClient.subscribe(TB_GATEWAY_ATTRIBUTES_TOPIC);
+        mqttClient.subscribe(TB_GATEWAY_ATTRIBUTES_RESPONSE_PREFIX "+");
+        // Règles locales : celles de la NVS restent en vigueur jusqu'à la réponse
+        mqttClient.publish(TB_GATEWAY_ATTRIBUTES_REQUEST_TOPIC, "{\"sharedKeys\":\"" TB_ATTR_EDGE_RULES "\"}");
 
         JsonDocument doc;
         JsonArray devices = doc.to<JsonArray>();
         deviceManager.getAllActiveDeviceNames(devices);
+        uint16_t requestId = 0;
         for(JsonVariant deviceName : devices) {
-            char payloadBuffer[64];
+            char payloadBuffer[128];
             snprintf(payloadBuffer, sizeof(payloadBuffer), "{\"device\":\"%s\"}", deviceName.as<const char*>());
             mqttClient.publish(TB_CONNECT_TOPIC, payloadBuffer);
+            // Les attributs ont pu changer pendant que la passerelle était déconnectée
+            snprintf(payloadBuffer, sizeof(payloadBuffer), "{\"id\":%u,\"device\":\"%s\",\"client\":false,\"key\":\"%s\"}",
+                     ++requestId, deviceName.as<const char*>(), TB_ATTR_MIN_REPORT_INTERVAL);
+            mqttClient.publish(TB_ATTRIBUTES_REQUEST_TOPIC, payloadBuffer);
             vTaskDelay(pdMS_TO_TICKS(50));
         }
     } else {
         systemStatus.mqtt = GW_MQTT_DISCONNECTED;
-        Serial.printf("MQTT connection failed, rc=%d\n", mqttClient.state());
+        LOGW(LOG_MOD_MQTT, "MQTT connection failed, rc=%d", mqttClient.state());
     }
 }
 
 void taskMqttHandler(void *pvParameters) {
     esp_task_wdt_add(NULL);
-    Serial.println("MQTT Task started");
+    LOGI(LOG_MOD_MQTT, "MQTT Task started");
     mqttClient.setServer(TB_SERVER, TB_PORT);
     mqttClient.setCallback(mqttCallback);
+    mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
 
-    StaticJsonDocument<256> telemetryDoc;
-    char mqttPayload[384];
+    char mqttPayload[640];
     unsigned long lastWifiAttempt = 0;
     unsigned long lastMqttAttempt = 0;
+    bool clockRequested = false;
 
     for (;;) {
         esp_task_wdt_reset();
@@ -74,6 +299,11 @@ void taskMqttHandler(void *pvParameters) {
             continue;
         }
         systemStatus.wifi = WIFI_CONNECTED;
+        if (!clockRequested) {
+            // Synchronisation SNTP en arrière-plan, renouvelée périodiquement par l'IDF
+            configTime(0, 0, NTP_SERVER);
+            clockRequested = true;
+        }
 
         if (!mqttClient.connected()) {
             if (millis() - lastMqttAttempt > MQTT_RECONNECT_INTERVAL_MS) {
@@ -94,71 +324,158 @@ void taskMqttHandler(void *pvParameters) {
             }
         }
 
+        RpcResult rpcResult;
+        if (xQueueReceive(rpcResultQueue, &rpcResult, 0) == pdPASS) {
+            publishRpcResult(deviceManager.getDeviceName(rpcResult.nodeId), rpcResult);
+        }
+
         LoRaMessage rxMsg;
         if (xQueueReceive(loraRxQueue, &rxMsg, 0) == pdPASS) {
-            StaticJsonDocument<256> telemetryDoc;
-            deserializeJson(telemetryDoc, rxMsg.payload);
-
-            const char* deviceName = deviceManager.getDeviceName(rxMsg.nodeId);
-            JsonObject data = telemetryDoc[LORA_KEY_DATA];
-            String dataStr;
-            serializeJson(data, dataStr);
+            rxMsg.timestamps.dequeuedAt = micros();
+#if CAPTURE_MODE
+            frameCapture.onTelemetry(rxMsg);
+#endif
+            if (formatTelemetry(rxMsg, mqttPayload, sizeof(mqttPayload)) > 0) {
+                bool published = mqttClient.publish(TB_TELEMETRY_TOPIC, mqttPayload);
+                rxMsg.timestamps.publishedAt = micros();
+                if (!published) {
+                    latencyStats.onPublishFailed();
+                    LOGW(LOG_MOD_MQTT, "MQTT Publish failed!");
+                } else {
+                    latencyStats.record(rxMsg.timestamps);
+                    LOGD(LOG_MOD_MQTT, "MQTT TX: %s", mqttPayload);
+                }
+#if LOAD_TEST_ENABLED
+                loadGenerator.onPublished(rxMsg, published);
+#endif
+            }
+        }
 
-            snprintf(mqttPayload, sizeof(mqttPayload), "{\"%s\":[{\"ts\":%lu, \"values\":%s}]}",
-                deviceName, millis(), dataStr.c_str());
+        if (latencyStats.closeWindow()) {
+            publishLatencyReport();
+        }
 
-            if (!mqttClient.publish(TB_TELEMETRY_TOPIC, mqttPayload)) {
-                Serial.println("MQTT Publish failed!");
-            } else {
-                Serial.printf("MQTT TX: %s\n", mqttPayload);
-            }
+        ProfilerReport profilerReport;
+        if (runtimeProfiler.takeReport(profilerReport)) {
+            publishProfilerReport(profilerReport);
         }
         vTaskDelay(pdMS_TO_TICKS(20));
     }
 }
 
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-    static uint16_t msgIdCounter = 0;
-    Serial.printf("MQTT RX: [%s]\n", topic);
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, payload, length);
-    if (error) {
-        Serial.printf("MQTT RX: JSON parsing failed: %s\n", error.c_str());
+// Applique le plancher d'intervalle reçu de ThingsBoard (attribut partagé, en secondes).
+// Une valeur non numérique ou négative est ignorée ; au-delà de CC_MAX_INTERVAL_MS, elle est bornée.
+static void applyReportFloor(const char* deviceName, JsonVariantConst value) {
+    if (value.isNull()) return;
+    uint8_t nodeId = deviceManager.findNodeIdByName(deviceName);
+    if (nodeId == 0) return;
+    if (!value.is<float>() || value.as<float>() < 0) {
+        LOGW(LOG_MOD_MQTT, "MQTT RX: %s %s is negative or not a number, ignored", deviceName, TB_ATTR_MIN_REPORT_INTERVAL);
         return;
     }
+    float seconds = min(value.as<float>(), CC_MAX_INTERVAL_MS / 1000.0f);
+    uint32_t floorMs = (uint32_t)(seconds * 1000.0f);
+    deviceManager.setReportFloor(nodeId, floorMs);
+    LOGI(LOG_MOD_MQTT, "MQTT RX: %s report floor set to %u ms", deviceName, floorMs);
+}
+
+// Règles locales reçues de ThingsBoard ; leur nombre en vigueur, ou le rejet, remonte dans la
+// télémétrie de la passerelle
+static void applyEdgeRules(JsonVariantConst value) {
+    int count = rulesEngine.update(value);
+    JsonDocument doc;
+    if (count < 0) {
+        doc["rules_rejected"] = true;
+    } else {
+        doc["rules_count"] = count;
+    }
+    publishGatewayTelemetry(doc);
+}
 
-    const char* deviceName = doc["device"]; 
+// RPC "fuota_start" : {"url":"http://...","sha256":"<hex>","group":["Wellguard-2",...]}
+// Le module destinataire du RPC est toujours inclus ; la réponse arrive en fin de session.
+static RpcFailure startFirmwareUpdate(uint8_t requesterId, int32_t rpcId, JsonVariantConst params) {
+    uint8_t nodeIds[MAX_DEVICES];
+    uint8_t count = 0;
+    nodeIds[count++] = requesterId;
+    for (JsonVariantConst name : params["group"].as<JsonArrayConst>()) {
+        uint8_t nodeId = deviceManager.findNodeIdByName(name | "");
+        if (nodeId == 0) return RPC_ERR_UNKNOWN_DEVICE;
+        if (count < MAX_DEVICES) nodeIds[count++] = nodeId;
+    }
+    return fuotaServer.start(params["url"] | "", params["sha256"] | "", nodeIds, count, requesterId, rpcId);
+}
+
+static void handleRpc(JsonDocument& doc) {
+    const char* deviceName = doc["device"];
     JsonObject data = doc["data"];
     if (!deviceName || data.isNull()) return;
 
     uint8_t targetNodeId = deviceManager.findNodeIdByName(deviceName);
+    int32_t rpcId = data["id"] | -1;
+    RpcResult failure = { targetNodeId, rpcId, RPC_OK, 0, 0, 0 };
 
-    if (targetNodeId > 0) {
+    if (targetNodeId > 0 && strcmp(data[LORA_KEY_METHOD] | "", LORA_METHOD_FUOTA_START) == 0) {
+        failure.status = startFirmwareUpdate(targetNodeId, rpcId, data[LORA_KEY_PARAMS]);
+    } else if (targetNodeId > 0) {
         LoRaTxCommand cmd;
-        cmd.targetNodeId = targetNodeId;
-        cmd.msgId = ++msgIdCounter;
-        cmd.requireAck = true;
-
-        JsonDocument plaintextDoc;
-        plaintextDoc[LORA_KEY_TYPE] = LORA_MSG_TYPE_CMD;
-        plaintextDoc[LORA_KEY_MSG_ID] = cmd.msgId;
-        plaintextDoc[LORA_KEY_METHOD] = data[LORA_KEY_METHOD];
-        plaintextDoc[LORA_KEY_PARAMS] = data[LORA_KEY_PARAMS];
-        String plaintextStr;
-        serializeJson(plaintextDoc, plaintextStr);
-
-        String encryptedPayload = encrypt_payload(plaintextStr);
-
-        JsonDocument loraDoc;
-        loraDoc[LORA_KEY_PAYLOAD] = encryptedPayload;
-        loraDoc[LORA_KEY_CRC] = calculateCRC32((const uint8_t*)plaintextStr.c_str(), plaintextStr.length());
-        
-        serializeJson(loraDoc, cmd.payload, sizeof(cmd.payload));
-
-        if (xQueueSend(loraTxQueue, &cmd, pdMS_TO_TICKS(10)) != pdPASS) {
-            Serial.println("LoRa TX Queue is full!");
+        static LoRaBulkCommand bulkCmd; // Trop volumineux pour la pile de la tâche MQTT
+        if (buildCommand(cmd, targetNodeId, data[LORA_KEY_METHOD], data[LORA_KEY_PARAMS], true)) {
+            cmd.rpcId = rpcId;
+            if (xQueueSend(loraTxQueue, &cmd, pdMS_TO_TICKS(10)) != pdPASS) {
+                LOGW(LOG_MOD_MQTT, "LoRa TX Queue is full!");
+                failure.status = RPC_ERR_QUEUE_FULL;
+            }
+        } else if (buildBulkCommand(bulkCmd, targetNodeId, data[LORA_KEY_METHOD], data[LORA_KEY_PARAMS])) {
+            // Commande plus longue qu'une trame : transfert fragmenté
+            bulkCmd.rpcId = rpcId;
+            if (xQueueSend(bulkTxQueue, &bulkCmd, pdMS_TO_TICKS(10)) != pdPASS) {
+                LOGW(LOG_MOD_MQTT, "LoRa bulk TX Queue is full!");
+                failure.status = RPC_ERR_QUEUE_FULL;
+            }
+        } else {
+            failure.status = RPC_ERR_ENCODING;
         }
     } else {
-        Serial.printf("MQTT RX: Command for unknown device '%s'\n", deviceName);
+        LOGW(LOG_MOD_MQTT, "MQTT RX: Command for unknown device '%s'", deviceName);
+        failure.status = RPC_ERR_UNKNOWN_DEVICE;
+    }
+
+    if (failure.status != RPC_OK && rpcId >= 0) {
+        publishRpcResult(deviceName, failure);
+    }
+}
+
+void mqttCallback(char* topic, byte* payload, unsigned int length) {
+    LOGD(LOG_MOD_MQTT, "MQTT RX: [%s]", topic);
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, payload, length);
+    if (error) {
+        LOGW(LOG_MOD_MQTT, "MQTT RX: JSON parsing failed: %s", error.c_str());
+        return;
+    }
+
+    if (strcmp(topic, TB_ATTRIBUTES_TOPIC) == 0) {
+        // Mise à jour d'attributs partagés : {"device":"...","data":{"minReportInterval":60}}
+        const char* deviceName = doc["device"];
+        if (deviceName) applyReportFloor(deviceName, doc["data"][TB_ATTR_MIN_REPORT_INTERVAL]);
+    } else if (strcmp(topic, TB_ATTRIBUTES_RESPONSE_TOPIC) == 0) {
+        // Réponse à une requête : {"id":1,"device":"...","value":60}
+        const char* deviceName = doc["device"];
+        if (deviceName) applyReportFloor(deviceName, doc["value"]);
+    } else if (strcmp(topic, TB_RPC_TOPIC) == 0) {
+        handleRpc(doc);
+    } else if (strcmp(topic, TB_GATEWAY_ATTRIBUTES_TOPIC) == 0) {
+        // Attributs partagés de la passerelle : {"edgeRules":[...]}, ou {"deleted":["edgeRules"]}
+        if (!doc[TB_ATTR_EDGE_RULES].isNull()) {
+            applyEdgeRules(doc[TB_ATTR_EDGE_RULES]);
+        } else {
+            for (JsonVariantConst key : doc["deleted"].as<JsonArrayConst>()) {
+                if (strcmp(key | "", TB_ATTR_EDGE_RULES) == 0) applyEdgeRules(JsonVariantConst());
+            }
+        }
+    } else if (strncmp(topic, TB_GATEWAY_ATTRIBUTES_RESPONSE_PREFIX, strlen(TB_GATEWAY_ATTRIBUTES_RESPONSE_PREFIX)) == 0) {
+        // Réponse à la requête de connexion : {"shared":{"edgeRules":[...]}} ; sans l'attribut, aucune règle
+        applyEdgeRules(doc["shared"][TB_ATTR_EDGE_RULES]);
     }
 }
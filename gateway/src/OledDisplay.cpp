@@ -2,6 +2,10 @@
 #include "config.h"
 #include "types.h"
 #include "DeviceManager.h"
+#include "CongestionController.h"
+#include "LoadGenerator.h"
+#include "LatencyStats.h"
+#include "Log.h"
 #include <Heltec.h>
 #include <WiFi.h>
 #include <esp_task_wdt.h>
@@ -13,13 +17,17 @@ extern SystemStatus systemStatus;
 enum DisplayPage {
     PAGE_HOME,
     PAGE_DEVICES,
-    PAGE_SYSTEM_STATS
+    PAGE_SYSTEM_STATS,
+#if LOAD_TEST_ENABLED
+    PAGE_LOAD_TEST,
+#endif
+    PAGE_COUNT
 };
 DisplayPage currentPage = PAGE_HOME;
 
 void taskOledDisplay(void *pvParameters) {
     esp_task_wdt_add(NULL);
-    Serial.println("OLED Task started");
+    LOGI(LOG_MOD_SYSTEM, "OLED Task started");
 
     pinMode(DIAG_BUTTON_PIN, INPUT_PULLUP);
     long lastButtonPress = 0;
@@ -30,7 +38,7 @@ void taskOledDisplay(void *pvParameters) {
         // Gestion du changement de page
         if (digitalRead(DIAG_BUTTON_PIN) == LOW && (millis() - lastButtonPress > 500)) {
             lastButtonPress = millis();
-            currentPage = (DisplayPage)(((int)currentPage + 1) % 3);
+            currentPage = (DisplayPage)(((int)currentPage + 1) % PAGE_COUNT);
         }
         
         systemStatus.onlineDevices = deviceManager.getOnlineDeviceCount();
@@ -90,14 +98,39 @@ void taskOledDisplay(void *pvParameters) {
             }
             case PAGE_SYSTEM_STATS: {
                 Heltec.display->drawString(0, 0, "==== STATS SYSTEME ====");
-                snprintf(buffer, sizeof(buffer), "Heap Libre: %u", esp_get_free_heap_size());
+                snprintf(buffer, sizeof(buffer), "Heap: %u Up: %lum", esp_get_free_heap_size(), millis() / 60000);
                 Heltec.display->drawString(0, 12, buffer);
-                snprintf(buffer, sizeof(buffer), "Uptime: %lum", millis() / 60000);
-                Heltec.display->drawString(0, 24, buffer);
                 snprintf(buffer, sizeof(buffer), "FW: %s", FIRMWARE_VERSION);
+                Heltec.display->drawString(0, 24, buffer);
+                // Interruption radio -> publication MQTT, sur la dernière fenêtre close
+                LatencySummary latency = latencyStats.getReport().stages[STAGE_TOTAL];
+                snprintf(buffer, sizeof(buffer), "Lat p50/p99: %.1f/%.1fms",
+                    latency.p50Us / 1000.0f, latency.p99Us / 1000.0f);
                 Heltec.display->drawString(0, 36, buffer);
+                snprintf(buffer, sizeof(buffer), "Canal: %.1f%% Pertes: %.0f%%",
+                    congestionController.getUtilization() * 100.0f, congestionController.getLossRatio() * 100.0f);
+                Heltec.display->drawString(0, 48, buffer);
+                break;
+            }
+#if LOAD_TEST_ENABLED
+            case PAGE_LOAD_TEST: {
+                LoadTestReport report = loadGenerator.getReport();
+                Heltec.display->drawString(0, 0, "==== TEST DE CHARGE ====");
+                snprintf(buffer, sizeof(buffer), "Inj %.0f Trt %.0f Pub %.0f /s",
+                    report.injectedPps, report.processedPps, report.publishedPps);
+                Heltec.display->drawString(0, 12, buffer);
+                snprintf(buffer, sizeof(buffer), "Pertes I:%u RX:%u M:%u",
+                    report.injectDrops, report.rxQueueDrops, report.publishFailures);
+                Heltec.display->drawString(0, 24, buffer);
+                snprintf(buffer, sizeof(buffer), "Files max I:%u/%d RX:%u/%d",
+                    report.injectHighWater, LOAD_TEST_QUEUE_SIZE, report.rxQueueHighWater, RX_QUEUE_SIZE);
+                Heltec.display->drawString(0, 36, buffer);
+                snprintf(buffer, sizeof(buffer), "Lat %.1f/%.1fms N:%u",
+                    report.latencyAvgUs / 1000.0f, report.latencyMaxUs / 1000.0f, report.joinedNodes);
+                Heltec.display->drawString(0, 48, buffer);
                 break;
             }
+#endif
         }
     Heltec.display->display();
         vTaskDelay(pdMS_TO_TICKS(200));
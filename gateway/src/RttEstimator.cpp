@@ -0,0 +1,39 @@
+#include "RttEstimator.h"
+
+RttEstimator::RttEstimator() {
+    for (int i = 0; i < MAX_DEVICES; i++) {
+        nodes[i] = { false, 0, 0 };
+    }
+}
+
+uint32_t RttEstimator::getTimeout(uint8_t nodeId, uint32_t seedRttMs) const {
+    uint32_t srtt = seedRttMs;
+    uint32_t rttvar = seedRttMs / 2;
+    if (nodeId >= 1 && nodeId <= MAX_DEVICES && nodes[nodeId - 1].valid) {
+        srtt = nodes[nodeId - 1].srttMs;
+        rttvar = nodes[nodeId - 1].rttvarMs;
+    }
+    uint32_t rto = srtt + 4 * rttvar;
+    if (rto < ACK_RTO_MIN_MS) rto = ACK_RTO_MIN_MS;
+    if (rto > ACK_RTO_MAX_MS) rto = ACK_RTO_MAX_MS;
+    return rto;
+}
+
+void RttEstimator::addSample(uint8_t nodeId, uint32_t rttMs) {
+    if (nodeId < 1 || nodeId > MAX_DEVICES) return;
+    State& state = nodes[nodeId - 1];
+    if (!state.valid) {
+        state.srttMs = rttMs;
+        state.rttvarMs = rttMs / 2;
+        state.valid = true;
+        return;
+    }
+    uint32_t delta = state.srttMs > rttMs ? state.srttMs - rttMs : rttMs - state.srttMs;
+    state.rttvarMs = (3 * state.rttvarMs + delta) / 4; // beta = 1/4
+    state.srttMs = (7 * state.srttMs + rttMs) / 8;     // alpha = 1/8
+}
+
+uint32_t RttEstimator::getSmoothedRtt(uint8_t nodeId) const {
+    if (nodeId < 1 || nodeId > MAX_DEVICES || !nodes[nodeId - 1].valid) return 0;
+    return nodes[nodeId - 1].srttMs;
+}
@@ -0,0 +1,193 @@
+#include "RulesEngine.h"
+#include "DeviceManager.h"
+#include "LoRaHandler.h"
+#include "Log.h"
+#include <Preferences.h>
+
+extern QueueHandle_t loraTxQueue;
+
+RulesEngine rulesEngine;
+
+RulesEngine::RulesEngine() {
+    mutex = xSemaphoreCreateMutex();
+    count = 0;
+    memset(rules, 0, sizeof(rules));
+    memset(matched, 0, sizeof(matched));
+}
+
+void RulesEngine::init() {
+    loadFromNVS();
+}
+
+static bool parseOp(const char* text, RuleOp& op) {
+    static const char* const names[] = { "==", "!=", "<", "<=", ">", ">=" };
+    for (uint8_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(text, names[i]) == 0) {
+            op = (RuleOp)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Chaîne non vide qui tient, zéro final compris, dans dest
+static bool copyString(char* dest, size_t size, JsonVariantConst value) {
+    const char* text = value.as<const char*>();
+    if (!text || text[0] == '\0' || strlen(text) >= size) return false;
+    strcpy(dest, text);
+    return true;
+}
+
+bool RulesEngine::compile(JsonObjectConst source, EdgeRule& rule) {
+    memset(&rule, 0, sizeof(rule)); // Octets de remplissage compris : les tables se comparent par memcmp
+    JsonVariantConst value = source["value"];
+    if (!value.is<float>() && !value.is<bool>()) return false;
+    rule.value = value.is<bool>() ? (value.as<bool>() ? 1.0f : 0.0f) : value.as<float>();
+
+    JsonVariantConst params = source["params"];
+    if (!params.isNull()) {
+        if (measureJson(params) >= sizeof(rule.params)) return false;
+        serializeJson(params, rule.params, sizeof(rule.params));
+    }
+    return copyString(rule.sourceType, sizeof(rule.sourceType), source["type"]) &&
+           copyString(rule.field, sizeof(rule.field), source["field"]) &&
+           parseOp(source["op"] | "", rule.op) &&
+           copyString(rule.target, sizeof(rule.target), source["target"]) &&
+           copyString(rule.method, sizeof(rule.method), source["method"]);
+}
+
+int RulesEngine::update(JsonVariantConst source) {
+    JsonArrayConst list = source.as<JsonArrayConst>();
+    if (!source.isNull() && list.isNull()) {
+        LOGW(LOG_MOD_RULES, "RULES: %s is not an array, rules unchanged", TB_ATTR_EDGE_RULES);
+        return -1;
+    }
+    if (list.size() > RULES_MAX) {
+        LOGW(LOG_MOD_RULES, "RULES: %u rules received, %d at most, rules unchanged", (uint32_t)list.size(), RULES_MAX);
+        return -1;
+    }
+
+    uint8_t stagedCount = 0;
+    for (JsonVariantConst entry : list) {
+        if (!compile(entry.as<JsonObjectConst>(), staged[stagedCount])) {
+            LOGW(LOG_MOD_RULES, "RULES: rule %u is invalid, rules unchanged", stagedCount);
+            return -1;
+        }
+        stagedCount++;
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    // Demandées à chaque connexion MQTT : la NVS n'est réécrite que si elles ont changé
+    bool changed = stagedCount != count || memcmp(staged, rules, stagedCount * sizeof(EdgeRule)) != 0;
+    if (changed) {
+        memcpy(rules, staged, stagedCount * sizeof(EdgeRule));
+        count = stagedCount;
+        memset(matched, 0, sizeof(matched));
+    }
+    xSemaphoreGive(mutex);
+    if (changed) {
+        saveToNVS(); // Hors du verrou : seule la tâche MQTT modifie la table
+        LOGI(LOG_MOD_RULES, "RULES: %u rules in force", stagedCount);
+    }
+    return stagedCount;
+}
+
+static bool test(RuleOp op, float value, float threshold) {
+    switch (op) {
+        case RULE_OP_EQ: return value == threshold;
+        case RULE_OP_NE: return value != threshold;
+        case RULE_OP_LT: return value < threshold;
+        case RULE_OP_LE: return value <= threshold;
+        case RULE_OP_GT: return value > threshold;
+        case RULE_OP_GE: return value >= threshold;
+    }
+    return false;
+}
+
+void RulesEngine::evaluate(uint8_t nodeId, JsonObjectConst data, uint32_t irqAt) {
+    if (nodeId < 1 || nodeId > MAX_DEVICES || count == 0) return;
+    const char* type = deviceManager.getDeviceType(nodeId);
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    JsonArrayConst batch = data[LORA_KEY_BATCH].as<JsonArrayConst>();
+    if (batch.isNull()) {
+        evaluateSample(nodeId, type, data, irqAt);
+    } else {
+        // Lot : les échantillons dans l'ordre, pour que chaque changement soit vu
+        for (JsonArrayConst sample : batch) {
+            evaluateSample(nodeId, type, sample[1].as<JsonObjectConst>(), irqAt);
+        }
+    }
+    xSemaphoreGive(mutex);
+}
+
+void RulesEngine::evaluateSample(uint8_t nodeId, const char* type, JsonObjectConst sample, uint32_t irqAt) {
+    for (uint8_t i = 0; i < count; i++) {
+        const EdgeRule& rule = rules[i];
+        if (strcmp(rule.sourceType, type) != 0) continue;
+        JsonVariantConst value = sample[rule.field];
+        if (!value.is<float>() && !value.is<bool>()) continue;
+
+        float reading = value.is<bool>() ? (value.as<bool>() ? 1.0f : 0.0f) : value.as<float>();
+        bool now = test(rule.op, reading, rule.value);
+        bool& was = matched[i][nodeId - 1];
+        if (now && !was) fire(rule, nodeId, irqAt);
+        was = now;
+    }
+}
+
+// Commande confirmée à chaque destinataire : la tâche LoRa la réémet tant que l'ACK manque
+void RulesEngine::fire(const EdgeRule& rule, uint8_t sourceId, uint32_t irqAt) {
+    uint8_t targets[MAX_DEVICES];
+    uint8_t targetCount = 0;
+    uint8_t named = deviceManager.findNodeIdByName(rule.target);
+    if (named != 0) {
+        targets[targetCount++] = named;
+    } else {
+        targetCount = deviceManager.findNodeIdsByType(rule.target, targets, MAX_DEVICES);
+    }
+    if (targetCount == 0) {
+        LOGW(LOG_MOD_RULES, "RULES: no device matches target %s", rule.target);
+        return;
+    }
+
+    JsonDocument paramsDoc;
+    if (rule.params[0] != '\0') deserializeJson(paramsDoc, rule.params);
+    for (uint8_t i = 0; i < targetCount; i++) {
+        LoRaTxCommand cmd;
+        if (!buildCommand(cmd, targets[i], rule.method, paramsDoc.as<JsonVariantConst>(), true)) continue;
+        if (xQueueSend(loraTxQueue, &cmd, 0) != pdPASS) {
+            LOGW(LOG_MOD_RULES, "RULES: TX queue full, %s for Node %d dropped", rule.method, targets[i]);
+            continue;
+        }
+        LOGI(LOG_MOD_RULES, "RULES: %s.%s on Node %d -> %s queued for Node %d, %u us after reception",
+                            rule.sourceType, rule.field, sourceId, rule.method, targets[i], (uint32_t)(micros() - irqAt));
+    }
+}
+
+// Table brute : une taille qui ne correspond pas (format modifié par une mise à jour) est ignorée
+void RulesEngine::loadFromNVS() {
+    Preferences prefs;
+    prefs.begin(RULES_NVS_NAMESPACE, true);
+    uint8_t stored = prefs.getUChar("count", 0);
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (stored <= RULES_MAX && stored > 0 && prefs.getBytesLength("table") == stored * sizeof(EdgeRule)) {
+        prefs.getBytes("table", rules, stored * sizeof(EdgeRule));
+        count = stored;
+    }
+    xSemaphoreGive(mutex);
+    prefs.end();
+    LOGI(LOG_MOD_RULES, "RULES: %u rules loaded from NVS", count);
+}
+
+void RulesEngine::saveToNVS() {
+    Preferences prefs;
+    prefs.begin(RULES_NVS_NAMESPACE, false);
+    if (count > 0) {
+        prefs.putBytes("table", rules, count * sizeof(EdgeRule));
+    } else {
+        prefs.remove("table");
+    }
+    prefs.putUChar("count", count);
+    prefs.end();
+}
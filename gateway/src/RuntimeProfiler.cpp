@@ -0,0 +1,124 @@
+#include "RuntimeProfiler.h"
+#include <esp_task_wdt.h>
+#include <esp_heap_caps.h>
+
+RuntimeProfiler runtimeProfiler;
+
+static portMUX_TYPE reportMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Relevé du noyau, trop volumineux pour la pile du profileur
+static TaskStatus_t systemTasks[PROFILER_MAX_SYSTEM_TASKS];
+
+void RuntimeProfiler::watchTask(const char* name, uint32_t stackSize) {
+    if (taskCount >= PROFILER_MAX_TASKS) return;
+    tasks[taskCount++] = { name, stackSize, 0 };
+}
+
+void RuntimeProfiler::watchQueue(const char* name, QueueHandle_t queue, uint16_t size) {
+    if (!queue || queueCount >= PROFILER_MAX_QUEUES) return;
+    queues[queueCount++] = { name, queue, size, 0 };
+}
+
+bool RuntimeProfiler::begin() {
+    if (PROFILER_REPORT_INTERVAL_MS == 0) return true;
+    return xTaskCreatePinnedToCore(task, "Profiler", PROFILER_TASK_STACK_SIZE, this, 1, NULL, 0) == pdPASS;
+}
+
+void RuntimeProfiler::task(void* params) {
+    static_cast<RuntimeProfiler*>(params)->run();
+}
+
+void RuntimeProfiler::run() {
+    esp_task_wdt_add(NULL);
+#if !configGENERATE_RUN_TIME_STATS
+    Serial.println("PROFILER: FreeRTOS run-time stats disabled, CPU usage not reported");
+#endif
+    closeWindow(false); // Référence des compteurs d'exécution : la première fenêtre part d'ici
+
+    for (;;) {
+        esp_task_wdt_reset();
+        sampleQueues();
+        if (millis() - windowStart >= PROFILER_REPORT_INTERVAL_MS) {
+            closeWindow(true);
+        }
+        vTaskDelay(pdMS_TO_TICKS(PROFILER_SAMPLE_MS));
+    }
+}
+
+void RuntimeProfiler::sampleQueues() {
+    for (uint8_t i = 0; i < queueCount; i++) {
+        uint16_t waiting = uxQueueMessagesWaiting(queues[i].queue);
+        if (waiting > queues[i].peak) queues[i].peak = waiting;
+    }
+}
+
+void RuntimeProfiler::closeWindow(bool publish) {
+    unsigned long now = millis();
+    ProfilerReport closed = {};
+    closed.windowMs = now - windowStart;
+    windowStart = now;
+
+    uint32_t totalRunTime = 0;
+    UBaseType_t systemCount = uxTaskGetSystemState(systemTasks, PROFILER_MAX_SYSTEM_TASKS, &totalRunTime);
+    uint32_t elapsed = totalRunTime - lastTotalRunTime;
+    lastTotalRunTime = totalRunTime;
+#if configGENERATE_RUN_TIME_STATS
+    closed.cpuAvailable = elapsed > 0;
+#endif
+
+    uint32_t idleRunTime = 0;
+    for (UBaseType_t k = 0; k < systemCount; k++) {
+        if (strncmp(systemTasks[k].pcTaskName, "IDLE", 4) == 0) idleRunTime += systemTasks[k].ulRunTimeCounter;
+    }
+    if (closed.cpuAvailable) {
+        closed.idlePercent = (idleRunTime - lastIdleRunTime) * 100.0f / ((float)elapsed * portNUM_PROCESSORS);
+    }
+    lastIdleRunTime = idleRunTime;
+
+    for (uint8_t i = 0; i < taskCount; i++) {
+        WatchedTask& watched = tasks[i];
+        TaskProfile& profile = closed.tasks[i];
+        profile.name = watched.name;
+        profile.stackSize = watched.stackSize;
+        for (UBaseType_t k = 0; k < systemCount; k++) {
+            if (strcmp(systemTasks[k].pcTaskName, watched.name) != 0) continue;
+            profile.running = true;
+            profile.stackFreeMin = systemTasks[k].usStackHighWaterMark; // En octets sur ESP32
+            uint32_t runTime = systemTasks[k].ulRunTimeCounter;
+            // Compteur inférieur au précédent : la tâche a été recréée pendant la fenêtre
+            uint32_t ran = runTime >= watched.lastRunTime ? runTime - watched.lastRunTime : runTime;
+            if (closed.cpuAvailable) profile.cpuPercent = ran * 100.0f / elapsed;
+            watched.lastRunTime = runTime;
+            break;
+        }
+        if (!profile.running) watched.lastRunTime = 0;
+    }
+    closed.taskCount = taskCount;
+
+    for (uint8_t i = 0; i < queueCount; i++) {
+        WatchedQueue& watched = queues[i];
+        uint16_t depth = uxQueueMessagesWaiting(watched.queue);
+        closed.queues[i] = { watched.name, watched.size, depth, depth > watched.peak ? depth : watched.peak };
+        watched.peak = 0;
+    }
+    closed.queueCount = queueCount;
+
+    closed.heapFree = esp_get_free_heap_size();
+    closed.heapMinFree = esp_get_minimum_free_heap_size();
+    closed.heapLargestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    if (!publish) return;
+
+    portENTER_CRITICAL(&reportMux);
+    report = closed;
+    reportReady = true;
+    portEXIT_CRITICAL(&reportMux);
+}
+
+bool RuntimeProfiler::takeReport(ProfilerReport& out) {
+    portENTER_CRITICAL(&reportMux);
+    bool ready = reportReady;
+    if (ready) out = report;
+    reportReady = false;
+    portEXIT_CRITICAL(&reportMux);
+    return ready;
+}
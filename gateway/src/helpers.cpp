@@ -1,4 +1,6 @@
 #include "helpers.h"
+#include "config.h"
+#include <sys/time.h>
 
 uint32_t calculateCRC32(const uint8_t *data, size_t length) {
     uint32_t crc = 0xffffffff;
@@ -13,3 +15,12 @@ uint32_t calculateCRC32(const uint8_t *data, size_t length) {
     }
     return crc;
 }
+
+bool epochMillisAt(uint32_t microsTimestamp, uint64_t& epochMs) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    if (now.tv_sec < NTP_MIN_VALID_EPOCH_S) return false; // Horloge pas encore réglée : elle part de 1970
+    uint64_t nowMs = (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+    epochMs = nowMs - (uint32_t)(micros() - microsTimestamp) / 1000;
+    return true;
+}
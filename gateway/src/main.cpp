@@ -11,6 +11,12 @@
 #include "OledTask.h"
 #include "MqttHandler.h"
 #include "LoRaHandler.h"
+#include "LoadGenerator.h"
+#include "RuntimeProfiler.h"
+#include "MetricsServer.h"
+#include "Log.h"
+#include "FrameCapture.h"
+#include "RulesEngine.h"
 
 extern void loraInterrupt();
 
@@ -28,6 +34,8 @@ SystemStatus systemStatus = { WIFI_DISCONNECTED, GW_MQTT_DISCONNECTED, 0, 0 };
 QueueHandle_t loraTxQueue;
 QueueHandle_t loraRxQueue;
 QueueHandle_t systemQueue;
+QueueHandle_t rpcResultQueue;
+QueueHandle_t bulkTxQueue;
 
 void setup() {
     Serial.begin(115200);
@@ -37,6 +45,13 @@ void setup() {
     Serial.printf("Version: %s\n", FIRMWARE_VERSION);
     Serial.println("=============================================");
 
+#if LOG_DEFERRED
+    // Démarré en premier : les lignes des autres modules passent par son tampon
+    if (!logger.begin()) {
+        Serial.println("Erreur: Impossible de démarrer la tâche de journal.");
+    }
+#endif
+
     esp_task_wdt_init(WATCHDOG_TIMEOUT_S, true);
     esp_task_wdt_add(NULL); // Le setup est aussi surveillé
 
@@ -55,7 +70,8 @@ void setup() {
     Heltec.display->display();
     delay(1000);
 
-    int state = radio.begin(LORA_FREQ);
+    int state = radio.begin(LORA_FREQ, LORA_BANDWIDTH_KHZ, LORA_SPREADING_FACTOR, LORA_CODING_RATE, LORA_SYNC_WORD,
+                            LORA_TX_POWER_DBM, LORA_PREAMBLE_LENGTH);
     if (state != RADIOLIB_ERR_NONE) {
         Serial.printf("Init LoRa echec, code: %d. Redemarrage...\n", state);
         Heltec.display->drawString(0, 30, "Erreur LoRa!");
@@ -68,19 +84,29 @@ void setup() {
 
     deviceManager.init();
     Serial.println("Device Manager initialisé.");
+    rulesEngine.init(); // Règles locales actives dès la première trame, sans attendre le WiFi
+
+#if CAPTURE_MODE
+    // Avant la tâche LoRa : la session et les modules précèdent la première trame capturée
+    if (!frameCapture.begin()) {
+        Serial.println("Erreur: Impossible de démarrer la capture des trames.");
+    }
+#endif
 
     loraTxQueue = xQueueCreate(TX_QUEUE_SIZE, sizeof(LoRaTxCommand));
     loraRxQueue = xQueueCreate(RX_QUEUE_SIZE, sizeof(LoRaMessage));
-    systemQueue = xQueueCreate(5, sizeof(SystemEvent));
-    if (!loraTxQueue || !loraRxQueue || !systemQueue) {
+    systemQueue = xQueueCreate(SYSTEM_QUEUE_SIZE, sizeof(SystemEvent));
+    rpcResultQueue = xQueueCreate(RPC_RESULT_QUEUE_SIZE, sizeof(RpcResult));
+    bulkTxQueue = xQueueCreate(BULK_TX_QUEUE_SIZE, sizeof(LoRaBulkCommand));
+    if (!loraTxQueue || !loraRxQueue || !systemQueue || !rpcResultQueue || !bulkTxQueue) {
         Serial.println("Erreur: Impossible de créer les files d'attente. Redemarrage...");
         delay(5000);
         ESP.restart();
     }
 
-    BaseType_t oledTaskStatus = xTaskCreatePinnedToCore(taskOledDisplay, "OLED", 3072, NULL, 1, NULL, 0);
-    BaseType_t mqttTaskStatus = xTaskCreatePinnedToCore(taskMqttHandler, "MQTT", 4096, NULL, 2, NULL, 0);
-    BaseType_t loraTaskStatus = xTaskCreatePinnedToCore(taskLoRaHandler, "LoRa", 4096, NULL, 2, NULL, 1);
+    BaseType_t oledTaskStatus = xTaskCreatePinnedToCore(taskOledDisplay, "OLED", OLED_TASK_STACK_SIZE, NULL, 1, NULL, 0);
+    BaseType_t mqttTaskStatus = xTaskCreatePinnedToCore(taskMqttHandler, "MQTT", MQTT_TASK_STACK_SIZE, NULL, 2, NULL, 0);
+    BaseType_t loraTaskStatus = xTaskCreatePinnedToCore(taskLoRaHandler, "LoRa", LORA_TASK_STACK_SIZE, NULL, 2, NULL, 1);
 
     if (oledTaskStatus != pdPASS || mqttTaskStatus != pdPASS || loraTaskStatus != pdPASS) {
         Serial.println("Erreur: Impossible de créer une ou plusieurs tâches FreeRTOS. Redemarrage...");
@@ -88,6 +114,37 @@ void setup() {
         ESP.restart();
     }
     
+#if LOAD_TEST_ENABLED
+    if (loadGenerator.begin()) {
+        Serial.printf("MODE CHARGE: %d modules virtuels, %d trames/s\n", LOAD_TEST_VIRTUAL_NODES, LOAD_TEST_RATE_PPS);
+    } else {
+        Serial.println("Erreur: Impossible de démarrer le générateur de charge.");
+    }
+#endif
+
+    runtimeProfiler.watchTask("OLED", OLED_TASK_STACK_SIZE);
+    runtimeProfiler.watchTask("MQTT", MQTT_TASK_STACK_SIZE);
+    runtimeProfiler.watchTask("LoRa", LORA_TASK_STACK_SIZE);
+    runtimeProfiler.watchTask("FUOTA", FUOTA_TASK_STACK_SIZE);
+    runtimeProfiler.watchTask("Profiler", PROFILER_TASK_STACK_SIZE);
+#if LOG_DEFERRED
+    runtimeProfiler.watchTask("Log", LOG_TASK_STACK_SIZE);
+#endif
+#if CAPTURE_MODE
+    runtimeProfiler.watchTask("Capture", CAPTURE_TASK_STACK_SIZE);
+#endif
+    runtimeProfiler.watchQueue("lora_tx", loraTxQueue, TX_QUEUE_SIZE);
+    runtimeProfiler.watchQueue("lora_rx", loraRxQueue, RX_QUEUE_SIZE);
+    runtimeProfiler.watchQueue("system", systemQueue, SYSTEM_QUEUE_SIZE);
+    runtimeProfiler.watchQueue("rpc_result", rpcResultQueue, RPC_RESULT_QUEUE_SIZE);
+    runtimeProfiler.watchQueue("bulk_tx", bulkTxQueue, BULK_TX_QUEUE_SIZE);
+    if (!runtimeProfiler.begin()) {
+        Serial.println("Erreur: Impossible de démarrer le profileur.");
+    }
+
+    // Écoute sur toutes les interfaces : répond dès que le WiFi est connecté
+    startMetricsServer();
+
     esp_task_wdt_delete(NULL); // Fin de la surveillance du setup
     Serial.println("Tâches FreeRTOS démarrées. Le système est opérationnel.");
 }
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+# Captures de trames de la passerelle (CAPTURE_MODE, voir include/CaptureFormat.h).
+#   capture.py extract moniteur.log -o terrain.lcap   lignes "CAP ..." du port série (CAPTURE_SERIAL)
+#   capture.py extract capture.bin -o terrain.lcap    anneau en flash lu par GET /capture (CAPTURE_FLASH)
+#   capture.py show terrain.lcap                      liste les enregistrements
+# Le fichier .lcap se rejoue dans le simulateur : network_sim --replay terrain.lcap
+import argparse
+import base64
+import binascii
+import struct
+import sys
+
+FILE_HEADER = struct.Struct("<4sHH")
+FILE_MAGIC = b"LCAP"
+FILE_VERSION = 1
+RECORD = struct.Struct("<BBHQ")            # Type, réservé, longueur, instant (µs)
+SESSION = struct.Struct("<IIBBBBHH16s")
+DEVICE = struct.Struct("<BBI20s24s")
+FRAME = struct.Struct("<ffh")
+TELEMETRY = struct.Struct("<B")
+SECTOR = struct.Struct("<II")              # Magie, numéro de séquence
+SECTOR_MAGIC = 0x4553434C
+SECTOR_SIZE = 4096
+TYPES = b"SDFT"
+
+
+def text(raw):
+    return raw.split(b"\0", 1)[0].decode("utf-8", "replace")
+
+
+def from_serial(data):
+    records = []
+    for line in data.splitlines():
+        start = line.find(b"CAP ")
+        if start < 0:
+            continue
+        try:
+            record = base64.b64decode(line[start + 4:].strip(), validate=True)
+        except binascii.Error:
+            continue  # Ligne coupée (redémarrage, tampon série plein)
+        if len(record) >= RECORD.size and len(record) == RECORD.size + RECORD.unpack_from(record)[2]:
+            records.append(record)
+    return records
+
+
+def from_flash(data):
+    sectors = []
+    for offset in range(0, len(data) - SECTOR_SIZE + 1, SECTOR_SIZE):
+        magic, sequence = SECTOR.unpack_from(data, offset)
+        if magic == SECTOR_MAGIC:
+            sectors.append((sequence, data[offset:offset + SECTOR_SIZE]))
+    records = []
+    for _sequence, sector in sorted(sectors):
+        pos = SECTOR.size
+        while pos + RECORD.size <= len(sector) and sector[pos] in TYPES:
+            length = RECORD.unpack_from(sector, pos)[2]
+            if pos + RECORD.size + length > len(sector):
+                break
+            records.append(sector[pos:pos + RECORD.size + length])
+            pos += RECORD.size + length
+    return records
+
+
+def read_lcap(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    magic, version, _ = FILE_HEADER.unpack_from(data)
+    if magic != FILE_MAGIC or version != FILE_VERSION:
+        sys.exit("%s : pas une capture .lcap version %d" % (path, FILE_VERSION))
+    pos = FILE_HEADER.size
+    while pos + RECORD.size <= len(data):
+        record_type, _, length, time_us = RECORD.unpack_from(data, pos)
+        yield chr(record_type), time_us, data[pos + RECORD.size:pos + RECORD.size + length]
+        pos += RECORD.size + length
+
+
+def extract(args):
+    with open(args.input, "rb") as f:
+        data = f.read()
+    flash = len(data) % SECTOR_SIZE == 0 and any(
+        SECTOR.unpack_from(data, offset)[0] == SECTOR_MAGIC for offset in range(0, len(data), SECTOR_SIZE))
+    records = from_flash(data) if flash else from_serial(data)
+    with open(args.output, "wb") as f:
+        f.write(FILE_HEADER.pack(FILE_MAGIC, FILE_VERSION, 0))
+        for record in records:
+            f.write(record)
+    sessions = sum(1 for record in records if record[0] == ord("S"))
+    print("%d enregistrement(s), %d session(s) -> %s" % (len(records), sessions, args.output))
+
+
+def show(args):
+    start = 0
+    for record_type, time_us, body in read_lcap(args.capture):
+        if record_type == "S":
+            start = time_us
+            freq, bw, sf, cr, sync, _, preamble, max_devices, firmware = SESSION.unpack_from(body)
+            print("SESSION  %.3f MHz BW %.1f kHz SF%d CR4/%d sync 0x%02x préambule %d, %d modules max, firmware %s"
+                  % (freq / 1e6, bw / 1e3, sf, cr, sync, preamble, max_devices, text(firmware)))
+            continue
+        stamp = "%12.6f" % ((time_us - start) / 1e6)
+        if record_type == "D":
+            node_id, _, floor_ms, name, kind = DEVICE.unpack_from(body)
+            print("%s DEVICE    node %3d %-20s %s, plancher %u ms" % (stamp, node_id, text(name), text(kind), floor_ms))
+        elif record_type == "F":
+            rssi, snr, state = FRAME.unpack_from(body)
+            payload = body[FRAME.size:]
+            print("%s FRAME     %3d o RSSI %6.1f SNR %5.1f état %d  %s"
+                  % (stamp, len(payload), rssi, snr, state, payload[:48].decode("latin-1")))
+        elif record_type == "T":
+            (node_id,) = TELEMETRY.unpack_from(body)
+            print("%s TELEMETRY node %3d %s" % (stamp, node_id, body[TELEMETRY.size:].decode("utf-8", "replace")))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Captures de trames de la passerelle")
+    commands = parser.add_subparsers(dest="command", required=True)
+    p = commands.add_parser("extract", help="sortie série ou image flash -> fichier .lcap")
+    p.add_argument("input")
+    p.add_argument("-o", "--output", required=True)
+    p.set_defaults(run=extract)
+    p = commands.add_parser("show", help="liste les enregistrements d'un fichier .lcap")
+    p.add_argument("capture")
+    p.set_defaults(run=show)
+    args = parser.parse_args()
+    args.run(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+# Décode le journal binaire de la passerelle (LOG_OUTPUT_BINARY=1, voir Log.cpp) en texte.
+# Les trames ne portent que l'adresse du format : son texte est lu dans l'ELF du firmware compilé.
+# Les octets hors trame (démarrage, rapports LATENCY/PROFILE) sont recopiés tels quels.
+# Usage : log_decode.py .pio/build/heltec_wifi_lora_32_V3/firmware.elf [capture.bin | --port /dev/ttyUSB0]
+import argparse
+import re
+import struct
+import sys
+
+from elftools.elf.elffile import ELFFile
+from elftools.elf.constants import SH_FLAGS
+
+MAGIC = b"\xa5\x5a"
+HEADER = struct.Struct("<IBBIB")  # Horodatage, niveau, module, adresse du format, nombre d'arguments
+MAX_FRAME = 2048  # LOG_MAX_RECORD : au-delà, les deux octets de synchronisation étaient du texte
+CONVERSION = re.compile(r"%([-+ #0-9.]*)(?:hh|h|ll|l|L|q|j|z|t)?([diuxXoceEfFgGs%])")
+
+
+class Formats:
+    def __init__(self, path):
+        self.sections = []
+        self.cache = {}
+        with open(path, "rb") as f:
+            elf = ELFFile(f)
+            for section in elf.iter_sections():
+                if section["sh_flags"] & SH_FLAGS.SHF_ALLOC and section["sh_type"] == "SHT_PROGBITS":
+                    self.sections.append((section["sh_addr"], section.data()))
+
+    def get(self, address):
+        if address not in self.cache:
+            text = "<format 0x%08x introuvable>" % address
+            for start, data in self.sections:
+                if start <= address < start + len(data):
+                    end = data.find(b"\0", address - start)
+                    text = data[address - start:end].decode("utf-8", "replace")
+                    break
+            self.cache[address] = text
+        return self.cache[address]
+
+
+def read_args(data, count):
+    args, pos = [], 0
+    for _ in range(count):
+        tag = chr(data[pos])
+        pos += 1
+        if tag == "s":
+            length = data[pos]
+            args.append(data[pos + 1:pos + 1 + length].decode("utf-8", "replace"))
+            pos += 1 + length
+        elif tag in "qQd":
+            args.append(struct.unpack_from({"q": "<q", "Q": "<Q", "d": "<d"}[tag], data, pos)[0])
+            pos += 8
+        else:
+            args.append(struct.unpack_from("<i" if tag == "i" else "<I", data, pos)[0])
+            pos += 4
+    return args
+
+
+def render(format, args):
+    queue = iter(args)
+
+    def conversion(match):
+        flags, kind = match.groups()
+        if kind == "%":
+            return "%"
+        value = next(queue, None)
+        if value is None:
+            return match.group(0)
+        if isinstance(value, str):
+            kind = "s"
+        elif isinstance(value, float) and kind not in "eEfFgG":
+            kind = "f"
+        elif isinstance(value, int) and kind in "eEfFgGs":
+            kind = "d"
+        return ("%" + flags + kind) % value
+
+    return CONVERSION.sub(conversion, format)
+
+
+def decode(chunks, formats, out):
+    buffer = b""
+    for chunk in chunks:
+        buffer += chunk
+        while buffer:
+            start = buffer.find(MAGIC)
+            if start < 0:
+                # Garde un éventuel premier octet de l'en-tête coupé en fin de lecture
+                keep = 1 if buffer.endswith(MAGIC[:1]) else 0
+                out.write(buffer[:len(buffer) - keep].decode("utf-8", "replace"))
+                buffer = buffer[len(buffer) - keep:]
+                break
+            out.write(buffer[:start].decode("utf-8", "replace"))
+            buffer = buffer[start:]
+            if len(buffer) < 4:
+                break
+            (length,) = struct.unpack_from("<H", buffer, 2)
+            if length < HEADER.size or length > MAX_FRAME:
+                out.write(buffer[:1].decode("utf-8", "replace"))
+                buffer = buffer[1:]
+                continue
+            if len(buffer) < 4 + length:
+                break
+            frame = buffer[4:4 + length]
+            buffer = buffer[4 + length:]
+            timestamp, _level, _module, address, count = HEADER.unpack_from(frame)
+            try:
+                text = render(formats.get(address), read_args(frame[HEADER.size:], count))
+            except (IndexError, struct.error, ValueError, TypeError):
+                text = "<trame illisible>"
+            out.write("[%u] %s\n" % (timestamp, text))
+        out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("elf", help="firmware.elf de la passerelle, exactement celui qui tourne sur la carte")
+    parser.add_argument("capture", nargs="?", help="capture brute du port série (entrée standard par défaut)")
+    parser.add_argument("--port", help="lit directement le port série (pyserial)")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    formats = Formats(args.elf)
+    if args.port:
+        import serial
+        port = serial.Serial(args.port, args.baud, timeout=0.1)
+        decode(iter(lambda: port.read(256), None), formats, sys.stdout)  # Sans fin
+    elif args.capture:
+        with open(args.capture, "rb") as stream:
+            decode(iter(lambda: stream.read(256), b""), formats, sys.stdout)
+    else:
+        decode(iter(lambda: sys.stdin.buffer.read1(256), b""), formats, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,41 @@
+# Les sources du firmware sont compilées chacune avec les en-têtes de son projet : les quatre
+# projets ont leur propre config.h, et la passerelle lit ses identifiants dans firmware/gateway.
+import os
+
+Import("env")
+
+ROOT = os.path.dirname(env.subst("$PROJECT_DIR"))
+# Rejeu d'une capture du terrain : credentials.h de la passerelle capturée, pour déchiffrer ses trames
+GATEWAY_CREDENTIALS = os.environ.get("GATEWAY_CREDENTIALS_DIR",
+                                     os.path.join(env.subst("$PROJECT_DIR"), "firmware", "gateway"))
+
+# Les deux versions d'ArduinoJson installées par lib_deps (espaces de noms versionnés : elles
+# cohabitent dans l'exécutable). L'en-tête de la bonne version passe devant celui qu'ajoute le LDF.
+LIBDEPS = os.path.join(env.subst("$PROJECT_LIBDEPS_DIR"), env.subst("$PIOENV"))
+ARDUINOJSON_V7 = os.path.join(LIBDEPS, "ArduinoJson", "src")
+ARDUINOJSON_V6 = os.path.join(LIBDEPS, "ArduinoJson6", "src")
+
+GROUPS = {
+    "gateway": (
+        [ARDUINOJSON_V7, os.path.join(ROOT, "gateway", "include"), GATEWAY_CREDENTIALS],
+        # Journal écrit directement : le port série du simulateur est déjà horodaté en temps virtuel
+        [("MAX_DEVICES", 120), ("LOG_DEFERRED", 0)],
+    ),
+    "wellguard": ([ARDUINOJSON_V6, os.path.join(ROOT, "Modules", "WellguardPro", "include")], []),
+    "aqua": ([ARDUINOJSON_V6, os.path.join(ROOT, "Modules", "AquaReservPro", "include")], []),
+    "swarm": ([ARDUINOJSON_V6, os.path.join(ROOT, "Modules", "NodeSwarm", "include")], []),
+}
+
+
+def firmware_object(includes, defines):
+    def middleware(env, node):
+        return env.Object(
+            node,
+            CPPPATH=includes + list(env.get("CPPPATH", [])),
+            CPPDEFINES=list(env.get("CPPDEFINES", [])) + defines,
+        )
+    return middleware
+
+
+for group, (includes, defines) in GROUPS.items():
+    env.AddBuildMiddleware(firmware_object(includes, defines), "*/firmware/%s/*" % group)
@@ -0,0 +1,10 @@
+#pragma once
+
+// Identifiants de la passerelle simulée : pas de WiFi ni de ThingsBoard, seule la clé LoRa
+// compte et doit être celle des modules (Modules/*/include/credentials.h).
+#define WIFI_SSID "simulator"
+#define WIFI_PASSWORD "simulator"
+#define TB_SERVER "127.0.0.1"
+#define TB_GATEWAY_TOKEN "simulator"
+#define LORA_SECRET_KEY "HydrauParkSecretKey2025"
+#define LORA_AES_IV "INITIALVECTORIV0"
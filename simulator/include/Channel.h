@@ -0,0 +1,96 @@
+#pragma once
+#include "Device.h"
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <vector>
+
+namespace sim {
+
+struct ChannelConfig {
+    double pathLossExponent = 2.7;   // Modèle log-distance, référence espace libre à 1 m
+    double shadowingSigmaDb = 6.0;   // Masquage log-normal, tiré une fois par lien
+    double noiseFigureDb = 6.0;
+    double captureThresholdDb = 6.0; // Une trame survit si elle dépasse chaque interféreur de ce seuil
+    uint8_t spreadingFactor = 0;     // Impose un SF à toutes les radios (0 : celui choisi par le firmware)
+    uint32_t seed = 1;
+};
+
+struct Transmission {
+    uint64_t id;
+    Device* source;
+    std::vector<uint8_t> data;
+    Time start;
+    Time end;
+    float frequencyMhz;
+    float bandwidthKhz;
+    uint8_t spreadingFactor;
+    std::vector<Reception*> receptions;
+    int gatewayOutcome;              // UplinkOutcome déjà connu au début de la trame, sinon -1
+};
+
+struct Reception {
+    Transmission* tx;
+    Device* receiver;
+    float rssi;
+    float snr;
+    bool corrupted;
+};
+
+// Issue d'une trame montante vue par la passerelle
+enum UplinkOutcome {
+    UPLINK_RECEIVED,
+    UPLINK_COLLIDED,     // Détectée mais détruite par une autre trame (erreur CRC)
+    UPLINK_GATEWAY_BUSY, // Passerelle en émission ou pas en écoute au début de la trame
+    UPLINK_LOCKED_OTHER, // Passerelle déjà verrouillée sur une autre trame
+    UPLINK_TOO_WEAK,     // Sous le seuil de démodulation du SF
+    UPLINK_OUTCOME_COUNT
+};
+
+// Canal radio partagé : temps d'antenne, affaiblissement de parcours, collisions avec effet de capture
+class Channel {
+public:
+    explicit Channel(const ChannelConfig& config);
+
+    // Canal utilisé par les radios simulées (une seule simulation par processus)
+    static Channel& active();
+    static void install(Channel* channel);
+    const ChannelConfig& configuration() const { return config; }
+
+    void addDevice(Device* device);
+    void setGateway(Device* device) { gateway = device; }
+
+    static Time airtime(const RadioState& radio, size_t length);
+    Time transmit(Device& source, const uint8_t* data, size_t length);
+    void leaveReceive(Device& device);
+    // Trame remise telle quelle à un récepteur en écoute, sans passer par l'air (rejeu d'une capture).
+    // Faux si la radio n'écoute pas ou démodule déjà une trame.
+    bool inject(Device& receiver, const std::vector<uint8_t>& data, float rssi, float snr, bool crcError);
+    double pathLoss(const Device& a, const Device& b);
+
+    // Appelé au début de chaque émission (décodage des trames pour les statistiques)
+    std::function<void(Device&, const uint8_t*, size_t)> observer;
+
+    uint64_t uplinkOutcomes[UPLINK_OUTCOME_COUNT] = {0};
+    Time busyTime = 0;               // Temps pendant lequel au moins une trame est en l'air
+
+private:
+    ChannelConfig config;
+    std::vector<Device*> devices;
+    Device* gateway = nullptr;
+    std::list<Transmission> onAir;
+    std::map<uint64_t, double> shadowing;
+    std::mt19937 rng;
+    uint64_t nextId = 1;
+    Time busySince = 0;
+
+    double rssiAt(const Transmission& tx, const Device& receiver);
+    double noiseFloor(float bandwidthKhz) const;
+    static double demodulationFloor(uint8_t spreadingFactor);
+    bool sameChannel(const Transmission& tx, const RadioState& radio) const;
+    void finish(uint64_t id);
+    void receiveDone(Device& receiver, const std::vector<uint8_t>& data, float rssi, float snr, bool crcError);
+};
+
+} // namespace sim
@@ -0,0 +1,71 @@
+#pragma once
+#include "Kernel.h"
+#include <cstdint>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+struct Reception;
+
+// État d'un SX1262 simulé. Les paramètres par défaut sont ceux de RadioLib (SX1262::begin)
+struct RadioState {
+    enum Mode { STANDBY, RX, TX };
+    Mode mode = STANDBY;
+    float frequencyMhz = 868.0f;
+    float bandwidthKhz = 125.0f;
+    uint8_t spreadingFactor = 9;
+    uint8_t codingRate = 7;          // 4/7
+    int8_t powerDbm = 10;
+    uint16_t preambleLength = 8;
+    uint32_t dio1Pin = 0;
+    void (*dio1Action)() = nullptr;
+
+    bool irq = false;                // Niveau de DIO1
+    bool rxDone = false;
+    bool crcError = false;
+    std::vector<uint8_t> rxBuffer;
+    float lastRssi = 0;
+    float lastSnr = 0;
+    Reception* lock = nullptr;       // Trame en cours de réception
+    Task* waiter = nullptr;          // Tâche bloquée dans receive()
+
+    Time txAirtime = 0;
+    uint32_t txFrames = 0;
+};
+
+// Espace de noms NVS (Preferences) : clé -> octets
+typedef std::map<std::string, std::vector<uint8_t>> NvsNamespace;
+
+// Un appareil simulé : la passerelle ou un module, avec sa radio, sa NVS et ses tâches
+struct Device {
+    int index = 0;
+    std::string name;
+    std::string kind;                // "gateway", "wellguard", "aqua", "swarm"
+    uint8_t mac[6] = {0};
+    double x = 0, y = 0;             // Position en mètres
+    RadioState radio;
+    std::map<std::string, NvsNamespace> nvs;
+    std::mt19937 rng;
+    std::vector<Task*> tasks;
+    bool logging = false;
+    std::string logLine;             // Ligne Serial en cours de composition
+
+    void (*boot)(Device&) = nullptr; // Démarrage du firmware (setup), exécuté dans la tâche loopTask
+    void* firmware = nullptr;        // État propre au firmware (LoraNode, ...)
+    uint32_t bootCount = 0;
+
+    Time clockBase = 0;              // Origine de millis() : dernier démarrage
+    Time bootedAt = NEVER;           // Premier démarrage
+    Time joinedAt = NEVER;
+    uint8_t nodeId = 0;              // Identifiant attribué par la passerelle, vu sur l'air
+};
+
+// Met l'appareil sous tension à l'instant donné : radio remise à zéro, millis() repart de 0
+void powerOn(Device& device, Time at);
+// Redémarre un appareil : ses tâches sont arrêtées, sa NVS est conservée
+void rebootDevice(Device& device, Time delay);
+
+} // namespace sim
@@ -0,0 +1,39 @@
+#pragma once
+#include "Device.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace sim {
+
+// Démarrage des firmwares (équivalent de setup() de chaque main.cpp), exécutés dans loopTask
+void bootGateway(Device& device);
+void bootWellguard(Device& device);
+void bootAqua(Device& device);
+void bootSwarm(Device& device);
+
+// Carte NodeSwarm : nombre de modules virtuels (SWARM_NODE_COUNT) et modules ayant adhéré
+extern const int swarmNodeCount;
+int swarmJoined(Device& device);
+
+// Trame vue sur l'air, déchiffrée avec la clé du réseau
+struct FrameInfo {
+    std::string type;                // JOIN_REQUEST, TELEMETRY, CMD... ; vide si illisible
+    int nodeId = -1;
+    uint32_t msgCtr = 0;
+    bool confirmed = false;
+};
+bool decodeFrame(const uint8_t* data, size_t length, FrameInfo& info);
+
+// Télémétrie remise par la passerelle à sa file vers ThingsBoard
+extern std::function<void(uint8_t nodeId, uint32_t msgCtr)> onGatewayDelivery;
+// Même remise, avec le JSON tel que la tâche MQTT le reçoit (comparé à la capture lors d'un rejeu)
+extern std::function<void(uint8_t nodeId, const char* payload)> onGatewayTelemetry;
+
+// Événements locaux des modules (basculement de pompe, changement de niveau), en plus des relevés périodiques
+struct NodeTraffic {
+    uint32_t eventMeanIntervalMs = 0; // 0 : aucun événement
+};
+extern NodeTraffic nodeTraffic;
+
+} // namespace sim
@@ -0,0 +1,19 @@
+#pragma once
+// Inclus avant les sources du firmware, qui sont ensuite placées dans un espace de noms propre
+// à chaque appareil (gateway, wellguard, aqua, swarm) : les en-têtes système et bibliothèques restent
+// ainsi déclarés une seule fois, dans l'espace global, et leurs gardes d'inclusion évitent
+// qu'ils soient repris à l'intérieur de l'espace de noms.
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <RadioLib.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <HTTPClient.h>
+#include <AESLib.h>
+#include <esp_task_wdt.h>
+#include <esp_system.h>
+#include <esp_partition.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+#include <sys/time.h>
+#include <atomic>
@@ -0,0 +1,102 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+namespace sim {
+
+typedef uint64_t Time;              // Temps virtuel, en microsecondes
+const Time NEVER = UINT64_MAX;
+
+struct Device;
+
+// Levée dans une tâche arrêtée (vTaskDelete, ESP.restart, fin de simulation) pour dérouler sa pile
+struct TaskExit {};
+
+// Tâche FreeRTOS simulée : un thread hôte qui ne s'exécute que lorsque le noyau lui passe la main
+struct Task {
+    std::string name;
+    Device* device = nullptr;
+    void (*entry)(void*) = nullptr;
+    void* param = nullptr;
+    pthread_t thread;
+    std::condition_variable cv;
+    bool hasBaton = false;
+    bool finished = false;
+    bool killed = false;
+
+    uint64_t waitToken = 0;          // Invalide les réveils programmés pour une attente précédente
+    bool blocked = false;
+    bool interruptible = false;      // Attente qu'un wake() peut écourter (file, notification)
+    bool woken = false;
+    uint32_t notifyValue = 0;        // Notification de tâche (ulTaskNotifyTake)
+    bool waitingNotify = false;
+};
+
+// Ordonnanceur à temps virtuel. Les tâches sont coopératives : une seule s'exécute à la fois
+// et le temps n'avance que lorsqu'elles sont toutes bloquées (delay, file, radio). Le code
+// embarqué s'exécute donc tel quel, de façon déterministe, et instantanément en temps virtuel.
+class Kernel {
+public:
+    static Kernel& instance();
+
+    Time now() const { return currentTime; }
+    Task* currentTask() const;
+    Device* currentDevice() const;
+
+    // Rappel exécuté dans le contexte du noyau (fin de trame radio, démarrage d'un module...)
+    void at(Time time, std::function<void()> callback);
+    // Contexte d'interruption : attribue les appels faits depuis un rappel au module concerné
+    void setInterruptDevice(Device* device) { interruptDevice = device; }
+
+    Task* spawn(Device* device, void (*entry)(void*), void* param, const char* name);
+    void kill(Task* task);
+    void killDevice(Device* device);
+
+    // Appelés depuis une tâche
+    void sleepUntil(Time time);
+    bool wait(Time deadline);        // Retourne true si réveillée par wake() avant l'échéance
+    void wake(Task* task);
+    void exitCurrent();
+
+    void run(Time until);
+    void shutdown();
+    size_t liveTaskCount() const;
+
+private:
+    struct Event {
+        Time time;
+        uint64_t seq;
+        Task* task;                  // Reprise d'une tâche, ou nullptr pour un rappel
+        uint64_t token;
+        std::function<void()> callback;
+        bool operator>(const Event& other) const {
+            return time != other.time ? time > other.time : seq > other.seq;
+        }
+    };
+
+    Time currentTime = 0;
+    uint64_t nextSeq = 0;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+    std::vector<Task*> tasks;
+    Device* interruptDevice = nullptr;
+
+    std::mutex mutex;
+    std::condition_variable kernelCv;
+    Task* running = nullptr;
+
+    void schedule(Time time, Task* task, uint64_t token, std::function<void()> callback);
+    void resume(Task* task);
+    void block(Time deadline, bool interruptible);
+    void yieldToKernel(std::unique_lock<std::mutex>& lock);
+    static void* threadEntry(void* arg);
+};
+
+inline Time ms(uint64_t value) { return value * 1000; }
+
+} // namespace sim
@@ -0,0 +1,10 @@
+#pragma once
+// AES-CBC avec l'interface d'AESLib. Le bourrage est laissé à l'appelant (le firmware le fait
+// déjà) et l'IV n'est pas modifié : chaque trame est chiffrée indépendamment, comme sur le terrain.
+#include "Arduino.h"
+
+class AESLib {
+public:
+    uint16_t encrypt(const byte input[], uint16_t input_length, byte* output, const byte key[], int bits, const byte my_iv[]);
+    uint16_t decrypt(const byte input[], uint16_t input_length, byte* output, const byte key[], int bits, const byte my_iv[]);
+};
@@ -0,0 +1,78 @@
+#pragma once
+// API Arduino-ESP32 minimale pour exécuter le firmware sur l'hôte, en temps virtuel
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "pgmspace.h"
+#include "WString.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+uint32_t esp_random();
+
+// Sortie série : préfixée du temps virtuel et du nom de l'appareil, muette sauf si activée
+class HardwareSerial {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    size_t write(const char* text, size_t length);
+    size_t print(const char* text);
+    size_t print(const String& text) { return print(text.c_str()); }
+    size_t print(const __FlashStringHelper* text) { return print(reinterpret_cast<const char*>(text)); }
+    size_t print(char c) { return write(&c, 1); }
+    size_t print(long value) { return printf("%ld", value); }
+    size_t print(int value) { return printf("%d", value); }
+    size_t print(unsigned int value) { return printf("%u", value); }
+    size_t print(unsigned long value) { return printf("%lu", value); }
+    size_t print(double value, int digits = 2) { return printf("%.*f", digits, value); }
+    size_t println() { return print("\n"); }
+    template <typename T> size_t println(const T& value) { size_t n = print(value); return n + print("\n"); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    [[noreturn]] void restart();
+    uint32_t getFreeHeap() { return 200000; }
+    uint32_t getCpuFreqMHz() { return 240; }
+};
+extern EspClass ESP;
@@ -0,0 +1,8 @@
+#pragma once
+// Bibliothèque Base64 d'Arduino (agdl/Base64) utilisée par la passerelle, même comportement aux bords
+#include "Arduino.h"
+
+int base64_encode(char* output, char* input, int inputLen);
+int base64_decode(char* output, char* input, int inputLen);
+int base64_enc_len(int inputLen);
+int base64_dec_len(char* input, int inputLen);
@@ -0,0 +1,20 @@
+#pragma once
+// Pas de réseau IP dans le simulateur : toute requête échoue (la FUOTA n'y est pas simulée)
+#include "WiFi.h"
+
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+
+class HTTPClient {
+public:
+    bool begin(const char* url) { (void)url; return true; }
+    bool begin(const String& url) { return begin(url.c_str()); }
+    void setTimeout(uint16_t timeout) { (void)timeout; }
+    int GET() { return HTTPC_ERROR_CONNECTION_REFUSED; }
+    int getSize() { return -1; }
+    WiFiClient* getStreamPtr() { return &client; }
+    void end() {}
+
+private:
+    WiFiClient client;
+};
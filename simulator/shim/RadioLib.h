@@ -0,0 +1,65 @@
+#pragma once
+// SX1262 simulé : même interface que RadioLib pour les appels utilisés par le firmware.
+// Un objet SX1262 global est partagé par tous les appareils d'un même firmware : chaque appel
+// s'applique à la radio de l'appareil dont la tâche est en cours d'exécution.
+#include "Arduino.h"
+
+#define RADIOLIB_ERR_NONE 0
+#define RADIOLIB_ERR_UNKNOWN -1
+#define RADIOLIB_ERR_CHIP_NOT_FOUND -2
+#define RADIOLIB_ERR_PACKET_TOO_LONG -4
+#define RADIOLIB_ERR_TX_TIMEOUT -5
+#define RADIOLIB_ERR_RX_TIMEOUT -6
+#define RADIOLIB_ERR_CRC_MISMATCH -7
+#define RADIOLIB_ERR_INVALID_BANDWIDTH -8
+#define RADIOLIB_ERR_INVALID_SPREADING_FACTOR -9
+#define RADIOLIB_ERR_INVALID_CODING_RATE -10
+#define RADIOLIB_ERR_INVALID_FREQUENCY -12
+#define RADIOLIB_ERR_INVALID_OUTPUT_POWER -13
+#define RADIOLIB_SX126X_MAX_PACKET_LENGTH 255
+#define RADIOLIB_SX126X_SYNC_WORD_PRIVATE 0x12
+#define RADIOLIB_NC 0xFFFFFFFF
+
+class Module {
+public:
+    Module(uint32_t cs, uint32_t irq, uint32_t rst, uint32_t gpio = RADIOLIB_NC) : irqPin(irq) {
+        (void)cs; (void)rst; (void)gpio;
+    }
+    uint32_t irqPin;
+};
+
+class SX1262 {
+public:
+    SX1262(Module* mod) : module(mod) {}
+
+    int16_t begin(float freq = 434.0, float bw = 125.0, uint8_t sf = 9, uint8_t cr = 7,
+                  uint8_t syncWord = RADIOLIB_SX126X_SYNC_WORD_PRIVATE, int8_t power = 10,
+                  uint16_t preambleLength = 8, float tcxoVoltage = 1.6, bool useRegulatorLDO = false);
+    int16_t setFrequency(float freq);
+    int16_t setBandwidth(float bw);
+    int16_t setSpreadingFactor(uint8_t sf);
+    int16_t setCodingRate(uint8_t cr);
+    int16_t setOutputPower(int8_t power);
+
+    int16_t transmit(const uint8_t* data, size_t len, uint8_t addr = 0);
+    int16_t transmit(const char* str, uint8_t addr = 0) { return transmit((const uint8_t*)str, strlen(str), addr); }
+    int16_t transmit(const String& str, uint8_t addr = 0) { return transmit((const uint8_t*)str.c_str(), str.length(), addr); }
+    int16_t transmit(const char* str, size_t len) { return transmit((const uint8_t*)str, len); }
+    int16_t receive(String& str, size_t len = 0);
+    int16_t receive(uint8_t* data, size_t len);
+    int16_t startReceive();
+    int16_t readData(String& str, size_t len = 0);
+    int16_t readData(uint8_t* data, size_t len);
+    size_t getPacketLength(bool update = true);
+    int16_t standby();
+    int16_t sleep(bool retainConfig = true);
+
+    float getRSSI();
+    float getSNR();
+    uint32_t getTimeOnAir(size_t len);
+    void setDio1Action(void (*func)(void));
+    void clearDio1Action();
+
+private:
+    Module* module;
+};
@@ -0,0 +1,99 @@
+#pragma once
+// Classe String d'Arduino, sur std::string (supporte les octets nuls, comme l'original)
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+
+class String {
+public:
+    String(const char* cstr = "") : value(cstr ? cstr : "") {}
+    String(const char* cstr, unsigned int length) : value(cstr ? std::string(cstr, length) : std::string()) {}
+    String(const String& other) = default;
+    String(String&& other) = default;
+    String(const __FlashStringHelper* str) : String(reinterpret_cast<const char*>(str)) {}
+    explicit String(char c) : value(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+
+    String& operator=(const String& other) = default;
+    String& operator=(String&& other) = default;
+    String& operator=(const char* cstr) { value = cstr ? cstr : ""; return *this; }
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return value.length(); }
+    bool isEmpty() const { return value.empty(); }
+    bool reserve(unsigned int size) { value.reserve(size); return true; }
+
+    bool concat(const String& other) { value += other.value; return true; }
+    bool concat(const char* cstr) { if (!cstr) return false; value += cstr; return true; }
+    bool concat(const char* cstr, unsigned int length) { if (!cstr) return false; value.append(cstr, length); return true; }
+    bool concat(char c) { value += c; return true; }
+    bool concat(unsigned char number) { return concat(String(number)); }
+    bool concat(int number) { return concat(String(number)); }
+    bool concat(unsigned int number) { return concat(String(number)); }
+    bool concat(long number) { return concat(String(number)); }
+    bool concat(unsigned long number) { return concat(String(number)); }
+    bool concat(float number) { return concat(String(number)); }
+    bool concat(double number) { return concat(String(number)); }
+    template <typename T> String& operator+=(const T& rhs) { concat(rhs); return *this; }
+
+    char charAt(unsigned int index) const { return index < value.length() ? value[index] : 0; }
+    void setCharAt(unsigned int index, char c) { if (index < value.length()) value[index] = c; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char& operator[](unsigned int index) { return value[index]; }
+
+    bool equals(const String& other) const { return value == other.value; }
+    bool equals(const char* cstr) const { return value == (cstr ? cstr : ""); }
+    bool operator==(const String& other) const { return equals(other); }
+    bool operator==(const char* cstr) const { return equals(cstr); }
+    bool operator!=(const String& other) const { return !equals(other); }
+    bool operator!=(const char* cstr) const { return !equals(cstr); }
+    bool operator<(const String& other) const { return value < other.value; }
+    bool startsWith(const String& prefix) const { return value.compare(0, prefix.value.length(), prefix.value) == 0; }
+    bool endsWith(const String& suffix) const;
+
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const String& str, unsigned int from = 0) const;
+    int lastIndexOf(char c) const;
+    String substring(unsigned int from) const { return substring(from, value.length()); }
+    String substring(unsigned int from, unsigned int to) const;
+    void getBytes(unsigned char* buffer, unsigned int size, unsigned int index = 0) const;
+    void toCharArray(char* buffer, unsigned int size, unsigned int index = 0) const {
+        getBytes((unsigned char*)buffer, size, index);
+    }
+    void remove(unsigned int index) { if (index < value.length()) value.erase(index); }
+    void remove(unsigned int index, unsigned int count) { if (index < value.length()) value.erase(index, count); }
+    void replace(const String& find, const String& replacement);
+    void trim();
+    void toUpperCase();
+    void toLowerCase();
+    long toInt() const { return strtol(value.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(value.c_str(), nullptr); }
+    double toDouble() const { return strtod(value.c_str(), nullptr); }
+
+private:
+    std::string value;
+};
+
+// Requis par ArduinoJson (détection du type des concaténations)
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& s) : String(s) {}
+    StringSumHelper(const char* p) : String(p) {}
+};
+
+StringSumHelper operator+(const String& lhs, const String& rhs);
+StringSumHelper operator+(const String& lhs, const char* rhs);
+StringSumHelper operator+(const char* lhs, const String& rhs);
+StringSumHelper operator+(const String& lhs, char rhs);
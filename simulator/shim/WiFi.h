@@ -0,0 +1,25 @@
+#pragma once
+// Le simulateur n'a pas de WiFi : seule l'adresse MAC (propre à chaque appareil) est utilisée
+#include "Arduino.h"
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_CONNECTED = 3,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+class WiFiClient {
+public:
+    int available() { return 0; }
+    size_t readBytes(uint8_t* buffer, size_t length) { (void)buffer; (void)length; return 0; }
+    bool connected() { return false; }
+};
+
+class WiFiClass {
+public:
+    String macAddress();
+    wl_status_t status() { return WL_DISCONNECTED; }
+    void begin(const char* ssid, const char* password) { (void)ssid; (void)password; }
+    String localIP() { return String("0.0.0.0"); }
+};
+extern WiFiClass WiFi;
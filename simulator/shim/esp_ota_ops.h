@@ -0,0 +1,11 @@
+#pragma once
+#include "esp_partition.h"
+
+inline const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* startFrom) {
+    (void)startFrom;
+    return nullptr;
+}
+inline esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition) {
+    (void)partition;
+    return ESP_FAIL;
+}
@@ -0,0 +1,26 @@
+#pragma once
+// Pas de partitions OTA dans le simulateur : les sessions FUOTA échouent proprement
+#include <cstddef>
+#include <cstdint>
+#include "esp_task_wdt.h"
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef struct {
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+} esp_partition_t;
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) {
+    (void)partition; (void)offset; (void)size;
+    return ESP_FAIL;
+}
+inline esp_err_t esp_partition_write(const esp_partition_t* partition, size_t offset, const void* src, size_t size) {
+    (void)partition; (void)offset; (void)src; (void)size;
+    return ESP_FAIL;
+}
+inline esp_err_t esp_partition_read(const esp_partition_t* partition, size_t offset, void* dst, size_t size) {
+    (void)partition; (void)offset; (void)dst; (void)size;
+    return ESP_FAIL;
+}
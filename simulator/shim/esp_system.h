@@ -0,0 +1,19 @@
+#pragma once
+// La mémoire RTC n'est pas simulée : chaque démarrage se présente comme une mise sous tension,
+// et le firmware ne se fie jamais à ce qu'il y aurait laissé (MessageCounter et la session de
+// LoraNode repartent de la NVS)
+typedef enum {
+    ESP_RST_UNKNOWN,
+    ESP_RST_POWERON,
+    ESP_RST_EXT,
+    ESP_RST_SW,
+    ESP_RST_PANIC,
+    ESP_RST_INT_WDT,
+    ESP_RST_TASK_WDT,
+    ESP_RST_WDT,
+    ESP_RST_DEEPSLEEP,
+    ESP_RST_BROWNOUT,
+    ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+inline esp_reset_reason_t esp_reset_reason() { return ESP_RST_POWERON; }
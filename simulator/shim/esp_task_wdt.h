@@ -0,0 +1,12 @@
+#pragma once
+// Le temps virtuel ne s'écoule que lorsque toutes les tâches sont bloquées : pas de chien de garde
+#include "freertos/FreeRTOS.h"
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+inline esp_err_t esp_task_wdt_init(uint32_t timeoutSeconds, bool panic) { (void)timeoutSeconds; (void)panic; return ESP_OK; }
+inline esp_err_t esp_task_wdt_add(TaskHandle_t task) { (void)task; return ESP_OK; }
+inline esp_err_t esp_task_wdt_delete(TaskHandle_t task) { (void)task; return ESP_OK; }
+inline esp_err_t esp_task_wdt_reset() { return ESP_OK; }
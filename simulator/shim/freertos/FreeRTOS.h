@@ -0,0 +1,43 @@
+#pragma once
+// FreeRTOS (variante ESP-IDF) sur le noyau à temps virtuel du simulateur. Un tick vaut 1 ms.
+#include <cstddef>
+#include <cstdint>
+
+namespace sim {
+struct Task;
+struct Queue;
+}
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef sim::Task* TaskHandle_t;
+typedef sim::Queue* QueueHandle_t;
+typedef sim::Queue* SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define errQUEUE_FULL 0
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t)(xTimeInMs))
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+// Les tâches simulées ne sont jamais préemptées : les sections critiques sont vides
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
+#define taskENTER_CRITICAL(mux) ((void)(mux))
+#define taskEXIT_CRITICAL(mux) ((void)(mux))
+#define portYIELD_FROM_ISR(...) ((void)0)
+#define portYIELD() taskYIELD()
@@ -0,0 +1,11 @@
+#pragma once
+#include "queue.h"
+
+// Sémaphores : files d'éléments vides, comme dans FreeRTOS (sans héritage de priorité)
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount);
+#define xSemaphoreTake(semaphore, ticks) xQueueReceive((semaphore), nullptr, (ticks))
+#define xSemaphoreGive(semaphore) xQueueSend((semaphore), nullptr, 0)
+#define xSemaphoreGiveFromISR(semaphore, woken) xQueueSendFromISR((semaphore), nullptr, (woken))
+#define vSemaphoreDelete(semaphore) vQueueDelete(semaphore)
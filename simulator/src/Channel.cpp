@@ -0,0 +1,190 @@
+#include "Channel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace sim {
+
+static Channel* installed = nullptr;
+
+Channel::Channel(const ChannelConfig& channelConfig) : config(channelConfig), rng(channelConfig.seed) {}
+
+Channel& Channel::active() {
+    if (!installed) {
+        fprintf(stderr, "sim: radio used before a channel was installed\n");
+        abort();
+    }
+    return *installed;
+}
+
+void Channel::install(Channel* channel) {
+    installed = channel;
+}
+
+void Channel::addDevice(Device* device) {
+    devices.push_back(device);
+}
+
+// Temps d'antenne d'une trame LoRa (formule de la fiche technique SX1262, en-tête explicite, CRC actif)
+Time Channel::airtime(const RadioState& radio, size_t length) {
+    double symbolUs = (double)(1UL << radio.spreadingFactor) * 1000.0 / radio.bandwidthKhz;
+    bool lowDataRate = symbolUs > 16000.0;
+    int sf = radio.spreadingFactor;
+    int cr = radio.codingRate - 4; // 4/5 -> 1 ... 4/8 -> 4
+    double numerator = 8.0 * length - 4.0 * sf + 28 + 16;
+    double denominator = 4.0 * (sf - (lowDataRate ? 2 : 0));
+    double payloadSymbols = 8 + std::max(std::ceil(numerator / denominator) * (cr + 4), 0.0);
+    double preambleSymbols = radio.preambleLength + 4.25;
+    return (Time)((preambleSymbols + payloadSymbols) * symbolUs);
+}
+
+double Channel::noiseFloor(float bandwidthKhz) const {
+    return -174.0 + 10.0 * std::log10(bandwidthKhz * 1000.0) + config.noiseFigureDb;
+}
+
+// SNR minimal de démodulation par SF (SX1262)
+double Channel::demodulationFloor(uint8_t spreadingFactor) {
+    static const double floors[] = { -5.0, -7.5, -10.0, -12.5, -15.0, -17.5, -20.0 }; // SF6 à SF12
+    if (spreadingFactor < 6) return -2.5;
+    if (spreadingFactor > 12) return -20.0;
+    return floors[spreadingFactor - 6];
+}
+
+double Channel::pathLoss(const Device& a, const Device& b) {
+    double distance = std::max(1.0, std::hypot(a.x - b.x, a.y - b.y));
+    double frequencyMhz = a.radio.frequencyMhz;
+    double referenceLoss = 20.0 * std::log10(frequencyMhz) - 27.55; // Espace libre à 1 m
+    uint64_t key = ((uint64_t)std::min(a.index, b.index) << 32) | (uint32_t)std::max(a.index, b.index);
+    auto it = shadowing.find(key);
+    if (it == shadowing.end()) {
+        std::normal_distribution<double> normal(0.0, config.shadowingSigmaDb);
+        it = shadowing.emplace(key, config.shadowingSigmaDb > 0 ? normal(rng) : 0.0).first;
+    }
+    return referenceLoss + 10.0 * config.pathLossExponent * std::log10(distance) + it->second;
+}
+
+double Channel::rssiAt(const Transmission& tx, const Device& receiver) {
+    return tx.source->radio.powerDbm - pathLoss(*tx.source, receiver);
+}
+
+// Les SF sont considérés comme orthogonaux : seules les trames de même fréquence, SF et bande interfèrent
+bool Channel::sameChannel(const Transmission& tx, const RadioState& radio) const {
+    return tx.spreadingFactor == radio.spreadingFactor && tx.bandwidthKhz == radio.bandwidthKhz &&
+           std::fabs(tx.frequencyMhz - radio.frequencyMhz) < 0.01f;
+}
+
+Time Channel::transmit(Device& source, const uint8_t* data, size_t length) {
+    Kernel& kernel = Kernel::instance();
+    leaveReceive(source);
+
+    Time now = kernel.now();
+    Time duration = airtime(source.radio, length);
+    source.radio.txAirtime += duration;
+    source.radio.txFrames++;
+    if (onAir.empty()) busySince = now;
+
+    onAir.push_back(Transmission{ nextId++, &source, std::vector<uint8_t>(data, data + length), now, now + duration,
+                                   source.radio.frequencyMhz, source.radio.bandwidthKhz, source.radio.spreadingFactor,
+                                   {}, -1 });
+    Transmission& tx = onAir.back();
+    bool uplink = gateway && &source != gateway;
+
+    for (Device* receiver : devices) {
+        if (receiver == &source) continue;
+        RadioState& radio = receiver->radio;
+        bool listening = radio.mode == RadioState::RX && sameChannel(tx, radio);
+        double rssi = rssiAt(tx, *receiver);
+        double snr = rssi - noiseFloor(radio.bandwidthKhz);
+
+        // La nouvelle trame perturbe celle que le récepteur est en train de démoduler
+        if (radio.lock && sameChannel(tx, radio) && rssi > radio.lock->rssi - config.captureThresholdDb) {
+            radio.lock->corrupted = true;
+        }
+        if (!listening) {
+            if (uplink && receiver == gateway) tx.gatewayOutcome = UPLINK_GATEWAY_BUSY;
+            continue;
+        }
+        if (radio.lock) {
+            if (uplink && receiver == gateway) tx.gatewayOutcome = UPLINK_LOCKED_OTHER;
+            continue;
+        }
+        if (snr < demodulationFloor(radio.spreadingFactor)) {
+            if (uplink && receiver == gateway) tx.gatewayOutcome = UPLINK_TOO_WEAK;
+            continue;
+        }
+
+        Reception* reception = new Reception{ &tx, receiver, (float)rssi, (float)snr, false };
+        // Trames déjà en l'air (commencées avant l'écoute ou trop faibles pour être accrochées)
+        for (const Transmission& other : onAir) {
+            if (&other == &tx || other.source == receiver || !sameChannel(other, radio)) continue;
+            if (rssiAt(other, *receiver) > rssi - config.captureThresholdDb) reception->corrupted = true;
+        }
+        radio.lock = reception;
+        tx.receptions.push_back(reception);
+    }
+
+    if (observer) observer(source, data, length);
+    uint64_t id = tx.id;
+    kernel.at(tx.end, [this, id] { finish(id); });
+    return tx.end;
+}
+
+void Channel::leaveReceive(Device& device) {
+    device.radio.lock = nullptr;
+}
+
+void Channel::finish(uint64_t id) {
+    Kernel& kernel = Kernel::instance();
+    auto it = std::find_if(onAir.begin(), onAir.end(), [id](const Transmission& tx) { return tx.id == id; });
+    if (it == onAir.end()) return;
+    Transmission& tx = *it;
+    bool uplink = gateway && tx.source != gateway;
+    int outcome = tx.gatewayOutcome;
+
+    for (Reception* reception : tx.receptions) {
+        Device* receiver = reception->receiver;
+        RadioState& radio = receiver->radio;
+        if (radio.lock != reception) {
+            // Le récepteur a quitté l'écoute pendant la trame
+            if (uplink && receiver == gateway) outcome = UPLINK_GATEWAY_BUSY;
+            delete reception;
+            continue;
+        }
+        radio.lock = nullptr;
+        if (uplink && receiver == gateway) outcome = reception->corrupted ? UPLINK_COLLIDED : UPLINK_RECEIVED;
+        receiveDone(*receiver, tx.data, reception->rssi, reception->snr, reception->corrupted);
+        delete reception;
+    }
+
+    if (uplink && outcome >= 0) uplinkOutcomes[outcome]++;
+    onAir.erase(it);
+    if (onAir.empty()) busyTime += kernel.now() - busySince;
+}
+
+// Fin de réception : tampon et mesures du SX1262, puis DIO1 comme depuis l'interruption
+void Channel::receiveDone(Device& receiver, const std::vector<uint8_t>& data, float rssi, float snr, bool crcError) {
+    Kernel& kernel = Kernel::instance();
+    RadioState& radio = receiver.radio;
+    radio.rxDone = true;
+    radio.irq = true;
+    radio.crcError = crcError;
+    radio.rxBuffer = data;
+    radio.lastRssi = rssi;
+    radio.lastSnr = snr;
+
+    if (radio.dio1Action) {
+        kernel.setInterruptDevice(&receiver);
+        radio.dio1Action();
+        kernel.setInterruptDevice(nullptr);
+    }
+    kernel.wake(radio.waiter);
+}
+
+bool Channel::inject(Device& receiver, const std::vector<uint8_t>& data, float rssi, float snr, bool crcError) {
+    if (receiver.radio.mode != RadioState::RX || receiver.radio.lock) return false;
+    receiveDone(receiver, data, rssi, snr, crcError);
+    return true;
+}
+
+} // namespace sim
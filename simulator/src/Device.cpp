@@ -0,0 +1,29 @@
+#include "Device.h"
+
+namespace sim {
+
+static void loopTask(void* param) {
+    Device* device = static_cast<Device*>(param);
+    device->boot(*device);
+}
+
+void powerOn(Device& device, Time at) {
+    Device* target = &device;
+    Kernel::instance().at(at, [target] {
+        Kernel& kernel = Kernel::instance();
+        target->bootCount++;
+        target->clockBase = kernel.now();
+        if (target->bootedAt == NEVER) target->bootedAt = kernel.now();
+        target->radio = RadioState();
+        target->logLine.clear();
+        kernel.spawn(target, loopTask, target, "loopTask");
+    });
+}
+
+void rebootDevice(Device& device, Time delay) {
+    Kernel& kernel = Kernel::instance();
+    powerOn(device, kernel.now() + delay);
+    kernel.killDevice(&device);
+}
+
+} // namespace sim
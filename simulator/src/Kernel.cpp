@@ -0,0 +1,207 @@
+#include "Kernel.h"
+#include "Device.h"
+#include <cstdio>
+#include <cstdlib>
+
+namespace sim {
+
+static thread_local Task* selfTask = nullptr;
+static const size_t TASK_STACK_SIZE = 512 * 1024;
+
+Kernel& Kernel::instance() {
+    static Kernel kernel;
+    return kernel;
+}
+
+Task* Kernel::currentTask() const {
+    return selfTask;
+}
+
+Device* Kernel::currentDevice() const {
+    return selfTask ? selfTask->device : interruptDevice;
+}
+
+void Kernel::schedule(Time time, Task* task, uint64_t token, std::function<void()> callback) {
+    events.push(Event{ time, nextSeq++, task, token, std::move(callback) });
+}
+
+void Kernel::at(Time time, std::function<void()> callback) {
+    schedule(time < currentTime ? currentTime : time, nullptr, 0, std::move(callback));
+}
+
+Task* Kernel::spawn(Device* device, void (*entry)(void*), void* param, const char* name) {
+    Task* task = new Task();
+    task->name = name ? name : "";
+    task->device = device;
+    task->entry = entry;
+    task->param = param;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, TASK_STACK_SIZE);
+    if (pthread_create(&task->thread, &attr, threadEntry, task) != 0) {
+        fprintf(stderr, "sim: cannot create thread for task %s\n", task->name.c_str());
+        abort();
+    }
+    pthread_attr_destroy(&attr);
+
+    tasks.push_back(task);
+    if (device) device->tasks.push_back(task);
+    // Comme xTaskCreate : la nouvelle tâche démarre au prochain point d'ordonnancement
+    task->blocked = true;
+    schedule(currentTime, task, task->waitToken, nullptr);
+    return task;
+}
+
+void* Kernel::threadEntry(void* arg) {
+    Task* task = static_cast<Task*>(arg);
+    Kernel& kernel = instance();
+    selfTask = task;
+    {
+        std::unique_lock<std::mutex> lock(kernel.mutex);
+        task->cv.wait(lock, [task] { return task->hasBaton; });
+    }
+    task->blocked = false;
+    if (!task->killed) {
+        try {
+            task->entry(task->param);
+        } catch (const TaskExit&) {
+        }
+    }
+    std::unique_lock<std::mutex> lock(kernel.mutex);
+    task->finished = true;
+    task->hasBaton = false;
+    kernel.running = nullptr;
+    kernel.kernelCv.notify_one();
+    return nullptr;
+}
+
+// Passe la main à une tâche et attend qu'elle se bloque ou se termine
+void Kernel::resume(Task* task) {
+    std::unique_lock<std::mutex> lock(mutex);
+    running = task;
+    task->hasBaton = true;
+    task->cv.notify_one();
+    kernelCv.wait(lock, [this] { return running == nullptr; });
+}
+
+void Kernel::yieldToKernel(std::unique_lock<std::mutex>& lock) {
+    Task* self = selfTask;
+    running = nullptr;
+    self->hasBaton = false;
+    kernelCv.notify_one();
+    self->cv.wait(lock, [self] { return self->hasBaton; });
+}
+
+void Kernel::block(Time deadline, bool interruptible) {
+    Task* self = selfTask;
+    if (!self) {
+        fprintf(stderr, "sim: blocking call outside of a task\n");
+        abort();
+    }
+    self->waitToken++;
+    self->blocked = true;
+    self->interruptible = interruptible;
+    self->woken = false;
+    if (deadline != NEVER) {
+        schedule(deadline, self, self->waitToken, nullptr);
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        yieldToKernel(lock);
+    }
+    self->blocked = false;
+    self->interruptible = false;
+    if (self->killed) throw TaskExit();
+}
+
+void Kernel::sleepUntil(Time time) {
+    block(time < currentTime ? currentTime : time, false);
+}
+
+bool Kernel::wait(Time deadline) {
+    block(deadline, true);
+    return selfTask->woken;
+}
+
+void Kernel::wake(Task* task) {
+    if (!task || !task->blocked || !task->interruptible || task->woken) return;
+    task->woken = true;
+    schedule(currentTime, task, task->waitToken, nullptr);
+}
+
+void Kernel::kill(Task* task) {
+    if (!task || task->finished || task->killed) return;
+    task->killed = true;
+    if (task == selfTask) throw TaskExit();
+    if (task->blocked) {
+        schedule(currentTime, task, task->waitToken, nullptr);
+    }
+}
+
+void Kernel::killDevice(Device* device) {
+    bool self = false;
+    for (Task* task : device->tasks) {
+        if (task == selfTask) {
+            self = true;
+            continue;
+        }
+        kill(task);
+    }
+    device->tasks.clear();
+    if (self) {
+        selfTask->killed = true;
+        throw TaskExit();
+    }
+}
+
+void Kernel::exitCurrent() {
+    selfTask->killed = true;
+    throw TaskExit();
+}
+
+void Kernel::run(Time until) {
+    while (!events.empty()) {
+        Event event = events.top();
+        if (event.time > until) break;
+        events.pop();
+        currentTime = event.time;
+
+        if (event.task) {
+            Task* task = event.task;
+            if (task->finished || !task->blocked || event.token != task->waitToken) continue;
+            resume(task);
+        } else if (event.callback) {
+            event.callback();
+            interruptDevice = nullptr;
+        }
+    }
+    if (until != NEVER && currentTime < until) currentTime = until;
+}
+
+// Arrête toutes les tâches et attend la fin de leurs threads
+void Kernel::shutdown() {
+    for (Task* task : tasks) {
+        if (!task->finished) {
+            task->killed = true;
+            if (task->blocked) {
+                task->waitToken++;
+                resume(task);
+            }
+        }
+    }
+    for (Task* task : tasks) {
+        if (task->finished) pthread_join(task->thread, nullptr);
+        else pthread_detach(task->thread);
+    }
+}
+
+size_t Kernel::liveTaskCount() const {
+    size_t count = 0;
+    for (Task* task : tasks) {
+        if (!task->finished) count++;
+    }
+    return count;
+}
+
+} // namespace sim
@@ -0,0 +1,6 @@
+// Modules/AquaReservPro/src/FuotaCodec.cpp, compilé sans modification dans l'espace de noms aqua
+#include "FirmwarePrelude.h"
+
+namespace aqua {
+#include "../../../../Modules/AquaReservPro/src/FuotaCodec.cpp"
+}
@@ -0,0 +1,81 @@
+// Équivalent de Modules/AquaReservPro/src/main.cpp : tâches capteur de niveau et LoRa. Le contact
+// de niveau est synthétique ; le WiFi et l'interface web ne sont pas simulés.
+#include "FirmwarePrelude.h"
+#include "Firmware.h"
+#include <random>
+
+namespace aqua {
+#include "config.h"
+#include "LoraNode.h"
+
+SX1262 radio = new Module(LORA_CS, LORA_DIO1, LORA_RST, LORA_BUSY);
+
+// État propre à chaque module simulé (les globales de main.cpp)
+struct Reservoir {
+    LoraNode loraNode;
+    bool contact = false;            // Niveau brut lu sur WATER_LEVEL_PIN
+};
+
+static void taskSensors(void* params) {
+    Reservoir& self = *static_cast<Reservoir*>(params);
+    unsigned long lastChangeTime = 0;
+    bool currentState = self.contact;
+    bool lastStableState = currentState;
+    for (;;) {
+        bool rawState = self.contact;
+        if (rawState != currentState) {
+            currentState = rawState;
+            lastChangeTime = millis();
+        }
+        if (self.loraNode.isReportDue()) {
+            self.loraNode.sendTelemetry(lastStableState);
+        }
+        if ((millis() - lastChangeTime > LEVEL_CONFIRMATION_MS) && (currentState != lastStableState)) {
+            lastStableState = currentState;
+            Serial.printf("Nouvel état de niveau confirmé : %s\n", lastStableState ? "PLEIN" : "VIDE");
+            if (self.loraNode.isJoined()) {
+                self.loraNode.sendTelemetry(lastStableState, true);
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+}
+
+// Remplissages et vidanges du réservoir, à intervalles exponentiels
+static void taskEvents(void* params) {
+    Reservoir& self = *static_cast<Reservoir*>(params);
+    sim::Device& device = *sim::Kernel::instance().currentDevice();
+    std::exponential_distribution<double> interval(1.0 / sim::nodeTraffic.eventMeanIntervalMs);
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS((TickType_t)interval(device.rng) + 1));
+        self.contact = !self.contact;
+    }
+}
+
+static void taskLoRa(void* params) {
+    Reservoir& self = *static_cast<Reservoir*>(params);
+    sim::Device& device = *sim::Kernel::instance().currentDevice();
+    for (;;) {
+        self.loraNode.run();
+        if (device.joinedAt == sim::NEVER && self.loraNode.isJoined()) device.joinedAt = sim::Kernel::instance().now();
+    }
+}
+}
+
+namespace sim {
+
+void bootAqua(Device& device) {
+    using namespace aqua;
+    delete static_cast<Reservoir*>(device.firmware);
+    Reservoir* self = new Reservoir();
+    device.firmware = self;
+
+    self->loraNode.init();
+    xTaskCreatePinnedToCore(taskSensors, "Sensors", 2048, self, 1, NULL, 0);
+    xTaskCreatePinnedToCore(taskLoRa, "LoRa", 4096, self, 1, NULL, 1);
+    if (nodeTraffic.eventMeanIntervalMs) {
+        xTaskCreatePinnedToCore(taskEvents, "Events", 2048, self, 1, NULL, 0);
+    }
+}
+
+} // namespace sim
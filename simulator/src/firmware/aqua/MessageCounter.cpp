@@ -0,0 +1,6 @@
+// Modules/AquaReservPro/src/MessageCounter.cpp, compilé sans modification dans l'espace de noms aqua
+#include "FirmwarePrelude.h"
+
+namespace aqua {
+#include "../../../../Modules/AquaReservPro/src/MessageCounter.cpp"
+}
@@ -0,0 +1,95 @@
+// Équivalent de gateway/src/main.cpp : radio, files et tâche LoRa. MQTT, WiFi et l'écran ne sont
+// pas simulés ; une tâche remplace MqttHandler et vide les files destinées à ThingsBoard.
+#include "FirmwarePrelude.h"
+#include <Base64.h>
+#include "Firmware.h"
+
+namespace gateway {
+#include "config.h"
+#include "types.h"
+#include "helpers.h"
+#include "DeviceManager.h"
+#include "LoRaHandler.h"
+#include "RulesEngine.h"
+
+SX1262 radio = new Module(LORA_CS, LORA_DIO1, LORA_RST, LORA_BUSY);
+SystemStatus systemStatus = { WIFI_DISCONNECTED, GW_MQTT_DISCONNECTED, 0, 0 };
+
+QueueHandle_t loraTxQueue;
+QueueHandle_t loraRxQueue;
+QueueHandle_t systemQueue;
+QueueHandle_t rpcResultQueue;
+QueueHandle_t bulkTxQueue;
+
+// Remplace taskMqttHandler : consomme les files comme le ferait la publication MQTT
+static void taskSink(void* params) {
+    (void)params;
+    JsonDocument doc;
+    for (;;) {
+        LoRaMessage msg;
+        if (xQueueReceive(loraRxQueue, &msg, pdMS_TO_TICKS(100)) == pdPASS) {
+            if (sim::onGatewayTelemetry) sim::onGatewayTelemetry(msg.nodeId, msg.payload);
+            if (deserializeJson(doc, msg.payload) == DeserializationError::Ok && sim::onGatewayDelivery) {
+                // Un relevé rejoué (HIST) livre, en retard, la télémétrie perdue dont il porte le compteur
+                sim::onGatewayDelivery(msg.nodeId, doc[LORA_KEY_ORIGINAL_COUNTER] | (doc[LORA_KEY_MSG_COUNTER] | 0u));
+            }
+        }
+        SystemEvent event;
+        while (xQueueReceive(systemQueue, &event, 0) == pdPASS) {
+        }
+        RpcResult result;
+        while (xQueueReceive(rpcResultQueue, &result, 0) == pdPASS) {
+        }
+    }
+}
+}
+
+namespace sim {
+
+std::function<void(uint8_t nodeId, uint32_t msgCtr)> onGatewayDelivery;
+std::function<void(uint8_t nodeId, const char* payload)> onGatewayTelemetry;
+
+void bootGateway(Device& device) {
+    (void)device;
+    using namespace gateway;
+
+    int state = radio.begin(LORA_FREQ, LORA_BANDWIDTH_KHZ, LORA_SPREADING_FACTOR, LORA_CODING_RATE, LORA_SYNC_WORD,
+                            LORA_TX_POWER_DBM, LORA_PREAMBLE_LENGTH);
+    if (state != RADIOLIB_ERR_NONE) {
+        Serial.printf("Init LoRa echec, code: %d. Redemarrage...\n", state);
+        ESP.restart();
+    }
+    radio.setDio1Action(loraInterrupt);
+    deviceManager.init();
+    rulesEngine.init();
+
+    loraTxQueue = xQueueCreate(TX_QUEUE_SIZE, sizeof(LoRaTxCommand));
+    loraRxQueue = xQueueCreate(RX_QUEUE_SIZE, sizeof(LoRaMessage));
+    systemQueue = xQueueCreate(5, sizeof(SystemEvent));
+    rpcResultQueue = xQueueCreate(RPC_RESULT_QUEUE_SIZE, sizeof(RpcResult));
+    bulkTxQueue = xQueueCreate(BULK_TX_QUEUE_SIZE, sizeof(LoRaBulkCommand));
+
+    xTaskCreatePinnedToCore(taskSink, "MQTT", 4096, NULL, 2, NULL, 0);
+    xTaskCreatePinnedToCore(taskLoRaHandler, "LoRa", 4096, NULL, 2, NULL, 1);
+    Serial.println("Tâches FreeRTOS démarrées. Le système est opérationnel.");
+}
+
+// Les trames sont déchiffrées avec les fonctions de la passerelle : même clé, même format
+bool decodeFrame(const uint8_t* data, size_t length, FrameInfo& info) {
+    JsonDocument frame;
+    if (deserializeJson(frame, (const char*)data, length) != DeserializationError::Ok) return false;
+    const char* payload = frame[gateway::LORA_KEY_PAYLOAD];
+    if (!payload) return false;
+    String plaintext = gateway::decrypt_payload(String(payload));
+    JsonDocument doc;
+    if (deserializeJson(doc, plaintext) != DeserializationError::Ok) return false;
+    const char* type = doc[gateway::LORA_KEY_TYPE];
+    if (!type) return false;
+    info.type = type;
+    info.nodeId = doc[gateway::LORA_KEY_NODE_ID] | -1;
+    info.msgCtr = doc[gateway::LORA_KEY_MSG_COUNTER] | 0u;
+    info.confirmed = (doc[gateway::LORA_KEY_CONFIRMED] | 0) != 0;
+    return true;
+}
+
+} // namespace sim
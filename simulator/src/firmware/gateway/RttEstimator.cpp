@@ -0,0 +1,7 @@
+// gateway/src/RttEstimator.cpp, compilé sans modification dans l'espace de noms gateway
+#include "FirmwarePrelude.h"
+#include <Base64.h>
+
+namespace gateway {
+#include "../../../../gateway/src/RttEstimator.cpp"
+}
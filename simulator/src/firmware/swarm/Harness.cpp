@@ -0,0 +1,41 @@
+// Équivalent de Modules/NodeSwarm/src/main.cpp : une carte qui joue le rôle de SWARM_NODE_COUNT modules
+#include "FirmwarePrelude.h"
+#include "Firmware.h"
+
+namespace swarm {
+#include "config.h"
+#include "Swarm.h"
+
+SX1262 radio = new Module(LORA_CS, LORA_DIO1, LORA_RST, LORA_BUSY);
+
+static void taskLoRa(void* params) {
+    Swarm& self = *static_cast<Swarm*>(params);
+    sim::Device& device = *sim::Kernel::instance().currentDevice();
+    for (;;) {
+        self.run();
+        // Temps d'adhésion de l'essaim : celui de son dernier module
+        if (device.joinedAt == sim::NEVER && self.getJoinedCount() == SWARM_NODE_COUNT) device.joinedAt = sim::Kernel::instance().now();
+    }
+}
+}
+
+namespace sim {
+
+const int swarmNodeCount = SWARM_NODE_COUNT;
+
+int swarmJoined(Device& device) {
+    swarm::Swarm* self = static_cast<swarm::Swarm*>(device.firmware);
+    return self ? self->getJoinedCount() : 0;
+}
+
+void bootSwarm(Device& device) {
+    using namespace swarm;
+    delete static_cast<Swarm*>(device.firmware);
+    Swarm* self = new Swarm();
+    device.firmware = self;
+
+    self->init();
+    xTaskCreatePinnedToCore(taskLoRa, "LoRa", 8192, self, 1, NULL, 1);
+}
+
+} // namespace sim
@@ -0,0 +1,6 @@
+// Modules/NodeSwarm/src/helpers.cpp, compilé sans modification dans l'espace de noms swarm
+#include "FirmwarePrelude.h"
+
+namespace swarm {
+#include "../../../../Modules/NodeSwarm/src/helpers.cpp"
+}
@@ -0,0 +1,93 @@
+// Équivalent de Modules/WellguardPro/src/main.cpp : tâches capteurs et LoRa. Les capteurs sont
+// synthétiques ; le WiFi et l'interface web ne sont pas simulés.
+#include "FirmwarePrelude.h"
+#include "Firmware.h"
+#include <random>
+
+namespace wellguard {
+#include "config.h"
+#include "LoraNode.h"
+
+SX1262 radio = new Module(LORA_CS, LORA_DIO1, LORA_RST, LORA_BUSY);
+
+// État propre à chaque module simulé (les globales de main.cpp)
+struct Station {
+    LoraNode loraNode;
+    bool pumpOn = false;
+};
+
+static Station& station() {
+    return *static_cast<Station*>(sim::Kernel::instance().currentDevice()->firmware);
+}
+
+static void setPumpState(bool state, bool fromLora) {
+    Station& self = station();
+    self.pumpOn = state;
+    Serial.printf("Pompe mise à %s (source: %s)\n", state ? "ON" : "OFF", fromLora ? "LoRa" : "Web");
+    if (!fromLora && self.loraNode.isJoined()) {
+        StaticJsonDocument<32> event;
+        event["pump_on"] = state;
+        self.loraNode.queueUplink(event.as<JsonObjectConst>(), true);
+    }
+}
+
+static bool handleLoraCommand(const char* method, JsonObjectConst params, const char*& refusal) {
+    if (strcmp(method, "setPump") == 0) {
+        setPumpState(params["state"], true);
+        return true;
+    }
+    return false;
+}
+
+static void taskSensors(void* params) {
+    Station& self = *static_cast<Station*>(params);
+    std::normal_distribution<float> noise(0.0f, 0.3f);
+    sim::Device& device = *sim::Kernel::instance().currentDevice();
+    for (;;) {
+        float temperature = 18.0f + noise(device.rng);
+        float humidity = 55.0f + noise(device.rng) * 5;
+        float voltage = 12.0f + noise(device.rng) / 10;
+        self.loraNode.sendTelemetry(temperature, humidity, voltage, true);
+        vTaskDelay(pdMS_TO_TICKS(SENSOR_READ_INTERVAL_MS));
+    }
+}
+
+// Basculements manuels de la pompe (interface web), à intervalles exponentiels
+static void taskEvents(void* params) {
+    Station& self = *static_cast<Station*>(params);
+    sim::Device& device = *sim::Kernel::instance().currentDevice();
+    std::exponential_distribution<double> interval(1.0 / sim::nodeTraffic.eventMeanIntervalMs);
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS((TickType_t)interval(device.rng) + 1));
+        setPumpState(!self.pumpOn, false);
+    }
+}
+
+static void taskLoRa(void* params) {
+    Station& self = *static_cast<Station*>(params);
+    sim::Device& device = *sim::Kernel::instance().currentDevice();
+    for (;;) {
+        self.loraNode.run();
+        if (device.joinedAt == sim::NEVER && self.loraNode.isJoined()) device.joinedAt = sim::Kernel::instance().now();
+    }
+}
+}
+
+namespace sim {
+
+void bootWellguard(Device& device) {
+    using namespace wellguard;
+    delete static_cast<Station*>(device.firmware);
+    Station* self = new Station();
+    device.firmware = self;
+
+    self->loraNode.init();
+    self->loraNode.onCommand(handleLoraCommand);
+    xTaskCreatePinnedToCore(taskSensors, "Sensors", 4096, self, 1, NULL, 0);
+    xTaskCreatePinnedToCore(taskLoRa, "LoRa", 4096, self, 1, NULL, 1);
+    if (nodeTraffic.eventMeanIntervalMs) {
+        xTaskCreatePinnedToCore(taskEvents, "Events", 2048, self, 1, NULL, 0);
+    }
+}
+
+} // namespace sim
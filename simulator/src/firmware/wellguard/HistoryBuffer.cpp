@@ -0,0 +1,11 @@
+// Modules/WellguardPro/src/HistoryBuffer.cpp, compilé sans modification dans l'espace de noms wellguard
+#include "FirmwarePrelude.h"
+
+// L'historique est une globale : partagé, il ferait rejouer à un module les relevés d'un autre.
+// Seule la tâche LoRa le lit et l'écrit ; une copie par thread en donne une à chaque module.
+#undef RTC_NOINIT_ATTR
+#define RTC_NOINIT_ATTR thread_local
+
+namespace wellguard {
+#include "../../../../Modules/WellguardPro/src/HistoryBuffer.cpp"
+}
@@ -0,0 +1,6 @@
+// Modules/WellguardPro/src/LoraNode.cpp, compilé sans modification dans l'espace de noms wellguard
+#include "FirmwarePrelude.h"
+
+namespace wellguard {
+#include "../../../../Modules/WellguardPro/src/LoraNode.cpp"
+}
@@ -0,0 +1,517 @@
+// Simulateur du réseau LoRa : la passerelle et des dizaines de modules exécutent leur firmware
+// réel sur un canal radio partagé, en temps virtuel. Voir README.md (section Simulateur).
+#include "Channel.h"
+#include "Firmware.h"
+#include "../../gateway/include/CaptureFormat.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace sim;
+
+namespace sim {
+NodeTraffic nodeTraffic;
+}
+
+struct Options {
+    std::string scenario = "steady";
+    int wellguard = -1;
+    int aqua = -1;
+    double durationS = -1;
+    double warmupS = -1;
+    double radiusM = 2000;
+    uint32_t eventMeanS = 0;
+    bool swarm = false;
+    std::string log;
+    bool json = false;
+    std::string replay;
+    double replaySpeed = 1.0;
+    int replaySession = 0;           // 0 : la dernière
+    ChannelConfig channel;
+};
+
+// Message montant suivi de sa première émission à sa remise par la passerelle
+struct UplinkRecord {
+    Time firstTx;
+    Time delivered = NEVER;
+    uint32_t frames = 0;
+    bool confirmed = false;
+};
+
+struct Snapshot {
+    Time time = 0;
+    Time busyTime = 0;
+    uint64_t outcomes[UPLINK_OUTCOME_COUNT] = {0};
+    std::vector<Time> txAirtime;
+    std::vector<uint32_t> txFrames;
+};
+
+static void usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --scenario NAME   steady (default) or join-storm\n"
+            "  --nodes N         N modules, split between WellguardPro and AquaReservPro\n"
+            "  --wellguard N     number of WellguardPro modules\n"
+            "  --aqua N          number of AquaReservPro modules\n"
+            "  --duration S      measured duration in seconds (steady: 3600, join-storm: 900)\n"
+            "  --warmup S        steady only: time left for joins before measuring (default 600)\n"
+            "  --radius M        modules placed uniformly within M metres of the gateway (default 2000)\n"
+            "  --sf N            force spreading factor N on every radio\n"
+            "  --events S        mean interval between local events per module (pump, level), 0 = none\n"
+            "  --swarm           add a NodeSwarm board (many virtual modules sharing one radio)\n"
+            "  --seed N          random seed (placement, shadowing, firmware randomness)\n"
+            "  --log NAME        print the Serial output of a device (gateway, wellguard3, aqua0, all)\n"
+            "  --json            machine-readable report on stdout\n"
+            "  --replay FILE     replay a gateway capture (.lcap) into the gateway alone, no modules\n"
+            "  --speed X         replay X times faster than captured (default 1)\n"
+            "  --session N       replay the Nth session of the capture (default: the last one)\n",
+            program);
+}
+
+static bool parse(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&](const char* name) -> const char* {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "missing value for %s\n", name);
+                exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--scenario") options.scenario = value("--scenario");
+        else if (arg == "--nodes") {
+            int nodes = atoi(value("--nodes"));
+            options.wellguard = (nodes + 1) / 2;
+            options.aqua = nodes / 2;
+        }
+        else if (arg == "--wellguard") options.wellguard = atoi(value("--wellguard"));
+        else if (arg == "--aqua") options.aqua = atoi(value("--aqua"));
+        else if (arg == "--duration") options.durationS = atof(value("--duration"));
+        else if (arg == "--warmup") options.warmupS = atof(value("--warmup"));
+        else if (arg == "--radius") options.radiusM = atof(value("--radius"));
+        else if (arg == "--sf") options.channel.spreadingFactor = atoi(value("--sf"));
+        else if (arg == "--events") options.eventMeanS = atoi(value("--events"));
+        else if (arg == "--swarm") options.swarm = true;
+        else if (arg == "--seed") options.channel.seed = strtoul(value("--seed"), nullptr, 10);
+        else if (arg == "--log") options.log = value("--log");
+        else if (arg == "--json") options.json = true;
+        else if (arg == "--replay") options.replay = value("--replay");
+        else if (arg == "--speed") options.replaySpeed = atof(value("--speed"));
+        else if (arg == "--session") options.replaySession = atoi(value("--session"));
+        else {
+            usage(argv[0]);
+            return false;
+        }
+    }
+    if (options.replaySpeed <= 0) {
+        fprintf(stderr, "replay speed must be positive\n");
+        return false;
+    }
+    if (options.scenario != "steady" && options.scenario != "join-storm") {
+        fprintf(stderr, "unknown scenario %s\n", options.scenario.c_str());
+        return false;
+    }
+    bool storm = options.scenario == "join-storm";
+    // La tempête d'adhésions : 50 modules redémarrent ensemble (coupure secteur)
+    if (options.wellguard < 0 && options.aqua < 0) options.wellguard = options.aqua = storm ? 25 : 10;
+    if (options.wellguard < 0) options.wellguard = 0;
+    if (options.aqua < 0) options.aqua = 0;
+    if (options.durationS < 0) options.durationS = storm ? 900 : 3600;
+    if (options.warmupS < 0) options.warmupS = storm ? 0 : 600;
+    if (options.channel.spreadingFactor && (options.channel.spreadingFactor < 6 || options.channel.spreadingFactor > 12)) {
+        fprintf(stderr, "spreading factor must be between 6 and 12\n");
+        return false;
+    }
+    return true;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return NAN;
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t)std::ceil(p / 100.0 * values.size());
+    return values[rank ? rank - 1 : 0];
+}
+
+static Snapshot snapshot(const Channel& channel, const std::vector<Device*>& devices) {
+    Snapshot shot;
+    shot.time = Kernel::instance().now();
+    shot.busyTime = channel.busyTime;
+    memcpy(shot.outcomes, channel.uplinkOutcomes, sizeof(shot.outcomes));
+    for (Device* device : devices) {
+        shot.txAirtime.push_back(device->radio.txAirtime);
+        shot.txFrames.push_back(device->radio.txFrames);
+    }
+    return shot;
+}
+
+// ------------------------------------------------------------------ Rejeu d'une capture
+
+// Codes RadioLib de readData enregistrés avec chaque trame
+static const int16_t RADIO_OK = 0;
+static const int16_t RADIO_CRC_MISMATCH = -7;
+
+struct CapturedFrame {
+    uint64_t timeUs;
+    CaptureFrame radio;
+    std::vector<uint8_t> data;
+};
+
+// Un démarrage de la passerelle : sa configuration, ses modules, ce qu'elle a reçu et remis à MQTT
+struct CaptureSessionRecords {
+    CaptureSession config;
+    uint64_t startUs;
+    std::vector<CaptureDevice> devices;
+    std::vector<CapturedFrame> frames;
+    std::vector<std::pair<uint8_t, std::string>> telemetry;
+};
+
+static bool loadCapture(const std::string& path, std::vector<CaptureSessionRecords>& sessions) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    CaptureFileHeader header;
+    if (!file.is_open() || data.size() < sizeof(header)) {
+        fprintf(stderr, "%s: cannot read capture\n", path.c_str());
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (memcmp(header.magic, CAPTURE_MAGIC, 4) != 0 || header.version != CAPTURE_VERSION) {
+        fprintf(stderr, "%s: not a version %d .lcap capture\n", path.c_str(), CAPTURE_VERSION);
+        return false;
+    }
+
+    size_t pos = sizeof(header);
+    while (pos + sizeof(CaptureRecordHeader) <= data.size()) {
+        CaptureRecordHeader record;
+        memcpy(&record, data.data() + pos, sizeof(record));
+        const uint8_t* body = data.data() + pos + sizeof(record);
+        pos += sizeof(record) + record.length;
+        if (pos > data.size()) break;
+        if (record.type == CAPTURE_RECORD_SESSION && record.length >= sizeof(CaptureSession)) {
+            sessions.emplace_back();
+            memcpy(&sessions.back().config, body, sizeof(CaptureSession));
+            sessions.back().startUs = record.timeUs;
+            continue;
+        }
+        if (sessions.empty()) continue; // Capture commencée après le démarrage de la passerelle
+        CaptureSessionRecords& session = sessions.back();
+        if (record.type == CAPTURE_RECORD_DEVICE && record.length >= sizeof(CaptureDevice)) {
+            CaptureDevice device;
+            memcpy(&device, body, sizeof(device));
+            session.devices.push_back(device);
+        } else if (record.type == CAPTURE_RECORD_FRAME && record.length >= sizeof(CaptureFrame)) {
+            CapturedFrame frame;
+            frame.timeUs = record.timeUs;
+            memcpy(&frame.radio, body, sizeof(frame.radio));
+            frame.data.assign(body + sizeof(CaptureFrame), body + record.length);
+            session.frames.push_back(std::move(frame));
+        } else if (record.type == CAPTURE_RECORD_TELEMETRY && record.length >= sizeof(CaptureTelemetry)) {
+            std::string payload((const char*)body + sizeof(CaptureTelemetry), record.length - sizeof(CaptureTelemetry));
+            session.telemetry.emplace_back(body[0], payload);
+        }
+    }
+    return true;
+}
+
+// Rejoue les trames d'une session dans la passerelle seule, aux mêmes instants (divisés par --speed),
+// avec la NVS qu'elle avait à son démarrage, puis compare sa sortie vers MQTT à celle de la capture
+static int runReplay(const Options& options) {
+    std::vector<CaptureSessionRecords> sessions;
+    if (!loadCapture(options.replay, sessions)) return 2;
+    if (sessions.empty()) {
+        fprintf(stderr, "%s: no session record (capture started after the gateway booted)\n", options.replay.c_str());
+        return 2;
+    }
+    int number = options.replaySession ? options.replaySession : (int)sessions.size();
+    if (number < 1 || number > (int)sessions.size()) {
+        fprintf(stderr, "session %d out of range (capture has %zu)\n", number, sessions.size());
+        return 2;
+    }
+    const CaptureSessionRecords& session = sessions[number - 1];
+
+    Kernel& kernel = Kernel::instance();
+    Channel channel(options.channel);
+    Channel::install(&channel);
+
+    Device* gateway = new Device();
+    gateway->kind = gateway->name = "gateway";
+    gateway->boot = bootGateway;
+    gateway->rng.seed(options.channel.seed * 7919u);
+    gateway->logging = options.log == "all" || options.log == "gateway";
+    channel.addDevice(gateway);
+    channel.setGateway(gateway);
+
+    // NVS de la passerelle au démarrage capturé, au format de DeviceManager::saveToNVS
+    for (const CaptureDevice& device : session.devices) {
+        if (device.nodeId < 1) continue;
+        char json[128];
+        int length = snprintf(json, sizeof(json), "{\"mac\":\"%.20s\",\"type\":\"%.24s\"", device.deviceName, device.deviceType);
+        if (device.reportFloorMs) length += snprintf(json + length, sizeof(json) - length, ",\"floor\":%u", device.reportFloorMs);
+        snprintf(json + length, sizeof(json) - length, "}");
+        gateway->nvs["devices"]["dev_" + std::to_string(device.nodeId - 1)] =
+            std::vector<uint8_t>(json, json + strlen(json) + 1);
+    }
+
+    std::vector<std::pair<uint8_t, std::string>> produced;
+    onGatewayTelemetry = [&](uint8_t nodeId, const char* payload) { produced.emplace_back(nodeId, payload); };
+
+    // La session est enregistrée à la fin du setup() réel : la passerelle simulée est prête bien avant
+    Time origin = ms(1000);
+    powerOn(*gateway, 0);
+    kernel.run(origin);
+
+    const RadioState& radio = gateway->radio;
+    if (radio.spreadingFactor != session.config.spreadingFactor || radio.codingRate != session.config.codingRate ||
+        (uint32_t)(radio.bandwidthKhz * 1000) != session.config.bandwidthHz ||
+        (uint32_t)(radio.frequencyMhz * 1e6f) != session.config.frequencyHz) {
+        fprintf(stderr, "warning: captured with %.3f MHz BW %.1f kHz SF%u CR4/%u, replayed with %.3f MHz BW %.1f kHz SF%u CR4/%u\n",
+                session.config.frequencyHz / 1e6, session.config.bandwidthHz / 1e3, session.config.spreadingFactor,
+                session.config.codingRate, radio.frequencyMhz, radio.bandwidthKhz, radio.spreadingFactor, radio.codingRate);
+    }
+
+    size_t injected = 0, missed = 0, skipped = 0;
+    Time last = origin;
+    for (const CapturedFrame& frame : session.frames) {
+        // Erreurs autres que le CRC (délai, en-tête) : la radio n'a rien remis au firmware à rejouer
+        if (frame.radio.radioState != RADIO_OK && frame.radio.radioState != RADIO_CRC_MISMATCH) {
+            skipped++;
+            continue;
+        }
+        uint64_t offset = frame.timeUs > session.startUs ? frame.timeUs - session.startUs : 0;
+        Time at = origin + (Time)(offset / options.replaySpeed);
+        last = std::max(last, at);
+        const CapturedFrame* replayed = &frame;
+        kernel.at(at, [&channel, gateway, replayed, &injected, &missed] {
+            bool crcError = replayed->radio.radioState == RADIO_CRC_MISMATCH;
+            if (channel.inject(*gateway, replayed->data, replayed->radio.rssi, replayed->radio.snr, crcError)) injected++;
+            else missed++;
+        });
+    }
+    kernel.run(last + ms(5000)); // Dernière trame traitée et remise à la tâche MQTT
+    kernel.shutdown();
+
+    const auto& expected = session.telemetry;
+    size_t common = std::min(expected.size(), produced.size());
+    size_t divergence = common;
+    for (size_t i = 0; i < common; i++) {
+        if (expected[i] != produced[i]) {
+            divergence = i;
+            break;
+        }
+    }
+    bool identical = divergence == common && expected.size() == produced.size();
+
+    if (options.json) {
+        printf("{\"replay\":\"%s\",\"session\":%d,\"speed\":%.2f,\"devices\":%zu,\"frames\":%zu,\"injected\":%zu,"
+               "\"missed\":%zu,\"skipped\":%zu,\"telemetry_expected\":%zu,\"telemetry_produced\":%zu,"
+               "\"matching_prefix\":%zu,\"identical\":%s}\n",
+               options.replay.c_str(), number, options.replaySpeed, session.devices.size(), session.frames.size(), injected,
+               missed, skipped, expected.size(), produced.size(), divergence, identical ? "true" : "false");
+        return identical ? 0 : 1;
+    }
+
+    printf("Replay      %s, session %d/%zu (firmware %.16s), speed x%g\n", options.replay.c_str(), number, sessions.size(),
+           session.config.firmware, options.replaySpeed);
+    printf("Devices     %zu restored from the capture\n", session.devices.size());
+    printf("Frames      %zu captured, %zu injected, %zu missed (gateway not listening), %zu skipped (radio error)\n",
+           session.frames.size(), injected, missed, skipped);
+    printf("Telemetry   %zu captured, %zu produced, %s\n", expected.size(), produced.size(),
+           identical ? "identical" : "DIFFERENT");
+    if (!identical) {
+        printf("            first difference at message %zu\n", divergence + 1);
+        if (divergence < expected.size()) {
+            printf("  captured  node %u %s\n", expected[divergence].first, expected[divergence].second.c_str());
+        }
+        if (divergence < produced.size()) {
+            printf("  replayed  node %u %s\n", produced[divergence].first, produced[divergence].second.c_str());
+        }
+    }
+    return identical ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parse(argc, argv, options)) return 2;
+    if (!options.replay.empty()) return runReplay(options);
+    bool storm = options.scenario == "join-storm";
+    nodeTraffic.eventMeanIntervalMs = options.eventMeanS * 1000;
+
+    Kernel& kernel = Kernel::instance();
+    Channel channel(options.channel);
+    Channel::install(&channel);
+    std::mt19937 placement(options.channel.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    std::vector<Device*> devices;
+    auto addDevice = [&](const std::string& kind, int number, void (*boot)(Device&)) {
+        Device* device = new Device();
+        device->index = devices.size();
+        device->kind = kind;
+        device->name = kind == "gateway" || kind == "swarm" ? kind : kind + std::to_string(number);
+        device->boot = boot;
+        device->rng.seed(options.channel.seed * 7919u + device->index);
+        uint8_t mac[6] = { 0x24, 0x0A, 0xC4, (uint8_t)(kind[0]), (uint8_t)(device->index >> 8), (uint8_t)device->index };
+        memcpy(device->mac, mac, sizeof(mac));
+        if (kind != "gateway") {
+            double r = options.radiusM * std::sqrt(unit(placement));
+            double angle = 2 * M_PI * unit(placement);
+            device->x = r * std::cos(angle);
+            device->y = r * std::sin(angle);
+        }
+        device->logging = options.log == "all" || options.log == device->name;
+        devices.push_back(device);
+        channel.addDevice(device);
+        return device;
+    };
+
+    Device* gateway = addDevice("gateway", 0, bootGateway);
+    channel.setGateway(gateway);
+    for (int i = 0; i < options.wellguard; i++) addDevice("wellguard", i, bootWellguard);
+    for (int i = 0; i < options.aqua; i++) addDevice("aqua", i, bootAqua);
+    Device* swarm = options.swarm ? addDevice("swarm", 0, bootSwarm) : nullptr;
+
+    // Suivi des télémétries : première émission vue sur l'air, puis remise par la passerelle
+    std::map<uint64_t, UplinkRecord> uplinks;
+    std::map<std::string, uint64_t> framesByType;
+    uint64_t undecodable = 0;
+    channel.observer = [&](Device& source, const uint8_t* data, size_t length) {
+        FrameInfo info;
+        if (!decodeFrame(data, length, info)) {
+            undecodable++;
+            return;
+        }
+        framesByType[info.type]++;
+        if (&source == gateway || info.type != "TELEMETRY" || info.nodeId <= 0) return;
+        source.nodeId = info.nodeId;
+        uint64_t key = (uint64_t)info.nodeId << 32 | info.msgCtr;
+        auto it = uplinks.find(key);
+        if (it == uplinks.end() || (it->second.delivered != NEVER && !info.confirmed)) {
+            // Nouveau message, ou compteur réutilisé après une nouvelle adhésion
+            it = uplinks.insert_or_assign(key, UplinkRecord{ kernel.now() }).first;
+        }
+        it->second.frames++;
+        it->second.confirmed = info.confirmed;
+    };
+    onGatewayDelivery = [&](uint8_t nodeId, uint32_t msgCtr) {
+        auto it = uplinks.find((uint64_t)nodeId << 32 | msgCtr);
+        if (it != uplinks.end() && it->second.delivered == NEVER) it->second.delivered = kernel.now();
+    };
+
+    // Mise sous tension : la passerelle d'abord, puis les modules ensemble (tempête) ou étalés sur une minute
+    powerOn(*gateway, 0);
+    Time nodesStart = ms(5000);
+    for (Device* device : devices) {
+        if (device == gateway) continue;
+        powerOn(*device, storm ? nodesStart : nodesStart + (Time)(unit(placement) * ms(60000)));
+    }
+
+    Time measureStart = nodesStart + (Time)(options.warmupS * 1e6);
+    Time end = measureStart + (Time)(options.durationS * 1e6);
+    kernel.run(measureStart);
+    Snapshot before = snapshot(channel, devices);
+    kernel.run(end);
+    Snapshot after = snapshot(channel, devices);
+    kernel.shutdown();
+
+    // ------------------------------------------------------------------ Rapport
+    double window = (after.time - before.time) / 1e6;
+    Time drain = ms(30000); // Les messages émis en fin de fenêtre peuvent encore être en cours de remise
+    size_t offered = 0, delivered = 0, confirmedOffered = 0, confirmedDelivered = 0;
+    std::vector<double> latencies;
+    for (const auto& entry : uplinks) {
+        const UplinkRecord& record = entry.second;
+        if (record.firstTx < measureStart || record.firstTx + drain > end) continue;
+        offered++;
+        if (record.confirmed) confirmedOffered++;
+        if (record.delivered == NEVER) continue;
+        delivered++;
+        if (record.confirmed) confirmedDelivered++;
+        latencies.push_back((record.delivered - record.firstTx) / 1000.0);
+    }
+
+    // La carte NodeSwarm a son propre bilan : ses modules virtuels ne comptent pas parmi les modules
+    std::vector<double> joinTimes;
+    size_t nodes = devices.size() - 1 - (swarm ? 1 : 0);
+    for (Device* device : devices) {
+        if (device == gateway || device == swarm || device->joinedAt == NEVER) continue;
+        joinTimes.push_back((device->joinedAt - device->bootedAt) / 1e6);
+    }
+
+    uint64_t outcomes[UPLINK_OUTCOME_COUNT];
+    uint64_t uplinkFrames = 0;
+    for (int i = 0; i < UPLINK_OUTCOME_COUNT; i++) {
+        outcomes[i] = after.outcomes[i] - before.outcomes[i];
+        uplinkFrames += outcomes[i];
+    }
+    static const char* outcomeNames[UPLINK_OUTCOME_COUNT] = { "received", "collided", "gateway_busy", "locked_other", "too_weak" };
+
+    double gatewayDuty = (after.txAirtime[0] - before.txAirtime[0]) / 1e6 / window;
+    double nodeDutyMax = 0, nodeDutySum = 0;
+    for (size_t i = 1; i < devices.size(); i++) {
+        if (devices[i] == swarm) continue;
+        double duty = (after.txAirtime[i] - before.txAirtime[i]) / 1e6 / window;
+        nodeDutyMax = std::max(nodeDutyMax, duty);
+        nodeDutySum += duty;
+    }
+    double swarmDuty = swarm ? (after.txAirtime[swarm->index] - before.txAirtime[swarm->index]) / 1e6 / window : 0;
+    double swarmJoinS = swarm && swarm->joinedAt != NEVER ? (swarm->joinedAt - swarm->bootedAt) / 1e6 : NAN;
+    double utilization = (after.busyTime - before.busyTime) / 1e6 / window;
+    double deliveryRatio = offered ? (double)delivered / offered : NAN;
+
+    if (options.json) {
+        printf("{\"scenario\":\"%s\",\"seed\":%u,\"wellguard\":%d,\"aqua\":%d,\"window_s\":%.1f,",
+               options.scenario.c_str(), options.channel.seed, options.wellguard, options.aqua, window);
+        printf("\"join\":{\"nodes\":%zu,\"joined\":%zu,\"p50_s\":%.2f,\"p90_s\":%.2f,\"max_s\":%.2f},",
+               nodes, joinTimes.size(), percentile(joinTimes, 50), percentile(joinTimes, 90), percentile(joinTimes, 100));
+        printf("\"telemetry\":{\"offered\":%zu,\"delivered\":%zu,\"delivery_ratio\":%.4f,"
+               "\"confirmed_offered\":%zu,\"confirmed_delivered\":%zu,",
+               offered, delivered, deliveryRatio, confirmedOffered, confirmedDelivered);
+        printf("\"latency_ms\":{\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f}},",
+               percentile(latencies, 50), percentile(latencies, 90), percentile(latencies, 99), percentile(latencies, 100));
+        if (swarm) {
+            printf("\"swarm\":{\"nodes\":%d,\"joined\":%d,\"all_joined_s\":%.2f,\"duty_cycle\":%.4f},",
+                   swarmNodeCount, swarmJoined(*swarm), swarmJoinS, swarmDuty);
+        }
+        printf("\"uplink_frames\":{");
+        for (int i = 0; i < UPLINK_OUTCOME_COUNT; i++) printf("%s\"%s\":%llu", i ? "," : "", outcomeNames[i], (unsigned long long)outcomes[i]);
+        printf("},\"frames_by_type\":{");
+        bool first = true;
+        for (const auto& entry : framesByType) {
+            printf("%s\"%s\":%llu", first ? "" : ",", entry.first.c_str(), (unsigned long long)entry.second);
+            first = false;
+        }
+        printf("},\"channel_utilization\":%.4f,\"gateway_duty_cycle\":%.4f,\"node_duty_cycle_avg\":%.5f,\"node_duty_cycle_max\":%.5f}\n",
+               utilization, gatewayDuty, nodes ? nodeDutySum / nodes : 0.0, nodeDutyMax);
+        return 0;
+    }
+
+    printf("Scenario %s: %d WellguardPro + %d AquaReservPro, seed %u, SF %s, radius %.0f m\n", options.scenario.c_str(),
+           options.wellguard, options.aqua, options.channel.seed,
+           options.channel.spreadingFactor ? std::to_string(options.channel.spreadingFactor).c_str() : "firmware",
+           options.radiusM);
+    printf("Measured window: %.0f s (after %.0f s warm-up)\n\n", window, options.warmupS);
+    printf("Join        %zu/%zu joined, time to join p50 %.1f s, p90 %.1f s, max %.1f s\n", joinTimes.size(), nodes,
+           percentile(joinTimes, 50), percentile(joinTimes, 90), percentile(joinTimes, 100));
+    printf("Telemetry   %zu offered, %zu delivered (%.1f %%), confirmed %zu/%zu\n", offered, delivered,
+           deliveryRatio * 100, confirmedDelivered, confirmedOffered);
+    if (swarm) {
+        printf("Swarm       %d/%d virtual nodes joined, all joined after %.1f s, duty cycle %.2f %%\n", swarmJoined(*swarm),
+               swarmNodeCount, swarmJoinS, swarmDuty * 100);
+    }
+    printf("Latency     p50 %.0f ms, p90 %.0f ms, p99 %.0f ms, max %.0f ms\n", percentile(latencies, 50),
+           percentile(latencies, 90), percentile(latencies, 99), percentile(latencies, 100));
+    printf("Uplinks     %llu frames:", (unsigned long long)uplinkFrames);
+    for (int i = 0; i < UPLINK_OUTCOME_COUNT; i++) printf(" %s %llu", outcomeNames[i], (unsigned long long)outcomes[i]);
+    printf("\nFrames      (whole run) ");
+    for (const auto& entry : framesByType) printf("%s %llu  ", entry.first.c_str(), (unsigned long long)entry.second);
+    if (undecodable) printf("undecodable %llu", (unsigned long long)undecodable);
+    printf("\nAirtime     channel busy %.2f %%, gateway duty cycle %.2f %%, nodes avg %.3f %% max %.3f %%\n",
+           utilization * 100, gatewayDuty * 100, nodes ? nodeDutySum / nodes * 100 : 0.0, nodeDutyMax * 100);
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include <AESLib.h>
+
+// AES (FIPS 197), version table-S compacte : la vitesse importe peu à l'échelle d'une trame
+static const uint8_t sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+static uint8_t inverseSbox[256];
+
+static uint8_t xtime(uint8_t x) {
+    return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1b : 0));
+}
+
+static uint8_t multiply(uint8_t a, uint8_t b) {
+    uint8_t result = 0;
+    while (b) {
+        if (b & 1) result ^= a;
+        a = xtime(a);
+        b >>= 1;
+    }
+    return result;
+}
+
+// Clés de tour pour AES-128/192/256 (la taille est donnée en octets ou en bits, comme AESLib)
+static int expandKey(const byte key[], int bits, uint8_t roundKeys[240]) {
+    int keyBytes = bits > 32 ? bits / 8 : bits;
+    if (keyBytes != 16 && keyBytes != 24 && keyBytes != 32) keyBytes = 16;
+    int nk = keyBytes / 4;
+    int rounds = nk + 6;
+    memcpy(roundKeys, key, keyBytes);
+    uint8_t rcon = 1;
+    for (int i = nk; i < 4 * (rounds + 1); i++) {
+        uint8_t t[4];
+        memcpy(t, roundKeys + 4 * (i - 1), 4);
+        if (i % nk == 0) {
+            uint8_t first = t[0];
+            t[0] = sbox[t[1]] ^ rcon;
+            t[1] = sbox[t[2]];
+            t[2] = sbox[t[3]];
+            t[3] = sbox[first];
+            rcon = xtime(rcon);
+        } else if (nk > 6 && i % nk == 4) {
+            for (int j = 0; j < 4; j++) t[j] = sbox[t[j]];
+        }
+        for (int j = 0; j < 4; j++) roundKeys[4 * i + j] = roundKeys[4 * (i - nk) + j] ^ t[j];
+    }
+    return rounds;
+}
+
+static void encryptBlock(uint8_t s[16], const uint8_t* roundKeys, int rounds) {
+    for (int i = 0; i < 16; i++) s[i] ^= roundKeys[i];
+    for (int round = 1; round <= rounds; round++) {
+        uint8_t t[16];
+        for (int i = 0; i < 16; i++) t[i] = sbox[s[(i + 4 * (i % 4)) % 16]]; // SubBytes + ShiftRows
+        if (round != rounds) {
+            for (int c = 0; c < 4; c++) {
+                uint8_t* col = t + 4 * c;
+                uint8_t a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+                col[0] = xtime(a0) ^ xtime(a1) ^ a1 ^ a2 ^ a3;
+                col[1] = a0 ^ xtime(a1) ^ xtime(a2) ^ a2 ^ a3;
+                col[2] = a0 ^ a1 ^ xtime(a2) ^ xtime(a3) ^ a3;
+                col[3] = xtime(a0) ^ a0 ^ a1 ^ a2 ^ xtime(a3);
+            }
+        }
+        for (int i = 0; i < 16; i++) s[i] = t[i] ^ roundKeys[16 * round + i];
+    }
+}
+
+static void decryptBlock(uint8_t s[16], const uint8_t* roundKeys, int rounds) {
+    if (!inverseSbox[sbox[1]]) {
+        for (int i = 0; i < 256; i++) inverseSbox[sbox[i]] = (uint8_t)i;
+    }
+    for (int i = 0; i < 16; i++) s[i] ^= roundKeys[16 * rounds + i];
+    for (int round = rounds - 1; round >= 0; round--) {
+        uint8_t t[16];
+        for (int i = 0; i < 16; i++) t[(i + 4 * (i % 4)) % 16] = inverseSbox[s[i]]; // InvShiftRows + InvSubBytes
+        for (int i = 0; i < 16; i++) t[i] ^= roundKeys[16 * round + i];
+        if (round != 0) {
+            for (int c = 0; c < 4; c++) {
+                uint8_t* col = t + 4 * c;
+                uint8_t a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+                col[0] = multiply(a0, 14) ^ multiply(a1, 11) ^ multiply(a2, 13) ^ multiply(a3, 9);
+                col[1] = multiply(a0, 9) ^ multiply(a1, 14) ^ multiply(a2, 11) ^ multiply(a3, 13);
+                col[2] = multiply(a0, 13) ^ multiply(a1, 9) ^ multiply(a2, 14) ^ multiply(a3, 11);
+                col[3] = multiply(a0, 11) ^ multiply(a1, 13) ^ multiply(a2, 9) ^ multiply(a3, 14);
+            }
+        }
+        memcpy(s, t, 16);
+    }
+}
+
+uint16_t AESLib::encrypt(const byte input[], uint16_t input_length, byte* output, const byte key[], int bits, const byte my_iv[]) {
+    uint8_t roundKeys[240];
+    int rounds = expandKey(key, bits, roundKeys);
+    uint8_t chain[16];
+    memcpy(chain, my_iv, 16);
+    uint16_t blocks = input_length / 16;
+    for (uint16_t b = 0; b < blocks; b++) {
+        for (int i = 0; i < 16; i++) chain[i] ^= input[16 * b + i];
+        encryptBlock(chain, roundKeys, rounds);
+        memcpy(output + 16 * b, chain, 16);
+    }
+    return blocks * 16;
+}
+
+// Seuls les blocs complets sont déchiffrés ; la fin d'un tampon incomplet est mise à zéro
+uint16_t AESLib::decrypt(const byte input[], uint16_t input_length, byte* output, const byte key[], int bits, const byte my_iv[]) {
+    uint8_t roundKeys[240];
+    int rounds = expandKey(key, bits, roundKeys);
+    uint8_t chain[16];
+    memcpy(chain, my_iv, 16);
+    uint16_t blocks = input_length / 16;
+    for (uint16_t b = 0; b < blocks; b++) {
+        uint8_t block[16];
+        memcpy(block, input + 16 * b, 16);
+        decryptBlock(block, roundKeys, rounds);
+        for (int i = 0; i < 16; i++) output[16 * b + i] = block[i] ^ chain[i];
+        memcpy(chain, input + 16 * b, 16);
+    }
+    memset(output + 16 * blocks, 0, input_length - 16 * blocks);
+    return blocks * 16;
+}
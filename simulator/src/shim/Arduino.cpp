@@ -0,0 +1,133 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include "Device.h"
+
+using sim::Kernel;
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+
+static std::mt19937 hostRng(1);
+
+static std::mt19937& rng() {
+    sim::Device* device = Kernel::instance().currentDevice();
+    return device ? device->rng : hostRng;
+}
+
+unsigned long millis() {
+    Kernel& kernel = Kernel::instance();
+    sim::Device* device = kernel.currentDevice();
+    return (kernel.now() - (device ? device->clockBase : 0)) / 1000;
+}
+
+unsigned long micros() {
+    Kernel& kernel = Kernel::instance();
+    sim::Device* device = kernel.currentDevice();
+    return kernel.now() - (device ? device->clockBase : 0);
+}
+
+void delay(uint32_t ms) {
+    Kernel& kernel = Kernel::instance();
+    kernel.sleepUntil(kernel.now() + sim::ms(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+    Kernel& kernel = Kernel::instance();
+    kernel.sleepUntil(kernel.now() + us);
+}
+
+void yield() {
+    Kernel& kernel = Kernel::instance();
+    if (kernel.currentTask()) kernel.sleepUntil(kernel.now());
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    (void)pin;
+    (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    (void)pin;
+    (void)value;
+}
+
+// Seule la ligne DIO1 de la radio est câblée
+int digitalRead(uint8_t pin) {
+    sim::Device* device = Kernel::instance().currentDevice();
+    if (device && pin == device->radio.dio1Pin) return device->radio.irq ? HIGH : LOW;
+    return LOW;
+}
+
+uint16_t analogRead(uint8_t pin) {
+    (void)pin;
+    return 0;
+}
+
+long random(long howbig) {
+    if (howbig <= 0) return 0;
+    return std::uniform_int_distribution<long>(0, howbig - 1)(rng());
+}
+
+long random(long howsmall, long howbig) {
+    if (howsmall >= howbig) return howsmall;
+    return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+    rng().seed(seed);
+}
+
+uint32_t esp_random() {
+    return rng()();
+}
+
+// Une ligne n'est émise qu'une fois complète, préfixée du temps virtuel et de l'appareil
+size_t HardwareSerial::write(const char* text, size_t length) {
+    sim::Device* device = Kernel::instance().currentDevice();
+    if (!device || !device->logging) return length;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '\n') {
+            sim::Time now = Kernel::instance().now();
+            fprintf(stderr, "[%6lu.%06lu] %-10s %s\n", (unsigned long)(now / 1000000), (unsigned long)(now % 1000000),
+                    device->name.c_str(), device->logLine.c_str());
+            device->logLine.clear();
+        } else if (text[i] != '\r') {
+            device->logLine += text[i];
+        }
+    }
+    return length;
+}
+
+size_t HardwareSerial::print(const char* text) {
+    return write(text, strlen(text));
+}
+
+size_t HardwareSerial::printf(const char* format, ...) {
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0) return 0;
+    return write(buffer, std::min((size_t)length, sizeof(buffer) - 1));
+}
+
+void EspClass::restart() {
+    Kernel& kernel = Kernel::instance();
+    sim::Device* device = kernel.currentDevice();
+    if (!device) abort();
+    sim::rebootDevice(*device, sim::ms(300));
+    kernel.exitCurrent();
+    abort();
+}
+
+String WiFiClass::macAddress() {
+    sim::Device* device = Kernel::instance().currentDevice();
+    char text[18] = "00:00:00:00:00:00";
+    if (device) {
+        snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", device->mac[0], device->mac[1], device->mac[2],
+                 device->mac[3], device->mac[4], device->mac[5]);
+    }
+    return String(text);
+}
@@ -0,0 +1,81 @@
+#include <Base64.h>
+
+static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static unsigned char lookup(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 71;
+    if (c >= '0' && c <= '9') return c + 4;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return 0xff;
+}
+
+static void toQuad(unsigned char* a4, const unsigned char* a3) {
+    a4[0] = (a3[0] & 0xfc) >> 2;
+    a4[1] = ((a3[0] & 0x03) << 4) + ((a3[1] & 0xf0) >> 4);
+    a4[2] = ((a3[1] & 0x0f) << 2) + ((a3[2] & 0xc0) >> 6);
+    a4[3] = a3[2] & 0x3f;
+}
+
+static void fromQuad(unsigned char* a3, const unsigned char* a4) {
+    a3[0] = (a4[0] << 2) + ((a4[1] & 0x30) >> 4);
+    a3[1] = ((a4[1] & 0xf) << 4) + ((a4[2] & 0x3c) >> 2);
+    a3[2] = ((a4[2] & 0x3) << 6) + a4[3];
+}
+
+int base64_encode(char* output, char* input, int inputLen) {
+    int i = 0, encLen = 0;
+    unsigned char a3[3], a4[4];
+    while (inputLen--) {
+        a3[i++] = *(input++);
+        if (i == 3) {
+            toQuad(a4, a3);
+            for (i = 0; i < 4; i++) output[encLen++] = alphabet[a4[i]];
+            i = 0;
+        }
+    }
+    if (i) {
+        for (int j = i; j < 3; j++) a3[j] = '\0';
+        toQuad(a4, a3);
+        for (int j = 0; j < i + 1; j++) output[encLen++] = alphabet[a4[j]];
+        while (i++ < 3) output[encLen++] = '=';
+    }
+    output[encLen] = '\0';
+    return encLen;
+}
+
+// Comme la bibliothèque d'origine : le décodage s'arrête au premier '=', les caractères inconnus ne sont pas filtrés
+int base64_decode(char* output, char* input, int inputLen) {
+    int i = 0, decLen = 0;
+    unsigned char a3[3], a4[4];
+    while (inputLen--) {
+        if (*input == '=') break;
+        a4[i++] = *(input++);
+        if (i == 4) {
+            for (i = 0; i < 4; i++) a4[i] = lookup(a4[i]);
+            fromQuad(a3, a4);
+            for (i = 0; i < 3; i++) output[decLen++] = a3[i];
+            i = 0;
+        }
+    }
+    if (i) {
+        for (int j = i; j < 4; j++) a4[j] = '\0';
+        for (int j = 0; j < 4; j++) a4[j] = lookup(a4[j]);
+        fromQuad(a3, a4);
+        for (int j = 0; j < i - 1; j++) output[decLen++] = a3[j];
+    }
+    output[decLen] = '\0';
+    return decLen;
+}
+
+int base64_enc_len(int plainLen) {
+    int n = plainLen;
+    return (n + 2 - ((n + 2) % 3)) / 3 * 4;
+}
+
+int base64_dec_len(char* input, int inputLen) {
+    int numEq = 0;
+    for (int i = inputLen - 1; i >= 0 && input[i] == '='; i--) numEq++;
+    return ((6 * inputLen) / 8) - numEq;
+}
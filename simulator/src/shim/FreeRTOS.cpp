@@ -0,0 +1,236 @@
+#include <Arduino.h>
+#include "Device.h"
+#include <algorithm>
+#include <deque>
+#include <list>
+
+using sim::Kernel;
+using sim::Task;
+
+namespace sim {
+
+struct Queue {
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+    std::list<Task*> senders;        // Tâches bloquées sur une file pleine
+    std::list<Task*> receivers;      // Tâches bloquées sur une file vide
+};
+
+} // namespace sim
+
+using sim::Queue;
+
+// Inscrit la tâche courante dans une liste d'attente le temps d'un blocage (retirée même si elle est arrêtée)
+struct WaitListEntry {
+    std::list<Task*>& list;
+    std::list<Task*>::iterator position;
+    WaitListEntry(std::list<Task*>& waiters, Task* task) : list(waiters), position(waiters.insert(waiters.end(), task)) {}
+    ~WaitListEntry() { list.erase(position); }
+};
+
+static sim::Time deadlineFor(TickType_t ticks) {
+    Kernel& kernel = Kernel::instance();
+    return ticks == portMAX_DELAY ? sim::NEVER : kernel.now() + sim::ms(ticks);
+}
+
+static void wakeAll(std::list<Task*>& waiters) {
+    for (Task* task : waiters) Kernel::instance().wake(task);
+}
+
+// ----------------------------------------------------------------- Tâches
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stackDepth, void* parameters,
+                                   UBaseType_t priority, TaskHandle_t* createdTask, BaseType_t coreId) {
+    (void)stackDepth;
+    (void)priority;
+    (void)coreId;
+    Kernel& kernel = Kernel::instance();
+    Task* task = kernel.spawn(kernel.currentDevice(), code, parameters, name);
+    if (createdTask) *createdTask = task;
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stackDepth, void* parameters,
+                       UBaseType_t priority, TaskHandle_t* createdTask) {
+    return xTaskCreatePinnedToCore(code, name, stackDepth, parameters, priority, createdTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    Kernel& kernel = Kernel::instance();
+    if (!task || task == kernel.currentTask()) kernel.exitCurrent();
+    kernel.kill(task);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    delay(ticks);
+}
+
+void taskYIELD() {
+    yield();
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return Kernel::instance().currentTask();
+}
+
+const char* pcTaskGetName(TaskHandle_t task) {
+    if (!task) task = Kernel::instance().currentTask();
+    return task ? task->name.c_str() : "";
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    (void)task;
+    return 4096;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    Kernel& kernel = Kernel::instance();
+    Task* self = kernel.currentTask();
+    sim::Time deadline = deadlineFor(ticksToWait);
+    while (self->notifyValue == 0 && ticksToWait != 0 && kernel.now() < deadline) {
+        self->waitingNotify = true;
+        kernel.wait(deadline);
+        self->waitingNotify = false;
+    }
+    uint32_t value = self->notifyValue;
+    if (value) self->notifyValue = clearCountOnExit ? 0 : value - 1;
+    return value;
+}
+
+// Les globales d'un firmware sont partagées par tous les modules du même type : un handle de
+// tâche rangé dans une variable statique (tâche radio réveillée par DIO1) est celui du dernier
+// module qui l'a écrit. La notification va à la tâche de même nom du module appelant.
+static Task* deviceTask(Task* task) {
+    sim::Device* device = Kernel::instance().currentDevice();
+    if (!device || task->device == device) return task;
+    for (Task* candidate : device->tasks) {
+        if (!candidate->finished && candidate->name == task->name) return candidate;
+    }
+    return nullptr;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    if (task) task = deviceTask(task);
+    if (!task) return pdFAIL;
+    task->notifyValue++;
+    if (task->waitingNotify) Kernel::instance().wake(task);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    xTaskNotifyGive(task);
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+}
+
+// ------------------------------------------------------------------ Files
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    if (length == 0) return nullptr;
+    return new Queue{ length, itemSize, {}, {}, {} };
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+static BaseType_t queueSend(Queue* queue, const void* item, TickType_t ticksToWait, bool front) {
+    if (!queue) return pdFAIL;
+    Kernel& kernel = Kernel::instance();
+    sim::Time deadline = deadlineFor(ticksToWait);
+    while (queue->items.size() >= queue->length) {
+        // Hors tâche (interruption, rappel du noyau), on ne peut pas attendre
+        if (ticksToWait == 0 || !kernel.currentTask() || kernel.now() >= deadline) return errQUEUE_FULL;
+        WaitListEntry entry(queue->senders, kernel.currentTask());
+        kernel.wait(deadline);
+    }
+    std::vector<uint8_t> data(queue->itemSize);
+    if (item && queue->itemSize) memcpy(data.data(), item, queue->itemSize);
+    if (front) queue->items.push_front(std::move(data));
+    else queue->items.push_back(std::move(data));
+    wakeAll(queue->receivers);
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return queueSend(queue, item, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return queueSend(queue, item, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return queueSend(queue, item, ticksToWait, true);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* higherPriorityTaskWoken) {
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+    return queueSend(queue, item, 0, false);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void* item) {
+    if (!queue) return pdFAIL;
+    queue->items.clear();
+    return queueSend(queue, item, 0, false);
+}
+
+static BaseType_t queueReceive(Queue* queue, void* buffer, TickType_t ticksToWait, bool remove) {
+    if (!queue) return pdFAIL;
+    Kernel& kernel = Kernel::instance();
+    sim::Time deadline = deadlineFor(ticksToWait);
+    while (queue->items.empty()) {
+        if (ticksToWait == 0 || !kernel.currentTask() || kernel.now() >= deadline) return pdFAIL;
+        WaitListEntry entry(queue->receivers, kernel.currentTask());
+        kernel.wait(deadline);
+    }
+    if (buffer && queue->itemSize) memcpy(buffer, queue->items.front().data(), queue->itemSize);
+    if (remove) {
+        queue->items.pop_front();
+        wakeAll(queue->senders);
+    }
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* buffer, TickType_t ticksToWait) {
+    return queueReceive(queue, buffer, ticksToWait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* buffer, TickType_t ticksToWait) {
+    return queueReceive(queue, buffer, ticksToWait, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return queue ? queue->items.size() : 0;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    return queue ? queue->length - queue->items.size() : 0;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    if (!queue) return pdFAIL;
+    queue->items.clear();
+    wakeAll(queue->senders);
+    return pdPASS;
+}
+
+// ------------------------------------------------------------- Sémaphores
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    Queue* queue = xQueueCreate(maxCount, 0);
+    for (UBaseType_t i = 0; i < initialCount && i < maxCount; i++) queue->items.emplace_back();
+    return queue;
+}
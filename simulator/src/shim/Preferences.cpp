@@ -0,0 +1,69 @@
+#include <Preferences.h>
+#include "Device.h"
+
+static sim::NvsNamespace* openNamespace(const std::string& name) {
+    sim::Device* device = sim::Kernel::instance().currentDevice();
+    return device ? &device->nvs[name] : nullptr;
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partitionLabel) {
+    (void)readOnly;
+    (void)partitionLabel;
+    if (!name || !openNamespace(name)) return false;
+    ns = name;
+    opened = true;
+    return true;
+}
+
+void Preferences::end() {
+    opened = false;
+}
+
+bool Preferences::clear() {
+    sim::NvsNamespace* nvs = opened ? openNamespace(ns) : nullptr;
+    if (!nvs) return false;
+    nvs->clear();
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    sim::NvsNamespace* nvs = opened ? openNamespace(ns) : nullptr;
+    return nvs && nvs->erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    sim::NvsNamespace* nvs = opened ? openNamespace(ns) : nullptr;
+    return nvs && nvs->count(key) > 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+    sim::NvsNamespace* nvs = opened ? openNamespace(ns) : nullptr;
+    if (!nvs || !key || !value) return 0;
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    (*nvs)[key] = std::vector<uint8_t>(bytes, bytes + length);
+    return length;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    sim::NvsNamespace* nvs = opened ? openNamespace(ns) : nullptr;
+    if (!nvs) return 0;
+    auto it = nvs->find(key);
+    return it == nvs->end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+    sim::NvsNamespace* nvs = opened ? openNamespace(ns) : nullptr;
+    if (!nvs) return 0;
+    auto it = nvs->find(key);
+    if (it == nvs->end() || it->second.size() > maxLength) return 0;
+    memcpy(buffer, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+    size_t length = getBytesLength(key);
+    if (length == 0) return defaultValue;
+    std::vector<char> buffer(length);
+    getBytes(key, buffer.data(), length);
+    return String(buffer.data());
+}
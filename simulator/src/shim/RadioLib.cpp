@@ -0,0 +1,196 @@
+#include <RadioLib.h>
+#include "Channel.h"
+
+using sim::Channel;
+using sim::Kernel;
+using sim::RadioState;
+
+static RadioState& state() {
+    sim::Device* device = Kernel::instance().currentDevice();
+    if (!device) {
+        fprintf(stderr, "sim: radio used outside of a device context\n");
+        abort();
+    }
+    return device->radio;
+}
+
+static sim::Device& device() {
+    return *Kernel::instance().currentDevice();
+}
+
+static void clearIrq(RadioState& radio) {
+    radio.irq = false;
+    radio.rxDone = false;
+    radio.crcError = false;
+}
+
+int16_t SX1262::begin(float freq, float bw, uint8_t sf, uint8_t cr, uint8_t syncWord, int8_t power,
+                      uint16_t preambleLength, float tcxoVoltage, bool useRegulatorLDO) {
+    (void)syncWord;
+    (void)tcxoVoltage;
+    (void)useRegulatorLDO;
+    RadioState& radio = state();
+    radio.mode = RadioState::STANDBY;
+    radio.lock = nullptr;
+    radio.dio1Pin = module->irqPin;
+    radio.preambleLength = preambleLength;
+    clearIrq(radio);
+    int16_t result;
+    if ((result = setFrequency(freq)) != RADIOLIB_ERR_NONE) return result;
+    if ((result = setBandwidth(bw)) != RADIOLIB_ERR_NONE) return result;
+    if ((result = setSpreadingFactor(sf)) != RADIOLIB_ERR_NONE) return result;
+    if ((result = setCodingRate(cr)) != RADIOLIB_ERR_NONE) return result;
+    return setOutputPower(power);
+}
+
+int16_t SX1262::setFrequency(float freq) {
+    if (freq < 150.0f || freq > 960.0f) return RADIOLIB_ERR_INVALID_FREQUENCY;
+    state().frequencyMhz = freq;
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::setBandwidth(float bw) {
+    static const float allowed[] = { 7.8f, 10.4f, 15.6f, 20.8f, 31.25f, 41.7f, 62.5f, 125.0f, 250.0f, 500.0f };
+    for (float value : allowed) {
+        if (std::fabs(bw - value) < 0.01f) {
+            state().bandwidthKhz = value;
+            return RADIOLIB_ERR_NONE;
+        }
+    }
+    return RADIOLIB_ERR_INVALID_BANDWIDTH;
+}
+
+// Un SF imposé par la ligne de commande prime sur celui du firmware
+int16_t SX1262::setSpreadingFactor(uint8_t sf) {
+    if (sf < 5 || sf > 12) return RADIOLIB_ERR_INVALID_SPREADING_FACTOR;
+    uint8_t forced = Channel::active().configuration().spreadingFactor;
+    state().spreadingFactor = forced ? forced : sf;
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::setCodingRate(uint8_t cr) {
+    if (cr < 5 || cr > 8) return RADIOLIB_ERR_INVALID_CODING_RATE;
+    state().codingRate = cr;
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::setOutputPower(int8_t power) {
+    if (power < -9 || power > 22) return RADIOLIB_ERR_INVALID_OUTPUT_POWER;
+    state().powerDbm = power;
+    return RADIOLIB_ERR_NONE;
+}
+
+// Émission bloquante : la tâche dort pendant le temps d'antenne, puis TxDone lève DIO1
+int16_t SX1262::transmit(const uint8_t* data, size_t len, uint8_t addr) {
+    (void)addr;
+    if (len > RADIOLIB_SX126X_MAX_PACKET_LENGTH) return RADIOLIB_ERR_PACKET_TOO_LONG;
+    Kernel& kernel = Kernel::instance();
+    RadioState& radio = state();
+    clearIrq(radio);
+    radio.mode = RadioState::TX;
+    sim::Time end = Channel::active().transmit(device(), data, len);
+    kernel.sleepUntil(end);
+    radio.mode = RadioState::STANDBY;
+    radio.irq = true;
+    if (radio.dio1Action) radio.dio1Action();
+    clearIrq(radio);
+    return RADIOLIB_ERR_NONE;
+}
+
+// Réception bloquante en mode simple : expire après ~100 symboles si aucune trame n'a été accrochée
+int16_t SX1262::receive(uint8_t* data, size_t len) {
+    Kernel& kernel = Kernel::instance();
+    RadioState& radio = state();
+    startReceive();
+    sim::Time symbolUs = (sim::Time)((1UL << radio.spreadingFactor) * 1000.0 / radio.bandwidthKhz);
+    sim::Time deadline = kernel.now() + 100 * symbolUs;
+    radio.waiter = kernel.currentTask();
+    while (!radio.rxDone) {
+        if (kernel.now() >= deadline) {
+            if (!radio.lock) break;
+            deadline = radio.lock->tx->end;
+        }
+        kernel.wait(deadline);
+    }
+    radio.waiter = nullptr;
+    if (!radio.rxDone) {
+        standby();
+        return RADIOLIB_ERR_RX_TIMEOUT;
+    }
+    int16_t result = readData(data, len);
+    standby();
+    return result;
+}
+
+int16_t SX1262::receive(String& str, size_t len) {
+    uint8_t buffer[RADIOLIB_SX126X_MAX_PACKET_LENGTH + 1];
+    int16_t result = receive(buffer, len ? std::min(len, sizeof(buffer) - 1) : RADIOLIB_SX126X_MAX_PACKET_LENGTH);
+    if (result == RADIOLIB_ERR_NONE) {
+        str = String((const char*)buffer, getPacketLength());
+    }
+    return result;
+}
+
+int16_t SX1262::startReceive() {
+    RadioState& radio = state();
+    radio.mode = RadioState::RX;
+    radio.lock = nullptr;
+    clearIrq(radio);
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::readData(uint8_t* data, size_t len) {
+    RadioState& radio = state();
+    bool crcError = radio.crcError;
+    size_t length = radio.rxDone ? std::min(len, radio.rxBuffer.size()) : 0;
+    if (length) memcpy(data, radio.rxBuffer.data(), length);
+    if (!radio.rxDone) radio.rxBuffer.clear();
+    clearIrq(radio);
+    return crcError ? RADIOLIB_ERR_CRC_MISMATCH : RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::readData(String& str, size_t len) {
+    RadioState& radio = state();
+    size_t length = len ? len : (radio.rxDone ? radio.rxBuffer.size() : 0);
+    uint8_t buffer[RADIOLIB_SX126X_MAX_PACKET_LENGTH + 1] = {0};
+    int16_t result = readData(buffer, std::min(length, (size_t)RADIOLIB_SX126X_MAX_PACKET_LENGTH));
+    str = result == RADIOLIB_ERR_NONE ? String((const char*)buffer, getPacketLength()) : String();
+    return result;
+}
+
+size_t SX1262::getPacketLength(bool update) {
+    (void)update;
+    return state().rxBuffer.size();
+}
+
+int16_t SX1262::standby() {
+    RadioState& radio = state();
+    radio.mode = RadioState::STANDBY;
+    radio.lock = nullptr;
+    return RADIOLIB_ERR_NONE;
+}
+
+int16_t SX1262::sleep(bool retainConfig) {
+    (void)retainConfig;
+    return standby();
+}
+
+float SX1262::getRSSI() {
+    return state().lastRssi;
+}
+
+float SX1262::getSNR() {
+    return state().lastSnr;
+}
+
+uint32_t SX1262::getTimeOnAir(size_t len) {
+    return (uint32_t)Channel::airtime(state(), len);
+}
+
+void SX1262::setDio1Action(void (*func)(void)) {
+    state().dio1Action = func;
+}
+
+void SX1262::clearDio1Action() {
+    state().dio1Action = nullptr;
+}
@@ -0,0 +1,131 @@
+#include <WString.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+static std::string toBase(unsigned long long value, unsigned char base, bool negative) {
+    if (base < 2 || base > 36) base = 10;
+    std::string digits;
+    do {
+        int digit = value % base;
+        digits += (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value);
+    if (negative) digits += '-';
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+static std::string fromSigned(long long value, unsigned char base) {
+    // Comme Arduino : seule la base 10 affiche un signe, les autres bases montrent le complément à deux
+    if (base == 10 && value < 0) return toBase(0ULL - (unsigned long long)value, base, true);
+    return toBase((unsigned long long)value, base, false);
+}
+
+static std::string fromDouble(double value, unsigned int decimalPlaces) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", (int)decimalPlaces, value);
+    return buffer;
+}
+
+String::String(unsigned char number, unsigned char base) : value(toBase(number, base, false)) {}
+String::String(int number, unsigned char base)
+    : value(base == 10 ? fromSigned(number, base) : toBase((unsigned int)number, base, false)) {}
+String::String(unsigned int number, unsigned char base) : value(toBase(number, base, false)) {}
+String::String(long number, unsigned char base)
+    : value(base == 10 ? fromSigned(number, base) : toBase((unsigned long)number, base, false)) {}
+String::String(unsigned long number, unsigned char base) : value(toBase(number, base, false)) {}
+String::String(long long number, unsigned char base) : value(fromSigned(number, base)) {}
+String::String(unsigned long long number, unsigned char base) : value(toBase(number, base, false)) {}
+String::String(float number, unsigned int decimalPlaces) : value(fromDouble(number, decimalPlaces)) {}
+String::String(double number, unsigned int decimalPlaces) : value(fromDouble(number, decimalPlaces)) {}
+
+bool String::endsWith(const String& suffix) const {
+    return value.length() >= suffix.value.length() &&
+           value.compare(value.length() - suffix.value.length(), suffix.value.length(), suffix.value) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t found = value.find(c, from);
+    return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::indexOf(const String& str, unsigned int from) const {
+    size_t found = value.find(str.value, from);
+    return found == std::string::npos ? -1 : (int)found;
+}
+
+int String::lastIndexOf(char c) const {
+    size_t found = value.rfind(c);
+    return found == std::string::npos ? -1 : (int)found;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= value.length()) return String();
+    to = std::min<unsigned int>(to, value.length());
+    String result;
+    result.value = value.substr(from, to - from);
+    return result;
+}
+
+void String::getBytes(unsigned char* buffer, unsigned int size, unsigned int index) const {
+    if (!buffer || size == 0) return;
+    if (index >= value.length()) {
+        buffer[0] = 0;
+        return;
+    }
+    unsigned int count = std::min<unsigned int>(size - 1, value.length() - index);
+    memcpy(buffer, value.data() + index, count);
+    buffer[count] = 0;
+}
+
+void String::replace(const String& find, const String& replacement) {
+    if (find.value.empty()) return;
+    size_t position = 0;
+    while ((position = value.find(find.value, position)) != std::string::npos) {
+        value.replace(position, find.value.length(), replacement.value);
+        position += replacement.value.length();
+    }
+}
+
+void String::trim() {
+    size_t begin = 0;
+    while (begin < value.length() && isspace((unsigned char)value[begin])) begin++;
+    size_t end = value.length();
+    while (end > begin && isspace((unsigned char)value[end - 1])) end--;
+    value = value.substr(begin, end - begin);
+}
+
+void String::toUpperCase() {
+    for (char& c : value) c = toupper((unsigned char)c);
+}
+
+void String::toLowerCase() {
+    for (char& c : value) c = tolower((unsigned char)c);
+}
+
+StringSumHelper operator+(const String& lhs, const String& rhs) {
+    StringSumHelper result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+StringSumHelper operator+(const String& lhs, const char* rhs) {
+    StringSumHelper result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+StringSumHelper operator+(const char* lhs, const String& rhs) {
+    StringSumHelper result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+StringSumHelper operator+(const String& lhs, char rhs) {
+    StringSumHelper result(lhs);
+    result.concat(rhs);
+    return result;
+}